@@ -3,15 +3,47 @@
 #ifndef HunterRoam_h
 #define HunterRoam_h
 
-#include <vector>
 #include <Arduino.h>
+#include "hunter_encoder.h"
 
 #define START_INTERVAL 900
 #define SHORT_INTERVAL 208
 #define LONG_INTERVAL 1875
+#define RESET_PULSE_MS 325
+#define RESET_GAP_MS 65
+
+// Reset and start pulses, 15 bytes of 2 pulses per bit, extra bit and stop bit
+#define HUNTER_MAX_PULSES 256
 
 #define HUNTER_PIN 12 // D0
 
+// Bit-banged frames are timed as they go out and sent again when a pulse
+// drifts further than this from its nominal width
+#define HUNTER_JITTER_TOLERANCE 10 // percent
+#define HUNTER_MAX_RETRIES 2
+
+// One bus level held for a number of microseconds
+struct HunterPulse {
+    uint32_t level : 1;
+    uint32_t micros : 31;
+};
+
+// A command rendered to bus timings, ready to be played out
+struct HunterFrame {
+    HunterPulse pulses[HUNTER_MAX_PULSES];
+    uint16_t count;
+};
+
+// Pulse timing of bit-banged frames, measured with the CPU cycle counter
+struct HunterJitterStats {
+    uint32_t frames;            // Frames sent with timing measurement
+    uint32_t retransmits;       // Repeats after a frame was out of tolerance
+    uint32_t failures;          // Commands still out of tolerance after all retries
+    uint8_t lastDeviation;      // Worst pulse deviation of the last frame, in percent
+    uint8_t maxDeviation;       // Worst pulse deviation since boot, in percent
+    uint32_t maxStretchMicros;  // Longest overrun of a bit pulse since boot
+};
+
 class HunterRoam {
     public:
         HunterRoam(int pin);
@@ -20,12 +52,33 @@ class HunterRoam {
         byte startProgram(byte num);
         String errorHint(byte error);
 
+        // Render a command to a timing table without touching the bus
+        byte renderZone(byte zone, byte time, HunterFrame &frame);
+        byte renderProgram(byte num, HunterFrame &frame);
+
+        // Play a rendered frame by bit-banging the pin (blocks until done);
+        // measured receives the pulse widths that actually went out
+        void playFrame(const HunterFrame &frame, HunterFrame *measured = nullptr);
+
+        // Play a frame, check its measured timing and repeat it when a
+        // pulse was out of tolerance (0 or error 6)
+        byte transmitFrame(const HunterFrame &frame);
+        const HunterJitterStats &getJitterStats() const { return _jitter; }
+
+        // Record played frames into a timeline instead of driving the pin, with
+        // no delays (nullptr to go back to the bus). Adjacent equal levels are
+        // merged, as they would be on the wire.
+        void setRecorder(HunterFrame *timeline) { _recorder = timeline; }
+
     private:
         int _pin;
-        void hunterBitfield(std::vector <byte> &bits, byte pos, byte val, byte len);
-        void writeBus(std::vector<byte> buffer, bool extrabit);
-        void sendLow(void);
-        void sendHigh(void);
+        HunterFrame *_recorder = nullptr;
+        HunterFrame _measured;
+        HunterJitterStats _jitter = {};
+        void renderBus(const byte *buffer, size_t length, bool extrabit, HunterFrame &frame);
+        void addPulse(HunterFrame &frame, byte level, uint32_t micros);
+        void addLow(HunterFrame &frame);
+        void addHigh(HunterFrame &frame);
 };
 
 #endif
\ No newline at end of file
@@ -3,11 +3,14 @@
 
 #include <Arduino.h>
 #include <Preferences.h>
+#include "hunter_zones.h"
 
 // Forward declaration
 class RTCModule;
 
-// Configuration structure
+// Configuration structure, stored in NVS as one blob whose size must match.
+// Do not add fields here: settings added later get their own preferences key
+// (see ConfigManager::loadSettingKeys) so existing units keep their config.
 struct SystemConfig {
     // Timezone settings
     int timezoneOffset;     // Timezone offset in half-hours from UTC (-24 to +28, where 19 = +9:30)
@@ -46,7 +49,7 @@ struct SystemConfig {
     // Irrigation settings
     bool enableScheduling;
     int maxZoneRunTime;     // Maximum run time in minutes
-    int maxEnabledZones;    // Maximum number of enabled zones (1-16)
+    int maxEnabledZones;    // Maximum number of enabled zones per bus (1-16)
     bool pumpSafetyMode;    // Turn off pump when no zones active
 
     // System settings
@@ -57,6 +60,8 @@ struct SystemConfig {
 class ConfigManager {
 private:
     SystemConfig config;
+    float supplyCapacityLpm; // Supply line capacity in L/min (0 = fixed 2-zone limit), key "supply_lpm"
+    int missedFireGraceMinutes; // Start missed fire times this late after a stall (0 = skip them), key "fire_grace"
     RTCModule* rtcModule;
     Preferences preferences; // ESP32 NVS storage
     bool configLoaded;
@@ -69,6 +74,7 @@ private:
     // Storage methods (uses ESP32 NVS)
     bool saveToNVS();
     bool loadFromNVS();
+    void loadSettingKeys();
 
 public:
     ConfigManager();
@@ -111,6 +117,10 @@ public:
     void setMaxEnabledZones(int zones);
     bool isPumpSafetyMode() const { return config.pumpSafetyMode; }
     void setPumpSafetyMode(bool enabled);
+    float getSupplyCapacityLpm() const { return supplyCapacityLpm; }
+    void setSupplyCapacityLpm(float lpm);
+    int getMissedFireGraceMinutes() const { return missedFireGraceMinutes; }
+    void setMissedFireGraceMinutes(int minutes);
 
     // Zone validation
     bool isZoneEnabled(int zone) const;
@@ -0,0 +1,70 @@
+#ifndef EVENT_JOURNAL_H
+#define EVENT_JOURNAL_H
+
+#include <Arduino.h>
+#include <FS.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+
+// Append-only journal of records waiting to be uploaded (the pending event
+// completions). Records are framed in one SPIFFS file; a second file holds
+// the offset up to which the server has acknowledged them, so uploads go out
+// in bounded batches and each acknowledged batch is released on its own.
+// Safe to use from both the main loop and the HTTP worker task.
+//
+// Frame: 'E', payload length (2 bytes, little endian), CRC-8 of the payload,
+// payload. A frame cut off by a reset is dropped when the journal is opened.
+class EventJournal {
+public:
+    static const uint16_t MAX_RECORD = 1024;
+    static const uint32_t MAX_BYTES = 131072;       // Appends fail beyond this
+
+    EventJournal(const char* journalPath, const char* ackPath, const char* tempPath);
+
+    // Open the journal on a mounted SPIFFS: read the acknowledge offset and
+    // count the records after it (the only scan of the file)
+    bool begin();
+
+    bool append(const String& record);
+
+    // Append up to maxRecords unacknowledged records to out, comma separated,
+    // stopping before maxBytes (at least one record is taken). endOffset,
+    // consumed and generation are what to pass to acknowledge(); corrupt
+    // records are consumed but not copied. Returns the number of records copied.
+    uint16_t readBatch(String& out, uint16_t maxRecords, size_t maxBytes, uint32_t& endOffset, uint16_t& consumed,
+                       uint32_t& generation);
+
+    // Release the records up to endOffset, once the server has taken them.
+    // Fails if the file was rewritten since the batch was read, as its
+    // offsets no longer apply; the records are then sent again.
+    bool acknowledge(uint32_t endOffset, uint16_t records, uint32_t generation);
+
+    uint32_t getPendingCount() const { return pendingCount; }
+    uint32_t getSize() const { return journalSize; }
+    uint32_t getAckOffset() const { return ackOffset; }
+
+private:
+    static const uint8_t FRAME_MAGIC = 'E';
+    static const uint8_t HEADER_SIZE = 4;
+    static const uint32_t COMPACT_BYTES = 16384;    // Acknowledged bytes that trigger a rewrite
+
+    const char* path;
+    const char* ackPath;
+    const char* tempPath;
+    SemaphoreHandle_t lock;
+    bool ready;
+    uint32_t journalSize;
+    uint32_t ackOffset;
+    uint32_t pendingCount;
+    uint32_t generation;        // Bumped whenever offsets move (rewrite or reset)
+
+    uint32_t countRecords(File& file, uint32_t from, uint32_t& validEnd, bool& onBoundary);
+    bool readHeader(File& file, uint16_t& length, uint8_t& crc);
+    bool saveAckOffset(uint32_t offset);
+    uint32_t loadAckOffset();
+    bool compact(uint32_t validEnd);
+    void reset();
+    static uint8_t crc8(uint8_t crc, uint8_t data);
+};
+
+#endif // EVENT_JOURNAL_H
@@ -6,6 +6,8 @@
 #include <SPIFFS.h>
 #include <ArduinoJson.h>
 #include <time.h>
+#include "hunter_zones.h"
+#include "schedule_manager.h"
 
 // Event types
 enum class EventType {
@@ -17,6 +19,7 @@ enum class EventType {
 
 // Single watering event record
 struct WateringEvent {
+    uint32_t eventId;        // Local event ID (matches "id" in the log)
     time_t startTime;        // Unix timestamp when watering started
     time_t endTime;          // Unix timestamp when watering ended (0 if still running)
     uint8_t zoneId;          // Zone number (1-based)
@@ -24,6 +27,7 @@ struct WateringEvent {
     uint16_t actualDurationSec; // Actual duration in seconds
     EventType eventType;     // Manual, scheduled, or system
     uint32_t scheduleId;     // Schedule ID if scheduled event (0 for manual)
+    uint32_t serverId;       // Server-side schedule ID (0 for manual/local)
     bool completed;          // True if completed normally, false if interrupted
 };
 
@@ -35,11 +39,14 @@ public:
     bool begin();
 
     // Log a new watering event start
-    uint32_t logEventStart(uint8_t zoneId, uint16_t durationMin, EventType type, uint32_t scheduleId = 0);
+    uint32_t logEventStart(uint8_t zoneId, uint16_t durationMin, EventType type, uint32_t scheduleId = 0, uint32_t serverId = 0);
 
-    // Log watering event completion
+    // Log watering event completion (eventId 0 = first running event)
     bool logEventEnd(uint32_t eventId, bool completed = true);
 
+    // Event ID of the running event for a zone (0 if none)
+    uint32_t getActiveEventId(uint8_t zoneId) const;
+
     // Retrieve events
     String getEventsJson(int limit = 100, time_t startDate = 0, time_t endDate = 0);
     int getEventCount(time_t startDate = 0, time_t endDate = 0);
@@ -57,9 +64,10 @@ private:
     static const char* LOG_FILE;
     static const int MAX_EVENTS_IN_MEMORY = 1000;
     static const int MAX_FILE_SIZE = 512000; // ~500KB max file size
+    static const int MAX_CURRENT_EVENTS = ScheduleManager::getMaxActiveZones(); // One per running zone
 
     uint32_t nextEventId;
-    WateringEvent currentEvents[4]; // Track up to 4 concurrent events (one per zone)
+    WateringEvent currentEvents[MAX_CURRENT_EVENTS]; // Open events of the running zones
 
     // File operations
     bool loadEvents();
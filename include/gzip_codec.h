@@ -0,0 +1,60 @@
+#ifndef GZIP_CODEC_H
+#define GZIP_CODEC_H
+
+#include <Arduino.h>
+#include <esp32/rom/miniz.h>
+
+// Streaming gzip decoder for server responses, on the inflate code in the
+// ESP32 ROM. The server picks the deflate window, so the full 32 KB
+// dictionary (plus ~11 KB of decoder tables) is taken from the heap while a
+// response is read, and freed with the inflater.
+class GzipInflater {
+public:
+    static const size_t DICT_SIZE = TINFL_LZ_DICT_SIZE;
+
+    GzipInflater();
+    ~GzipInflater();
+
+    // Enough heap to inflate a response; checked before asking for gzip
+    static bool canAllocate();
+
+    bool begin();
+
+    // Decode from in; inLength is set to the bytes taken. out/outLength get
+    // the next piece of output, valid until the next call (it may be empty
+    // while the header is read). False once the stream is found corrupt.
+    bool inflate(const uint8_t* in, size_t& inLength, const uint8_t*& out, size_t& outLength);
+
+    bool hasMoreOutput() const { return state == GZIP_BODY && moreOutput; }
+    bool isDone() const { return state == GZIP_DONE; }
+    size_t getOutputSize() const { return outputSize; }
+
+private:
+    enum State { GZIP_HEADER, GZIP_BODY, GZIP_TRAILER, GZIP_DONE, GZIP_ERROR };
+    static const size_t HEAP_MARGIN = 16384;    // Left for everything else while inflating
+
+    State state;
+    tinfl_decompressor* decompressor;
+    uint8_t* dict;
+    size_t dictPos;
+    bool moreOutput;
+    uint32_t crc;
+    uint32_t outputSize;
+
+    uint8_t fixed[10];          // Fixed part of the header, then the 8-byte trailer
+    uint8_t fixedPos;
+    uint8_t flags;              // Optional header fields still to skip
+    uint16_t skip;              // Bytes left of the extra field (or header CRC)
+    uint8_t lengthPos;          // Bytes read of the extra field length
+
+    bool headerByte(uint8_t c);
+    void takeLookAhead();
+};
+
+// Compress data into a gzip member with fixed Huffman codes and a 4 KB
+// match window, for request bodies. Needs 2 KB of heap and no tables.
+// Returns the compressed size, or 0 if it doesn't fit into outSize (or
+// the input is over 64 KB).
+size_t gzipCompress(const uint8_t* data, size_t length, uint8_t* out, size_t outSize);
+
+#endif // GZIP_CODEC_H
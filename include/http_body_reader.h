@@ -0,0 +1,61 @@
+#ifndef HTTP_BODY_READER_H
+#define HTTP_BODY_READER_H
+
+#include <Arduino.h>
+#include <FS.h>
+#include "gzip_codec.h"
+
+// Reads an HTTP response body straight off the socket for deserializeJson()
+// (which only needs read() and readBytes()), so a response is parsed as it
+// arrives instead of being buffered in a String first. Undoes chunked
+// transfer encoding, stops at Content-Length, inflates a gzip content
+// encoding, and can copy the (decoded) body into a file on the way (the
+// SPIFFS schedule cache).
+class HttpBodyReader {
+public:
+    // contentLength < 0: unknown, read until the connection closes
+    HttpBodyReader(Stream& source, int contentLength, bool chunked, File* copyTo = nullptr, bool gzip = false);
+
+    int read();
+    size_t readBytes(char* buffer, size_t length);
+
+    // Read and drop whatever the parser left, so a kept-alive connection
+    // ends up at the start of the next response. False if the body was cut off.
+    bool skipRest();
+
+    bool isComplete() const;
+    size_t getBytesRead() const { return bytesRead; }       // Off the wire
+    size_t getDecodedBytes() const { return gzip ? inflater.getOutputSize() : bytesRead; }
+    bool copyFailed() const { return copyError; }
+    bool decodeFailed() const { return decodeError; }
+
+private:
+    static const size_t BUFFER_SIZE = 256;
+    static const size_t MAX_LINE = 24;      // Chunk size line, extensions are dropped
+
+    Stream& stream;
+    File* copy;
+    int remaining;          // Left in the body or current chunk, -1 = unknown
+    bool chunked;
+    bool firstChunk;
+    bool lastChunk;
+    bool ended;
+    bool copyError;
+    bool gzip;
+    bool decodeError;
+    GzipInflater inflater;
+    char buffer[BUFFER_SIZE];   // Body bytes as received
+    size_t rawLength;
+    size_t rawPos;
+    const char* data;           // Bytes handed out: the buffer, or inflated output
+    size_t bufferLength;
+    size_t bufferPos;
+    size_t bytesRead;
+
+    bool fill();
+    bool fillRaw();
+    bool nextChunk();
+    bool readLine(char* line, size_t size);
+};
+
+#endif // HTTP_BODY_READER_H
@@ -4,6 +4,14 @@
 #include <Arduino.h>
 #include <HTTPClient.h>
 #include <ArduinoJson.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/task.h>
+#include <freertos/semphr.h>
+#include <FS.h>
+#include "hunter_zones.h"
+#include "event_journal.h"
+#include "schedule_snapshot.h"
 
 // Forward declarations
 class ConfigManager;
@@ -35,6 +43,131 @@ struct EventCompletion {
     String notes;             // Optional notes
 };
 
+// Details of one zone from the server
+struct ZoneDetail {
+    uint32_t databaseId;
+    float waterRateLpm;
+    uint16_t nameOffset;        // Into the table's name arena (0 = no name)
+    uint8_t loaded;
+    uint8_t active;
+};
+
+// Zone details from the server, indexed by zone number. One flat block:
+// names are interned into a fixed arena, so a table holds no Strings and
+// is copied with a plain assignment.
+struct ZoneDetailsTable {
+    static const uint8_t MAX_NAME = 31;                         // Longer names are cut (and counted)
+    static const uint16_t NAME_ARENA = HUNTER_MAX_ZONE * 24;
+
+    ZoneDetail zones[HUNTER_MAX_ZONE + 1];
+    char names[NAME_ARENA];
+    uint16_t namesUsed;
+    uint8_t count;
+    uint8_t namesCut;           // Names longer than MAX_NAME
+    uint32_t hash;              // Of the content, 0 = empty (set by seal())
+
+    ZoneDetailsTable() { clear(); }
+    void clear();
+    void set(uint8_t zoneId, const char* name, bool active, float waterRateLpm, uint32_t databaseId);
+    void seal();
+    bool has(uint8_t zoneId) const { return zoneId <= HUNTER_MAX_ZONE && zones[zoneId].loaded; }
+    const char* name(uint8_t zoneId) const { return names + zones[zoneId].nameOffset; }
+};
+
+// Server endpoints, each with its own circuit breaker
+enum HttpEndpoint {
+    HTTP_ENDPOINT_SCHEDULES = 0,    // /api/schedules/...
+    HTTP_ENDPOINT_ZONE_DETAILS,     // /api/zonedetails
+    HTTP_ENDPOINT_EVENTS,           // /api/events/... (completions, starts, sync)
+    HTTP_ENDPOINT_SYSTEM,           // Anything else (connection test)
+    HTTP_ENDPOINT_COUNT
+};
+
+enum BreakerState {
+    BREAKER_CLOSED = 0,     // Calls go through
+    BREAKER_OPEN,           // Calls fail at once until the cooldown ends
+    BREAKER_HALF_OPEN       // Cooldown over, one probe call (single attempt) decides
+};
+
+// Circuit breaker of one endpoint. It opens after BREAKER_THRESHOLD failed
+// calls in a row (or a Retry-After from the server), and its cooldown
+// doubles on every trip until a call succeeds.
+struct CircuitBreaker {
+    BreakerState state;
+    uint8_t failures;           // Failed calls in a row
+    uint8_t trips;              // Times opened since it last closed
+    uint32_t openedAt;
+    uint32_t openMs;            // Cooldown of the current open period
+    uint32_t rejected;          // Calls failed fast while open
+    int lastCode;               // Status of the last call (<= 0 = connection error)
+};
+
+// Validators of a resource from its last 200 response, for conditional GETs
+struct HttpValidator {
+    uint32_t urlHash;           // 0 = free slot
+    String etag;
+    String lastModified;
+    uint8_t days;               // Schedules: days the stored response covered
+    uint16_t events;            // Schedules: AI events it loaded into that window
+    uint32_t usedAt;            // Millis of last use, the oldest is replaced
+};
+
+// Server revision a schedule table was built from, for delta syncs
+struct ScheduleRevision {
+    uint32_t revision;          // 0 = unknown, the next fetch loads the whole horizon
+    char horizonEnd[11];        // Last date ("YYYY-MM-DD") whose events are all loaded
+};
+
+// Requests run by the HTTP worker task
+enum HttpJobType {
+    HTTP_JOB_FETCH_SCHEDULE = 0,
+    HTTP_JOB_FETCH_ZONE_DETAILS = 1,
+    HTTP_JOB_REPORT_COMPLETION = 2,
+    HTTP_JOB_TEST_CONNECTION = 3
+};
+
+enum HttpJobStatus {
+    HTTP_JOB_OK = 0,
+    HTTP_JOB_FAILED = 1,
+    HTTP_JOB_CANCELLED = 2,
+    HTTP_JOB_EXPIRED = 3        // Deadline passed before or while it ran
+};
+
+// Queued request (plain data, copied into the FreeRTOS queue)
+struct HttpJob {
+    uint32_t id;
+    HttpJobType type;
+    uint32_t queuedAt;          // Millis when queued
+    uint32_t deadline;          // Millis by which it has to be done
+    ScheduleManager* shadow;    // Schedule fetch: snapshot of the table to fill
+    ScheduleRevision base;      // Schedule fetch: revision of the snapshot's AI schedules
+    uint8_t days;               // Schedule fetch: days to fetch
+    int8_t zoneId;              // Schedule fetch: zone filter (-1 = all), completion: zone
+    uint32_t clearGeneration;   // Schedule fetch: AI schedule clears seen when queued
+    uint32_t scheduleId;        // Completion: server schedule ID
+    float durationMin;          // Completion: minutes run
+    float waterUsed;            // Completion: liters
+    uint32_t endTime;           // Completion: unix time the run ended
+    char status[12];            // Completion: "completed", "failed", "cancelled"
+};
+
+// Outcome of a request, handed back to the main loop
+struct HttpJobResult {
+    uint32_t id;
+    HttpJobType type;
+    HttpJobStatus status;
+    uint32_t elapsedMs;         // From queueing to completion
+    ScheduleManager* shadow;    // Schedule fetch: filled table, committed on the loop
+    int daysLoaded;             // Schedule fetch: days in the shadow (server or cache)
+    ScheduleRevision revision;  // Schedule fetch: revision of the filled shadow
+    uint32_t clearGeneration;   // Schedule fetch: copied from the job
+    bool delta;                 // Schedule fetch: only the changes since the base were applied
+    uint8_t requests;           // Schedule fetch: HTTP requests made
+    uint8_t notModified;        // Requests answered 304, nothing was re-parsed
+    ZoneDetailsTable* zones;    // Zone details fetch: changed table, applied on the loop (null if unchanged)
+    char error[96];
+};
+
 class HTTPScheduleClient {
 private:
     ConfigManager* configManager;
@@ -46,33 +179,173 @@ private:
 
     // HTTP configuration
     static const int HTTP_TIMEOUT = 10000;      // 10 second timeout (cross-subnet)
-    static const int MAX_RETRIES = 3;           // Retry failed requests
-    static const int RETRY_DELAY = 2000;        // 2 seconds between retries
+    static const int MAX_RETRIES = 3;           // Attempts per call
+    static const size_t MAX_ERROR_BODY = 256;   // Kept of an error response for lastError
+    static const size_t MAX_STRING_BODY = 8192; // Read by executeRequest()
+
+    // Shared retry policy: attempts of one call wait a random time between
+    // 0 and BACKOFF_BASE_MS * 2^attempt (full jitter, capped), or what the
+    // server's Retry-After asks for. Waits longer than MAX_INLINE_WAIT_MS
+    // are left to the circuit breaker instead of blocking the call.
+    static const uint32_t BACKOFF_BASE_MS = 1000;
+    static const uint32_t BACKOFF_MAX_MS = 8000;
+    static const uint32_t MAX_INLINE_WAIT_MS = 10000;
+    static const uint8_t BREAKER_THRESHOLD = 3;             // Failed calls in a row that open it
+    static const uint32_t BREAKER_OPEN_MS = 30000;          // First cooldown, doubled per trip
+    static const uint32_t BREAKER_MAX_OPEN_MS = 600000;     // Cooldown cap (10 minutes)
+    static const uint32_t MAX_RETRY_AFTER_MS = 3600000;     // Longest Retry-After honoured
+    CircuitBreaker breakers[HTTP_ENDPOINT_COUNT];
+
+    // One kept-alive HTTP/1.1 connection to the server, reused by every GET
+    // and POST. Idle connections are closed after KEEP_ALIVE_IDLE_MS; one
+    // the server closed is reopened on the next request.
+    static const uint32_t KEEP_ALIVE_IDLE_MS = 65000;  // Outlasts the 60 s zone details poll
+    unsigned long lastRequestAt;
+    volatile uint32_t connectionsOpened;
+    volatile uint32_t connectionsReused;
+    volatile uint32_t connectionsDropped;    // Kept-alive connections the server had closed
+
+    // Conditional GETs: validators of the last good response per URL. A 304
+    // skips parsing, the cache rebuild and the SPIFFS write.
+    static const uint8_t MAX_VALIDATORS = 8;
+    HttpValidator validators[MAX_VALIDATORS];
+    String responseEtag;            // Validators of the last 200 response
+    String responseLastModified;
+    volatile uint32_t notModifiedCount;
+    bool lastNotModified;           // Last GET was answered with 304
+
+    // gzip both ways: GETs ask for gzip while there is heap to inflate it,
+    // and POST bodies of GZIP_MIN_PAYLOAD bytes or more go out compressed
+    // unless the server turned a compressed body down
+    static const size_t GZIP_MIN_PAYLOAD = 512;
+    bool gzipUploads;
+    volatile uint32_t gzipResponses;
+    volatile uint32_t gzipResponseBytes;    // As received
+    volatile uint32_t gzipInflatedBytes;
+    volatile uint32_t gzipUploadCount;
+    volatile uint32_t gzipUploadBytes;      // As sent
+    volatile uint32_t gzipUploadPlainBytes;
+
+    // Responses are parsed straight off the socket through these filters,
+    // keeping only the fields the parsers read
+    JsonDocument scheduleFilter;
+    JsonDocument zoneDetailsFilter;
+    void buildFilters();
 
     // Helper methods
-    String buildScheduleUrl(const String& date, int8_t zoneId = -1);  // Build URL with date parameter
+    String buildScheduleUrl(const String& date, int8_t zoneId = -1, int days = 1);  // Build URL with date (and range) parameter
     String buildZoneDetailsUrl();
     String buildCompletionUrl();
     String buildEventStartUrl();
     String buildEventSyncUrl();
-    bool parseScheduleResponse(const String& json, int expectedDays = 1);
-    bool parse5DayScheduleResponse(const String& json);
-    bool parseZoneDetailsResponse(const String& json);
+    bool parseScheduleResponse(JsonDocument& doc, ScheduleManager* target, int expectedDays = 1, int* daysReturned = nullptr);
+    bool parse5DayScheduleResponse(JsonDocument& doc, ScheduleManager* target);
+    bool getDateScope(const String& date, uint8_t& dayMask, uint32_t& dayEndUtc);
+    bool commitShadow(ScheduleManager* shadow, int daysLoaded, const ScheduleRevision* revision = nullptr);
+    bool parseZoneDetailsResponse(JsonDocument& doc, ZoneDetailsTable& out);
+    bool requestZoneDetails(ZoneDetailsTable& out);
+    void applyZoneDetails(ZoneDetailsTable* details);
+    void renderZoneDetailsJSON();
+    int loadSchedule(int days, int8_t zoneId, ScheduleManager* shadow, const ScheduleRevision& base);
+    uint32_t addServerEvent(ScheduleManager* target, uint8_t zoneId, JsonObject event, uint8_t dayMask,
+                            uint32_t dayEndUtc, const String& date);
     String createCompletionPayload(const EventCompletion& completion);
+    String createPendingEventRecord(const EventCompletion& completion);
+    void importLegacyPendingEvents();
+    EventCompletion buildCompletion(uint32_t scheduleId, uint8_t zoneId, float durationMin, float waterUsed,
+                                    const String& status, time_t endTime);
     String createEventStartPayload(uint32_t scheduleId, uint8_t zoneId, const String& startTime);
-    bool executeRequest(const String& url, String& response);
+    int sendRequest(const String& url, const String* payload, const HttpValidator* validator = nullptr,
+                    const uint8_t* gzipBody = nullptr, size_t gzipLength = 0);
+    void closeConnection();
+    void closeIdleConnection();
+    bool openRequest(const String& url, bool conditional = false);
+    bool executeRequest(const String& url, String& response, bool conditional = false);
+    bool readJsonResponse(JsonDocument& doc, const JsonDocument& filter, File* copyTo = nullptr);
+    String readResponseString(size_t maxLength);
+    bool readJsonFile(const String& path, JsonDocument& doc);
+    File beginCacheFile(const String& date);
+    void endCacheFile(const String& date, File& file, bool keep);
+    static uint32_t hashUrl(const String& url);
+    HttpValidator* findValidator(const String& url);
+    void saveValidator(const String& url, uint8_t days = 0, uint16_t events = 0);
+    void forgetValidator(const String& url);
+    bool scheduleUnchanged(const String& url, const String& firstDate, ScheduleManager* shadow);
+    uint16_t countAIEvents(ScheduleManager* table, const String& firstDate, uint8_t days);
+    int fetchScheduleRange(const String& firstDate, int days, int8_t zoneId, ScheduleManager* shadow);
+    void clearUnlistedDays(JsonObject data, const String& firstDate, int days, ScheduleManager* shadow);
+    int fetchScheduleDelta(const String* dates, int days, const ScheduleRevision& base, ScheduleManager* shadow);
+    bool applyScheduleChanges(JsonArray changes, ScheduleManager* shadow);
+    int fetchScheduleDays(const String* dates, int days, int8_t zoneId, ScheduleManager* shadow, int& daysFromCache);
     bool executePostRequest(const String& url, const String& payload, String& response);
+    bool postWithRetries(const String& url, const String& payload, const uint8_t* gzipBody, size_t gzipLength,
+                         String& response);
+    static HttpEndpoint endpointFor(const String& url);
+    bool breakerAllows(HttpEndpoint endpoint);
+    void breakerResult(HttpEndpoint endpoint, bool serverOk, int httpCode, uint32_t retryAfterMs = 0);
+    bool waitBeforeRetry(uint8_t attempt, uint32_t retryAfterMs);
+    uint32_t readRetryAfter();
+
+    // Completions not yet on the server, uploaded by syncPendingEvents() in
+    // batches of up to SYNC_BATCH_EVENTS; each batch the server takes is
+    // acknowledged in the journal
+    static const uint16_t SYNC_BATCH_EVENTS = 20;
+    static const size_t SYNC_BATCH_BYTES = 4096;
+    EventJournal pendingEvents;
 
-    // Zone details cache (keyed by ESP32-facing zone_id/device_zone_number)
-    static const uint8_t MAX_ZONE_ID = 48;
-    bool zoneHasData[MAX_ZONE_ID + 1];
-    String zoneNames[MAX_ZONE_ID + 1];
-    bool zoneActive[MAX_ZONE_ID + 1];
-    float zoneWaterRateLpm[MAX_ZONE_ID + 1];
-    uint32_t zoneDatabaseId[MAX_ZONE_ID + 1];
-    uint8_t zoneDetailsCount;
+    // AI schedules last made live, restored at boot and when offline. The
+    // worker restores it when a fetch falls back to the cache, so every use
+    // holds snapshotLock.
+    ScheduleSnapshot scheduleSnapshot;
+    SemaphoreHandle_t snapshotLock;
+    void lockSnapshot();
+    void unlockSnapshot();
+
+    // Bumped when the AI schedules are cleared; a fetch queued before that
+    // is discarded instead of bringing them back
+    uint32_t aiClearGeneration;
+
+    // Zone details cache (keyed by ESP32-facing zone_id/device_zone_number),
+    // replaced as a whole on the main loop, and only when its content hash
+    // changed. Responses are parsed into the staging table (worker side).
+    // The zones array of getZoneDetailsJSON() is rendered once per change.
+    static const uint8_t MAX_ZONE_ID = HUNTER_MAX_ZONE;
+    ZoneDetailsTable* zoneDetails;
+    ZoneDetailsTable* zoneDetailsStaging;
+    volatile uint32_t zoneDetailsHash;
+    String zoneDetailsJson;
     unsigned long lastZoneDetailsFetchTime;
 
+    // Worker task: requests in, results out
+    static const uint8_t JOB_QUEUE_LENGTH = 8;
+    static const uint8_t RESULT_QUEUE_LENGTH = 8;
+    static const uint32_t WORKER_STACK = 8192;
+    static const uint8_t WORKER_PRIORITY = 1;       // Same as the Arduino loop task
+    static const uint8_t RECENT_RESULTS = 8;        // Kept for /api/http/jobs
+    static const uint8_t CANCEL_SLOTS = 4;
+    QueueHandle_t jobQueue;
+    QueueHandle_t resultQueue;
+    TaskHandle_t workerTask;
+    uint32_t nextJobId;
+    uint8_t pendingJobs[4];                         // Per HttpJobType, queued or running
+    volatile uint32_t activeJobId;                  // Job the worker is running (0 = none)
+    volatile uint32_t activeDeadline;
+    volatile uint32_t cancelledIds[CANCEL_SLOTS];
+    uint8_t nextCancelSlot;
+    HttpJobResult recentResults[RECENT_RESULTS];
+    uint8_t recentCount;
+    void (*resultCallback)(const HttpJobResult& result) = nullptr;
+
+    static void workerLoop(void* param);
+    uint32_t submit(HttpJob& job, uint32_t timeoutMs);
+    void runJob(const HttpJob& job, HttpJobResult& result);
+    void finishJob(HttpJobResult& result);
+    bool isCancelled(uint32_t id) const;
+    bool jobAborted();
+    uint16_t requestTimeout();
+    static const char* jobTypeName(HttpJobType type);
+    static const char* jobStatusName(HttpJobStatus status);
+
 public:
     HTTPScheduleClient();
 
@@ -89,6 +362,7 @@ public:
 
     // Zone details fetching
     bool fetchZoneDetails();
+    uint8_t getZoneDetailsCount() const { return zoneDetails->count; }
     String getZoneName(uint8_t zoneId) const;
     bool hasZoneDetails(uint8_t zoneId) const;
     String getZoneDetailsJSON() const;  // {count, last_fetch_ms, zones:[...]}
@@ -96,15 +370,17 @@ public:
 
     // SPIFFS caching for offline resilience
     bool cacheScheduleToSPIFFS(const String& date, const String& json);
-    bool loadScheduleFromCache(const String& date);
-    bool loadLatestCachedSchedule();
+    bool loadScheduleFromCache(const String& date, ScheduleManager* target = nullptr);
+    bool loadLatestCachedSchedule(ScheduleManager* target = nullptr);
     bool clearOldCache(int daysToKeep = 7);
+    bool restoreScheduleSnapshot(ScheduleManager* target = nullptr);  // No JSON parsing
+    void clearScheduleSnapshot();   // Also forgets the revision, the next fetch is a full one
 
     // Event completion reporting
     bool reportCompletion(const EventCompletion& completion);
     bool reportCompletion(uint32_t scheduleId, uint8_t zoneId,
                          float durationMin, float waterUsed,
-                         const String& status = "completed");
+                         const String& status = "completed", time_t endTime = 0);
 
     // Event start notification (immediate update when watering begins)
     bool reportEventStart(uint32_t scheduleId, uint8_t zoneId, const String& startTime);
@@ -116,17 +392,73 @@ public:
 
     // Status and diagnostics
     bool testConnection();
-    String getLastError() const { return lastError; }
+    // With the worker running, the error of the last finished request as
+    // handed over in its result; lastError itself belongs to the worker
+    String getLastError() const { return isWorkerRunning() ? String(lastResultError) : lastError; }
     unsigned long getLastFetchTime() const { return lastFetchTime; }
+    unsigned long getLastFetchDuration() const { return lastFetchDurationMs; }
+    uint8_t getLastFetchRequestCount() const { return lastFetchRequests; }
+    bool isRangeFetchSupported() const { return rangeSupported; }
+    uint32_t getScheduleRevision() const { return appliedRevision.revision; }
+
+    // Background requests. After startWorker() the network calls run on a
+    // separate task: the submit calls return a request ID at once (0 if the
+    // queue is full) and processResults(), called from the main loop, commits
+    // fetched schedules and zone details and hands each result to the result
+    // callback. Without a worker the submit calls block while the request runs.
+    // The blocking calls above are for setup() or the worker only.
+    static const uint32_t SCHEDULE_DEADLINE_MS = 120000;
+    static const uint32_t ZONE_DETAILS_DEADLINE_MS = 30000;
+    static const uint32_t COMPLETION_DEADLINE_MS = 60000;
+    static const uint32_t CONNECTION_TEST_DEADLINE_MS = 30000;
+
+    bool startWorker();
+    bool isWorkerRunning() const { return jobQueue != nullptr; }
+    uint32_t submitScheduleFetch(int days = 1, int8_t zoneId = -1, uint32_t timeoutMs = SCHEDULE_DEADLINE_MS);
+    uint32_t submitZoneDetailsFetch(uint32_t timeoutMs = ZONE_DETAILS_DEADLINE_MS);
+    uint32_t submitCompletion(uint32_t scheduleId, uint8_t zoneId, float durationMin, float waterUsed,
+                              const char* status = "completed", uint32_t timeoutMs = COMPLETION_DEADLINE_MS);
+    uint32_t submitConnectionTest(uint32_t timeoutMs = CONNECTION_TEST_DEADLINE_MS);
+    bool cancelRequest(uint32_t id);        // Queued or running; a cancelled completion is kept for sync
+    bool isRequestPending(HttpJobType type) const { return pendingJobs[type] > 0; }
+    uint8_t processResults();               // Returns the number of results handled
+    String getWorkerStatusJSON() const;     // {running, queued, active, recent:[...]}
+
+    // Called from processResults() on the main loop for every finished request
+    void setResultCallback(void (*callback)(const HttpJobResult& result));
 
     // Retry tracking
     int getConsecutiveFailures() const { return consecutiveFailures; }
     void resetFailureCount() { consecutiveFailures = 0; }
+    static uint32_t backoffDelay(uint8_t attempt, uint32_t baseMs, uint32_t capMs);  // Full jitter
+    uint32_t getRetryIn(HttpEndpoint endpoint) const;   // Ms until an open breaker lets a call through
+    String getBreakerJSON() const;          // {schedules:{state, failures, ...}, ...}
 
 private:
     String lastError;
+    char lastResultError[sizeof(HttpJobResult::error)];
     unsigned long lastFetchTime;
     int consecutiveFailures;  // Track consecutive fetch failures for retry logic
+    int lastHttpCode;         // Status of the last GET (<= 0 = connection error)
+
+    // Multi-day fetches use one range request (date + days); the server
+    // rejecting that form switches to one request per day. The range form is
+    // tried again RANGE_RETRY_MS later (the next daily fetch) or when the URL changes.
+    static const uint32_t RANGE_RETRY_MS = 43200000;   // 12 hours
+    bool rangeSupported;
+    unsigned long rangeUnsupportedAt;
+    unsigned long lastFetchDurationMs;
+    uint8_t lastFetchRequests;
+
+    // Delta sync: the live AI schedules are at appliedRevision (main loop),
+    // and a fetch asks for the changes since the revision of its shadow. The
+    // worker leaves the revision of what it loaded in fetchedRevision.
+    ScheduleRevision appliedRevision;
+    ScheduleRevision fetchedRevision;
+    uint32_t responseRevision;      // "revision" of the last schedule response (0 = none)
+    bool lastFetchDelta;
+    volatile uint32_t deltaSyncs;
+    volatile uint32_t fullResyncs;  // Delta asked for, whole horizon loaded instead
 };
 
 #endif // HTTP_CLIENT_H
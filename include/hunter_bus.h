@@ -0,0 +1,116 @@
+#ifndef HUNTER_BUS_H
+#define HUNTER_BUS_H
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/task.h>
+#include <driver/rmt.h>
+#include "HunterRoam.h"
+#include "hunter_zones.h"
+
+// Bus command kinds
+enum HunterBusCommand {
+    BUS_START_ZONE = 0,
+    BUS_STOP_ZONE = 1,
+    BUS_RUN_PROGRAM = 2
+};
+
+// Queued bus request
+struct HunterBusRequest {
+    HunterBusCommand command;
+    uint8_t bus;            // Index of the bus that sent it
+    uint8_t zone;           // Zone number on that bus (start/stop)
+    uint8_t value;          // Minutes for a start, program number for a program
+    uint32_t queuedAt;      // Millis when queued
+};
+
+// Non-blocking transmitter for the Hunter REM bus. Requests go into a bounded
+// queue serviced by a dedicated task, which renders each command to a timing
+// table and plays it out through the RMT peripheral. Callers return at once,
+// and the pulse widths are generated in hardware so interrupts and task
+// switches can't stretch them. Without RMT the task bit-bangs the frame.
+//
+// Commands already waiting in the queue when the task wakes are sent as one
+// batch: a zone command followed by a later one for the same zone is dropped,
+// and the remaining frames are queued back to back on the RMT channel so the
+// next frame is rendered while the previous one is still on the wire. The
+// task never waits for further commands, so a start goes out as soon as the
+// bus is free.
+//
+// Each X-Core unit gets its own HunterBus (own pin, RMT channel, queue and
+// task), so commands for different units go out in parallel.
+class HunterBus {
+private:
+    static const uint8_t QUEUE_LENGTH = 8;
+    static const uint8_t BATCH_SIZE = QUEUE_LENGTH;
+    static const uint32_t STOP_QUEUE_WAIT_MS = 50;  // A stop waits this long for queue space
+    static const uint32_t TASK_STACK = 4096;
+    static const uint8_t TASK_PRIORITY = 3;         // Above the Arduino loop task
+    static const uint16_t MAX_ITEM_TICKS = 32767;   // 15-bit RMT duration, 1 us per tick
+    static const uint16_t MAX_ITEMS = HUNTER_MAX_PULSES / 2 + 16; // Long pulses take several items
+
+    HunterRoam& encoder;
+    uint8_t index;
+    int pin;
+    rmt_channel_t channel;
+    bool rmtReady;
+    QueueHandle_t queue;
+    TaskHandle_t task;
+
+    // Only used by the bus task; two item buffers so one frame can be
+    // rendered while the other is being sent
+    HunterFrame frame;
+    rmt_item32_t items[2][MAX_ITEMS];
+
+    // Statistics
+    volatile uint32_t sentCount;
+    volatile uint32_t failedCount;
+    volatile uint32_t droppedCount;
+    volatile uint32_t supersededCount;  // Commands dropped because a later one replaced them
+    volatile uint32_t maxWaitMillis;    // Longest time a request sat in the queue
+
+    void (*completionCallback)(const HunterBusRequest& request, byte result) = nullptr;
+
+    static void taskLoop(void* param);
+    bool submit(HunterBusCommand command, uint8_t zone, uint8_t value, uint32_t waitMillis = 0);
+    void markSuperseded(const HunterBusRequest* batch, byte* results, uint8_t count);
+    void transmitBatch(const HunterBusRequest* batch, byte* results, uint8_t count);
+    byte renderRequest(const HunterBusRequest& request);
+    uint16_t renderItems(rmt_item32_t* out);
+
+public:
+    static const byte RESULT_SUPERSEDED = 5;    // Completion result of a dropped redundant command
+
+    HunterBus(HunterRoam& roam, uint8_t busIndex = 0);
+
+    // Initialization: set up RMT on the pin and start the bus task
+    bool begin(int busPin, rmt_channel_t rmtChannel = RMT_CHANNEL_0);
+
+    // Queue a command for a zone on this bus (1-48); false if the arguments
+    // are invalid or the queue is full. A stop waits briefly for queue space.
+    bool startZone(uint8_t zone, uint8_t minutes);
+    bool stopZone(uint8_t zone);
+    bool startProgram(uint8_t num);
+
+    // Status
+    uint8_t getIndex() const { return index; }
+    bool isRunning() const { return queue != nullptr; }
+    uint8_t getQueuedCount() const;
+    bool isUsingRMT() const { return rmtReady; }
+    uint32_t getSentCount() const { return sentCount; }
+    uint32_t getFailedCount() const { return failedCount; }
+    uint32_t getDroppedCount() const { return droppedCount; }
+    uint32_t getSupersededCount() const { return supersededCount; }
+    uint32_t getMaxWaitMillis() const { return maxWaitMillis; }
+
+    // Queue counters and the pulse timing of bit-banged frames; RMT frames
+    // are timed in hardware and are not measured
+    String getStatsJSON() const;
+
+    // Called on the bus task after each command went out (result 0 = sent,
+    // RESULT_SUPERSEDED, otherwise a HunterRoam error code); keep it short and thread-safe
+    void setCompletionCallback(void (*callback)(const HunterBusRequest& request, byte result));
+};
+
+#endif // HUNTER_BUS_H
@@ -0,0 +1,51 @@
+#ifndef HUNTER_DECODER_H
+#define HUNTER_DECODER_H
+
+#include <Arduino.h>
+#include "HunterRoam.h"
+
+// Decode result
+enum HunterDecodeStatus {
+    DECODE_OK = 0,
+    DECODE_BAD_RESET,       // Reset pulse or gap missing or out of tolerance
+    DECODE_BAD_START,       // Start pulse missing or out of tolerance
+    DECODE_BAD_PULSE,       // Bit pulse pair matches neither a 0 nor a 1
+    DECODE_BAD_LENGTH,      // Bit count is not a zone or program frame
+    DECODE_BAD_FRAME        // Bits decode, but don't re-encode to the same frame
+};
+
+// Command recovered from a bus timeline
+struct HunterDecoded {
+    HunterDecodeStatus status;
+    bool isProgram;
+    uint8_t zone;           // Zone number (zone frames)
+    uint8_t minutes;        // Run time, 0 = stop (zone frames)
+    uint8_t program;        // Program number (program frames)
+    uint16_t bitCount;      // Data bits, without the stop bit
+    uint16_t errorPulse;    // Index of the offending pulse when decoding failed
+    uint8_t maxDeviation;   // Worst pulse width deviation from nominal, in percent
+    uint32_t busMicros;     // Time the frame occupies the bus
+};
+
+// Turns a recorded bus timeline (levels and their durations) back into the
+// command it carries, checking every pulse width against the nominal timing.
+// Works on frames from HunterRoam's renderer, on timelines recorded through
+// HunterRoam::setRecorder(), or on captures from any other transmitter.
+class HunterDecoder {
+public:
+    static const uint8_t DEFAULT_TOLERANCE = 20;    // Percent either side of nominal
+
+    static HunterDecoded decode(const HunterPulse* pulses, uint16_t count,
+                                uint8_t tolerancePercent = DEFAULT_TOLERANCE);
+    static HunterDecoded decode(const HunterFrame& frame, uint8_t tolerancePercent = DEFAULT_TOLERANCE) {
+        return decode(frame.pulses, frame.count, tolerancePercent);
+    }
+    static const char* statusText(HunterDecodeStatus status);
+
+private:
+    static uint32_t deviation(const HunterPulse& pulse, uint32_t nominal);
+    static bool accept(const HunterPulse& pulse, uint32_t nominal, uint8_t tolerancePercent,
+                       HunterDecoded& result);
+};
+
+#endif // HUNTER_DECODER_H
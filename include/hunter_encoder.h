@@ -0,0 +1,159 @@
+#ifndef HUNTER_ENCODER_H
+#define HUNTER_ENCODER_H
+
+#include <array>
+#include <stddef.h>
+#include <stdint.h>
+
+// Hunter bus command encoding without heap allocation. The frame layout is a
+// table of constexpr field descriptors applied to a base frame, so fixed frames
+// (zone stops, programs) are built at compile time and zone starts are packed
+// into a std::array at run time with the same code.
+
+typedef std::array<uint8_t, 15> HunterZoneBytes;
+typedef std::array<uint8_t, 7> HunterProgramBytes;
+
+// Value a frame field is filled from
+enum HunterFieldSource : uint8_t {
+    FIELD_BANK = 0,         // 0x1 for zones > 12, 0x2 otherwise
+    FIELD_ZONE_17,          // zone + 0x17
+    FIELD_ZONE_23,          // zone + 0x23
+    FIELD_ZONE_2F,          // zone + 0x2f
+    FIELD_TIME_LOW,         // minutes (low nibble)
+    FIELD_TIME_HIGH,        // minutes >> 4
+    FIELD_ZONE_INDEX,       // zone - 1
+    FIELD_PROGRAM,          // program - 1
+    FIELD_SOURCE_COUNT
+};
+
+typedef std::array<uint8_t, FIELD_SOURCE_COUNT> HunterFieldValues;
+
+// Bit field within a frame; bit 0 is the MSB of byte 0 and values are written LSB first
+struct HunterField {
+    uint8_t pos;
+    uint8_t width;
+    HunterFieldSource source;
+};
+
+constexpr HunterZoneBytes HUNTER_ZONE_BASE = {{
+    0xff, 0x00, 0x00, 0x00, 0x10, 0x00, 0x00, 0x04, 0x00, 0x00, 0x01, 0x00, 0x01, 0xb8, 0x3f
+}};
+
+constexpr HunterProgramBytes HUNTER_PROGRAM_BASE = {{
+    0xff, 0x40, 0x03, 0x96, 0x09, 0xbd, 0x7f
+}};
+
+// Zone frame layout (the bus protocol is a little bizarre)
+constexpr HunterField HUNTER_ZONE_FIELDS[] = {
+    {9, 2, FIELD_BANK},                                                 // Bits 9:10
+    {23, 7, FIELD_ZONE_17}, {36, 7, FIELD_ZONE_17},                     // Bits 23:29 and 36:42
+    {49, 7, FIELD_ZONE_23}, {62, 7, FIELD_ZONE_23},                     // Bits 49:55 and 62:68
+    {75, 7, FIELD_ZONE_2F}, {88, 7, FIELD_ZONE_2F},                     // Bits 75:81 and 88:94
+    {31, 4, FIELD_TIME_LOW}, {57, 4, FIELD_TIME_LOW}, {83, 4, FIELD_TIME_LOW},     // Bits 31:34, 57:60, 83:86
+    {44, 4, FIELD_TIME_HIGH}, {70, 4, FIELD_TIME_HIGH}, {96, 4, FIELD_TIME_HIGH},  // Bits 44:47, 70:73, 96:99
+    {109, 4, FIELD_ZONE_INDEX}                                          // Bits 109:112
+};
+
+constexpr HunterField HUNTER_PROGRAM_FIELDS[] = {
+    {31, 2, FIELD_PROGRAM}                                              // Bits 31:32
+};
+
+// Write every field into a copy of the base frame. Bits are set with masks
+// rather than branches, so the run time does not depend on the values.
+template <size_t N, size_t F>
+constexpr std::array<uint8_t, N> hunterPackFields(std::array<uint8_t, N> bytes, const HunterField (&fields)[F],
+                                                  const HunterFieldValues& values) {
+    for (size_t f = 0; f < F; f++) {
+        uint8_t value = values[fields[f].source];
+        for (uint8_t b = 0; b < fields[f].width; b++) {
+            uint8_t pos = fields[f].pos + b;
+            uint8_t mask = 0x80 >> (pos % 8);
+            uint8_t bit = (value >> b) & 0x1;
+            bytes[pos / 8] = (uint8_t)((bytes[pos / 8] & ~mask) | ((0 - bit) & mask));
+        }
+    }
+    return bytes;
+}
+
+// Read back the value of the first field filled from the given source
+template <size_t N, size_t F>
+constexpr uint8_t hunterReadField(const std::array<uint8_t, N>& bytes, const HunterField (&fields)[F],
+                                  HunterFieldSource source) {
+    for (size_t f = 0; f < F; f++) {
+        if (fields[f].source != source) continue;
+        uint8_t value = 0;
+        for (uint8_t b = 0; b < fields[f].width; b++) {
+            uint8_t pos = fields[f].pos + b;
+            value |= (uint8_t)(((bytes[pos / 8] >> (7 - pos % 8)) & 0x1) << b);
+        }
+        return value;
+    }
+    return 0;
+}
+
+// Zone start frame (zone 1-48, minutes 0-240; 0 stops the zone)
+constexpr HunterZoneBytes hunterEncodeZone(uint8_t zone, uint8_t minutes) {
+    return hunterPackFields(HUNTER_ZONE_BASE, HUNTER_ZONE_FIELDS, HunterFieldValues{{
+        (uint8_t)(2 - (zone > 12)),
+        (uint8_t)(zone + 0x17),
+        (uint8_t)(zone + 0x23),
+        (uint8_t)(zone + 0x2f),
+        minutes,
+        (uint8_t)(minutes >> 4),
+        (uint8_t)(zone - 1),
+        0
+    }});
+}
+
+// Program start frame (program 1-4)
+constexpr HunterProgramBytes hunterEncodeProgram(uint8_t num) {
+    return hunterPackFields(HUNTER_PROGRAM_BASE, HUNTER_PROGRAM_FIELDS, HunterFieldValues{{
+        0, 0, 0, 0, 0, 0, 0, (uint8_t)(num - 1)
+    }});
+}
+
+constexpr std::array<HunterZoneBytes, 48> hunterBuildStopFrames() {
+    std::array<HunterZoneBytes, 48> frames = {};
+    for (uint8_t zone = 1; zone <= 48; zone++) {
+        frames[zone - 1] = hunterEncodeZone(zone, 0);
+    }
+    return frames;
+}
+
+constexpr std::array<HunterProgramBytes, 4> hunterBuildProgramFrames() {
+    std::array<HunterProgramBytes, 4> frames = {};
+    for (uint8_t num = 1; num <= 4; num++) {
+        frames[num - 1] = hunterEncodeProgram(num);
+    }
+    return frames;
+}
+
+// Fixed frames, built at compile time and kept in flash
+constexpr std::array<HunterZoneBytes, 48> HUNTER_STOP_FRAMES = hunterBuildStopFrames();
+constexpr std::array<HunterProgramBytes, 4> HUNTER_PROGRAM_FRAMES = hunterBuildProgramFrames();
+
+// std::array's operator== is only constexpr from C++20
+template <size_t N>
+constexpr bool hunterBytesEqual(const std::array<uint8_t, N>& a, const std::array<uint8_t, N>& b) {
+    for (size_t i = 0; i < N; i++) {
+        if (a[i] != b[i]) return false;
+    }
+    return true;
+}
+
+// Known frames captured from the original bitfield encoder
+static_assert(hunterBytesEqual(HUNTER_STOP_FRAMES[0], HunterZoneBytes{{
+    0xff, 0x20, 0x00, 0x30, 0x11, 0x80, 0x12, 0x04, 0x90, 0x01, 0x81, 0x0c, 0x01, 0xb8, 0x3f}}),
+    "zone 1 stop frame changed");
+static_assert(hunterBytesEqual(hunterEncodeZone(13, 240), HunterZoneBytes{{
+    0xff, 0x40, 0x00, 0x48, 0x12, 0x4f, 0x06, 0x04, 0x33, 0xc7, 0x81, 0x3c, 0xf1, 0xb9, 0xbf}}),
+    "zone 13 frame changed");
+static_assert(hunterBytesEqual(hunterEncodeZone(48, 90), HunterZoneBytes{{
+    0xff, 0x40, 0x01, 0xc4, 0xbe, 0x2a, 0x65, 0x2f, 0x2a, 0x9f, 0x4b, 0xfa, 0xa1, 0xbf, 0xbf}}),
+    "zone 48 frame changed");
+static_assert(hunterBytesEqual(HUNTER_PROGRAM_FRAMES[0], HunterProgramBytes{{0xff, 0x40, 0x03, 0x96, 0x09, 0xbd, 0x7f}}),
+    "program 1 frame changed");
+static_assert(hunterBytesEqual(HUNTER_PROGRAM_FRAMES[3], HunterProgramBytes{{0xff, 0x40, 0x03, 0x97, 0x89, 0xbd, 0x7f}}),
+    "program 4 frame changed");
+
+#endif // HUNTER_ENCODER_H
@@ -0,0 +1,34 @@
+#ifndef HUNTER_ZONES_H
+#define HUNTER_ZONES_H
+
+#include <stdint.h>
+
+// Zone numbering across several Hunter buses. Each bus drives one X-Core
+// unit with local zones 1-48, and controller zone numbers run on from one bus
+// to the next: bus 0 has zones 1-48, bus 1 has zones 49-96 and so on.
+
+#ifndef HUNTER_BUS_COUNT
+#define HUNTER_BUS_COUNT 1
+#endif
+
+// GPIO of each bus, e.g. -DHUNTER_BUS_COUNT=2 '-DHUNTER_BUS_PINS={12,14}'
+#ifndef HUNTER_BUS_PINS
+#define HUNTER_BUS_PINS {HUNTER_PIN}
+#endif
+
+#define HUNTER_ZONES_PER_BUS 48
+#define HUNTER_MAX_ZONE (HUNTER_BUS_COUNT * HUNTER_ZONES_PER_BUS)
+
+// One RMT channel per bus, and zone numbers have to fit a uint8_t
+static_assert(HUNTER_BUS_COUNT >= 1 && HUNTER_BUS_COUNT <= 4, "1-4 Hunter buses are supported");
+
+// Bus index (0-based) of a controller zone
+inline uint8_t hunterZoneBus(uint8_t zone) { return (zone - 1) / HUNTER_ZONES_PER_BUS; }
+
+// Zone number on its own bus (1-48)
+inline uint8_t hunterLocalZone(uint8_t zone) { return (zone - 1) % HUNTER_ZONES_PER_BUS + 1; }
+
+// Controller zone of a local zone on a bus
+inline uint8_t hunterGlobalZone(uint8_t bus, uint8_t localZone) { return bus * HUNTER_ZONES_PER_BUS + localZone; }
+
+#endif // HUNTER_ZONES_H
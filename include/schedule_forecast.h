@@ -0,0 +1,90 @@
+#ifndef SCHEDULE_FORECAST_H
+#define SCHEDULE_FORECAST_H
+
+#include <Arduino.h>
+#include "schedule_manager.h"
+
+// Forward declarations
+class ConfigManager;
+
+// One planned zone run
+struct ForecastEntry {
+    uint32_t start;         // Planned start (unix UTC)
+    uint32_t end;           // Planned stop (unix UTC, 0 = after the horizon)
+    uint32_t nominal;       // Time the schedule asked for (start - nominal = queue delay)
+    uint32_t scheduleId;    // Local schedule ID (0 = manual run)
+    uint32_t serverId;      // Server-side schedule ID (0 = local)
+    uint8_t zone;           // Zone number
+    uint8_t cycle;          // Cycle number of a cycle/soak schedule (0-based)
+    ScheduleType type;      // BASIC or AI schedule
+    bool running;           // Already running when the forecast was computed
+};
+
+// Planned runs for the next hours, computed by replaying the schedule set on a
+// private ScheduleManager copy. The replay jumps straight from one event (cycle
+// start or zone stop) to the next, so day masks, expiry, cycle/soak, the flow
+// budget and conflict resolution all come out of the same code the live
+// scheduler runs. The result is cached until the schedule revision or the
+// relevant config changes.
+class ScheduleForecast {
+private:
+    static const uint8_t MAX_ENTRIES = 128;
+    static const uint16_t MAX_OCCURRENCES = 256;
+    static const uint32_t HORIZON_SLACK = 3600;     // Extra seconds computed so the cache outlives a request
+    static const uint32_t MAX_CACHE_AGE = 86400;    // Recompute at least daily
+
+    ConfigManager* configManager;
+    ScheduleManager* sourceManager;
+
+    ForecastEntry entries[MAX_ENTRIES];
+    uint8_t entryCount;
+    bool truncated;
+
+    // Cache key
+    bool valid;
+    bool lastRefreshHit;
+    uint32_t computedAt;
+    uint32_t horizonEnd;
+    uint32_t cachedRevision;
+    uint32_t cachedConfigKey;
+
+    // Statistics
+    uint32_t computeMillis;
+    uint32_t computeCount;
+    uint32_t hitCount;
+
+    // Replay state
+    uint32_t replayStart;
+    uint32_t virtualUnixNow;
+    uint32_t baseMillis;
+    ScheduleManager* replay;
+    const ScheduleOccurrence* occurrences;
+    uint16_t occurrenceCount;
+
+    static ScheduleForecast* instance;
+    static uint32_t virtualMillis();
+    static uint32_t virtualUnixTime();
+    static bool recordActuation(uint8_t zone, bool state, uint16_t duration, ScheduleType schedType, uint32_t schedId, uint32_t serverId, RunEndReason reason);
+
+    uint32_t getConfigKey();
+    bool compute(uint32_t nowUtc, uint32_t toUtc);
+    ForecastEntry* addEntry();
+    void findNominal(uint32_t scheduleId, uint32_t t, uint32_t& nominal, uint8_t& cycle);
+
+public:
+    static const uint16_t MAX_HOURS = 168;
+
+    ScheduleForecast();
+
+    // Initialization
+    bool begin(ConfigManager* config, ScheduleManager* source);
+
+    // Recompute if the cached plan does not cover [nowUtc, nowUtc + hours] or is stale
+    bool refresh(uint32_t nowUtc, uint16_t hours);
+    void invalidate() { valid = false; }
+
+    // Planned runs overlapping [nowUtc, nowUtc + hours]
+    String getForecastJSON(uint32_t nowUtc, uint16_t hours);
+};
+
+#endif // SCHEDULE_FORECAST_H
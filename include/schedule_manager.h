@@ -3,6 +3,14 @@
 
 #include <Arduino.h>
 #include <RTClib.h>
+#include "hunter_zones.h"
+
+// Cycle/soak firing: with -DSCHEDULE_CYCLE_SOAK=1 a schedule runs repeatCount
+// cycles with restMinutes between them. Off by default, so a schedule fires
+// once per selected day for its duration and the repeat/rest values are ignored.
+#ifndef SCHEDULE_CYCLE_SOAK
+#define SCHEDULE_CYCLE_SOAK 0
+#endif
 
 // Forward declarations
 class ConfigManager;
@@ -26,18 +34,46 @@ enum ZoneState {
 
 // Schedule entry structure
 struct ScheduleEntry {
-    uint8_t id;             // Unique schedule ID
+    uint32_t id;            // Unique schedule ID
+    uint32_t serverId;      // Server-side schedule ID (0 = local schedule)
     uint8_t zone;           // Zone number (1-16)
     uint8_t dayMask;        // Day mask: bit 0=Sunday, bit 6=Saturday
     uint8_t startHour;      // Start hour (0-23)
     uint8_t startMinute;    // Start minute (0-59)
-    uint16_t duration;      // Duration in minutes
+    uint16_t duration;      // Duration in minutes (per cycle)
+    uint8_t repeatCount;    // Number of cycles (1 = single run)
+    uint16_t restMinutes;   // Soak time between cycles in minutes
     bool enabled;           // Schedule enabled flag
     ScheduleType type;      // BASIC or AI schedule
     uint32_t createdTime;   // Unix timestamp when created
     uint32_t expiryTime;    // Unix timestamp when AI schedule expires (0 = never)
 };
 
+// Expanded schedule occurrence (one cycle of one schedule)
+struct ScheduleOccurrence {
+    uint32_t time;          // Unix timestamp (UTC) of the cycle start
+    uint8_t slot;           // Schedule slot index
+    uint8_t cycle;          // Cycle number (0-based)
+};
+
+// Weekly run window of one cycle, in local minutes of the week (0 = Sunday 00:00)
+struct RunWindow {
+    uint16_t start;         // First minute of the run
+    uint16_t end;           // Minute after the run (windows crossing the week end are split)
+    uint8_t slot;           // Schedule slot index
+    uint8_t cycle;          // Cycle number (0-based)
+};
+
+// Planned overlap found in the run window index
+struct ScheduleConflict {
+    uint16_t weekMinute;    // Local minute of the week where the cycle would start
+    uint8_t zone;           // Zone of the cycle that would not start on time
+    uint32_t scheduleId;    // Schedule of that cycle (0 = schedule being added)
+    uint32_t otherId;       // Schedule already running the same zone (0 = over capacity)
+    uint8_t runningCount;   // Zones already planned to be running at that minute
+    bool sameZone;          // true = same zone twice, false = over the concurrency/flow limit
+};
+
 // Active zone tracking
 struct ActiveZone {
     uint8_t zone;           // Zone number
@@ -45,8 +81,46 @@ struct ActiveZone {
     uint32_t startTime;     // Millis when started
     uint32_t duration;      // Duration in milliseconds
     bool isScheduled;       // True if started by schedule, false if manual
-    uint8_t scheduleId;     // ID of schedule that started this zone
+    uint32_t scheduleId;    // ID of schedule that started this zone
+    uint32_t serverId;      // Server-side schedule ID (0 = manual or local)
     uint32_t timeRemaining; // Calculated remaining time in seconds
+    ScheduleType type;      // Schedule type that started this zone
+    float flowLpm;          // Flow committed against the supply budget
+};
+
+// Scheduled run waiting for supply capacity
+struct PendingRun {
+    uint8_t zone;           // Zone number
+    uint16_t duration;      // Duration in minutes
+    ScheduleType type;      // BASIC or AI schedule
+    uint32_t scheduleId;    // ID of schedule that queued this run
+    uint32_t serverId;      // Server-side schedule ID (0 = local)
+    uint32_t queuedAt;      // Millis when queued
+};
+
+// One step of a run plan: manual run of a zone, then a pause before the next step
+struct RunPlanStep {
+    uint8_t zone;           // Zone number
+    uint16_t minutes;       // Run time in minutes
+    uint16_t gapSeconds;    // Pause after this run before the next step starts
+};
+
+// Why a run ended, passed to the zone control callback on stop
+enum RunEndReason {
+    RUN_COMPLETED = 0,      // Ran for its full duration
+    RUN_STOPPED = 1,        // Stopped via API or MQTT
+    RUN_PREEMPTED = 2,      // Stopped to make room for another zone
+    RUN_RAIN_CANCELLED = 3, // Cancelled due to rain
+    RUN_PLAN_CANCELLED = 4  // Its run plan was cancelled
+};
+
+// Run plan states
+enum RunPlanState {
+    PLAN_IDLE = 0,          // No plan loaded
+    PLAN_RUNNING = 1,       // Current step's zone is running
+    PLAN_GAP = 2,           // Waiting between steps
+    PLAN_COMPLETED = 3,     // All steps done
+    PLAN_CANCELLED = 4      // Cancelled as a unit
 };
 
 // Conflict resolution result
@@ -59,12 +133,48 @@ struct ConflictResult {
 class ScheduleManager {
 private:
     static const uint8_t MAX_SCHEDULES = 48;  // 24 basic + 24 AI schedules
-    static const uint8_t MAX_ACTIVE_ZONES = 2; // Maximum concurrent zones
+    static const uint8_t MAX_ACTIVE_ZONES = 6; // Hard cap on concurrent zones
+    static const uint8_t DEFAULT_MAX_CONCURRENT_ZONES = 2; // Limit per bus when no supply capacity is set
+    static const uint8_t MAX_PENDING_RUNS = 16; // Scheduled runs waiting for capacity
+    static const uint8_t MAX_ZONE_ID = HUNTER_MAX_ZONE;
+    static const uint8_t SERVER_INDEX_SIZE = 64; // Power of two, > MAX_SCHEDULES
+    static const uint16_t MAX_RUN_WINDOWS = 512; // Weekly run windows in the overlap index
+    static const uint16_t MINUTES_PER_WEEK = 10080;
+
+    // Schedules plus their indexes, kept together so a whole table can be
+    // built off to the side and swapped in with one pointer store
+    struct ScheduleTable {
+        ScheduleEntry schedules[MAX_SCHEDULES];
+        uint8_t scheduleCount;
+        uint32_t nextScheduleId;
+
+        // Open-addressing index from serverId to schedule slot (-1 = empty)
+        int8_t serverIndex[SERVER_INDEX_SIZE];
+
+        // Weekly run windows of all enabled schedules, sorted by (start, slot)
+        RunWindow runWindows[MAX_RUN_WINDOWS];
+        uint16_t runWindowCount;
+        bool runWindowsFull;        // Some windows did not fit, overlap checks are incomplete
+    };
+    ScheduleTable* table;
 
-    ScheduleEntry schedules[MAX_SCHEDULES];
     ActiveZone activeZones[MAX_ACTIVE_ZONES];
-    uint8_t scheduleCount;
-    uint8_t nextScheduleId;
+    PendingRun pendingRuns[MAX_PENDING_RUNS];
+    uint8_t pendingRunCount;
+    uint32_t revision;              // Bumped on any change that alters the plan
+
+    // Missed-fire catch-up after loop stalls
+    uint32_t lastEvaluatedMinute;   // Last unix minute checked for fire times (0 = not yet)
+    uint32_t lateStartCount;        // Fires started late within the grace window
+    uint32_t missedFireCount;       // Fires skipped because they were older than the grace window
+    uint32_t maxLateSeconds;        // Worst lateness of a late start
+    bool clockBehind;               // Clock stepped back, waiting to reach lastEvaluatedMinute
+
+    // Per-zone flow rates in L/min from server zone details (0 = unknown)
+    float zoneFlowLpm[MAX_ZONE_ID + 1];
+
+    // Stops not yet confirmed by the bus
+    bool zoneStopPending[MAX_ZONE_ID + 1];
 
     ConfigManager* configManager;
     RTCModule* rtcModule;
@@ -76,32 +186,86 @@ private:
 
     // Schedule management
     bool isScheduleSlotFree(uint8_t index);
-    uint8_t findScheduleById(uint8_t id);
+    uint8_t findScheduleById(uint32_t id);
     uint8_t findFreeScheduleSlot();
     void cleanupExpiredAISchedules();
+    static void setCycles(ScheduleEntry& schedule, uint8_t repeatCount, uint16_t restMinutes);
+
+    // Server ID index
+    uint8_t findServerIndexPos(uint32_t serverId) const;
+    void indexServerId(uint8_t slot);
+    void unindexServerId(uint32_t serverId);
+    void rebuildServerIndex();
+
+    // Run window index
+    uint16_t buildRunWindows(const ScheduleEntry& schedule, uint8_t slot, RunWindow* out, uint16_t maxCount);
+    void indexRunWindows(uint8_t slot);
+    void unindexRunWindows(uint8_t slot);
+    void rebuildRunWindows();
+    bool windowConflicts(const RunWindow& window, uint8_t zone, uint8_t ignoreSlot, ScheduleConflict* conflict);
+    bool scheduleConflicts(const ScheduleEntry& schedule, uint8_t slot, ScheduleConflict* conflict);
 
     // Zone management
     int8_t findActiveZone(uint8_t zone);
     int8_t findFreeActiveSlot();
     uint8_t getActiveZoneCount();
+    uint8_t getActiveZoneCountOnBus(uint8_t bus);
     ConflictResult resolveZoneConflict(uint8_t newZone, bool isManual);
     uint32_t getRemainingTime(uint8_t activeIndex);
+    bool stopZoneSlot(uint8_t slot, RunEndReason reason);
+    bool activateZone(uint8_t zone, uint16_t duration, bool isScheduled, ScheduleType type, uint32_t scheduleId, uint32_t serverId);
+    void startScheduledRun(uint8_t zone, uint16_t duration, ScheduleType type, uint32_t scheduleId, uint32_t serverId);
+
+    // Run plan execution
+    void startRunPlanStep();
+    void advanceRunPlan();
+
+    // Flow budget packing
+    float getZoneFlowDemand(uint8_t zone);
+    bool budgetAllows(float committed, uint8_t count, uint8_t busCount, float demand);
+    bool fitsFlowBudget(uint8_t zone);
+    uint32_t estimateStartDelay(uint8_t zone);
+    bool queuePendingRun(uint8_t zone, uint16_t duration, ScheduleType type, uint32_t scheduleId, uint32_t serverId);
+    void removePendingRunAt(uint8_t index);
+    void purgePendingRuns();
+    void dispatchPendingRuns();
 
     // Time utilities
     bool isTimeMatch(const ScheduleEntry& schedule, const DateTime& now);
+    uint32_t nextOccurrence(const ScheduleEntry& schedule, uint32_t fromUtc, uint8_t* cycle = nullptr);
+    void reportMissedFires(uint32_t fromUtc, uint32_t toUtc, uint32_t nowUtc, uint32_t graceMinutes);
     uint32_t getCurrentUnixTime();
+    uint32_t nowMillis();
+    int getLocalOffsetSeconds();
+
+    // Optional clock overrides (nullptr = millis() and RTC)
+    uint32_t (*millisSource)() = nullptr;
+    uint32_t (*unixTimeSource)() = nullptr;
 
 public:
     ScheduleManager();
+    ~ScheduleManager();
+    ScheduleManager(const ScheduleManager&) = delete;
+    ScheduleManager& operator=(const ScheduleManager&) = delete;
 
     // Initialization
     bool begin(ConfigManager* config, RTCModule* rtc);
 
     // Schedule management
-    uint8_t addBasicSchedule(uint8_t zone, uint8_t dayMask, uint8_t hour, uint8_t minute, uint16_t duration);
-    uint8_t addAISchedule(uint8_t zone, uint8_t dayMask, uint8_t hour, uint8_t minute, uint16_t duration, uint32_t expiryTime);
-    bool removeSchedule(uint8_t id);
-    bool enableSchedule(uint8_t id, bool enabled);
+    uint32_t addBasicSchedule(uint8_t zone, uint8_t dayMask, uint8_t hour, uint8_t minute, uint16_t duration,
+                              uint8_t repeatCount = 1, uint16_t restMinutes = 0, ScheduleConflict* conflict = nullptr);
+    uint32_t addAISchedule(uint8_t zone, uint8_t dayMask, uint8_t hour, uint8_t minute, uint16_t duration, uint32_t expiryTime,
+                           uint32_t serverId = 0, uint8_t repeatCount = 1, uint16_t restMinutes = 0);
+    bool removeSchedule(uint32_t id);
+    bool enableSchedule(uint32_t id, bool enabled);
+    const ScheduleEntry* findByServerId(uint32_t serverId) const;  // O(1) lookup for completion correlation
+
+    // Overlap analysis against the planned weekly run windows
+    bool checkScheduleConflict(uint8_t zone, uint8_t dayMask, uint8_t hour, uint8_t minute, uint16_t duration,
+                               uint8_t repeatCount = 1, uint16_t restMinutes = 0, ScheduleConflict* conflict = nullptr);
+    uint16_t findConflicts(ScheduleConflict* out, uint16_t maxCount);  // Returns the total number found
+    String getConflictsJSON();
+    static String describeConflict(const ScheduleConflict& conflict);
     void clearAISchedules();
     void clearAllSchedules();
 
@@ -113,6 +277,27 @@ public:
     bool stopZone(uint8_t zone);
     void stopAllZones();
 
+    // Run plan: ordered manual runs executed on-device, cancellable as a unit
+    static const uint8_t MAX_RUN_PLAN_STEPS = 48;
+    uint32_t startRunPlan(const RunPlanStep* steps, uint8_t count);  // Returns the plan ID, 0 if rejected
+    bool cancelRunPlan();
+    bool isRunPlanActive() const { return runPlanState == PLAN_RUNNING || runPlanState == PLAN_GAP; }
+    String getRunPlanJSON();
+
+    // Supply line flow budget
+    void setZoneFlowRate(uint8_t zone, float lpm);
+    float getZoneFlowRate(uint8_t zone) const;
+    float getCommittedFlowLpm();
+    uint8_t getPendingRunCount() const { return pendingRunCount; }
+    uint32_t getLateStartCount() const { return lateStartCount; }
+    uint32_t getMissedFireCount() const { return missedFireCount; }
+    const PendingRun* getPendingRun(uint8_t index) const { return index < pendingRunCount ? &pendingRuns[index] : nullptr; }
+    const ActiveZone* getActiveZoneAt(uint8_t index) const {
+        return (index < MAX_ACTIVE_ZONES && activeZones[index].zone > 0) ? &activeZones[index] : nullptr;
+    }
+    static constexpr uint8_t getMaxActiveZones() { return MAX_ACTIVE_ZONES; }
+    static uint8_t getMaxSchedules() { return MAX_SCHEDULES; }
+
     // Status and information
     String getSchedulesJSON();
     String getActiveZonesJSON();
@@ -138,11 +323,56 @@ public:
     // Process running zones (call from main loop)
     void processActiveZones();
 
-    // Callback function pointer for zone control
-    void setZoneControlCallback(void (*callback)(uint8_t zone, bool state, uint16_t duration, ScheduleType schedType, uint8_t schedId));
+    // Replace the millis()/RTC time base, e.g. with a virtual clock for simulation
+    void setClockSource(uint32_t (*millisFn)(), uint32_t (*unixTimeFn)());
+
+    // Copy schedules and zone flow rates from another manager (active zones are not copied)
+    void copySchedulesFrom(const ScheduleManager& other);
+
+    // Copy schedules plus running and queued zones, e.g. to plan ahead from the current state
+    void copyStateFrom(const ScheduleManager& other);
+
+    // Shadow table for bulk updates: fill the copy returned by createShadow(),
+    // then swapScheduleTable() to make it live in one step (caller deletes the shadow)
+    ScheduleManager* createShadow(bool keepAISchedules = false);
+    void swapScheduleTable(ScheduleManager& shadow);
+
+    // Replace this table's AI schedules with copies of other's (IDs kept, renumbered
+    // on a clash); basic schedules stay. Rebases a shadow filled in the background
+    // onto basic schedule edits made in the meantime.
+    void takeAISchedulesFrom(const ScheduleManager& other);
+    uint8_t removeAISchedulesExpiring(uint32_t expiryFrom, uint32_t expiryTo, bool outsideRange = false);
+    uint8_t countAISchedulesExpiring(uint32_t expiryFrom, uint32_t expiryTo) const;
+
+    // Planning support
+    uint32_t getRevision() const { return revision; }
+    const ScheduleEntry* getScheduleAt(uint8_t slot) const;
+    uint16_t expandOccurrences(uint32_t fromUtc, uint32_t toUtc, ScheduleOccurrence* out, uint16_t maxCount, bool* truncated = nullptr);
+    uint32_t getMillisUntilNextStop();  // UINT32_MAX if no zone is running
+
+    // Callback function pointer for zone control; returns false if the command
+    // could not be handed to the bus. A refused start frees the zone again.
+    // On stop, schedType/schedId/serverId describe the run that is ending and
+    // reason tells why it ended; on start reason is RUN_COMPLETED and unused
+    void setZoneControlCallback(bool (*callback)(uint8_t zone, bool state, uint16_t duration, ScheduleType schedType, uint32_t schedId, uint32_t serverId, RunEndReason reason));
+
+    // Zones whose stop was sent but not yet confirmed on the bus; they still
+    // count as active until the controller reports the stop went out
+    void setZoneStopPending(uint8_t zone, bool pending);
+    bool isZoneStopPending(uint8_t zone) const;
 
 private:
-    void (*zoneControlCallback)(uint8_t zone, bool state, uint16_t duration, ScheduleType schedType, uint8_t schedId) = nullptr;
+    // Run plan (sequential manual runs)
+    RunPlanStep runPlanSteps[MAX_RUN_PLAN_STEPS];
+    bool runPlanSkipped[MAX_RUN_PLAN_STEPS];  // Step could not start
+    uint8_t runPlanStepCount;
+    uint8_t runPlanCurrent;         // Index of the running or next step
+    RunPlanState runPlanState;
+    uint32_t runPlanId;             // Handle of the current plan (0 = none yet)
+    uint32_t runPlanPhaseStart;     // Millis when the current step or gap began
+    uint32_t runPlanStartMillis;    // Millis when the plan started
+
+    bool (*zoneControlCallback)(uint8_t zone, bool state, uint16_t duration, ScheduleType schedType, uint32_t schedId, uint32_t serverId, RunEndReason reason) = nullptr;
 };
 
 #endif // SCHEDULE_MANAGER_H
\ No newline at end of file
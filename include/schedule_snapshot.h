@@ -0,0 +1,84 @@
+#ifndef SCHEDULE_SNAPSHOT_H
+#define SCHEDULE_SNAPSHOT_H
+
+#include <Arduino.h>
+
+class ScheduleManager;
+
+// Binary copy of the AI schedules last made live, so the whole fetched
+// horizon comes back after a reset or while offline without reading and
+// parsing the server's JSON again. One SPIFFS file: a header with a format
+// version, the server revision of the schedules and a CRC-32 over header and
+// records, then one fixed-size record per schedule. Written through a temp
+// file, so a reset mid-write leaves the previous snapshot in place.
+class ScheduleSnapshot {
+public:
+    static const uint16_t VERSION = 2;
+    static const uint8_t DATE_SIZE = 11;            // "YYYY-MM-DD" and terminator
+
+    ScheduleSnapshot(const char* snapshotPath, const char* tempPath);
+
+    // Save the AI schedules of manager with the server revision they were
+    // built from; skipped when schedules and revision match the file
+    bool save(const ScheduleManager& manager, uint32_t nowUtc, uint32_t revision, const char* horizonEnd);
+
+    // Add the saved schedules to target, dropping those expired by nowUtc
+    // (0 = keep all). Returns the number added, -1 if there is no valid
+    // snapshot. getRevision() and getHorizonEnd() then describe it, and
+    // getRestoreFailures() counts unexpired schedules target refused; the
+    // restored table is only the saved one if that is 0.
+    int restore(ScheduleManager& target, uint32_t nowUtc);
+
+    // Forget the saved schedules, e.g. when they were cleared on purpose
+    void remove();
+
+    uint16_t getSavedCount() const { return savedCount; }
+    uint32_t getSavedAt() const { return savedAt; }
+    uint32_t getRevision() const { return savedRevision; }
+    const char* getHorizonEnd() const { return savedHorizonEnd; }
+    uint16_t getRestoreFailures() const { return restoreFailures; }
+
+private:
+    static const uint32_t MAGIC = 0x50414E53;   // "SNAP"
+    static const uint8_t MAX_RECORDS = 48;
+
+    struct Header {
+        uint32_t magic;
+        uint16_t version;
+        uint16_t recordSize;
+        uint16_t count;
+        uint16_t reserved;
+        uint32_t savedAt;       // Unix time of the save (0 = clock not set)
+        uint32_t revision;      // Server revision of the schedules (0 = unknown)
+        char horizonEnd[12];    // Last date fully loaded at that revision
+        uint32_t crc;           // CRC-32 of the header up to here, then the records
+    };
+
+    // Fields of ScheduleEntry that are needed to add it again
+    struct Record {
+        uint32_t serverId;
+        uint32_t expiryTime;
+        uint16_t duration;
+        uint16_t restMinutes;
+        uint8_t zone;
+        uint8_t dayMask;
+        uint8_t startHour;
+        uint8_t startMinute;
+        uint8_t repeatCount;
+        uint8_t reserved[3];
+    };
+
+    const char* path;
+    const char* tempPath;
+    uint32_t savedCrc;          // CRC of the file on flash (0 = unknown)
+    uint16_t savedCount;
+    uint32_t savedAt;
+    uint32_t savedRevision;
+    char savedHorizonEnd[DATE_SIZE];
+    uint16_t restoreFailures;   // Schedules the last restore() could not add
+
+    bool load(Header& header, Record* records);
+    static uint32_t checksum(const Header& header, const Record* records);
+};
+
+#endif // SCHEDULE_SNAPSHOT_H
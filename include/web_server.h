@@ -4,6 +4,7 @@
 #include <Arduino.h>
 #include <WiFi.h>
 #include <WebServer.h>
+#include "hunter_zones.h"
 
 // Forward declarations
 class RTCModule;
@@ -11,6 +12,7 @@ class ConfigManager;
 class ScheduleManager;
 class HTTPScheduleClient;
 class MQTTManager;
+class ScheduleForecast;
 
 // Zone schedule structure
 struct ZoneSchedule {
@@ -41,8 +43,8 @@ private:
     static int zoneDurations[16]; // Track duration for each zone
 
     // Volatile last-watered tracking (since boot)
-    // Index by zone number (1-48). Value is a human-readable timestamp string.
-    static char zoneLastWatered[49][48];
+    // Index by zone number (1-HUNTER_MAX_ZONE). Value is a human-readable timestamp string.
+    static char zoneLastWatered[HUNTER_MAX_ZONE + 1][48];
     static bool zoneLastWateredInitialized;
 
     // Pin definitions
@@ -66,6 +68,11 @@ private:
     // MQTT Manager reference
     static class MQTTManager* mqttManager;
 
+    // Schedule forecast reference
+    static class ScheduleForecast* scheduleForecast;
+    static class HunterBus** hunterBuses;
+    static uint8_t hunterBusCount;
+
     // Private methods for handling requests
     static void handleRoot();
     static void handleNotFound();
@@ -74,6 +81,9 @@ private:
     static void handleStartZone();
     static void handleStopZone();
     static void handleRunProgram();
+    static void handleStartRunPlan();
+    static void handleGetRunPlan();
+    static void handleCancelRunPlan();
     static void handleGetTime();
     static void handleGetStatus();
     static void handleSetTime();
@@ -90,10 +100,15 @@ private:
     static void handleSetAISchedules();
     static void handleClearAISchedules();
     static void handleFetchSchedules();
+    static void handleGetHttpJobs();
+    static void handleCancelHttpJob();
+    static void handleGetScheduleConflicts();
 
     // Device status and control handlers for Node-RED
     static void handleGetDeviceStatus();
     static void handleGetNextEvent();
+    static void handleGetForecast();
+    static void handleGetBusStats();
     static void handleDeviceCommand();
 
     // MQTT configuration handlers
@@ -130,6 +145,12 @@ public:
     // Set MQTT manager reference
     void setMQTTManager(class MQTTManager* mqtt) { mqttManager = mqtt; }
 
+    // Set Schedule forecast reference
+    void setScheduleForecast(class ScheduleForecast* forecast) { scheduleForecast = forecast; }
+
+    // Set Hunter bus references (one per X-Core unit)
+    void setHunterBuses(class HunterBus** buses, uint8_t count) { hunterBuses = buses; hunterBusCount = count; }
+
     // Process any pending commands (call this in main loop)
     void processCommands();
 
@@ -19,15 +19,22 @@
  */
 
 #include "HunterRoam.h"
+#include "hunter_decoder.h"
+
+// Interrupts on the sending core are held off for one bit at a time
+static portMUX_TYPE hunterBusMux = portMUX_INITIALIZER_UNLOCKED;
 
 /**
  * Constructor for the object HunterRoam.
  *
- * @param pin GPIO number where the REM wire is connected to.
+ * @param pin GPIO number where the REM wire is connected to (-1 for an
+ *            instance that only renders or records frames).
  */
 HunterRoam::HunterRoam(int pin) {
 	_pin = pin;
-	pinMode(pin, OUTPUT);
+	if (pin >= 0) {
+		pinMode(pin, OUTPUT);
+	}
 }
 
 /**
@@ -46,89 +53,216 @@ String HunterRoam::errorHint(byte error) {
 			return String("Invalid watering time.");
 		case 3:
 			return String("Invalid program number.");
+		case 4:
+			return String("Bus transmit failed.");
+		case 5:
+			return String("Superseded by a later command.");
+		case 6:
+			return String("Bus timing out of tolerance.");
 		default:
 			return String("Unknonwn error.");
 	}
 }
 
 /**
- * Write low bit on the bus.
+ * Append one level to a frame's timing table.
+ *
+ * @param frame frame to append to
+ * @param level bus level (HIGH or LOW)
+ * @param micros time to hold the level in microseconds
  */
-void HunterRoam::sendLow() {
-	digitalWrite(_pin, HIGH);
-	delayMicroseconds(SHORT_INTERVAL);
-	digitalWrite(_pin, LOW);
-	delayMicroseconds(LONG_INTERVAL);
+void HunterRoam::addPulse(HunterFrame &frame, byte level, uint32_t micros) {
+	if (frame.count >= HUNTER_MAX_PULSES) {
+		return;
+	}
+	frame.pulses[frame.count].level = level ? 1 : 0;
+	frame.pulses[frame.count].micros = micros;
+	frame.count++;
 }
 
 /**
- * Write high bit on the bus
- *
- * Arguments: none
+ * Append a low bit to a frame.
  */
-void HunterRoam::sendHigh() {
-	digitalWrite(_pin, HIGH);
-	delayMicroseconds(LONG_INTERVAL);
-	digitalWrite(_pin, LOW);
-	delayMicroseconds(SHORT_INTERVAL);
+void HunterRoam::addLow(HunterFrame &frame) {
+	addPulse(frame, HIGH, SHORT_INTERVAL);
+	addPulse(frame, LOW, LONG_INTERVAL);
 }
 
 /**
- * Write the bit sequence out of the bus
+ * Append a high bit to a frame.
+ */
+void HunterRoam::addHigh(HunterFrame &frame) {
+	addPulse(frame, HIGH, LONG_INTERVAL);
+	addPulse(frame, LOW, SHORT_INTERVAL);
+}
+
+/**
+ * Render the bit sequence to bus timings
  *
- * @param buffer blob containing the bits to transmit
+ * @param buffer encoded command bytes
+ * @param length number of bytes in the buffer
  * @param extrabit if true, then write an extra 1 bit
+ * @param frame receives the timing table
  */
-void HunterRoam::writeBus(std::vector<byte> buffer, bool extrabit) {
+void HunterRoam::renderBus(const byte *buffer, size_t length, bool extrabit, HunterFrame &frame) {
+	frame.count = 0;
+
 	// Resetimpulse
-	digitalWrite(_pin, HIGH);
-	delay(325); //milliseconds
-	digitalWrite(_pin, LOW);
-	delay(65); //milliseconds
+	addPulse(frame, HIGH, RESET_PULSE_MS * 1000UL);
+	addPulse(frame, LOW, RESET_GAP_MS * 1000UL);
 
 	// Startimpulse
-	digitalWrite(_pin, HIGH);
-	delayMicroseconds(START_INTERVAL);
-	digitalWrite(_pin, LOW);
-	delayMicroseconds(SHORT_INTERVAL);
+	addPulse(frame, HIGH, START_INTERVAL);
+	addPulse(frame, LOW, SHORT_INTERVAL);
 
 	// Write the bits out
-	for (auto &sendByte : buffer) {
+	for (size_t i = 0; i < length; i++) {
+		byte sendByte = buffer[i];
 		for (byte inner = 0; inner < 8; inner++) {
 			// Send high order bits first
-			(sendByte & 0x80) ? sendHigh() : sendLow();
+			(sendByte & 0x80) ? addHigh(frame) : addLow(frame);
 			sendByte <<= 1;
 		}
 	}
 
 	// Include an extra 1 bit
 	if (extrabit) {
-		sendHigh();
+		addHigh(frame);
 	}
 
 	// Write the stop pulse
-	sendLow();
+	addLow(frame);
 }
 
 /**
- * Set a value with an arbitrary bit width to a bit position within a blob.
+ * Play a rendered frame out of the bus by bit-banging the pin.
+ * Blocks for the whole frame (about 0.6 s for a zone command).
+ *
+ * Each bit (a high and a low pulse) is sent inside a critical section and
+ * timed on the CPU cycle counter rather than with delayMicroseconds(), so
+ * interrupts can't stretch it. Interrupts are served between bits and
+ * during the millisecond reset pulses; the width of every pulse is measured
+ * from edge to edge, so any stretching there still shows up.
  *
- * @param bits blob to write the value to
- * @param pos position within the blob
- * @param val to write
- * @param len in bits of the value
+ * @param frame timing table from renderZone() or renderProgram()
+ * @param measured if not null, receives the measured pulse widths
  */
-void HunterRoam::hunterBitfield(std::vector <byte> &bits, byte pos, byte val, byte len) {
-	while (len > 0) {
-		if (val & 0x1) {
-			bits[pos / 8] = bits[pos / 8] | 0x80 >> (pos % 8);
-		} else {
-			bits[pos / 8] = bits[pos / 8] & ~(0x80 >> (pos % 8));
+void HunterRoam::playFrame(const HunterFrame &frame, HunterFrame *measured) {
+	if (_recorder) {
+		for (uint16_t i = 0; i < frame.count; i++) {
+			uint16_t last = _recorder->count;
+			if (last > 0 && _recorder->pulses[last - 1].level == frame.pulses[i].level) {
+				_recorder->pulses[last - 1].micros += frame.pulses[i].micros;
+			} else {
+				addPulse(*_recorder, frame.pulses[i].level, frame.pulses[i].micros);
+			}
+		}
+		return;
+	}
+
+	if (_pin < 0 || frame.count == 0) {
+		return;
+	}
+
+	if (measured) {
+		measured->count = 0;
+	}
+
+	const uint32_t cyclesPerMicro = ESP.getCpuFreqMHz();
+	uint32_t edge = 0;
+	uint16_t i = 0;
+	while (i < frame.count) {
+		bool critical = frame.pulses[i].micros < 10000;
+		uint16_t end = i + 1;
+		if (critical && end < frame.count && frame.pulses[end].micros < 10000) {
+			end++;
+		}
+
+		if (critical) {
+			portENTER_CRITICAL(&hunterBusMux);
+		}
+		for (; i < end; i++) {
+			uint32_t now = ESP.getCycleCount();
+			if (i > 0 && measured) {
+				addPulse(*measured, frame.pulses[i - 1].level, (now - edge) / cyclesPerMicro);
+			}
+			edge = now;
+
+			digitalWrite(_pin, frame.pulses[i].level ? HIGH : LOW);
+			if (critical) {
+				uint32_t cycles = frame.pulses[i].micros * cyclesPerMicro;
+				while (ESP.getCycleCount() - edge < cycles) {
+				}
+			} else {
+				delay(frame.pulses[i].micros / 1000);
+			}
 		}
-		len--;
-		val = val >> 1;
-		pos++;
+		if (critical) {
+			portEXIT_CRITICAL(&hunterBusMux);
+		}
+	}
+
+	if (measured) {
+		addPulse(*measured, frame.pulses[frame.count - 1].level, (ESP.getCycleCount() - edge) / cyclesPerMicro);
 	}
+	digitalWrite(_pin, LOW);
+}
+
+/**
+ * Send a frame and verify its timing. The measured pulses are decoded with
+ * HUNTER_JITTER_TOLERANCE; if any pulse was out of tolerance (or the frame
+ * does not decode) it is sent again, up to HUNTER_MAX_RETRIES times.
+ *
+ * @param frame timing table from renderZone() or renderProgram()
+ */
+byte HunterRoam::transmitFrame(const HunterFrame &frame) {
+	if (_recorder || _pin < 0) {
+		playFrame(frame);
+		return 0;
+	}
+
+	for (byte attempt = 0; attempt <= HUNTER_MAX_RETRIES; attempt++) {
+		if (attempt > 0) {
+			_jitter.retransmits++;
+		}
+
+		playFrame(frame, &_measured);
+		_jitter.frames++;
+
+		HunterDecoded decoded = HunterDecoder::decode(_measured, HUNTER_JITTER_TOLERANCE);
+		_jitter.lastDeviation = decoded.maxDeviation;
+		for (uint16_t i = 4; i < _measured.count && i < frame.count; i++) {
+			uint32_t sent = frame.pulses[i].micros;
+			uint32_t measured = _measured.pulses[i].micros;
+			if (measured > sent && measured - sent > _jitter.maxStretchMicros) {
+				_jitter.maxStretchMicros = measured - sent;
+			}
+		}
+
+		if (decoded.status == DECODE_OK) {
+			if (decoded.maxDeviation > _jitter.maxDeviation) {
+				_jitter.maxDeviation = decoded.maxDeviation;
+			}
+			return 0;
+		}
+
+		// The failing pulse is outside the tolerance; count it as the worst seen
+		if (decoded.errorPulse < _measured.count && decoded.errorPulse < frame.count) {
+			const HunterPulse &sent = _measured.pulses[decoded.errorPulse];
+			uint32_t nominal = frame.pulses[decoded.errorPulse].micros;
+			uint32_t diff = sent.micros > nominal ? sent.micros - nominal : nominal - sent.micros;
+			uint32_t percent = diff * 100 / nominal;
+			_jitter.lastDeviation = percent > 255 ? 255 : percent;
+			if (_jitter.lastDeviation > _jitter.maxDeviation) {
+				_jitter.maxDeviation = _jitter.lastDeviation;
+			}
+		}
+		Serial.printf("HunterRoam: Frame timing out of tolerance (%s at pulse %d), attempt %d\n",
+		              HunterDecoder::statusText(decoded.status), decoded.errorPulse, attempt + 1);
+	}
+
+	_jitter.failures++;
+	return 6;
 }
 
 /**
@@ -138,55 +272,38 @@ void HunterRoam::hunterBitfield(std::vector <byte> &bits, byte pos, byte val, by
  * @param time time in minutes (0-240)
  */
 byte HunterRoam::startZone(byte zone, byte time) {
+	HunterFrame frame;
+	byte error = renderZone(zone, time, frame);
+	if (error == 0) {
+		error = transmitFrame(frame);
+	}
+	return error;
+}
 
-	// Start out with a base frame
-	std::vector<byte> buffer = {0xff,0x00,0x00,0x00,0x10,0x00,0x00,0x04,0x00,0x00,0x01,0x00,0x01,0xb8,0x3f};
-
+/**
+ * Render a zone start to bus timings
+ *
+ * @param zone zone number (1-48)
+ * @param time time in minutes (0-240, 0 stops the zone)
+ * @param frame receives the timing table
+ */
+byte HunterRoam::renderZone(byte zone, byte time, HunterFrame &frame) {
 	if (zone < 1 || zone > 48) {
 		return 1;
 	}
 
-	if (time < 0 || time > 240) {
+	if (time > 240) {
 		return 2;
 	}
 
-	// The bus protocol is a little bizzare, not sure why
-
-	// Bits 9:10 are 0x1 for zones > 12 and 0x2 otherwise
-	if (zone > 12) {
-		hunterBitfield(buffer, 9, 0x1, 2);
+	// Stop frames are prebuilt in flash, start frames are packed on the stack
+	if (time == 0) {
+		renderBus(HUNTER_STOP_FRAMES[zone - 1].data(), HUNTER_STOP_FRAMES[zone - 1].size(), true, frame);
 	} else {
-		hunterBitfield(buffer, 9, 0x2, 2);
+		HunterZoneBytes buffer = hunterEncodeZone(zone, time);
+		renderBus(buffer.data(), buffer.size(), true, frame);
 	}
 
-	// Zone + 0x17 is at bits 23:29 and 36:42
-	hunterBitfield(buffer, 23, zone + 0x17, 7);
-	hunterBitfield(buffer, 36, zone + 0x17, 7);
-
-	// Zone + 0x23 is at bits 49:55 and 62:68
-	hunterBitfield(buffer, 49, zone + 0x23, 7);
-	hunterBitfield(buffer, 62, zone + 0x23, 7);
-
-	// Zone + 0x2f is at bits 75:81 and 88:94
-	hunterBitfield(buffer, 75, zone + 0x2f, 7);
-	hunterBitfield(buffer, 88, zone + 0x2f, 7);
-
-	// Time is encoded in three places and broken up by nibble
-	// Low nibble: bits 31:34, 57:60, and 83:86
-	// High nibble: bits 44:47, 70:73, and 96:99
-	hunterBitfield(buffer, 31, time, 4);
-	hunterBitfield(buffer, 44, time >> 4, 4);
-	hunterBitfield(buffer, 57, time, 4);
-	hunterBitfield(buffer, 70, time >> 4, 4);
-	hunterBitfield(buffer, 83, time, 4);
-	hunterBitfield(buffer, 96, time >> 4, 4);
-
-	// Bottom nibble of zone - 1 is at bits 109:112
-	hunterBitfield(buffer, 109, zone - 1, 4);
-
-	// Write the bits out of the bus
-	writeBus(buffer, true);
-
 	return 0;
 }
 
@@ -205,16 +322,26 @@ byte HunterRoam::stopZone(byte zone) {
  * @param num - program number (1-4)
  */
 byte HunterRoam::startProgram(byte num) {
-	// Start with a basic program frame
-	std::vector<byte> buffer = {0xff, 0x40, 0x03, 0x96, 0x09 ,0xbd ,0x7f};
+	HunterFrame frame;
+	byte error = renderProgram(num, frame);
+	if (error == 0) {
+		error = transmitFrame(frame);
+	}
+	return error;
+}
 
+/**
+ * Render a program start to bus timings
+ *
+ * @param num - program number (1-4)
+ * @param frame receives the timing table
+ */
+byte HunterRoam::renderProgram(byte num, HunterFrame &frame) {
 	if (num < 1 || num > 4) {
 		return 3;
 	}
 
-	// Program number - 1 is at bits 31:32
-	hunterBitfield(buffer, 31, num - 1, 2);
-	writeBus(buffer, false);
+	renderBus(HUNTER_PROGRAM_FRAMES[num - 1].data(), HUNTER_PROGRAM_FRAMES[num - 1].size(), false, frame);
 
 	return 0;
 }
\ No newline at end of file
@@ -62,6 +62,8 @@ void ConfigManager::setDefaults() {
     config.maxZoneRunTime = 240; // 4 hours max
     config.maxEnabledZones = 8;   // Default to 8 zones enabled
     config.pumpSafetyMode = true;
+    supplyCapacityLpm = 0; // Flow budget disabled, fall back to zone count limit
+    missedFireGraceMinutes = 15; // Late starts allowed after a loop stall
 
     // System
     config.configVersion = 1;
@@ -113,6 +115,8 @@ bool ConfigManager::loadConfig() {
         loaded = false;
     }
 
+    loadSettingKeys();
+
     configLoaded = true;
     return loaded;
 }
@@ -135,6 +139,8 @@ bool ConfigManager::saveConfig() {
 bool ConfigManager::saveToNVS() {
     preferences.putBytes("config", &config, sizeof(config));
     preferences.putUInt("magic", CONFIG_MAGIC_NUMBER);
+    preferences.putFloat("supply_lpm", supplyCapacityLpm);
+    preferences.putInt("fire_grace", missedFireGraceMinutes);
     return true;
 }
 
@@ -154,6 +160,20 @@ bool ConfigManager::loadFromNVS() {
     return (preferences.getBytes("config", &config, sizeof(config)) == sizeof(config));
 }
 
+// Settings kept outside the config blob; a missing or out of range key
+// leaves the default in place
+void ConfigManager::loadSettingKeys() {
+    float lpm = preferences.getFloat("supply_lpm", supplyCapacityLpm);
+    if (lpm >= 0 && lpm <= 2000) {
+        supplyCapacityLpm = lpm;
+    }
+
+    int grace = preferences.getInt("fire_grace", missedFireGraceMinutes);
+    if (grace >= 0 && grace <= 240) { // Max 4 hours
+        missedFireGraceMinutes = grace;
+    }
+}
+
 void ConfigManager::resetToDefaults() {
     setDefaults();
     saveConfig();
@@ -249,8 +269,23 @@ void ConfigManager::setMaxEnabledZones(int zones) {
     }
 }
 
+void ConfigManager::setSupplyCapacityLpm(float lpm) {
+    if (lpm >= 0 && lpm <= 2000) {
+        supplyCapacityLpm = lpm;
+        Serial.printf("Supply capacity set to %.1f L/min\n", lpm);
+    }
+}
+
+void ConfigManager::setMissedFireGraceMinutes(int minutes) {
+    if (minutes >= 0 && minutes <= 240) {
+        missedFireGraceMinutes = minutes;
+        Serial.printf("Missed fire grace set to %d minutes\n", minutes);
+    }
+}
+
 bool ConfigManager::isZoneEnabled(int zone) const {
-    return (zone >= 1 && zone <= config.maxEnabledZones);
+    // The limit applies to each bus, so zones 1-N of every X-Core unit are enabled
+    return (zone >= 1 && zone <= HUNTER_MAX_ZONE && hunterLocalZone(zone) <= config.maxEnabledZones);
 }
 
 void ConfigManager::printConfig() {
@@ -270,6 +305,12 @@ void ConfigManager::printConfig() {
     Serial.printf("Max Zone Runtime: %d minutes\n", config.maxZoneRunTime);
     Serial.printf("Max Enabled Zones: %d\n", config.maxEnabledZones);
     Serial.printf("Pump Safety Mode: %s\n", config.pumpSafetyMode ? "Enabled" : "Disabled");
+    if (supplyCapacityLpm > 0) {
+        Serial.printf("Supply Capacity: %.1f L/min\n", supplyCapacityLpm);
+    } else {
+        Serial.println("Supply Capacity: (not set, 2 zones max)");
+    }
+    Serial.printf("Missed Fire Grace: %d minutes\n", missedFireGraceMinutes);
     Serial.printf("Checksum: 0x%08X\n", config.checksum);
     Serial.println("=============================");
 }
@@ -305,7 +346,9 @@ String ConfigManager::getConfigJSON() {
     json += "\"scheduling\":" + String(config.enableScheduling ? "true" : "false") + ",";
     json += "\"max_runtime\":" + String(config.maxZoneRunTime) + ",";
     json += "\"max_enabled_zones\":" + String(config.maxEnabledZones) + ",";
-    json += "\"pump_safety\":" + String(config.pumpSafetyMode ? "true" : "false");
+    json += "\"pump_safety\":" + String(config.pumpSafetyMode ? "true" : "false") + ",";
+    json += "\"supply_capacity_lpm\":" + String(supplyCapacityLpm, 1) + ",";
+    json += "\"missed_fire_grace_min\":" + String(missedFireGraceMinutes);
     json += "}";
     return json;
 }
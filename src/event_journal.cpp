@@ -0,0 +1,348 @@
+#include "event_journal.h"
+#include <SPIFFS.h>
+
+EventJournal::EventJournal(const char* journalPath, const char* ackFile, const char* tempFile) {
+    path = journalPath;
+    ackPath = ackFile;
+    tempPath = tempFile;
+    lock = nullptr;
+    ready = false;
+    journalSize = 0;
+    ackOffset = 0;
+    pendingCount = 0;
+    generation = 0;
+}
+
+bool EventJournal::begin() {
+    if (!lock) {
+        lock = xSemaphoreCreateMutex();
+        if (!lock) {
+            Serial.println("EventJournal: Failed to create lock");
+            return false;
+        }
+    }
+    xSemaphoreTake(lock, portMAX_DELAY);
+
+    // A rewrite cut off by a reset: the copy is complete once the old file is gone
+    if (SPIFFS.exists(tempPath)) {
+        if (SPIFFS.exists(path)) {
+            SPIFFS.remove(tempPath);
+        } else {
+            SPIFFS.rename(tempPath, path);
+        }
+    }
+
+    uint32_t validEnd = 0;
+    File file = SPIFFS.open(path, "r");
+    if (file) {
+        journalSize = file.size();
+        ackOffset = loadAckOffset();
+        if (ackOffset > journalSize) {
+            ackOffset = 0;
+        }
+
+        bool onBoundary;
+        pendingCount = countRecords(file, ackOffset, validEnd, onBoundary);
+        if (!onBoundary) {
+            // The offset doesn't land on a record: resend everything, the
+            // server skips events it already has
+            Serial.println("EventJournal: Acknowledge offset invalid, resending all records");
+            ackOffset = 0;
+            pendingCount = countRecords(file, 0, validEnd, onBoundary);
+        }
+        file.close();
+    } else {
+        journalSize = 0;
+        ackOffset = 0;
+        pendingCount = 0;
+    }
+
+    if (validEnd < journalSize) {
+        Serial.printf("EventJournal: Dropping %lu bytes after the last whole record\n",
+                      (unsigned long)(journalSize - validEnd));
+        compact(validEnd);
+    } else if (journalSize > 0 && pendingCount == 0) {
+        reset();
+    }
+
+    ready = true;
+    Serial.printf("EventJournal: %lu pending record(s), %lu bytes\n",
+                  (unsigned long)pendingCount, (unsigned long)journalSize);
+    xSemaphoreGive(lock);
+    return true;
+}
+
+bool EventJournal::append(const String& record) {
+    size_t length = record.length();
+    if (!ready || length == 0 || length > MAX_RECORD) {
+        return false;
+    }
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+
+    if (journalSize + HEADER_SIZE + length > MAX_BYTES && ackOffset > 0) {
+        compact(journalSize);
+    }
+    if (journalSize + HEADER_SIZE + length > MAX_BYTES) {
+        Serial.printf("EventJournal: Journal full (%lu records), record dropped\n", (unsigned long)pendingCount);
+        xSemaphoreGive(lock);
+        return false;
+    }
+
+    uint8_t header[HEADER_SIZE];
+    header[0] = FRAME_MAGIC;
+    header[1] = length & 0xFF;
+    header[2] = length >> 8;
+    header[3] = 0;
+    for (size_t i = 0; i < length; i++) {
+        header[3] = crc8(header[3], record[i]);
+    }
+
+    size_t written = 0;
+    File file = SPIFFS.open(path, "a");
+    if (file) {
+        written = file.write(header, HEADER_SIZE);
+        written += file.write((const uint8_t*)record.c_str(), length);
+        file.close();
+    }
+
+    if (written != HEADER_SIZE + length) {
+        // Records appended after a partial frame could not be read back
+        Serial.println("EventJournal: Append failed");
+        if (written > 0) {
+            compact(journalSize);
+        }
+        xSemaphoreGive(lock);
+        return false;
+    }
+
+    journalSize += written;
+    pendingCount++;
+    xSemaphoreGive(lock);
+    return true;
+}
+
+uint16_t EventJournal::readBatch(String& out, uint16_t maxRecords, size_t maxBytes, uint32_t& endOffset, uint16_t& consumed,
+                                 uint32_t& batchGeneration) {
+    uint16_t copied = 0;
+    consumed = 0;
+    endOffset = ackOffset;
+    batchGeneration = generation;
+    if (!ready || pendingCount == 0) {
+        return 0;
+    }
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+    batchGeneration = generation;
+
+    uint32_t offset = ackOffset;
+    File file = SPIFFS.open(path, "r");
+    if (!file || !file.seek(offset)) {
+        xSemaphoreGive(lock);
+        return 0;
+    }
+
+    out.reserve(out.length() + maxBytes);
+    size_t batchBytes = 0;
+    while (consumed < maxRecords && offset < journalSize) {
+        uint16_t length;
+        uint8_t crc;
+        if (!readHeader(file, length, crc)) {
+            break;
+        }
+        if (copied > 0 && batchBytes + length + 1 > maxBytes) {
+            break;
+        }
+
+        unsigned int start = out.length();
+        if (copied > 0) {
+            out += ',';
+        }
+        uint8_t check = 0;
+        uint16_t i = 0;
+        for (; i < length; i++) {
+            int c = file.read();
+            if (c < 0) {
+                break;
+            }
+            check = crc8(check, c);
+            out += (char)c;
+        }
+        if (i < length) {
+            out.remove(start);
+            break;
+        }
+
+        offset += HEADER_SIZE + length;
+        consumed++;
+        if (check != crc) {
+            out.remove(start);
+            Serial.printf("EventJournal: Skipping corrupt record at offset %lu\n",
+                          (unsigned long)(offset - HEADER_SIZE - length));
+            continue;
+        }
+        batchBytes += length + (copied > 0 ? 1 : 0);
+        copied++;
+    }
+    file.close();
+
+    endOffset = offset;
+    xSemaphoreGive(lock);
+    return copied;
+}
+
+bool EventJournal::acknowledge(uint32_t endOffset, uint16_t records, uint32_t batchGeneration) {
+    if (!ready) {
+        return false;
+    }
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+    if (batchGeneration != generation) {
+        // An append compacted the file while the batch was out
+        Serial.println("EventJournal: Journal rewritten since the batch was read, not acknowledging it");
+        xSemaphoreGive(lock);
+        return false;
+    }
+    if (endOffset <= ackOffset || endOffset > journalSize) {
+        xSemaphoreGive(lock);
+        return false;
+    }
+
+    ackOffset = endOffset;
+    pendingCount = records < pendingCount ? pendingCount - records : 0;
+
+    bool saved;
+    if (ackOffset == journalSize) {
+        reset();            // All sent, start over with an empty file
+        saved = true;
+    } else if (ackOffset >= COMPACT_BYTES) {
+        saved = compact(journalSize);
+    } else {
+        saved = saveAckOffset(ackOffset);
+    }
+
+    xSemaphoreGive(lock);
+    return saved;
+}
+
+// Walk the frames from the start of the file, counting those at or after
+// from; validEnd is where the last whole frame ends
+uint32_t EventJournal::countRecords(File& file, uint32_t from, uint32_t& validEnd, bool& onBoundary) {
+    uint32_t count = 0;
+    validEnd = 0;
+    onBoundary = (from == 0);
+    if (!file.seek(0)) {
+        return 0;
+    }
+
+    uint16_t length;
+    uint8_t crc;
+    while (validEnd + HEADER_SIZE <= journalSize && readHeader(file, length, crc) &&
+           validEnd + HEADER_SIZE + length <= journalSize) {
+        if (!file.seek(length, SeekCur)) {
+            break;
+        }
+        if (validEnd >= from) {
+            count++;
+        }
+        validEnd += HEADER_SIZE + length;
+        if (validEnd == from) {
+            onBoundary = true;
+        }
+    }
+    return count;
+}
+
+bool EventJournal::readHeader(File& file, uint16_t& length, uint8_t& crc) {
+    uint8_t header[HEADER_SIZE];
+    if (file.read(header, HEADER_SIZE) != HEADER_SIZE || header[0] != FRAME_MAGIC) {
+        return false;
+    }
+    length = header[1] | (header[2] << 8);
+    crc = header[3];
+    return length > 0 && length <= MAX_RECORD;
+}
+
+// Offset followed by its complement, so a torn write reads as 0
+bool EventJournal::saveAckOffset(uint32_t offset) {
+    File file = SPIFFS.open(ackPath, "w");
+    if (!file) {
+        Serial.println("EventJournal: Failed to save acknowledge offset");
+        return false;
+    }
+    uint32_t data[2] = {offset, ~offset};
+    bool ok = file.write((const uint8_t*)data, sizeof(data)) == sizeof(data);
+    file.close();
+    return ok;
+}
+
+uint32_t EventJournal::loadAckOffset() {
+    File file = SPIFFS.open(ackPath, "r");
+    if (!file) {
+        return 0;
+    }
+    uint32_t data[2] = {0, 0};
+    bool ok = file.read((uint8_t*)data, sizeof(data)) == sizeof(data);
+    file.close();
+    return ok && data[1] == ~data[0] ? data[0] : 0;
+}
+
+// Rewrite the journal with only the unacknowledged records up to validEnd
+bool EventJournal::compact(uint32_t validEnd) {
+    if (validEnd <= ackOffset) {
+        reset();
+        return true;
+    }
+
+    File in = SPIFFS.open(path, "r");
+    File out = SPIFFS.open(tempPath, "w");
+    bool ok = in && out && in.seek(ackOffset);
+
+    uint8_t buffer[256];
+    uint32_t left = validEnd - ackOffset;
+    while (ok && left > 0) {
+        size_t got = in.read(buffer, left < sizeof(buffer) ? left : sizeof(buffer));
+        ok = got > 0 && out.write(buffer, got) == got;
+        left -= got;
+    }
+    if (in) in.close();
+    if (out) out.close();
+
+    if (!ok) {
+        Serial.println("EventJournal: Compaction failed");
+        SPIFFS.remove(tempPath);
+        return false;
+    }
+
+    // Offsets restart at 0 in the new file. Saved first, so a reset before
+    // the rename can only resend acknowledged records, never skip any.
+    saveAckOffset(0);
+    SPIFFS.remove(path);
+    if (!SPIFFS.rename(tempPath, path)) {
+        Serial.println("EventJournal: Failed to replace journal");
+        return false;
+    }
+
+    journalSize = validEnd - ackOffset;
+    ackOffset = 0;
+    generation++;
+    return true;
+}
+
+void EventJournal::reset() {
+    SPIFFS.remove(path);
+    SPIFFS.remove(ackPath);
+    journalSize = 0;
+    ackOffset = 0;
+    pendingCount = 0;
+    generation++;
+}
+
+// CRC-8, polynomial 0x07
+uint8_t EventJournal::crc8(uint8_t crc, uint8_t data) {
+    crc ^= data;
+    for (uint8_t i = 0; i < 8; i++) {
+        crc = (crc & 0x80) ? (crc << 1) ^ 0x07 : crc << 1;
+    }
+    return crc;
+}
@@ -5,7 +5,8 @@ const char* EventLogger::LOG_FILE = "/events.jsonl";
 
 EventLogger::EventLogger() : nextEventId(1) {
     // Initialize current events array
-    for (int i = 0; i < 4; i++) {
+    for (int i = 0; i < MAX_CURRENT_EVENTS; i++) {
+        currentEvents[i].eventId = 0;
         currentEvents[i].startTime = 0;
         currentEvents[i].endTime = 0;
         currentEvents[i].zoneId = 0;
@@ -52,8 +53,8 @@ bool EventLogger::begin() {
     return true;
 }
 
-uint32_t EventLogger::logEventStart(uint8_t zoneId, uint16_t durationMin, EventType type, uint32_t scheduleId) {
-    if (zoneId < 1 || zoneId > 4) {
+uint32_t EventLogger::logEventStart(uint8_t zoneId, uint16_t durationMin, EventType type, uint32_t scheduleId, uint32_t serverId) {
+    if (zoneId < 1 || zoneId > HUNTER_MAX_ZONE) {
         Serial.println("EventLogger: Invalid zone ID: " + String(zoneId));
         return 0;
     }
@@ -64,10 +65,26 @@ uint32_t EventLogger::logEventStart(uint8_t zoneId, uint16_t durationMin, EventT
         return 0;
     }
 
+    // Reuse the zone's slot if it is still open, otherwise take a free one
+    int idx = -1;
+    for (int i = 0; i < MAX_CURRENT_EVENTS; i++) {
+        if (currentEvents[i].zoneId == zoneId) {
+            idx = i;
+            break;
+        }
+        if (idx < 0 && currentEvents[i].zoneId == 0) {
+            idx = i;
+        }
+    }
+    if (idx < 0) {
+        Serial.println("EventLogger: Too many concurrent events, not tracking zone " + String(zoneId));
+        return 0;
+    }
+
     uint32_t eventId = nextEventId++;
-    int idx = zoneId - 1;
 
     // Store in current events
+    currentEvents[idx].eventId = eventId;
     currentEvents[idx].startTime = now;
     currentEvents[idx].endTime = 0;
     currentEvents[idx].zoneId = zoneId;
@@ -75,6 +92,7 @@ uint32_t EventLogger::logEventStart(uint8_t zoneId, uint16_t durationMin, EventT
     currentEvents[idx].actualDurationSec = 0;
     currentEvents[idx].eventType = type;
     currentEvents[idx].scheduleId = scheduleId;
+    currentEvents[idx].serverId = serverId;
     currentEvents[idx].completed = false;
 
     // Log immediately to file (start event)
@@ -88,6 +106,9 @@ uint32_t EventLogger::logEventStart(uint8_t zoneId, uint16_t durationMin, EventT
     if (scheduleId > 0) {
         doc["schedule_id"] = scheduleId;
     }
+    if (serverId > 0) {
+        doc["server_id"] = serverId;
+    }
     doc["completed"] = false;
     doc["status"] = "running";
 
@@ -118,9 +139,9 @@ bool EventLogger::logEventEnd(uint32_t eventId, bool completed) {
 
     // Find the event in current events
     WateringEvent* event = nullptr;
-    for (int i = 0; i < 4; i++) {
-        if (currentEvents[i].zoneId > 0 && currentEvents[i].startTime > 0) {
-            // Match by zone and start time (approximate event ID)
+    for (int i = 0; i < MAX_CURRENT_EVENTS; i++) {
+        if (currentEvents[i].zoneId > 0 && currentEvents[i].startTime > 0 &&
+            (eventId == 0 || currentEvents[i].eventId == eventId)) {
             event = &currentEvents[i];
             break;
         }
@@ -137,7 +158,7 @@ bool EventLogger::logEventEnd(uint32_t eventId, bool completed) {
 
     // Log completion to file
     JsonDocument doc;
-    doc["id"] = eventId;
+    doc["id"] = event->eventId;
     doc["zone_id"] = event->zoneId;
     doc["start_time"] = event->startTime;
     doc["end_time"] = now;
@@ -147,6 +168,9 @@ bool EventLogger::logEventEnd(uint32_t eventId, bool completed) {
     if (event->scheduleId > 0) {
         doc["schedule_id"] = event->scheduleId;
     }
+    if (event->serverId > 0) {
+        doc["server_id"] = event->serverId;
+    }
     doc["completed"] = completed;
     doc["status"] = completed ? "completed" : "interrupted";
 
@@ -158,12 +182,13 @@ bool EventLogger::logEventEnd(uint32_t eventId, bool completed) {
         file.println(jsonLine);
         file.close();
 
-        Serial.println("EventLogger: Ended event " + String(eventId) +
+        Serial.println("EventLogger: Ended event " + String(event->eventId) +
                       " (Zone " + String(event->zoneId) + ", " +
                       String(event->actualDurationSec) + " sec, " +
                       (completed ? "completed" : "interrupted") + ")");
 
         // Clear from current events
+        event->eventId = 0;
         event->zoneId = 0;
         event->startTime = 0;
 
@@ -174,6 +199,15 @@ bool EventLogger::logEventEnd(uint32_t eventId, bool completed) {
     }
 }
 
+uint32_t EventLogger::getActiveEventId(uint8_t zoneId) const {
+    for (int i = 0; i < MAX_CURRENT_EVENTS; i++) {
+        if (currentEvents[i].zoneId == zoneId && currentEvents[i].startTime > 0) {
+            return currentEvents[i].eventId;
+        }
+    }
+    return 0;
+}
+
 String EventLogger::getEventsJson(int limit, time_t startDate, time_t endDate) {
     JsonDocument doc;
     JsonArray events = doc["events"].to<JsonArray>();
@@ -0,0 +1,338 @@
+#include "gzip_codec.h"
+#include <esp32/rom/crc.h>
+
+// Optional gzip header fields (RFC 1952), in the order they appear
+static const uint8_t GZIP_FEXTRA = 0x04;
+static const uint8_t GZIP_FNAME = 0x08;
+static const uint8_t GZIP_FCOMMENT = 0x10;
+static const uint8_t GZIP_FHCRC = 0x02;
+
+static uint32_t readLE32(const uint8_t* p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+GzipInflater::GzipInflater() {
+    state = GZIP_HEADER;
+    decompressor = nullptr;
+    dict = nullptr;
+    dictPos = 0;
+    moreOutput = false;
+    crc = 0;
+    outputSize = 0;
+    fixedPos = 0;
+    flags = 0;
+    skip = 0;
+    lengthPos = 0;
+}
+
+GzipInflater::~GzipInflater() {
+    free(decompressor);
+    free(dict);
+}
+
+bool GzipInflater::canAllocate() {
+    return ESP.getMaxAllocHeap() >= DICT_SIZE + HEAP_MARGIN &&
+           ESP.getFreeHeap() >= DICT_SIZE + sizeof(tinfl_decompressor) + HEAP_MARGIN;
+}
+
+bool GzipInflater::begin() {
+    if (!decompressor) {
+        decompressor = (tinfl_decompressor*)malloc(sizeof(tinfl_decompressor));
+    }
+    if (!dict) {
+        dict = (uint8_t*)malloc(DICT_SIZE);
+    }
+    if (!decompressor || !dict) {
+        state = GZIP_ERROR;
+        return false;
+    }
+
+    tinfl_init(decompressor);
+    state = GZIP_HEADER;
+    dictPos = 0;
+    moreOutput = false;
+    crc = 0;
+    outputSize = 0;
+    fixedPos = 0;
+    return true;
+}
+
+bool GzipInflater::inflate(const uint8_t* in, size_t& inLength, const uint8_t*& out, size_t& outLength) {
+    size_t used = 0;
+    out = nullptr;
+    outLength = 0;
+
+    while (state == GZIP_HEADER && used < inLength) {
+        if (headerByte(in[used++])) {
+            state = GZIP_BODY;
+        }
+    }
+
+    if (state == GZIP_BODY) {
+        // The dictionary doubles as the output buffer: output is written at
+        // dictPos up to its end, then wraps around
+        size_t inSize = inLength - used;
+        size_t outSize = DICT_SIZE - dictPos;
+        tinfl_status status = tinfl_decompress(decompressor, in + used, &inSize, dict, dict + dictPos, &outSize,
+                                               TINFL_FLAG_HAS_MORE_INPUT);
+        used += inSize;
+
+        out = dict + dictPos;
+        outLength = outSize;
+        crc = crc32_le(crc, out, outSize);
+        outputSize += outSize;
+        dictPos = (dictPos + outSize) & (DICT_SIZE - 1);
+        moreOutput = (status == TINFL_STATUS_HAS_MORE_OUTPUT);
+
+        if (status == TINFL_STATUS_DONE) {
+            state = GZIP_TRAILER;
+            fixedPos = 0;
+            takeLookAhead();
+        } else if (status < 0) {
+            state = GZIP_ERROR;
+        }
+    }
+
+    // CRC-32 and length of the data, checked against what came out
+    while (state == GZIP_TRAILER && fixedPos < 8 && used < inLength) {
+        fixed[fixedPos++] = in[used++];
+    }
+    if (state == GZIP_TRAILER && fixedPos == 8) {
+        bool valid = readLE32(fixed) == crc && readLE32(fixed + 4) == outputSize;
+        state = valid ? GZIP_DONE : GZIP_ERROR;
+    }
+
+    inLength = used;
+    return state != GZIP_ERROR;
+}
+
+// The ROM tinfl refills its bit buffer two bytes at a time and reports
+// them as used, so when the stream ends the first trailer bytes can already
+// be sitting in the bit buffer instead of in what's left of the input
+void GzipInflater::takeLookAhead() {
+    uint32_t bits = decompressor->m_num_bits;
+    uint32_t buffered = decompressor->m_bit_buf >> (bits & 7);
+    bits &= ~7u;
+    while (bits >= 8 && fixedPos < 8) {
+        fixed[fixedPos++] = buffered & 0xFF;
+        buffered >>= 8;
+        bits -= 8;
+    }
+    decompressor->m_num_bits = 0;
+    decompressor->m_bit_buf = 0;
+}
+
+// Take one header byte; true once the whole header has been read
+bool GzipInflater::headerByte(uint8_t c) {
+    if (fixedPos < sizeof(fixed)) {
+        fixed[fixedPos++] = c;
+        if (fixedPos < sizeof(fixed)) {
+            return false;
+        }
+        if (fixed[0] != 0x1F || fixed[1] != 0x8B || fixed[2] != 8) {
+            state = GZIP_ERROR;     // Not gzip, or not deflate
+            return false;
+        }
+        flags = fixed[3] & (GZIP_FEXTRA | GZIP_FNAME | GZIP_FCOMMENT | GZIP_FHCRC);
+        skip = 0;
+        lengthPos = 0;
+        return flags == 0;
+    }
+
+    if (flags & GZIP_FEXTRA) {
+        if (lengthPos < 2) {
+            skip |= c << (8 * lengthPos++);
+            if (lengthPos == 2 && skip == 0) {
+                flags &= ~GZIP_FEXTRA;
+            }
+        } else if (--skip == 0) {
+            flags &= ~GZIP_FEXTRA;
+        }
+    } else if (flags & GZIP_FNAME) {
+        if (c == 0) {
+            flags &= ~GZIP_FNAME;
+        }
+    } else if (flags & GZIP_FCOMMENT) {
+        if (c == 0) {
+            flags &= ~GZIP_FCOMMENT;
+        }
+    } else if (flags & GZIP_FHCRC) {
+        if (++skip == 2) {
+            flags &= ~GZIP_FHCRC;
+        }
+    }
+    return flags == 0;
+}
+
+// ===== COMPRESSION =====
+
+static const uint16_t DEFLATE_WINDOW = 4096;
+static const uint8_t DEFLATE_HASH_BITS = 10;
+static const uint16_t DEFLATE_MAX_MATCH = 258;
+
+static const uint16_t LENGTH_BASE[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+static const uint8_t LENGTH_EXTRA[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+// Codes up to 4 KB, the match window
+static const uint16_t DIST_BASE[24] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073
+};
+static const uint8_t DIST_EXTRA[24] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10
+};
+
+// Packs deflate bits LSB first into a fixed buffer
+struct DeflateWriter {
+    uint8_t* out;
+    size_t size;
+    size_t pos;
+    uint32_t bits;
+    uint8_t count;
+    bool overflow;
+
+    void putBits(uint32_t value, uint8_t length) {
+        bits |= value << count;
+        count += length;
+        while (count >= 8) {
+            putByte(bits & 0xFF);
+            bits >>= 8;
+            count -= 8;
+        }
+    }
+
+    // Huffman codes are sent starting from their most significant bit
+    void putCode(uint16_t code, uint8_t length) {
+        uint16_t reversed = 0;
+        for (uint8_t i = 0; i < length; i++) {
+            reversed = (reversed << 1) | (code & 1);
+            code >>= 1;
+        }
+        putBits(reversed, length);
+    }
+
+    // Literal/length symbol with the fixed code table
+    void putSymbol(uint16_t symbol) {
+        if (symbol < 144) {
+            putCode(0x30 + symbol, 8);
+        } else if (symbol < 256) {
+            putCode(0x190 + symbol - 144, 9);
+        } else if (symbol < 280) {
+            putCode(symbol - 256, 7);
+        } else {
+            putCode(0xC0 + symbol - 280, 8);
+        }
+    }
+
+    void putMatch(uint16_t length, uint16_t distance) {
+        uint8_t i = 28;
+        while (LENGTH_BASE[i] > length) i--;
+        putSymbol(257 + i);
+        putBits(length - LENGTH_BASE[i], LENGTH_EXTRA[i]);
+
+        uint8_t d = 23;
+        while (DIST_BASE[d] > distance) d--;
+        putCode(d, 5);
+        putBits(distance - DIST_BASE[d], DIST_EXTRA[d]);
+    }
+
+    void putByte(uint8_t value) {
+        if (pos < size) {
+            out[pos++] = value;
+        } else {
+            overflow = true;
+        }
+    }
+
+    void putLE32(uint32_t value) {
+        for (uint8_t i = 0; i < 4; i++) {
+            putByte(value >> (8 * i));
+        }
+    }
+
+    void flush() {
+        if (count > 0) {
+            putByte(bits & 0xFF);
+        }
+        bits = 0;
+        count = 0;
+    }
+};
+
+static uint16_t hash3(const uint8_t* p) {
+    uint32_t v = p[0] | (p[1] << 8) | (p[2] << 16);
+    return (v * 2654435761u) >> (32 - DEFLATE_HASH_BITS);
+}
+
+size_t gzipCompress(const uint8_t* data, size_t length, uint8_t* out, size_t outSize) {
+    if (length >= 65535) {
+        return 0;
+    }
+
+    // Last position (+1) of each 3-byte hash; one candidate per match
+    uint16_t* table = (uint16_t*)calloc(1 << DEFLATE_HASH_BITS, sizeof(uint16_t));
+    if (!table) {
+        return 0;
+    }
+
+    DeflateWriter writer = {out, outSize, 0, 0, 0, false};
+
+    // Header: deflate, no name, no time, unknown OS
+    static const uint8_t header[10] = {0x1F, 0x8B, 8, 0, 0, 0, 0, 0, 0, 0xFF};
+    for (uint8_t i = 0; i < sizeof(header); i++) {
+        writer.putByte(header[i]);
+    }
+
+    // One final block with the fixed codes
+    writer.putBits(1, 1);
+    writer.putBits(1, 2);
+
+    size_t pos = 0;
+    while (pos < length && !writer.overflow) {
+        uint16_t matchLength = 0;
+        uint16_t distance = 0;
+
+        if (pos + 3 <= length) {
+            uint16_t h = hash3(data + pos);
+            uint16_t candidate = table[h];
+            table[h] = pos + 1;
+
+            if (candidate > 0 && pos - (candidate - 1) <= DEFLATE_WINDOW) {
+                size_t from = candidate - 1;
+                size_t limit = length - pos < DEFLATE_MAX_MATCH ? length - pos : DEFLATE_MAX_MATCH;
+                size_t n = 0;
+                while (n < limit && data[from + n] == data[pos + n]) n++;
+                if (n >= 3) {
+                    matchLength = n;
+                    distance = pos - from;
+                }
+            }
+        }
+
+        if (matchLength > 0) {
+            writer.putMatch(matchLength, distance);
+            // Index the bytes inside the match too, so later repeats find them
+            for (size_t i = 1; i < matchLength && pos + i + 3 <= length; i++) {
+                table[hash3(data + pos + i)] = pos + i + 1;
+            }
+            pos += matchLength;
+        } else {
+            writer.putSymbol(data[pos]);
+            pos++;
+        }
+    }
+    free(table);
+
+    writer.putSymbol(256);      // End of block
+    writer.flush();
+    writer.putLE32(crc32_le(0, data, length));
+    writer.putLE32(length);
+
+    return writer.overflow ? 0 : writer.pos;
+}
@@ -0,0 +1,202 @@
+#include "http_body_reader.h"
+
+HttpBodyReader::HttpBodyReader(Stream& source, int contentLength, bool isChunked, File* copyTo, bool isGzip)
+    : stream(source) {
+    copy = copyTo;
+    chunked = isChunked;
+    remaining = chunked ? 0 : contentLength;
+    firstChunk = true;
+    lastChunk = false;
+    ended = false;
+    copyError = false;
+    gzip = isGzip;
+    decodeError = gzip && !inflater.begin();
+    rawLength = 0;
+    rawPos = 0;
+    data = buffer;
+    bufferLength = 0;
+    bufferPos = 0;
+    bytesRead = 0;
+}
+
+int HttpBodyReader::read() {
+    if (bufferPos >= bufferLength && !fill()) {
+        return -1;
+    }
+    return (uint8_t)data[bufferPos++];
+}
+
+size_t HttpBodyReader::readBytes(char* out, size_t length) {
+    size_t copied = 0;
+    while (copied < length) {
+        if (bufferPos >= bufferLength && !fill()) {
+            break;
+        }
+        size_t n = bufferLength - bufferPos;
+        if (n > length - copied) {
+            n = length - copied;
+        }
+        memcpy(out + copied, data + bufferPos, n);
+        bufferPos += n;
+        copied += n;
+    }
+    return copied;
+}
+
+bool HttpBodyReader::skipRest() {
+    bufferPos = bufferLength;
+    while (fill()) {
+        bufferPos = bufferLength;
+    }
+    // Anything after the end of a gzip stream (or a corrupt one)
+    rawPos = rawLength;
+    while (fillRaw()) {
+        rawPos = rawLength;
+    }
+    return isComplete();
+}
+
+bool HttpBodyReader::isComplete() const {
+    if (!ended) {
+        return false;
+    }
+    if (gzip && (decodeError || !inflater.isDone())) {
+        return false;
+    }
+    if (chunked) {
+        return lastChunk;
+    }
+    return remaining <= 0;
+}
+
+// Hand out the next piece of body; false at the end of it
+bool HttpBodyReader::fill() {
+    bufferLength = 0;
+    bufferPos = 0;
+
+    if (!gzip) {
+        if (!fillRaw()) {
+            return false;
+        }
+        data = buffer;
+        bufferLength = rawLength;
+        rawPos = rawLength;
+    } else {
+        // Feed received bytes to the inflater until it puts something out
+        while (bufferLength == 0) {
+            if (decodeError || inflater.isDone()) {
+                return false;
+            }
+            if (rawPos >= rawLength && !inflater.hasMoreOutput() && !fillRaw()) {
+                return false;
+            }
+
+            size_t used = rawLength - rawPos;
+            const uint8_t* out;
+            size_t outLength;
+            if (!inflater.inflate((const uint8_t*)buffer + rawPos, used, out, outLength) ||
+                (used == 0 && outLength == 0 && rawPos < rawLength)) {
+                decodeError = true;
+                return false;
+            }
+            rawPos += used;
+            data = (const char*)out;
+            bufferLength = outLength;
+        }
+    }
+
+    if (copy && !copyError && copy->write((const uint8_t*)data, bufferLength) != bufferLength) {
+        copyError = true;
+    }
+    return true;
+}
+
+// Refill the buffer with the next bytes of the body as received
+bool HttpBodyReader::fillRaw() {
+    rawLength = 0;
+    rawPos = 0;
+    if (ended) {
+        return false;
+    }
+
+    if (chunked && remaining == 0 && !nextChunk()) {
+        ended = true;
+        return false;
+    }
+    if (!chunked && remaining == 0) {
+        ended = true;
+        return false;
+    }
+
+    // Never ask for more than the body (or chunk) still holds, so the read
+    // doesn't sit out the socket timeout waiting for bytes that won't come
+    size_t want = BUFFER_SIZE;
+    if (remaining > 0 && (size_t)remaining < want) {
+        want = remaining;
+    } else if (remaining < 0) {
+        int available = stream.available();
+        want = available <= 0 ? 1 : (size_t)available < want ? available : want;
+    }
+
+    size_t got = stream.readBytes(buffer, want);
+    if (got == 0) {
+        ended = true;       // Timed out or closed
+        return false;
+    }
+    if (remaining > 0) {
+        remaining -= got;
+    }
+
+    rawLength = got;
+    bytesRead += got;
+    return true;
+}
+
+// Read the next chunk header; false once the last (empty) chunk is reached
+bool HttpBodyReader::nextChunk() {
+    char line[MAX_LINE];
+
+    // Data of the previous chunk is followed by CRLF
+    if (!firstChunk && !readLine(line, sizeof(line))) {
+        return false;
+    }
+    firstChunk = false;
+
+    if (!readLine(line, sizeof(line))) {
+        return false;
+    }
+    char* end = nullptr;
+    unsigned long size = strtoul(line, &end, 16);
+    if (end == line) {
+        return false;       // Not a chunk header
+    }
+
+    if (size == 0) {
+        // Skip trailers up to the blank line that ends the response
+        while (readLine(line, sizeof(line)) && line[0] != '\0') {
+        }
+        lastChunk = true;
+        return false;
+    }
+
+    remaining = size;
+    return true;
+}
+
+bool HttpBodyReader::readLine(char* line, size_t size) {
+    size_t length = 0;
+    while (true) {
+        char c;
+        if (stream.readBytes(&c, 1) != 1) {
+            return false;
+        }
+        if (c == '\n') {
+            break;
+        }
+        if (c != '\r' && length < size - 1) {
+            line[length++] = c;
+        }
+    }
+    line[length] = '\0';
+    return true;
+}
@@ -2,25 +2,75 @@
 #include "config_manager.h"
 #include "schedule_manager.h"
 #include "rtc_module.h"
+#include "http_body_reader.h"
+#include "gzip_codec.h"
 #include <SPIFFS.h>
 
-HTTPScheduleClient::HTTPScheduleClient() {
+HTTPScheduleClient::HTTPScheduleClient()
+    : pendingEvents("/events/pending.log", "/events/pending.ack", "/events/pending.tmp"),
+      scheduleSnapshot("/schedules/snapshot.bin", "/schedules/snapshot.new") {
     configManager = nullptr;
     scheduleManager = nullptr;
     serverUrl = "http://172.17.254.10:2880";  // Default server
     deviceId = "esp32_irrigation_001";         // Default device ID
     lastFetchTime = 0;
     lastError = "";
+    lastResultError[0] = '\0';
     consecutiveFailures = 0;
-
-    zoneDetailsCount = 0;
+    lastHttpCode = 0;
+    rangeSupported = true;
+    rangeUnsupportedAt = 0;
+    lastFetchDurationMs = 0;
+    lastFetchRequests = 0;
+    appliedRevision = ScheduleRevision();
+    fetchedRevision = ScheduleRevision();
+    responseRevision = 0;
+    lastFetchDelta = false;
+    deltaSyncs = 0;
+    fullResyncs = 0;
+    lastRequestAt = 0;
+    connectionsOpened = 0;
+    connectionsReused = 0;
+    connectionsDropped = 0;
+    notModifiedCount = 0;
+    lastNotModified = false;
+    gzipUploads = true;
+    gzipResponses = 0;
+    gzipResponseBytes = 0;
+    gzipInflatedBytes = 0;
+    gzipUploadCount = 0;
+    gzipUploadBytes = 0;
+    gzipUploadPlainBytes = 0;
+    for (uint8_t i = 0; i < MAX_VALIDATORS; i++) {
+        validators[i].urlHash = 0;
+    }
+    for (uint8_t i = 0; i < HTTP_ENDPOINT_COUNT; i++) {
+        breakers[i] = CircuitBreaker();
+        breakers[i].state = BREAKER_CLOSED;
+    }
+
+    zoneDetails = new ZoneDetailsTable();
+    zoneDetailsStaging = new ZoneDetailsTable();
+    zoneDetailsHash = 0;
+    zoneDetailsJson = "[]";
     lastZoneDetailsFetchTime = 0;
-    for (uint8_t i = 0; i <= MAX_ZONE_ID; i++) {
-        zoneHasData[i] = false;
-        zoneNames[i] = "";
-        zoneActive[i] = false;
-        zoneWaterRateLpm[i] = 0.0f;
-        zoneDatabaseId[i] = 0;
+    buildFilters();
+
+    snapshotLock = nullptr;
+    aiClearGeneration = 0;
+    jobQueue = nullptr;
+    resultQueue = nullptr;
+    workerTask = nullptr;
+    nextJobId = 1;
+    activeJobId = 0;
+    activeDeadline = 0;
+    nextCancelSlot = 0;
+    recentCount = 0;
+    for (uint8_t i = 0; i < 4; i++) {
+        pendingJobs[i] = 0;
+    }
+    for (uint8_t i = 0; i < CANCEL_SLOTS; i++) {
+        cancelledIds[i] = 0;
     }
 }
 
@@ -33,6 +83,14 @@ bool HTTPScheduleClient::begin(ConfigManager* config, ScheduleManager* schedule)
         return false;
     }
 
+    if (!snapshotLock) {
+        snapshotLock = xSemaphoreCreateMutex();
+        if (!snapshotLock) {
+            Serial.println("HTTP Client: Failed to create snapshot lock");
+            return false;
+        }
+    }
+
     // Initialize SPIFFS for schedule caching
     if (!SPIFFS.begin(true)) {  // true = format if mount fails
         Serial.println("HTTP Client: WARNING - SPIFFS mount failed");
@@ -54,6 +112,13 @@ bool HTTPScheduleClient::begin(ConfigManager* config, ScheduleManager* schedule)
 
         // Clean up old cache files (keep last 7 days)
         clearOldCache(7);
+
+        if (pendingEvents.begin()) {
+            importLegacyPendingEvents();
+        }
+
+        // The last fetched horizon runs until the server is reached again
+        restoreScheduleSnapshot();
     }
 
     // Get device ID from MAC address if available
@@ -75,6 +140,19 @@ void HTTPScheduleClient::setServerUrl(const String& url) {
         serverUrl = serverUrl.substring(0, serverUrl.length() - 1);
     }
     Serial.println("HTTP Client: Server URL set to " + serverUrl);
+    closeConnection();  // The kept-alive connection belongs to the old server
+    for (uint8_t i = 0; i < MAX_VALIDATORS; i++) {
+        validators[i].urlHash = 0;  // So do the validators
+    }
+    for (uint8_t i = 0; i < HTTP_ENDPOINT_COUNT; i++) {
+        breakers[i].state = BREAKER_CLOSED;  // And the breaker states
+        breakers[i].failures = 0;
+        breakers[i].trips = 0;
+    }
+    rangeSupported = true;  // Give a new server the chance to answer range requests
+    rangeUnsupportedAt = 0;
+    appliedRevision = ScheduleRevision();  // Revisions are per server
+    gzipUploads = true;     // And compressed uploads
 }
 
 void HTTPScheduleClient::setDeviceId(const String& id) {
@@ -82,9 +160,14 @@ void HTTPScheduleClient::setDeviceId(const String& id) {
     Serial.println("HTTP Client: Device ID set to " + deviceId);
 }
 
-String HTTPScheduleClient::buildScheduleUrl(const String& date, int8_t zoneId) {
+String HTTPScheduleClient::buildScheduleUrl(const String& date, int8_t zoneId, int days) {
     String url = serverUrl + "/api/schedules/daily?date=" + date;
 
+    // Range form: this date and the following days in one response
+    if (days > 1) {
+        url += "&days=" + String(days);
+    }
+
     // Add device_id parameter for multi-device filtering
     if (deviceId.length() > 0) {
         url += "&device_id=" + deviceId;
@@ -104,18 +187,46 @@ String HTTPScheduleClient::buildZoneDetailsUrl() {
     return url;
 }
 
-bool HTTPScheduleClient::parseZoneDetailsResponse(const String& json) {
+// Fields the parsers read; everything else in a response is skipped while
+// it streams in and never reaches the heap
+void HTTPScheduleClient::buildFilters() {
+    scheduleFilter["success"] = true;
+    scheduleFilter["error"] = true;
+    scheduleFilter["days_returned"] = true;
+    scheduleFilter["revision"] = true;
+    JsonObject change = scheduleFilter["changes"][0].to<JsonObject>();
+    change["op"] = true;
+    change["id"] = true;
+    change["date"] = true;
+    change["zone_id"] = true;
+    change["start_time"] = true;
+    change["duration_min"] = true;
+    change["repeat_count"] = true;
+    change["rest_time_min"] = true;
+    JsonObject zone = scheduleFilter["data"]["*"][0].to<JsonObject>();
+    zone["zone_id"] = true;
+    JsonObject event = zone["events"][0].to<JsonObject>();
+    event["id"] = true;
+    event["start_time"] = true;
+    event["duration_min"] = true;
+    event["repeat_count"] = true;
+    event["rest_time_min"] = true;
+    event["priority"] = true;
+
+    zoneDetailsFilter["success"] = true;
+    zoneDetailsFilter["error"] = true;
+    JsonObject detail = zoneDetailsFilter["zones"][0].to<JsonObject>();
+    detail["zone_id"] = true;
+    detail["zone_name"] = true;
+    detail["active"] = true;
+    detail["water_rate_lpm"] = true;
+    detail["database_zone_id"] = true;
+}
+
+bool HTTPScheduleClient::parseZoneDetailsResponse(JsonDocument& doc, ZoneDetailsTable& out) {
     // Response example:
     // { success:true, device_id:"...", generated_at:"...", count:N, zones:[{zone_id, zone_name, database_zone_id, water_rate_lpm, active}, ...] }
 
-    DynamicJsonDocument doc(4096);
-    DeserializationError error = deserializeJson(doc, json);
-    if (error) {
-        lastError = "Zone details JSON parse failed: " + String(error.c_str());
-        Serial.println("HTTP Client: " + lastError);
-        return false;
-    }
-
     if (!doc["success"].is<bool>() || !doc["success"].as<bool>()) {
         const char* errMsg = doc["error"].is<const char*>() ? doc["error"].as<const char*>() : "Unknown error";
         lastError = "Zone details request failed: " + String(errMsg);
@@ -130,15 +241,7 @@ bool HTTPScheduleClient::parseZoneDetailsResponse(const String& json) {
         return false;
     }
 
-    // Clear cache
-    zoneDetailsCount = 0;
-    for (uint8_t i = 0; i <= MAX_ZONE_ID; i++) {
-        zoneHasData[i] = false;
-        zoneNames[i] = "";
-        zoneActive[i] = false;
-        zoneWaterRateLpm[i] = 0.0f;
-        zoneDatabaseId[i] = 0;
-    }
+    out.clear();
 
     for (JsonVariant v : zones) {
         if (!v.is<JsonObject>()) continue;
@@ -149,20 +252,124 @@ bool HTTPScheduleClient::parseZoneDetailsResponse(const String& json) {
             continue;
         }
 
-        const char* zoneName = z["zone_name"] | "";
-        zoneHasData[zoneId] = true;
-        zoneNames[zoneId] = String(zoneName);
-        zoneActive[zoneId] = z["active"] | false;
-        zoneWaterRateLpm[zoneId] = z["water_rate_lpm"] | 0.0;
-        zoneDatabaseId[zoneId] = z["database_zone_id"] | 0;
-        zoneDetailsCount++;
+        out.set(zoneId, z["zone_name"] | "", z["active"] | false, z["water_rate_lpm"] | 0.0f,
+                z["database_zone_id"] | 0);
     }
+    out.seal();
 
-    Serial.println("HTTP Client: Loaded " + String(zoneDetailsCount) + " zone detail entries");
+    Serial.println("HTTP Client: Loaded " + String(out.count) + " zone detail entries");
     return true;
 }
 
+void ZoneDetailsTable::clear() {
+    memset(zones, 0, sizeof(zones));
+    names[0] = '\0';      // Offset 0 is the empty name
+    namesUsed = 1;
+    count = 0;
+    namesCut = 0;
+    hash = 0;
+}
+
+void ZoneDetailsTable::set(uint8_t zoneId, const char* name, bool active, float waterRateLpm, uint32_t databaseId) {
+    ZoneDetail& zone = zones[zoneId];
+    if (!zone.loaded) {
+        count++;
+    }
+    zone.loaded = 1;
+    zone.active = active ? 1 : 0;
+    zone.waterRateLpm = waterRateLpm;
+    zone.databaseId = databaseId;
+    zone.nameOffset = 0;
+
+    size_t length = strlen(name);
+    if (length > MAX_NAME) {
+        Serial.printf("HTTP Client: Name of zone %d is %u characters, keeping the first %u\n", zoneId,
+                      (unsigned)length, MAX_NAME);
+        length = MAX_NAME;
+        namesCut++;
+    }
+    if (length == 0) {
+        return;
+    }
+
+    // Zones often share a name; keep one copy
+    for (uint8_t i = 1; i <= HUNTER_MAX_ZONE; i++) {
+        if (i != zoneId && zones[i].nameOffset > 0 && strncmp(names + zones[i].nameOffset, name, length) == 0 &&
+            names[zones[i].nameOffset + length] == '\0') {
+            zone.nameOffset = zones[i].nameOffset;
+            return;
+        }
+    }
+
+    if (namesUsed + length + 1 > NAME_ARENA) {
+        Serial.printf("HTTP Client: No room for the name of zone %d\n", zoneId);
+        return;
+    }
+    zone.nameOffset = namesUsed;
+    memcpy(names + namesUsed, name, length);
+    names[namesUsed + length] = '\0';
+    namesUsed += length + 1;
+}
+
+// FNV-1a over the zones and their names (not the arena layout, which
+// depends on the order the zones came in)
+void ZoneDetailsTable::seal() {
+    if (count == 0) {
+        hash = 0;
+        return;
+    }
+
+    uint32_t h = 2166136261u;
+    for (uint8_t i = 1; i <= HUNTER_MAX_ZONE; i++) {
+        if (!zones[i].loaded) continue;
+        uint8_t record[10];
+        record[0] = i;
+        record[1] = zones[i].active;
+        memcpy(record + 2, &zones[i].databaseId, 4);
+        memcpy(record + 6, &zones[i].waterRateLpm, 4);
+        for (uint8_t b = 0; b < sizeof(record); b++) {
+            h = (h ^ record[b]) * 16777619u;
+        }
+        for (const char* c = name(i); ; c++) {
+            h = (h ^ (uint8_t)*c) * 16777619u;
+            if (*c == '\0') break;
+        }
+    }
+    hash = h ? h : 1;
+}
+
+void HTTPScheduleClient::applyZoneDetails(ZoneDetailsTable* details) {
+    ZoneDetailsTable* previous = zoneDetails;
+    zoneDetails = details;
+    zoneDetailsHash = details->hash;
+    delete previous;
+    lastZoneDetailsFetchTime = millis();
+    renderZoneDetailsJSON();
+
+    // Hand flow rates to the scheduler for supply-line budgeting
+    if (scheduleManager) {
+        for (uint8_t i = 1; i <= MAX_ZONE_ID; i++) {
+            scheduleManager->setZoneFlowRate(i, details->has(i) ? details->zones[i].waterRateLpm : 0.0f);
+        }
+    }
+}
+
 bool HTTPScheduleClient::fetchZoneDetails() {
+    if (!requestZoneDetails(*zoneDetailsStaging)) {
+        return false;
+    }
+    if (lastNotModified || zoneDetailsStaging->hash == zoneDetailsHash) {
+        // Current table is still right
+        lastZoneDetailsFetchTime = millis();
+        return true;
+    }
+    applyZoneDetails(new ZoneDetailsTable(*zoneDetailsStaging));
+    return true;
+}
+
+// Network half of a zone details fetch; the table is applied by the caller.
+// Returns true with lastNotModified set (and out untouched) on a 304.
+bool HTTPScheduleClient::requestZoneDetails(ZoneDetailsTable& out) {
     if (!configManager) {
         lastError = "Config manager not initialized";
         return false;
@@ -183,55 +390,70 @@ bool HTTPScheduleClient::fetchZoneDetails() {
     Serial.println("HTTP Client: Fetching zone details");
     Serial.println("  URL: " + url);
 
-    String response;
-    if (!executeRequest(url, response)) {
+    // Only ask conditionally while there is a table the 304 would confirm
+    if (!openRequest(url, zoneDetailsHash != 0)) {
         Serial.println("HTTP Client: Zone details request failed - " + lastError);
         return false;
     }
 
-    bool ok = parseZoneDetailsResponse(response);
-    if (ok) {
-        lastZoneDetailsFetchTime = millis();
+    if (lastNotModified) {
+        Serial.println("HTTP Client: Zone details not modified");
+        return true;
+    }
+
+    JsonDocument doc;
+    if (!readJsonResponse(doc, zoneDetailsFilter) || !parseZoneDetailsResponse(doc, out)) {
+        forgetValidator(url);
+        return false;
     }
-    return ok;
+    saveValidator(url);
+    return true;
 }
 
 String HTTPScheduleClient::getZoneName(uint8_t zoneId) const {
     if (zoneId == 0 || zoneId > MAX_ZONE_ID) {
         return "";
     }
-    if (!zoneHasData[zoneId]) {
+    if (!zoneDetails->has(zoneId)) {
         return "";
     }
-    return zoneNames[zoneId];
+    return String(zoneDetails->name(zoneId));
 }
 
 bool HTTPScheduleClient::hasZoneDetails(uint8_t zoneId) const {
     if (zoneId == 0 || zoneId > MAX_ZONE_ID) {
         return false;
     }
-    return zoneHasData[zoneId];
+    return zoneDetails->has(zoneId);
 }
 
 String HTTPScheduleClient::getZoneDetailsJSON() const {
-    DynamicJsonDocument doc(4096);
-    doc["count"] = zoneDetailsCount;
-    doc["last_fetch_ms"] = lastZoneDetailsFetchTime;
-    JsonArray zones = doc.createNestedArray("zones");
+    String json = "{\"count\":" + String(zoneDetails->count);
+    json += ",\"last_fetch_ms\":" + String(lastZoneDetailsFetchTime);
+    json += ",\"name_max_length\":" + String(ZoneDetailsTable::MAX_NAME);
+    json += ",\"names_cut\":" + String(zoneDetails->namesCut);
+    json += ",\"zones\":" + zoneDetailsJson + "}";
+    return json;
+}
+
+// Render the zones array once per table change
+void HTTPScheduleClient::renderZoneDetailsJSON() {
+    JsonDocument doc;
+    JsonArray zones = doc.to<JsonArray>();
 
     for (uint8_t i = 1; i <= MAX_ZONE_ID; i++) {
-        if (!zoneHasData[i]) continue;
-        JsonObject z = zones.createNestedObject();
+        if (!zoneDetails->has(i)) continue;
+        const ZoneDetail& zone = zoneDetails->zones[i];
+        JsonObject z = zones.add<JsonObject>();
         z["zone_id"] = i;
-        z["zone_name"] = zoneNames[i];
-        z["database_zone_id"] = zoneDatabaseId[i];
-        z["water_rate_lpm"] = zoneWaterRateLpm[i];
-        z["active"] = zoneActive[i];
+        z["zone_name"] = zoneDetails->name(i);
+        z["database_zone_id"] = zone.databaseId;
+        z["water_rate_lpm"] = zone.waterRateLpm;
+        z["active"] = zone.active != 0;
     }
 
-    String out;
-    serializeJson(doc, out);
-    return out;
+    zoneDetailsJson = "";
+    serializeJson(doc, zoneDetailsJson);
 }
 
 String HTTPScheduleClient::buildCompletionUrl() {
@@ -246,33 +468,158 @@ String HTTPScheduleClient::buildEventSyncUrl() {
     return serverUrl + "/api/events/sync";
 }
 
-bool HTTPScheduleClient::executeRequest(const String& url, String& response) {
-    for (int retry = 0; retry < MAX_RETRIES; retry++) {
-        if (retry > 0) {
-            Serial.println("HTTP Client: Retry attempt " + String(retry + 1));
-            delay(RETRY_DELAY);
+// Send one request over the kept-alive connection, opening a new one when
+// there is none. Leaves the response to be read and http.end() to the caller;
+// end() keeps the connection open unless the server asked to close it.
+int HTTPScheduleClient::sendRequest(const String& url, const String* payload, const HttpValidator* validator,
+                                    const uint8_t* gzipBody, size_t gzipLength) {
+    closeIdleConnection();
+
+    for (int attempt = 0; attempt < 2; attempt++) {
+        bool reused = http.connected();
+        if (reused) {
+            connectionsReused++;
+        } else {
+            connectionsOpened++;
         }
 
+        // begin(url) keeps HTTPClient's own socket between requests while
+        // reuse is on and the server answers with keep-alive
+        http.setReuse(true);
         http.begin(url);
-        http.setTimeout(HTTP_TIMEOUT);
+        http.setTimeout(requestTimeout());
         http.addHeader("Content-Type", "application/json");
         http.addHeader("User-Agent", "ESP32-Irrigation/" + deviceId);
 
-        int httpCode = http.GET();
+        static const char* responseHeaders[] = {"ETag", "Last-Modified", "Transfer-Encoding", "Retry-After",
+                                                "Content-Encoding"};
+        http.collectHeaders(responseHeaders, 5);
 
-        if (httpCode > 0) {
-            response = http.getString();
+        // Replaces HTTPClient's default, which ranks identity first
+        if (!payload && GzipInflater::canAllocate()) {
+            http.setAcceptEncoding("gzip;q=1.0, identity;q=0.5");
+        } else {
+            http.setAcceptEncoding("identity;q=1,chunked;q=0.1,*;q=0");
+        }
+        if (gzipBody) {
+            http.addHeader("Content-Encoding", "gzip");
+        }
+        if (validator) {
+            if (validator->etag.length() > 0) {
+                http.addHeader("If-None-Match", validator->etag);
+            }
+            if (validator->lastModified.length() > 0) {
+                http.addHeader("If-Modified-Since", validator->lastModified);
+            }
+        }
+
+        int httpCode;
+        if (gzipBody) {
+            httpCode = http.POST((uint8_t*)gzipBody, gzipLength);
+        } else {
+            httpCode = payload ? http.POST(*payload) : http.GET();
+        }
+        lastRequestAt = millis();
+
+        // The server closed a kept-alive connection before the request got
+        // through: send it once more on a new connection, without a retry delay
+        if (reused && (httpCode == HTTPC_ERROR_SEND_HEADER_FAILED || httpCode == HTTPC_ERROR_NOT_CONNECTED ||
+                       httpCode == HTTPC_ERROR_CONNECTION_LOST)) {
             http.end();
+            closeConnection();
+            connectionsDropped++;
+            continue;
+        }
 
-            if (httpCode == HTTP_CODE_OK) {
-                lastError = "";
-                consecutiveFailures = 0;  // Reset on success
-                return true;
-            } else {
-                lastError = "HTTP " + String(httpCode) + ": " + response;
-                Serial.println("HTTP Client Error: " + lastError);
+        // Don't reuse a connection in an unknown state
+        if (httpCode < 0) {
+            closeConnection();
+        }
+        return httpCode;
+    }
+    return HTTPC_ERROR_CONNECTION_LOST;
+}
+
+void HTTPScheduleClient::closeConnection() {
+    // end() only closes the socket when reuse is off
+    http.setReuse(false);
+    http.end();
+    http.setReuse(true);
+}
+
+// Close the kept-alive connection once it has been idle for KEEP_ALIVE_IDLE_MS
+void HTTPScheduleClient::closeIdleConnection() {
+    if (http.connected() && millis() - lastRequestAt > KEEP_ALIVE_IDLE_MS) {
+        Serial.println("HTTP Client: Closing idle server connection");
+        closeConnection();
+    }
+}
+
+// GET with retries, up to the response headers. On a 200 the body is left
+// on the socket for the caller to read (readJsonResponse or getString) and
+// end. With conditional set, the stored validators of the URL are sent; a
+// 304 then returns true with lastNotModified set and nothing left to read.
+// After a 200 the caller decides whether to keep the new validators
+// (saveValidator) once it has accepted the body.
+bool HTTPScheduleClient::openRequest(const String& url, bool conditional) {
+    HttpValidator* validator = conditional ? findValidator(url) : nullptr;
+    lastNotModified = false;
+    responseEtag = "";
+    responseLastModified = "";
+
+    HttpEndpoint endpoint = endpointFor(url);
+    if (!breakerAllows(endpoint)) {
+        return false;
+    }
+    uint8_t attempts = breakers[endpoint].state == BREAKER_HALF_OPEN ? 1 : MAX_RETRIES;
+
+    int httpCode = 0;
+    uint32_t retryAfterMs = 0;
+    for (uint8_t retry = 0; retry < attempts; retry++) {
+        if (retry > 0 && !waitBeforeRetry(retry, retryAfterMs)) {
+            break;
+        }
+        if (jobAborted()) {
+            return false;
+        }
+
+        httpCode = sendRequest(url, nullptr, validator);
+        lastHttpCode = httpCode;
+
+        if (httpCode == HTTP_CODE_NOT_MODIFIED && validator) {
+            http.end();
+            validator->usedAt = millis();
+            lastNotModified = true;
+            notModifiedCount++;
+            lastError = "";
+            consecutiveFailures = 0;
+            breakerResult(endpoint, true, httpCode);
+            return true;
+        }
+
+        if (httpCode == HTTP_CODE_OK) {
+            responseEtag = http.header("ETag");
+            responseLastModified = http.header("Last-Modified");
+            lastError = "";
+            consecutiveFailures = 0;  // Reset on success
+            breakerResult(endpoint, true, httpCode);
+            return true;
+        }
+
+        if (httpCode > 0) {
+            // Error bodies are short; they go into the error message
+            retryAfterMs = readRetryAfter();
+            lastError = "HTTP " + String(httpCode) + ": " + readResponseString(MAX_ERROR_BODY);
+            Serial.println("HTTP Client Error: " + lastError);
+
+            // The server rejected the request itself, a retry gets the same
+            // answer; it is up, so this doesn't count against the breaker
+            if (httpCode >= 400 && httpCode < 500 && httpCode != HTTP_CODE_TOO_MANY_REQUESTS) {
+                breakerResult(endpoint, true, httpCode);
+                return false;
             }
         } else {
+            retryAfterMs = 0;
             lastError = "Connection failed: " + http.errorToString(httpCode);
             Serial.println("HTTP Client Error: " + lastError);
         }
@@ -280,35 +627,281 @@ bool HTTPScheduleClient::executeRequest(const String& url, String& response) {
         http.end();
     }
 
+    breakerResult(endpoint, false, httpCode, retryAfterMs);
     return false;
 }
 
+// GET into a String, for short responses
+bool HTTPScheduleClient::executeRequest(const String& url, String& response, bool conditional) {
+    response = "";
+    if (!openRequest(url, conditional)) {
+        return false;
+    }
+    if (!lastNotModified) {
+        response = readResponseString(MAX_STRING_BODY);
+    }
+    return true;
+}
+
+// Read the body of an opened response into a String (up to maxLength
+// bytes, inflated if gzip), then end the request
+String HTTPScheduleClient::readResponseString(size_t maxLength) {
+    bool chunked = http.header("Transfer-Encoding").equalsIgnoreCase("chunked");
+    bool gzip = http.header("Content-Encoding").equalsIgnoreCase("gzip");
+    HttpBodyReader body(http.getStream(), chunked ? -1 : http.getSize(), chunked, nullptr, gzip);
+
+    String text;
+    int c;
+    while (text.length() < maxLength && (c = body.read()) >= 0) {
+        text += (char)c;
+    }
+
+    bool complete = body.skipRest();
+    http.end();
+    if (!complete) {
+        closeConnection();
+    }
+    return text;
+}
+
+// Parse the body of an opened 200 response as it streams off the socket,
+// keeping only what the filter selects, then end the request. The body is
+// never held whole in memory; with copyTo set its raw bytes are also
+// written to that file (the SPIFFS cache).
+bool HTTPScheduleClient::readJsonResponse(JsonDocument& doc, const JsonDocument& filter, File* copyTo) {
+    bool chunked = http.header("Transfer-Encoding").equalsIgnoreCase("chunked");
+    bool gzip = http.header("Content-Encoding").equalsIgnoreCase("gzip");
+    HttpBodyReader body(http.getStream(), chunked ? -1 : http.getSize(), chunked, copyTo, gzip);
+
+    DeserializationError error = deserializeJson(doc, body, DeserializationOption::Filter(filter));
+
+    // Whatever follows the JSON value has to be consumed before the
+    // connection can carry the next request
+    bool complete = body.skipRest();
+    http.end();
+    if (!complete) {
+        closeConnection();
+    }
+
+    if (gzip) {
+        gzipResponses++;
+        gzipResponseBytes += body.getBytesRead();
+        gzipInflatedBytes += body.getDecodedBytes();
+        Serial.println("  Received (" + String(body.getBytesRead()) + " bytes gzip, " +
+                       String(body.getDecodedBytes()) + " inflated)");
+    } else {
+        Serial.println("  Received (" + String(body.getBytesRead()) + " bytes)");
+    }
+
+    if (body.decodeFailed()) {
+        lastError = "Failed to inflate gzip response";
+        Serial.println("HTTP Client: " + lastError);
+        return false;
+    }
+    if (error) {
+        lastError = "JSON parse error: " + String(error.c_str());
+        Serial.println("HTTP Client: " + lastError);
+        return false;
+    }
+    if (!complete) {
+        lastError = "Response cut off after " + String(body.getBytesRead()) + " bytes";
+        Serial.println("HTTP Client: " + lastError);
+        return false;
+    }
+    if (copyTo && body.copyFailed()) {
+        Serial.println("HTTP Client: Failed to write cache file");
+    }
+    return true;
+}
+
+// Parse a cached response file the same way, without loading it whole
+bool HTTPScheduleClient::readJsonFile(const String& path, JsonDocument& doc) {
+    File file = SPIFFS.open(path, "r");
+    if (!file) {
+        Serial.println("HTTP Client: Failed to open cache file: " + path);
+        return false;
+    }
+
+    Serial.println("HTTP Client: Loading cached schedule from " + path + " (" + String(file.size()) + " bytes)");
+    HttpBodyReader body(file, file.size(), false);
+    DeserializationError error = deserializeJson(doc, body, DeserializationOption::Filter(scheduleFilter));
+    file.close();
+
+    if (error) {
+        lastError = "JSON parse error: " + String(error.c_str());
+        Serial.println("HTTP Client: " + lastError);
+        return false;
+    }
+    return true;
+}
+
+// FNV-1a, enough to tell a handful of URLs apart
+uint32_t HTTPScheduleClient::hashUrl(const String& url) {
+    uint32_t hash = 2166136261UL;
+    for (unsigned int i = 0; i < url.length(); i++) {
+        hash ^= (uint8_t)url.charAt(i);
+        hash *= 16777619UL;
+    }
+    return hash ? hash : 1;
+}
+
+HttpValidator* HTTPScheduleClient::findValidator(const String& url) {
+    uint32_t hash = hashUrl(url);
+    for (uint8_t i = 0; i < MAX_VALIDATORS; i++) {
+        if (validators[i].urlHash == hash) {
+            return &validators[i];
+        }
+    }
+    return nullptr;
+}
+
+// Keep the validators of the last 200 response for this URL (if it sent any)
+void HTTPScheduleClient::saveValidator(const String& url, uint8_t days, uint16_t events) {
+    if (responseEtag.length() == 0 && responseLastModified.length() == 0) {
+        forgetValidator(url);
+        return;
+    }
+
+    HttpValidator* slot = findValidator(url);
+    if (!slot) {
+        // A free slot, or else the one unused the longest
+        slot = &validators[0];
+        for (uint8_t i = 0; i < MAX_VALIDATORS; i++) {
+            if (validators[i].urlHash == 0) {
+                slot = &validators[i];
+                break;
+            }
+            if (millis() - validators[i].usedAt > millis() - slot->usedAt) {
+                slot = &validators[i];
+            }
+        }
+    }
+
+    slot->urlHash = hashUrl(url);
+    slot->etag = responseEtag;
+    slot->lastModified = responseLastModified;
+    slot->days = days;
+    slot->events = events;
+    slot->usedAt = millis();
+}
+
+void HTTPScheduleClient::forgetValidator(const String& url) {
+    HttpValidator* validator = findValidator(url);
+    if (validator) {
+        validator->urlHash = 0;
+        validator->etag = "";
+        validator->lastModified = "";
+    }
+}
+
+// AI events in the table that belong to the given days
+uint16_t HTTPScheduleClient::countAIEvents(ScheduleManager* table, const String& firstDate, uint8_t days) {
+    uint8_t dayMask;
+    uint32_t dayEnd;
+    if (!getDateScope(firstDate, dayMask, dayEnd)) {
+        return 0;
+    }
+
+    return table->countAISchedulesExpiring(dayEnd, dayEnd + days * 86400UL);
+}
+
+// After a 304: the response the server confirmed is the one loaded before.
+// Its events are still in the shadow unless something removed them since
+// (e.g. AI schedules cleared through the API); then reload the cached copy.
+bool HTTPScheduleClient::scheduleUnchanged(const String& url, const String& firstDate, ScheduleManager* shadow) {
+    HttpValidator* validator = findValidator(url);
+    if (validator && countAIEvents(shadow, firstDate, validator->days) == validator->events) {
+        return true;
+    }
+
+    Serial.println("  Loaded events differ from the unchanged response, reloading it from the cache");
+    return loadScheduleFromCache(firstDate, shadow);
+}
+
+// POST with retries. Large bodies are sent gzip compressed when the server
+// takes that; the compressed copy lives only for this call.
 bool HTTPScheduleClient::executePostRequest(const String& url, const String& payload, String& response) {
-    for (int retry = 0; retry < MAX_RETRIES; retry++) {
-        if (retry > 0) {
-            Serial.println("HTTP Client: POST retry attempt " + String(retry + 1));
-            delay(RETRY_DELAY);
+    uint8_t* gzipBody = nullptr;
+    size_t gzipLength = 0;
+    if (gzipUploads && payload.length() >= GZIP_MIN_PAYLOAD) {
+        // Only worth sending if it came out smaller
+        gzipBody = (uint8_t*)malloc(payload.length());
+        if (gzipBody) {
+            gzipLength = gzipCompress((const uint8_t*)payload.c_str(), payload.length(), gzipBody, payload.length());
+        }
+        if (gzipLength > 0) {
+            Serial.println("  Compressed payload " + String(payload.length()) + " -> " + String(gzipLength) + " bytes");
+        } else {
+            free(gzipBody);
+            gzipBody = nullptr;
         }
+    }
 
-        http.begin(url);
-        http.setTimeout(HTTP_TIMEOUT);
-        http.addHeader("Content-Type", "application/json");
-        http.addHeader("User-Agent", "ESP32-Irrigation/" + deviceId);
+    bool success = postWithRetries(url, payload, gzipBody, gzipLength, response);
+    free(gzipBody);
+    return success;
+}
+
+bool HTTPScheduleClient::postWithRetries(const String& url, const String& payload, const uint8_t* gzipBody,
+                                         size_t gzipLength, String& response) {
+    HttpEndpoint endpoint = endpointFor(url);
+    if (!breakerAllows(endpoint)) {
+        return false;
+    }
+    uint8_t attempts = breakers[endpoint].state == BREAKER_HALF_OPEN ? 1 : MAX_RETRIES;
+
+    int httpCode = 0;
+    uint32_t retryAfterMs = 0;
+    for (uint8_t retry = 0; retry < attempts; retry++) {
+        if (retry > 0 && !waitBeforeRetry(retry, retryAfterMs)) {
+            break;
+        }
+        if (jobAborted()) {
+            return false;
+        }
+
+        httpCode = sendRequest(url, &payload, nullptr, gzipBody, gzipLength);
 
-        int httpCode = http.POST(payload);
+        // Not every server decodes request bodies: try it plain, and keep
+        // sending plain bodies if that one goes through
+        if (gzipBody && (httpCode == HTTP_CODE_BAD_REQUEST || httpCode == HTTP_CODE_UNSUPPORTED_MEDIA_TYPE)) {
+            // Read the rejection off the kept-alive connection first, or
+            // the plain request's response would be parsed from its tail
+            http.getString();
+            http.end();
+            gzipBody = nullptr;
+            httpCode = sendRequest(url, &payload);
+            if (httpCode == HTTP_CODE_OK || httpCode == HTTP_CODE_CREATED) {
+                Serial.println("HTTP Client: Server doesn't take compressed bodies, uploads go out uncompressed");
+                gzipUploads = false;
+            }
+        }
 
         if (httpCode > 0) {
+            if (gzipBody) {
+                gzipUploadCount++;
+                gzipUploadBytes += gzipLength;
+                gzipUploadPlainBytes += payload.length();
+            }
+            retryAfterMs = readRetryAfter();
             response = http.getString();
             http.end();
 
             if (httpCode == HTTP_CODE_OK || httpCode == HTTP_CODE_CREATED) {
                 lastError = "";
+                breakerResult(endpoint, true, httpCode);
                 return true;
             } else {
                 lastError = "HTTP " + String(httpCode) + ": " + response;
                 Serial.println("HTTP Client POST Error: " + lastError);
             }
+
+            if (httpCode >= 400 && httpCode < 500 && httpCode != HTTP_CODE_TOO_MANY_REQUESTS) {
+                breakerResult(endpoint, true, httpCode);
+                return false;
+            }
         } else {
+            retryAfterMs = 0;
             lastError = "POST connection failed: " + http.errorToString(httpCode);
             Serial.println("HTTP Client POST Error: " + lastError);
         }
@@ -316,20 +909,171 @@ bool HTTPScheduleClient::executePostRequest(const String& url, const String& pay
         http.end();
     }
 
+    breakerResult(endpoint, false, httpCode, retryAfterMs);
     return false;
 }
 
-bool HTTPScheduleClient::parseScheduleResponse(const String& json, int expectedDays) {
-    // Parse JSON response
-    JsonDocument doc;
-    DeserializationError error = deserializeJson(doc, json);
+// ===== RETRY POLICY AND CIRCUIT BREAKERS =====
 
-    if (error) {
-        lastError = "JSON parse error: " + String(error.c_str());
-        Serial.println("HTTP Client: " + lastError);
+HttpEndpoint HTTPScheduleClient::endpointFor(const String& url) {
+    if (url.indexOf("/api/schedules") >= 0) return HTTP_ENDPOINT_SCHEDULES;
+    if (url.indexOf("/api/zonedetails") >= 0) return HTTP_ENDPOINT_ZONE_DETAILS;
+    if (url.indexOf("/api/events") >= 0) return HTTP_ENDPOINT_EVENTS;
+    return HTTP_ENDPOINT_SYSTEM;
+}
+
+static const char* endpointName(uint8_t endpoint) {
+    switch (endpoint) {
+        case HTTP_ENDPOINT_SCHEDULES: return "schedules";
+        case HTTP_ENDPOINT_ZONE_DETAILS: return "zone_details";
+        case HTTP_ENDPOINT_EVENTS: return "events";
+        default: return "system";
+    }
+}
+
+static const char* breakerStateName(BreakerState state) {
+    switch (state) {
+        case BREAKER_OPEN: return "open";
+        case BREAKER_HALF_OPEN: return "half_open";
+        default: return "closed";
+    }
+}
+
+// Random wait in [0, min(cap, base * 2^attempt)]
+uint32_t HTTPScheduleClient::backoffDelay(uint8_t attempt, uint32_t baseMs, uint32_t capMs) {
+    uint32_t ceiling = baseMs;
+    for (uint8_t i = 0; i < attempt && ceiling < capMs; i++) {
+        ceiling *= 2;
+    }
+    if (ceiling > capMs) {
+        ceiling = capMs;
+    }
+    return random(0, (long)ceiling + 1);
+}
+
+// An open breaker fails the call straight away; once its cooldown is over
+// the next call goes through as the half-open probe
+bool HTTPScheduleClient::breakerAllows(HttpEndpoint endpoint) {
+    CircuitBreaker& breaker = breakers[endpoint];
+    if (breaker.state != BREAKER_OPEN) {
+        return true;
+    }
+    if (millis() - breaker.openedAt >= breaker.openMs) {
+        breaker.state = BREAKER_HALF_OPEN;
+        Serial.println("HTTP Client: Circuit for " + String(endpointName(endpoint)) + " half-open, sending a probe");
+        return true;
+    }
+
+    breaker.rejected++;
+    lastHttpCode = 0;
+    lastError = "Server unavailable, " + String(endpointName(endpoint)) + " circuit open for " +
+                String(getRetryIn(endpoint) / 1000) + " s";
+    return false;
+}
+
+void HTTPScheduleClient::breakerResult(HttpEndpoint endpoint, bool serverOk, int httpCode, uint32_t retryAfterMs) {
+    CircuitBreaker& breaker = breakers[endpoint];
+    breaker.lastCode = httpCode;
+
+    if (serverOk) {
+        if (breaker.state != BREAKER_CLOSED) {
+            Serial.println("HTTP Client: Circuit for " + String(endpointName(endpoint)) + " closed");
+        }
+        breaker.state = BREAKER_CLOSED;
+        breaker.failures = 0;
+        breaker.trips = 0;
+        return;
+    }
+
+    if (breaker.failures < 255) {
+        breaker.failures++;
+    }
+    if (breaker.state != BREAKER_HALF_OPEN && breaker.failures < BREAKER_THRESHOLD && retryAfterMs == 0) {
+        return;
+    }
+
+    // Open, or back to open after a failed probe, for a cooldown that
+    // doubles per trip. Half of it is random so a fleet of controllers that
+    // lost the server together doesn't come back in step.
+    if (breaker.trips < 255) {
+        breaker.trips++;
+    }
+    uint32_t cooldown = BREAKER_OPEN_MS;
+    for (uint8_t i = 1; i < breaker.trips && cooldown < BREAKER_MAX_OPEN_MS; i++) {
+        cooldown *= 2;
+    }
+    if (cooldown > BREAKER_MAX_OPEN_MS) {
+        cooldown = BREAKER_MAX_OPEN_MS;
+    }
+    cooldown = cooldown / 2 + random(0, (long)(cooldown / 2) + 1);
+    if (retryAfterMs > cooldown) {
+        cooldown = retryAfterMs;
+    }
+
+    breaker.state = BREAKER_OPEN;
+    breaker.openedAt = millis();
+    breaker.openMs = cooldown;
+    Serial.println("HTTP Client: Circuit for " + String(endpointName(endpoint)) + " open for " +
+                   String(cooldown / 1000) + " s after " + String(breaker.failures) + " failed call(s)");
+}
+
+// Wait before the next attempt of a call. False when the wait is longer than
+// the call should block for (or than its deadline allows); the breaker takes
+// over from there.
+bool HTTPScheduleClient::waitBeforeRetry(uint8_t attempt, uint32_t retryAfterMs) {
+    uint32_t wait = retryAfterMs > 0 ? retryAfterMs : backoffDelay(attempt, BACKOFF_BASE_MS, BACKOFF_MAX_MS);
+    if (wait > MAX_INLINE_WAIT_MS) {
+        Serial.println("HTTP Client: Server asked to wait " + String(wait / 1000) + " s, not retrying now");
+        return false;
+    }
+    if (activeJobId != 0 && (int32_t)(activeDeadline - millis()) < (int32_t)wait) {
         return false;
     }
 
+    Serial.println("HTTP Client: Retry attempt " + String(attempt + 1) + " in " + String(wait) + " ms");
+    delay(wait);
+    return true;
+}
+
+// Retry-After of the response in ms (delta-seconds form; 0 if absent)
+uint32_t HTTPScheduleClient::readRetryAfter() {
+    String value = http.header("Retry-After");
+    value.trim();
+    if (value.length() == 0 || !isDigit(value.charAt(0))) {
+        return 0;   // Missing, or an HTTP date (not used by the schedule server)
+    }
+    uint32_t ms = (uint32_t)value.toInt() * 1000UL;
+    return ms > MAX_RETRY_AFTER_MS ? MAX_RETRY_AFTER_MS : ms;
+}
+
+uint32_t HTTPScheduleClient::getRetryIn(HttpEndpoint endpoint) const {
+    const CircuitBreaker& breaker = breakers[endpoint];
+    if (breaker.state != BREAKER_OPEN) {
+        return 0;
+    }
+    uint32_t elapsed = millis() - breaker.openedAt;
+    return elapsed >= breaker.openMs ? 0 : breaker.openMs - elapsed;
+}
+
+String HTTPScheduleClient::getBreakerJSON() const {
+    JsonDocument doc;
+    for (uint8_t i = 0; i < HTTP_ENDPOINT_COUNT; i++) {
+        const CircuitBreaker& breaker = breakers[i];
+        JsonObject entry = doc[endpointName(i)].to<JsonObject>();
+        entry["state"] = breakerStateName(breaker.state);
+        entry["failures"] = breaker.failures;
+        entry["trips"] = breaker.trips;
+        entry["retry_in_ms"] = getRetryIn((HttpEndpoint)i);
+        entry["rejected"] = breaker.rejected;
+        entry["last_code"] = breaker.lastCode;
+    }
+
+    String json;
+    serializeJson(doc, json);
+    return json;
+}
+
+bool HTTPScheduleClient::parseScheduleResponse(JsonDocument& doc, ScheduleManager* target, int expectedDays, int* daysReturned) {
     // Check success field
     bool success = doc["success"] | false;
     if (!success) {
@@ -360,11 +1104,12 @@ bool HTTPScheduleClient::parseScheduleResponse(const String& json, int expectedD
     }
 
     int totalEvents = 0;
-
-    // Clear existing server schedules (but keep basic schedules)
-    scheduleManager->clearAISchedules();
+    responseRevision = doc["revision"] | 0;
 
     Serial.println("HTTP Client: Found " + String(data.size()) + " dates in response");
+    if (daysReturned) {
+        *daysReturned = doc["days_returned"] | (int)data.size();
+    }
 
     // Iterate through each date in the data object
     for (JsonPair datePair : data) {
@@ -382,15 +1127,24 @@ bool HTTPScheduleClient::parseScheduleResponse(const String& json, int expectedD
             continue;
         }
 
+        // Events fire on their own date only and expire at the end of it
+        uint8_t dayMask = 0x7F;
+        uint32_t dayEndUtc = 0;
+        if (!getDateScope(dateStr, dayMask, dayEndUtc)) {
+            Serial.println("  WARNING: Unrecognised date key, events will repeat daily");
+        } else {
+            // Replace whatever this date had before
+            target->removeAISchedulesExpiring(dayEndUtc, dayEndUtc + 86400UL);
+        }
+
         Serial.println("  Zones count: " + String(zonesForDate.size()));
 
         // Parse each zone for this date
         for (JsonObject zone : zonesForDate) {
             uint8_t zoneId = zone["zone_id"] | 0;
-            String zoneName = zone["zone_name"] | "Unknown";
             JsonArray events = zone["events"];
 
-            Serial.println("  Zone " + String(zoneId) + " (" + zoneName + "): " +
+            Serial.println("  Zone " + String(zoneId) + ": " +
                          String(events.isNull() ? 0 : events.size()) + " events");
 
             if (events.isNull() || zoneId == 0) {
@@ -400,51 +1154,8 @@ bool HTTPScheduleClient::parseScheduleResponse(const String& json, int expectedD
             }
 
             for (JsonObject event : events) {
-                // Parse event data
-                uint32_t serverId = event["id"] | 0;
-                String startTime = event["start_time"] | "00:00";
-                uint16_t durationMin = event["duration_min"] | 0;
-                uint8_t repeatCount = event["repeat_count"] | 1;
-                uint16_t restTimeMin = event["rest_time_min"] | 0;
-                uint8_t priority = event["priority"] | 5;
-
-                Serial.println("  Event: zone=" + String(zoneId) +
-                             " time=" + startTime +
-                             " duration=" + String(durationMin));
-
-                // Parse start time (format: "HH:MM")
-                int colonPos = startTime.indexOf(':');
-                if (colonPos <= 0) {
-                    Serial.println("  Invalid time format: " + startTime);
-                    continue;
-                }
-
-                uint8_t hour = startTime.substring(0, colonPos).toInt();
-                uint8_t minute = startTime.substring(colonPos + 1).toInt();
-
-                if (hour > 23 || minute > 59) {
-                    Serial.println("  Invalid time values: " + String(hour) + ":" + String(minute));
-                    continue;
-                }
-
-                // Calculate expiry time (end of day in Unix time)
-                uint32_t expiryTime = 0;  // 0 means expires end of day (handled by ScheduleManager)
-
-                // Create day mask for today only (will be expanded in Phase 2)
-                uint8_t dayMask = 0x7F;  // All days for now (will be refined later)
-
-                // Add to ScheduleManager as AI schedule
-                uint8_t scheduleId = scheduleManager->addAISchedule(
-                    zoneId, dayMask, hour, minute, durationMin, expiryTime
-                );
-
-                if (scheduleId > 0) {
+                if (addServerEvent(target, zoneId, event, dayMask, dayEndUtc, dateStr) > 0) {
                     totalEvents++;
-                    Serial.println("  Added: Zone " + String(zoneId) +
-                                 " at " + String(hour) + ":" + String(minute) +
-                                 " for " + String(durationMin) + " min (" + dateStr + ")");
-                } else {
-                    Serial.println("  Failed to add event for zone " + String(zoneId));
                 }
             }
         }
@@ -456,6 +1167,59 @@ bool HTTPScheduleClient::parseScheduleResponse(const String& json, int expectedD
     return true;
 }
 
+// Add one server event of the given date as an AI schedule, or update the
+// one with the same server ID. Returns the local schedule ID, 0 if the event
+// is invalid or could not be added.
+uint32_t HTTPScheduleClient::addServerEvent(ScheduleManager* target, uint8_t zoneId, JsonObject event, uint8_t dayMask,
+                                            uint32_t dayEndUtc, const String& date) {
+    // Parse event data
+    uint32_t serverId = event["id"] | 0;
+    String startTime = event["start_time"] | "00:00";
+    uint16_t durationMin = event["duration_min"] | 0;
+    uint8_t repeatCount = event["repeat_count"] | 1;
+    uint16_t restTimeMin = event["rest_time_min"] | 0;
+
+    Serial.println("  Event: zone=" + String(zoneId) +
+                 " time=" + startTime +
+                 " duration=" + String(durationMin));
+
+    // Parse start time (format: "HH:MM")
+    int colonPos = startTime.indexOf(':');
+    if (colonPos <= 0) {
+        Serial.println("  Invalid time format: " + startTime);
+        return 0;
+    }
+
+    uint8_t hour = startTime.substring(0, colonPos).toInt();
+    uint8_t minute = startTime.substring(colonPos + 1).toInt();
+
+    if (hour > 23 || minute > 59) {
+        Serial.println("  Invalid time values: " + String(hour) + ":" + String(minute));
+        return 0;
+    }
+
+    // Expire once the last cycle of the day has started
+    uint32_t expiryTime = 0;
+    if (dayEndUtc > 0) {
+        expiryTime = dayEndUtc + (uint32_t)(repeatCount > 1 ? repeatCount - 1 : 0) * (durationMin + restTimeMin) * 60UL;
+    }
+
+    // Add to the shadow table as AI schedule
+    uint32_t scheduleId = target->addAISchedule(
+        zoneId, dayMask, hour, minute, durationMin, expiryTime, serverId,
+        repeatCount, restTimeMin
+    );
+
+    if (scheduleId > 0) {
+        Serial.println("  Added: Zone " + String(zoneId) +
+                     " at " + String(hour) + ":" + String(minute) +
+                     " for " + String(durationMin) + " min (" + date + ")");
+    } else {
+        Serial.println("  Failed to add event for zone " + String(zoneId));
+    }
+    return scheduleId;
+}
+
 bool HTTPScheduleClient::fetchDailySchedule(const String& date, int8_t zoneId) {
     if (!configManager || !scheduleManager) {
         lastError = "Client not initialized";
@@ -474,24 +1238,92 @@ bool HTTPScheduleClient::fetchDailySchedule(const String& date, int8_t zoneId) {
     String url = buildScheduleUrl(date, zoneId);
     Serial.println("  URL: " + url);
 
-    String response;
-    if (!executeRequest(url, response)) {
+    if (!openRequest(url)) {
         Serial.println("HTTP Client: Request failed - " + lastError);
         return false;
     }
 
-    Serial.println("HTTP Client: Received response (" + String(response.length()) + " bytes)");
+    JsonDocument doc;
+    if (!readJsonResponse(doc, scheduleFilter)) {
+        return false;
+    }
 
-    // Parse and load into ScheduleManager
-    bool success = parseScheduleResponse(response);
+    // Parse into a shadow table, other days stay as they are
+    ScheduleManager* shadow = scheduleManager->createShadow(true);
+    if (!shadow) {
+        lastError = "Out of memory for schedule table";
+        return false;
+    }
 
+    bool success = parseScheduleResponse(doc, shadow);
     if (success) {
+        success = commitShadow(shadow, 1);
         lastFetchTime = millis();
+    } else {
+        delete shadow;
     }
 
     return success;
 }
 
+bool HTTPScheduleClient::getDateScope(const String& date, uint8_t& dayMask, uint32_t& dayEndUtc) {
+    // Date keys are local dates: "YYYY-MM-DD"
+    if (date.length() != 10 || date.charAt(4) != '-' || date.charAt(7) != '-') {
+        return false;
+    }
+
+    int year = date.substring(0, 4).toInt();
+    int month = date.substring(5, 7).toInt();
+    int day = date.substring(8, 10).toInt();
+    if (year < 2020 || month < 1 || month > 12 || day < 1 || day > 31) {
+        return false;
+    }
+
+    int offsetSeconds = configManager->getTimezoneOffset() * 1800; // Convert half-hours to seconds
+    if (configManager->isDaylightSaving()) {
+        offsetSeconds += 3600; // Add 1 hour for DST
+    }
+
+    DateTime localEnd(year, month, day, 23, 59, 59);
+    dayMask = 1 << localEnd.dayOfTheWeek();
+    dayEndUtc = localEnd.unixtime() - offsetSeconds;
+    return true;
+}
+
+// Unix time for the schedule snapshot, 0 while the clock is not set yet
+static uint32_t snapshotTime() {
+    time_t now = time(nullptr);
+    return now > 1577836800 ? (uint32_t)now : 0;   // After 2020-01-01
+}
+
+// revision is the server revision of the shadow's AI schedules; without one
+// the next fetch loads the whole horizon
+bool HTTPScheduleClient::commitShadow(ScheduleManager* shadow, int daysLoaded, const ScheduleRevision* revision) {
+    if (!shadow) return false;
+
+    // Validate the new table as a whole before it goes live
+    if (daysLoaded <= 0) {
+        Serial.println("HTTP Client: No days loaded, keeping current schedules");
+        delete shadow;
+        return false;
+    }
+
+    uint16_t conflicts = shadow->findConflicts(nullptr, 0);
+    if (conflicts > 0) {
+        Serial.println("HTTP Client: ⚠️  New schedule has " + String(conflicts) +
+                       " planned overlaps (see /api/schedules/conflicts)");
+    }
+
+    scheduleManager->swapScheduleTable(*shadow);
+    delete shadow;  // Now holds the previous table
+
+    appliedRevision = revision ? *revision : ScheduleRevision();
+    lockSnapshot();
+    scheduleSnapshot.save(*scheduleManager, snapshotTime(), appliedRevision.revision, appliedRevision.horizonEnd);
+    unlockSnapshot();
+    return true;
+}
+
 bool HTTPScheduleClient::fetchTodaySchedule() {
     // Get today's date from RTC or system time
     // Format: YYYY-MM-DD
@@ -573,9 +1405,15 @@ bool HTTPScheduleClient::reportCompletion(const EventCompletion& completion) {
 
 bool HTTPScheduleClient::reportCompletion(uint32_t scheduleId, uint8_t zoneId,
                                          float durationMin, float waterUsed,
-                                         const String& status) {
-    // Get current time for timestamps
-    time_t now = time(nullptr);
+                                         const String& status, time_t endTime) {
+    return reportCompletion(buildCompletion(scheduleId, zoneId, durationMin, waterUsed, status, endTime));
+}
+
+EventCompletion HTTPScheduleClient::buildCompletion(uint32_t scheduleId, uint8_t zoneId,
+                                                    float durationMin, float waterUsed,
+                                                    const String& status, time_t endTime) {
+    // Timestamps from the end of the run (now unless given)
+    time_t now = endTime > 0 ? endTime : time(nullptr);
     time_t startTime = now - (uint32_t)(durationMin * 60);
 
     struct tm timeinfo;
@@ -599,7 +1437,7 @@ bool HTTPScheduleClient::reportCompletion(uint32_t scheduleId, uint8_t zoneId,
     completion.status = status;
     completion.notes = "";
 
-    return reportCompletion(completion);
+    return completion;
 }
 
 bool HTTPScheduleClient::testConnection() {
@@ -632,17 +1470,7 @@ bool HTTPScheduleClient::fetch5DaySchedule(int8_t zoneId) {
     return fetchSchedule(5, zoneId);
 }
 
-bool HTTPScheduleClient::parse5DayScheduleResponse(const String& json) {
-    // Parse JSON response for 5-day schedule
-    JsonDocument doc;
-    DeserializationError error = deserializeJson(doc, json);
-
-    if (error) {
-        lastError = "JSON parse error: " + String(error.c_str());
-        Serial.println("HTTP Client: " + lastError);
-        return false;
-    }
-
+bool HTTPScheduleClient::parse5DayScheduleResponse(JsonDocument& doc, ScheduleManager* target) {
     // Check success field
     bool success = doc["success"] | false;
     if (!success) {
@@ -662,9 +1490,6 @@ bool HTTPScheduleClient::parse5DayScheduleResponse(const String& json) {
     int totalEvents = 0;
     int daysProcessed = 0;
 
-    // Clear existing AI schedules before loading new ones
-    scheduleManager->clearAISchedules();
-
     // Iterate through each day in the response
     for (JsonPair dayPair : data) {
         String date = dayPair.key().c_str();
@@ -673,8 +1498,11 @@ bool HTTPScheduleClient::parse5DayScheduleResponse(const String& json) {
         Serial.println("Processing date: " + date + " (" + String(zonesForDay.size()) + " zones)");
         daysProcessed++;
 
-        // TODO: Save to SPIFFS as /schedule_YYYY-MM-DD.json for offline resilience
-        // This will be implemented in Phase 2 with proper SPIFFS caching
+        uint8_t dayMask = 0x7F;
+        uint32_t dayEndUtc = 0;
+        if (getDateScope(date, dayMask, dayEndUtc)) {
+            target->removeAISchedulesExpiring(dayEndUtc, dayEndUtc + 86400UL);
+        }
 
         // Each zone has an events array
         for (JsonObject zone : zonesForDay) {
@@ -704,9 +1532,14 @@ bool HTTPScheduleClient::parse5DayScheduleResponse(const String& json) {
 
                 if (hour > 23 || minute > 59) continue;
 
-                // Add to ScheduleManager (AI schedule with expiry at end of day)
-                uint8_t scheduleId = scheduleManager->addAISchedule(
-                    zoneId, 0x7F, hour, minute, durationMin, 0
+                // Add to the shadow table (AI schedule with expiry at end of its day)
+                uint32_t expiryTime = 0;
+                if (dayEndUtc > 0) {
+                    expiryTime = dayEndUtc + (uint32_t)(repeatCount > 1 ? repeatCount - 1 : 0) * (durationMin + restTimeMin) * 60UL;
+                }
+                uint32_t scheduleId = target->addAISchedule(
+                    zoneId, dayMask, hour, minute, durationMin, expiryTime, serverId,
+                    repeatCount, restTimeMin
                 );
 
                 if (scheduleId > 0) {
@@ -772,6 +1605,42 @@ bool HTTPScheduleClient::reportEventStart(uint32_t scheduleId, uint8_t zoneId, c
 
 // ===== SPIFFS CACHING METHODS =====
 
+// Downloads are written to <date>.tmp while they are parsed and only replace
+// the day's cache file once the response was accepted
+File HTTPScheduleClient::beginCacheFile(const String& date) {
+    if (!SPIFFS.begin()) {
+        return File();
+    }
+    File file = SPIFFS.open("/schedules/" + date + ".tmp", "w");
+    if (!file) {
+        Serial.println("HTTP Client: Failed to create cache file for " + date);
+    }
+    return file;
+}
+
+void HTTPScheduleClient::endCacheFile(const String& date, File& file, bool keep) {
+    if (!file) {
+        return;
+    }
+    size_t bytesWritten = file.size();
+    file.close();
+
+    String tempPath = "/schedules/" + date + ".tmp";
+    String filepath = "/schedules/" + date + ".json";
+    if (!keep) {
+        SPIFFS.remove(tempPath);
+        return;
+    }
+
+    SPIFFS.remove(filepath);
+    if (SPIFFS.rename(tempPath, filepath)) {
+        Serial.println("HTTP Client: Cached schedule to " + filepath + " (" + String(bytesWritten) + " bytes)");
+    } else {
+        Serial.println("HTTP Client: Failed to write cache file");
+        SPIFFS.remove(tempPath);
+    }
+}
+
 bool HTTPScheduleClient::cacheScheduleToSPIFFS(const String& date, const String& json) {
     if (!SPIFFS.begin()) {
         Serial.println("HTTP Client: SPIFFS not available for caching");
@@ -798,7 +1667,7 @@ bool HTTPScheduleClient::cacheScheduleToSPIFFS(const String& date, const String&
     }
 }
 
-bool HTTPScheduleClient::loadScheduleFromCache(const String& date) {
+bool HTTPScheduleClient::loadScheduleFromCache(const String& date, ScheduleManager* target) {
     if (!SPIFFS.begin()) {
         Serial.println("HTTP Client: SPIFFS not available");
         return false;
@@ -811,19 +1680,26 @@ bool HTTPScheduleClient::loadScheduleFromCache(const String& date) {
         return false;
     }
 
-    File file = SPIFFS.open(filepath, "r");
-    if (!file) {
-        Serial.println("HTTP Client: Failed to open cache file: " + filepath);
+    JsonDocument doc;
+    if (!readJsonFile(filepath, doc)) {
+        Serial.println("HTTP Client: ❌ Failed to parse cached schedule");
         return false;
     }
 
-    String json = file.readString();
-    file.close();
-
-    Serial.println("HTTP Client: Loading cached schedule from " + filepath + " (" + String(json.length()) + " bytes)");
+    // Parse into the caller's shadow table, or build and swap one here
+    ScheduleManager* shadow = target ? target : scheduleManager->createShadow(true);
+    if (!shadow) {
+        return false;
+    }
 
-    // Parse and load the cached schedule
-    bool success = parse5DayScheduleResponse(json);
+    bool success = parse5DayScheduleResponse(doc, shadow);
+    if (!target) {
+        if (success) {
+            success = commitShadow(shadow, 1);
+        } else {
+            delete shadow;
+        }
+    }
 
     if (success) {
         Serial.println("HTTP Client: ✅ Successfully loaded schedule from cache");
@@ -834,36 +1710,124 @@ bool HTTPScheduleClient::loadScheduleFromCache(const String& date) {
     return success;
 }
 
-bool HTTPScheduleClient::loadLatestCachedSchedule() {
+bool HTTPScheduleClient::loadLatestCachedSchedule(ScheduleManager* target) {
     if (!SPIFFS.begin()) {
         Serial.println("HTTP Client: SPIFFS not available");
         return false;
     }
 
-    // Get today's date
+    // The snapshot holds the whole horizon last applied, already parsed
+    if (restoreScheduleSnapshot(target)) {
+        return true;
+    }
+
+    // Otherwise every cached day from today on, then yesterday's
     time_t now = time(nullptr);
     struct tm timeinfo;
-    localtime_r(&now, &timeinfo);
     char dateStr[11];
-    strftime(dateStr, sizeof(dateStr), "%Y-%m-%d", &timeinfo);
+    ScheduleManager* shadow = target ? target : scheduleManager->createShadow(true);
+    if (!shadow) {
+        return false;
+    }
 
-    // Try to load today's cache first
-    if (loadScheduleFromCache(String(dateStr))) {
-        return true;
+    int daysLoaded = 0;
+    for (int dayOffset = 0; dayOffset < 5; dayOffset++) {
+        time_t targetTime = now + dayOffset * 86400;
+        localtime_r(&targetTime, &timeinfo);
+        strftime(dateStr, sizeof(dateStr), "%Y-%m-%d", &timeinfo);
+        if (SPIFFS.exists("/schedules/" + String(dateStr) + ".json") &&
+            loadScheduleFromCache(String(dateStr), shadow)) {
+            daysLoaded++;
+        }
     }
 
-    // If today's cache doesn't exist, try yesterday's
-    now -= 86400;  // Subtract 1 day
-    localtime_r(&now, &timeinfo);
-    strftime(dateStr, sizeof(dateStr), "%Y-%m-%d", &timeinfo);
+    if (daysLoaded == 0) {
+        now -= 86400;  // Subtract 1 day
+        localtime_r(&now, &timeinfo);
+        strftime(dateStr, sizeof(dateStr), "%Y-%m-%d", &timeinfo);
 
-    if (loadScheduleFromCache(String(dateStr))) {
-        Serial.println("HTTP Client: Using yesterday's cached schedule as fallback");
-        return true;
+        if (loadScheduleFromCache(String(dateStr), shadow)) {
+            Serial.println("HTTP Client: Using yesterday's cached schedule as fallback");
+            daysLoaded++;
+        }
     }
 
-    Serial.println("HTTP Client: No recent cached schedules found");
-    return false;
+    if (!target) {
+        if (daysLoaded > 0) {
+            commitShadow(shadow, daysLoaded);
+        } else {
+            delete shadow;
+        }
+    }
+
+    if (daysLoaded == 0) {
+        Serial.println("HTTP Client: No recent cached schedules found");
+        return false;
+    }
+    Serial.println("HTTP Client: Loaded " + String(daysLoaded) + " cached day(s)");
+    return true;
+}
+
+// Put the saved AI schedules into target, or into a shadow that is then made
+// live. Records only, so no parser heap and no JSON on the way.
+bool HTTPScheduleClient::restoreScheduleSnapshot(ScheduleManager* target) {
+    ScheduleManager* shadow = target ? target : scheduleManager->createShadow(true);
+    if (!shadow) {
+        return false;
+    }
+
+    unsigned long start = millis();
+    lockSnapshot();
+    int restored = scheduleSnapshot.restore(*shadow, snapshotTime());
+    uint16_t failures = scheduleSnapshot.getRestoreFailures();
+    ScheduleRevision revision = ScheduleRevision();
+    revision.revision = scheduleSnapshot.getRevision();
+    strncpy(revision.horizonEnd, scheduleSnapshot.getHorizonEnd(), sizeof(revision.horizonEnd) - 1);
+    unlockSnapshot();
+
+    if (restored <= 0) {
+        if (!target) {
+            delete shadow;
+        }
+        return false;
+    }
+
+    if (!target) {
+        // The table is what was live when the snapshot was saved, at its revision.
+        // Schedules that could not be added make it a different table: it
+        // gets revision 0 and no horizon, so the next fetch loads it all again
+        // instead of asking for the changes since the snapshot.
+        if (failures > 0) {
+            revision = ScheduleRevision();
+            Serial.println("HTTP Client: Snapshot restored partially, schedules will be fetched again");
+        }
+        if (!commitShadow(shadow, 1, &revision)) {
+            return false;
+        }
+    }
+    Serial.println("HTTP Client: Restored " + String(restored) + " schedule(s) from snapshot in " +
+                   String(millis() - start) + " ms");
+    return true;
+}
+
+void HTTPScheduleClient::clearScheduleSnapshot() {
+    lockSnapshot();
+    scheduleSnapshot.remove();
+    unlockSnapshot();
+    appliedRevision = ScheduleRevision();   // The live table no longer matches it
+    aiClearGeneration++;                    // Fetches already queued must not bring them back
+}
+
+void HTTPScheduleClient::lockSnapshot() {
+    if (snapshotLock) {
+        xSemaphoreTake(snapshotLock, portMAX_DELAY);
+    }
+}
+
+void HTTPScheduleClient::unlockSnapshot() {
+    if (snapshotLock) {
+        xSemaphoreGive(snapshotLock);
+    }
 }
 
 bool HTTPScheduleClient::clearOldCache(int daysToKeep) {
@@ -886,11 +1850,12 @@ bool HTTPScheduleClient::clearOldCache(int daysToKeep) {
     while (file) {
         String filename = String(file.name());
 
-        // Only process .json files in the schedules directory
-        if (filename.endsWith(".json") && !filename.equals(".init")) {
+        // Only process .json files in the schedules directory, and .tmp
+        // files left by a download that was cut short
+        if ((filename.endsWith(".json") || filename.endsWith(".tmp")) && !filename.equals(".init")) {
             time_t fileTime = file.getLastWrite();
 
-            if (fileTime < cutoffTime) {
+            if (fileTime < cutoffTime || filename.endsWith(".tmp")) {
                 String filepath = "/schedules/" + filename;
                 file.close();
 
@@ -913,7 +1878,269 @@ bool HTTPScheduleClient::clearOldCache(int daysToKeep) {
     return true;
 }
 
-// Unified fetch method that supports 1-5 days by calling API once per day
+// Fetch days..days+N-1 with one range request. Returns the number of days
+// loaded into the shadow, 0 if the request or parse failed, or -1 if the
+// server does not support the range form.
+int HTTPScheduleClient::fetchScheduleRange(const String& firstDate, int days, int8_t zoneId, ScheduleManager* shadow) {
+    String url = buildScheduleUrl(firstDate, zoneId, days);
+    Serial.println("  URL: " + url);
+
+    lastFetchRequests++;
+    bool fetched = openRequest(url, true);
+    if (fetched && lastNotModified) {
+        Serial.println("  Not modified");
+        HttpValidator* validator = findValidator(url);
+        uint8_t daysReturned = validator ? validator->days : 0;
+        if (daysReturned > 0 && scheduleUnchanged(url, firstDate, shadow)) {
+            return daysReturned < days ? daysReturned : days;
+        }
+
+        // Nothing left to rebuild it from: ask for the full response
+        forgetValidator(url);
+        lastFetchRequests++;
+        fetched = openRequest(url);
+    }
+    if (!fetched) {
+        Serial.println("  ⚠️  Range request failed - " + lastError);
+
+        // Unknown parameter, route or method: fall back to per-day requests
+        if (lastHttpCode == 400 || lastHttpCode == 404 || lastHttpCode == 405 || lastHttpCode == 501) {
+            return -1;
+        }
+        return 0;
+    }
+
+    // The whole range is cached under its first date as it streams in; the
+    // cache loader handles multi-day bodies
+    File cache = beginCacheFile(firstDate);
+    JsonDocument doc;
+    int daysReturned = 0;
+    if (!readJsonResponse(doc, scheduleFilter, cache ? &cache : nullptr) ||
+        !parseScheduleResponse(doc, shadow, days, &daysReturned)) {
+        Serial.println("  ⚠️  Failed to parse range response");
+        endCacheFile(firstDate, cache, false);
+        forgetValidator(url);
+        return 0;
+    }
+
+    // A server that ignores days= answers with the first day only and says
+    // so in days_returned; the per-day requests replace that day again, so
+    // nothing is lost. Without days_returned the reply covers the range and
+    // may list only the days that have events: the others are empty.
+    if (!doc["days_returned"].isNull()) {
+        if (daysReturned <= 1) {
+            endCacheFile(firstDate, cache, false);
+            forgetValidator(url);
+            return -1;
+        }
+    } else {
+        clearUnlistedDays(doc["data"].as<JsonObject>(), firstDate, days, shadow);
+        daysReturned = days;
+    }
+
+    endCacheFile(firstDate, cache, true);
+    uint8_t loaded = daysReturned < days ? daysReturned : days;
+    saveValidator(url, loaded, countAIEvents(shadow, firstDate, loaded));
+    return loaded;
+}
+
+// Remove the AI events of the days in [firstDate, firstDate + days) that a
+// range reply did not list
+void HTTPScheduleClient::clearUnlistedDays(JsonObject data, const String& firstDate, int days, ScheduleManager* shadow) {
+    uint8_t dayMask;
+    uint32_t firstDayEnd;
+    if (!getDateScope(firstDate, dayMask, firstDayEnd)) {
+        return;
+    }
+
+    uint32_t listed = 0;  // Bit per day offset
+    for (JsonPair datePair : data) {
+        uint32_t dayEnd;
+        if (!getDateScope(datePair.key().c_str(), dayMask, dayEnd) || dayEnd < firstDayEnd) continue;
+        uint32_t offset = (dayEnd - firstDayEnd + 43200UL) / 86400UL;  // Rounded over DST changes
+        if (offset < 32) {
+            listed |= 1UL << offset;
+        }
+    }
+
+    for (int offset = 0; offset < days && offset < 32; offset++) {
+        if (listed & (1UL << offset)) continue;
+        uint32_t dayEnd = firstDayEnd + offset * 86400UL;
+        shadow->removeAISchedulesExpiring(dayEnd, dayEnd + 86400UL);
+    }
+}
+
+// Ask for what changed since base: the server answers with the events added,
+// changed or deleted since that revision within the horizon, plus the whole
+// of each day after base.horizonEnd in the usual data object. Returns the
+// number of days brought up to date in the shadow, 0 if the request failed,
+// or -1 to load the whole horizon instead (revision history gone, or a reply
+// that could not be applied).
+int HTTPScheduleClient::fetchScheduleDelta(const String* dates, int days, const ScheduleRevision& base, ScheduleManager* shadow) {
+    String url = buildScheduleUrl(dates[0], -1, days) + "&since=" + String(base.revision) +
+                 "&known_until=" + String(base.horizonEnd);
+    Serial.println("  URL: " + url);
+
+    // Not conditional: the reply depends on since=, and an empty one is small
+    lastFetchRequests++;
+    if (!openRequest(url)) {
+        Serial.println("  ⚠️  Delta request failed - " + lastError);
+
+        // 410 Gone or any other rejection of the request itself
+        if (lastHttpCode >= 400 && lastHttpCode < 500 && lastHttpCode != HTTP_CODE_TOO_MANY_REQUESTS) {
+            return -1;
+        }
+        return 0;
+    }
+
+    JsonDocument doc;
+    if (!readJsonResponse(doc, scheduleFilter)) {
+        Serial.println("  ⚠️  Failed to read delta response");
+        return 0;
+    }
+
+    JsonArray changes = doc["changes"];
+    if (changes.isNull()) {
+        // A server without revisions sends the horizon as a range response
+        int daysReturned = 0;
+        if (!parseScheduleResponse(doc, shadow, days, &daysReturned) || daysReturned < days) {
+            return -1;
+        }
+        Serial.println("  ✅ Server sent the whole horizon");
+        return days;
+    }
+
+    if (!(doc["success"] | false) || !applyScheduleChanges(changes, shadow)) {
+        return -1;
+    }
+
+    // Days the shadow had no events for yet come whole
+    if (!doc["data"].isNull() && !parseScheduleResponse(doc, shadow, 0)) {
+        return -1;
+    }
+
+    responseRevision = doc["revision"] | 0;
+    if (responseRevision == 0) {
+        return -1;
+    }
+
+    lastFetchDelta = true;
+    deltaSyncs++;
+    Serial.println("  ✅ Applied " + String(changes.size()) + " change(s), revision " +
+                   String(base.revision) + " -> " + String(responseRevision));
+    return days;
+}
+
+// Apply a delta to the shadow. Changes are keyed by server event ID:
+//   {"op":"upsert", "id", "date", "zone_id", "start_time", "duration_min", ...}
+//   {"op":"delete", "id"}
+// False on a change that can't be applied; the caller then loads in full.
+bool HTTPScheduleClient::applyScheduleChanges(JsonArray changes, ScheduleManager* shadow) {
+    for (JsonObject change : changes) {
+        const char* op = change["op"] | "";
+        uint32_t serverId = change["id"] | 0;
+        if (serverId == 0) {
+            Serial.println("  ⚠️  Change without an event ID");
+            return false;
+        }
+
+        const ScheduleEntry* existing = shadow->findByServerId(serverId);
+        if (strcmp(op, "delete") == 0) {
+            if (existing) {
+                shadow->removeSchedule(existing->id);
+            }
+            continue;
+        }
+        if (strcmp(op, "upsert") != 0) {
+            Serial.println("  ⚠️  Unknown change \"" + String(op) + "\" for event " + String(serverId));
+            return false;
+        }
+
+        String date = change["date"] | "";
+        uint8_t dayMask;
+        uint32_t dayEndUtc;
+        uint8_t zoneId = change["zone_id"] | 0;
+        if (!getDateScope(date, dayMask, dayEndUtc) || zoneId == 0) {
+            Serial.println("  ⚠️  Invalid date or zone for event " + String(serverId));
+            return false;
+        }
+
+        // Updated in place; if the new version can't be added (e.g. moved to
+        // a disabled zone) the old one must not keep running
+        uint32_t existingId = existing ? existing->id : 0;
+        if (addServerEvent(shadow, zoneId, change, dayMask, dayEndUtc, date) == 0 && existingId > 0) {
+            shadow->removeSchedule(existingId);
+        }
+    }
+    return true;
+}
+
+// Legacy path: one request per day, falling back to each day's cache
+int HTTPScheduleClient::fetchScheduleDays(const String* dates, int days, int8_t zoneId, ScheduleManager* shadow, int& daysFromCache) {
+    int daysSuccessful = 0;
+
+    for (int dayOffset = 0; dayOffset < days; dayOffset++) {
+        // Days not reached keep their previous events
+        if (jobAborted()) {
+            break;
+        }
+
+        const String& dateStr = dates[dayOffset];
+        Serial.println("\n  Day " + String(dayOffset + 1) + "/" + String(days) + ": " + dateStr);
+
+        String url = buildScheduleUrl(dateStr, zoneId);
+        Serial.println("    URL: " + url);
+
+        lastFetchRequests++;
+        bool fetched = openRequest(url, true);
+        if (fetched && lastNotModified) {
+            // Same events as last time, and the cached copy is this response
+            Serial.println("    Not modified");
+            if (scheduleUnchanged(url, dateStr, shadow)) {
+                daysSuccessful++;
+                continue;
+            }
+            lastFetchRequests++;
+            fetched = openRequest(url);
+        }
+        if (!fetched) {
+            Serial.println("    ⚠️  Failed to fetch - " + lastError);
+            if (loadScheduleFromCache(dateStr, shadow)) {
+                daysFromCache++;
+            }
+            continue;  // Continue with next day even if this one fails
+        }
+
+        // Parse this day's schedule into the shadow table, caching the
+        // response as it streams in
+        File cache = beginCacheFile(dateStr);
+        JsonDocument doc;
+        if (readJsonResponse(doc, scheduleFilter, cache ? &cache : nullptr) &&
+            parseScheduleResponse(doc, shadow, 1)) {
+            daysSuccessful++;
+            Serial.println("    ✅ Loaded schedules successfully");
+            endCacheFile(dateStr, cache, true);
+            saveValidator(url, 1, countAIEvents(shadow, dateStr, 1));
+        } else {
+            endCacheFile(dateStr, cache, false);
+            forgetValidator(url);
+            Serial.println("    ⚠️  Failed to parse response");
+            if (loadScheduleFromCache(dateStr, shadow)) {
+                daysFromCache++;
+            }
+        }
+
+        // Small delay between requests to avoid overwhelming server
+        if (dayOffset < days - 1) {
+            delay(100);
+        }
+    }
+
+    return daysSuccessful;
+}
+
+// Unified fetch method that supports 1-5 days with one range request,
+// or one request per day when the server does not support ranges
 bool HTTPScheduleClient::fetchSchedule(int days, int8_t zoneId) {
     if (days < 1 || days > 5) {
         lastError = "Invalid days parameter (must be 1-5)";
@@ -925,70 +2152,134 @@ bool HTTPScheduleClient::fetchSchedule(int days, int8_t zoneId) {
         return false;
     }
 
+    // Build the new AI schedules in a shadow table. The live table keeps
+    // running unchanged until every day has been fetched and checked, and a
+    // day that fails keeps its previous (or cached) events instead of a gap.
+    ScheduleManager* shadow = scheduleManager->createShadow(true);
+    if (!shadow) {
+        lastError = "Out of memory for schedule table";
+        Serial.println("HTTP Client: " + lastError);
+        return false;
+    }
+
+    int daysLoaded = loadSchedule(days, zoneId, shadow, appliedRevision);
+    if (daysLoaded <= 0) {
+        delete shadow;
+        return false;
+    }
+    return commitShadow(shadow, daysLoaded, &fetchedRevision);
+}
+
+// Fetch the horizon into a shadow table, falling back to the cache. Returns
+// the number of days loaded, 0 if nothing could be loaded. Only the shadow,
+// the SPIFFS cache and the network are touched, so this runs on the worker.
+int HTTPScheduleClient::loadSchedule(int days, int8_t zoneId, ScheduleManager* shadow, const ScheduleRevision& base) {
+    // Cached and per-day loads have no revision of their own
+    fetchedRevision = ScheduleRevision();
+    lastFetchDelta = false;
+
     if (WiFi.status() != WL_CONNECTED) {
         lastError = "WiFi not connected";
         Serial.println("HTTP Client: " + lastError + " - attempting to load from cache");
         consecutiveFailures++;
 
         // Try to load from cache as fallback
-        return loadLatestCachedSchedule();
+        return loadLatestCachedSchedule(shadow) ? 1 : 0;
     }
 
     Serial.println("HTTP Client: Fetching " + String(days) + "-day schedule" +
                    (zoneId > 0 ? " (zone " + String(zoneId) + ")" : " (all zones)"));
     Serial.println("  Server: " + serverUrl);
 
-    // Clear existing AI schedules before loading new ones
-    scheduleManager->clearAISchedules();
+    unsigned long fetchStart = millis();
+    lastFetchRequests = 0;
 
-    // Get current time for calculating dates
+    // Local dates of the horizon
     time_t now = time(nullptr);
     struct tm timeinfo;
-    localtime_r(&now, &timeinfo);
-
-    int totalEventsLoaded = 0;
-    int daysSuccessful = 0;
-
-    // Fetch schedule for each day
+    String dates[5];
+    uint32_t firstDayEnd = 0;
+    uint32_t lastDayEnd = 0;
     for (int dayOffset = 0; dayOffset < days; dayOffset++) {
-        // Calculate date for this iteration
         time_t targetTime = now + (dayOffset * 86400);  // Add days in seconds
         localtime_r(&targetTime, &timeinfo);
 
         char dateStr[11];
         strftime(dateStr, sizeof(dateStr), "%Y-%m-%d", &timeinfo);
+        dates[dayOffset] = String(dateStr);
 
-        Serial.println("\n  Day " + String(dayOffset + 1) + "/" + String(days) + ": " + String(dateStr));
-
-        String url = buildScheduleUrl(String(dateStr), zoneId);
-        Serial.println("    URL: " + url);
-
-        String response;
-        if (!executeRequest(url, response)) {
-            Serial.println("    ⚠️  Failed to fetch - " + lastError);
-            continue;  // Continue with next day even if this one fails
+        uint8_t dayMask;
+        uint32_t dayEnd;
+        if (getDateScope(dates[dayOffset], dayMask, dayEnd)) {
+            if (firstDayEnd == 0) firstDayEnd = dayEnd;
+            lastDayEnd = dayEnd;
         }
+    }
 
-        Serial.println("    Received (" + String(response.length()) + " bytes)");
-
-        // Parse this day's schedule and add to ScheduleManager
-        if (parseScheduleResponse(response, 1)) {
-            daysSuccessful++;
-            Serial.println("    ✅ Loaded schedules successfully");
+    // A rejection may have been a deploy hiccup: probe the range form again
+    if (!rangeSupported && millis() - rangeUnsupportedAt >= RANGE_RETRY_MS) {
+        Serial.println("  Trying range requests again");
+        rangeSupported = true;
+    }
 
-            // Cache this day's response
-            cacheScheduleToSPIFFS(String(dateStr), response);
+    int daysSuccessful = 0;
+    int daysFromCache = 0;
+    bool perDay = (days == 1 || !rangeSupported);
+
+    // Only the changes since the shadow's revision, when it has one
+    bool fullRange = !perDay;
+    responseRevision = 0;
+    if (!perDay && zoneId <= 0 && base.revision > 0 && base.horizonEnd[0] != '\0') {
+        int loaded = fetchScheduleDelta(dates, days, base, shadow);
+        if (loaded > 0) {
+            daysSuccessful = loaded;
+            fullRange = false;
+        } else if (loaded < 0) {
+            Serial.println("  Changes since revision " + String(base.revision) +
+                           " not available, fetching the whole horizon");
+            fullResyncs++;
+            responseRevision = 0;
         } else {
-            Serial.println("    ⚠️  Failed to parse response");
+            fullRange = false;  // Failed like a range request would, the cache is below
         }
+    }
 
-        // Small delay between requests to avoid overwhelming server
-        if (dayOffset < days - 1) {
-            delay(100);
+    if (fullRange) {
+        int loaded = fetchScheduleRange(dates[0], days, zoneId, shadow);
+        if (loaded > 0) {
+            daysSuccessful = loaded;
+            Serial.println("  ✅ Loaded " + String(loaded) + " days in one request");
+        } else if (loaded < 0) {
+            Serial.println("  Server does not support range requests, fetching day by day");
+            rangeSupported = false;
+            rangeUnsupportedAt = millis();
+            perDay = true;
         }
+        // A failed range request falls through to the latest cached range below
+    }
+
+    if (perDay) {
+        daysSuccessful = fetchScheduleDays(dates, days, zoneId, shadow, daysFromCache);
+        responseRevision = 0;
     }
 
+    // One response covered the whole horizon of all zones: the shadow is at
+    // its revision
+    if (!perDay && zoneId <= 0 && daysSuccessful == days && responseRevision > 0) {
+        fetchedRevision.revision = responseRevision;
+        strncpy(fetchedRevision.horizonEnd, dates[days - 1].c_str(), sizeof(fetchedRevision.horizonEnd) - 1);
+    }
+
+    lastFetchDurationMs = millis() - fetchStart;
     Serial.println("");
+    Serial.println("HTTP Client: Fetch took " + String(lastFetchDurationMs) + " ms with " +
+                   String(lastFetchRequests) + " request(s)");
+
+    // Drop AI events from before yesterday or without a date
+    if (daysSuccessful + daysFromCache > 0 && firstDayEnd > 0) {
+        shadow->removeAISchedulesExpiring(firstDayEnd - 86400UL, lastDayEnd + 86400UL, true);
+    }
+
     if (daysSuccessful > 0) {
         lastFetchTime = millis();
         consecutiveFailures = 0;
@@ -1001,197 +2292,612 @@ bool HTTPScheduleClient::fetchSchedule(int days, int8_t zoneId) {
             syncPendingEvents();
         }
 
-        return true;
+        return daysSuccessful + daysFromCache;
     } else {
         consecutiveFailures++;
         Serial.println("HTTP Client: ❌ Failed to fetch any schedules");
+        if (daysFromCache > 0) {
+            return daysFromCache;
+        }
         Serial.println("  Attempting to load from cache...");
-        return loadLatestCachedSchedule();
+        return loadLatestCachedSchedule(shadow) ? 1 : 0;
     }
 }
 
 /**
  * Save event to pending queue (for offline sync)
- * Events are stored in SPIFFS and synced when connection restored
+ * Events are appended to the SPIFFS journal and synced when connection restored
  */
 bool HTTPScheduleClient::savePendingEvent(const EventCompletion& completion) {
-    if (!SPIFFS.begin()) {
-        Serial.println("HTTP Client: Failed to mount SPIFFS for pending event save");
+    if (!pendingEvents.append(createPendingEventRecord(completion))) {
+        Serial.println("HTTP Client: Failed to save pending event for zone " + String(completion.zoneId));
         return false;
     }
 
-    // Create /events directory if it doesn't exist
-    if (!SPIFFS.exists("/events")) {
-        File dir = SPIFFS.open("/events/.init", "w");
-        if (dir) {
-            dir.close();
-        }
-    }
-
-    // Generate filename: /events/pending_{timestamp}_{zoneId}.json
-    String filename = "/events/pending_" + String(millis()) + "_z" + String(completion.zoneId) + ".json";
+    Serial.println("HTTP Client: 💾 Saved pending event for zone " + String(completion.zoneId) +
+                   " (" + String(pendingEvents.getPendingCount()) + " pending)");
+    return true;
+}
 
-    File file = SPIFFS.open(filename, "w");
-    if (!file) {
-        Serial.println("HTTP Client: Failed to create pending event file: " + filename);
-        return false;
-    }
+/**
+ * Get count of pending events waiting to be synced
+ */
+int HTTPScheduleClient::getPendingEventCount() {
+    return pendingEvents.getPendingCount();
+}
 
-    // Write event data as JSON
+// One event as the sync endpoint takes it, stored as a journal record
+String HTTPScheduleClient::createPendingEventRecord(const EventCompletion& completion) {
     JsonDocument doc;
     doc["schedule_id"] = completion.scheduleId;
     doc["zone_id"] = completion.zoneId;
-    doc["device_id"] = completion.deviceId;
     doc["start_time"] = completion.startTime;
     doc["end_time"] = completion.endTime;
     doc["duration_min"] = completion.actualDurationMin;
     doc["water_used_liters"] = completion.waterUsedLiters;
+    doc["completed"] = (completion.status == "completed");
     doc["status"] = completion.status;
     doc["notes"] = completion.notes;
-    doc["saved_at"] = String(millis());
 
-    serializeJson(doc, file);
-    file.close();
-
-    Serial.println("HTTP Client: 💾 Saved pending event: " + filename);
-    return true;
+    String record;
+    serializeJson(doc, record);
+    return record;
 }
 
-/**
- * Get count of pending events waiting to be synced
- */
-int HTTPScheduleClient::getPendingEventCount() {
-    if (!SPIFFS.begin()) {
-        return 0;
-    }
-
-    int count = 0;
+// Move events saved one file each by older firmware into the journal
+void HTTPScheduleClient::importLegacyPendingEvents() {
     File root = SPIFFS.open("/events");
     if (!root || !root.isDirectory()) {
-        return 0;
+        return;
     }
 
+    int imported = 0;
     File file = root.openNextFile();
     while (file) {
-        String name = file.name();
-        if (name.startsWith("/events/pending_")) {
-            count++;
+        String path = file.path();
+        if (path.startsWith("/events/pending_")) {
+            JsonDocument doc;
+            DeserializationError error = deserializeJson(doc, file);
+            file.close();
+
+            if (!error) {
+                EventCompletion completion;
+                completion.scheduleId = doc["schedule_id"];
+                completion.zoneId = doc["zone_id"];
+                completion.startTime = doc["start_time"].as<String>();
+                completion.endTime = doc["end_time"].as<String>();
+                completion.actualDurationMin = doc["duration_min"];
+                completion.waterUsedLiters = doc["water_used_liters"];
+                completion.status = doc["status"].as<String>();
+                completion.notes = doc["notes"] | "";
+                if (!pendingEvents.append(createPendingEventRecord(completion))) {
+                    break;      // Keep the file, try again on the next boot
+                }
+                imported++;
+            }
+            SPIFFS.remove(path);
+        } else {
+            file.close();
         }
         file = root.openNextFile();
     }
 
-    return count;
+    if (imported > 0) {
+        Serial.println("HTTP Client: Moved " + String(imported) + " pending event file(s) into the journal");
+    }
 }
 
 /**
- * Sync all pending events to server
+ * Sync pending events to server, one bounded batch at a time
  * Called after successful schedule fetch or WiFi reconnection
  */
 bool HTTPScheduleClient::syncPendingEvents() {
-    if (!SPIFFS.begin()) {
-        Serial.println("HTTP Client: Failed to mount SPIFFS for event sync");
-        return false;
-    }
-
-    // Collect all pending events
-    JsonDocument eventsDoc;
-    JsonArray events = eventsDoc["events"].to<JsonArray>();
-    eventsDoc["device_id"] = deviceId;
-
-    File root = SPIFFS.open("/events");
-    if (!root || !root.isDirectory()) {
+    if (pendingEvents.getPendingCount() == 0) {
         Serial.println("HTTP Client: No pending events to sync");
         return true;
     }
 
-    int eventCount = 0;
-    File file = root.openNextFile();
-    while (file) {
-        String name = file.name();
-        if (name.startsWith("/events/pending_")) {
-            // Parse event file
-            JsonDocument eventDoc;
-            DeserializationError error = deserializeJson(eventDoc, file);
+    String url = buildEventSyncUrl();
+    int totalSynced = 0;
+    int totalSkipped = 0;
+    int totalErrors = 0;
 
-            if (!error) {
-                JsonObject event = events.add<JsonObject>();
-                event["schedule_id"] = eventDoc["schedule_id"];
-                event["zone_id"] = eventDoc["zone_id"];
-                event["start_time"] = eventDoc["start_time"];
-                event["end_time"] = eventDoc["end_time"];
-                event["duration_min"] = eventDoc["duration_min"];
-                event["water_used_liters"] = eventDoc["water_used_liters"];
-                event["completed"] = (eventDoc["status"].as<String>() == "completed");
-                event["status"] = eventDoc["status"];
-                event["notes"] = eventDoc["notes"];
-
-                eventCount++;
-            } else {
-                Serial.println("HTTP Client: Failed to parse event file: " + name);
+    while (pendingEvents.getPendingCount() > 0) {
+        if (jobAborted()) {
+            return false;       // The rest goes with the next sync
+        }
+
+        String payload = "{\"device_id\":\"" + deviceId + "\",\"events\":[";
+        uint32_t endOffset;
+        uint16_t consumed;
+        uint32_t generation;
+        uint16_t eventCount = pendingEvents.readBatch(payload, SYNC_BATCH_EVENTS, SYNC_BATCH_BYTES, endOffset, consumed,
+                                                      generation);
+        payload += "]}";
+
+        if (consumed == 0) {
+            Serial.println("HTTP Client: Failed to read pending events");
+            return false;
+        }
+
+        if (eventCount > 0) {
+            Serial.println("HTTP Client: 📤 Syncing " + String(eventCount) + " of " +
+                           String(pendingEvents.getPendingCount()) + " pending events");
+            Serial.println("  Payload size: " + String(payload.length()) + " bytes");
+
+            String response;
+            if (!executePostRequest(url, payload, response)) {
+                Serial.println("HTTP Client: ❌ Failed to sync events - " + lastError);
+                return false;
             }
+
+            JsonDocument respDoc;
+            DeserializationError error = deserializeJson(respDoc, response);
+            if (error) {
+                Serial.println("HTTP Client: Failed to parse sync response");
+                return false;
+            }
+            if (!respDoc["success"]) {
+                Serial.println("HTTP Client: ⚠️  Event sync partially failed");
+                return false;
+            }
+
+            totalSynced += respDoc["synced"] | 0;
+            totalSkipped += respDoc["skipped"] | 0;
+            totalErrors += respDoc["errors"] | 0;
+        }
+
+        // The server has this batch; it won't be sent again unless the journal
+        // was rewritten meanwhile, and then the server skips the duplicates
+        if (!pendingEvents.acknowledge(endOffset, consumed, generation)) {
+            Serial.println("HTTP Client: Failed to acknowledge synced events");
+            return false;
         }
-        file.close();
-        file = root.openNextFile();
     }
 
-    if (eventCount == 0) {
-        Serial.println("HTTP Client: No valid pending events to sync");
-        return true;
+    Serial.println("HTTP Client: ✅ Event sync completed");
+    Serial.println("  Synced: " + String(totalSynced) + ", Skipped: " + String(totalSkipped) + ", Errors: " + String(totalErrors));
+    return true;
+}
+
+// ===== BACKGROUND WORKER =====
+
+const char* HTTPScheduleClient::jobTypeName(HttpJobType type) {
+    switch (type) {
+        case HTTP_JOB_FETCH_SCHEDULE: return "schedule";
+        case HTTP_JOB_FETCH_ZONE_DETAILS: return "zone_details";
+        case HTTP_JOB_REPORT_COMPLETION: return "completion";
+        case HTTP_JOB_TEST_CONNECTION: return "connection_test";
+        default: return "unknown";
     }
+}
 
-    // Serialize payload
-    String payload;
-    serializeJson(eventsDoc, payload);
+const char* HTTPScheduleClient::jobStatusName(HttpJobStatus status) {
+    switch (status) {
+        case HTTP_JOB_OK: return "ok";
+        case HTTP_JOB_FAILED: return "failed";
+        case HTTP_JOB_CANCELLED: return "cancelled";
+        case HTTP_JOB_EXPIRED: return "expired";
+        default: return "unknown";
+    }
+}
 
-    Serial.println("HTTP Client: 📤 Syncing " + String(eventCount) + " pending events");
-    Serial.println("  Payload size: " + String(payload.length()) + " bytes");
+bool HTTPScheduleClient::startWorker() {
+    if (jobQueue) {
+        return true; // Already running
+    }
 
-    // POST to /api/events/sync
-    String url = buildEventSyncUrl();
-    String response;
+    if (!resultQueue) {
+        resultQueue = xQueueCreate(RESULT_QUEUE_LENGTH, sizeof(HttpJobResult));
+    }
+    QueueHandle_t jobs = xQueueCreate(JOB_QUEUE_LENGTH, sizeof(HttpJob));
+    if (!jobs || !resultQueue) {
+        Serial.println("HTTP Client: Failed to create worker queues");
+        if (jobs) vQueueDelete(jobs);
+        return false;
+    }
+    jobQueue = jobs;
 
-    if (!executePostRequest(url, payload, response)) {
-        Serial.println("HTTP Client: ❌ Failed to sync events - " + lastError);
+    // Core 0 with the WiFi stack; the loop and the Hunter buses run on core 1
+    if (xTaskCreatePinnedToCore(workerLoop, "httpWorker", WORKER_STACK, this, WORKER_PRIORITY, &workerTask, 0) != pdPASS) {
+        Serial.println("HTTP Client: Failed to start worker task");
+        vQueueDelete(jobQueue);
+        jobQueue = nullptr;
+        workerTask = nullptr;
         return false;
     }
 
-    // Parse response
-    JsonDocument respDoc;
-    DeserializationError error = deserializeJson(respDoc, response);
+    Serial.println("HTTP Client: Worker task started (queue of " + String(JOB_QUEUE_LENGTH) + ")");
+    return true;
+}
 
-    if (error) {
-        Serial.println("HTTP Client: Failed to parse sync response");
+void HTTPScheduleClient::setResultCallback(void (*callback)(const HttpJobResult& result)) {
+    resultCallback = callback;
+}
+
+uint32_t HTTPScheduleClient::submit(HttpJob& job, uint32_t timeoutMs) {
+    job.id = nextJobId++;
+    if (nextJobId == 0) nextJobId = 1;
+    job.queuedAt = millis();
+    job.deadline = job.queuedAt + timeoutMs;
+
+    if (!jobQueue) {
+        // No worker: run the request here (blocking); its result is handled
+        // by the next processResults() like any other, so callers see the same order
+        if (!resultQueue) {
+            resultQueue = xQueueCreate(RESULT_QUEUE_LENGTH, sizeof(HttpJobResult));
+        }
+        HttpJobResult result;
+        pendingJobs[job.type]++;
+        runJob(job, result);
+        if (!resultQueue || xQueueSend(resultQueue, &result, 0) != pdTRUE) {
+            finishJob(result);
+        }
+        return job.id;
+    }
+
+    if (xQueueSend(jobQueue, &job, 0) != pdTRUE) {
+        Serial.println("HTTP Client: Request queue full, dropped " + String(jobTypeName(job.type)) + " request");
+        return 0;
+    }
+    pendingJobs[job.type]++;
+    return job.id;
+}
+
+uint32_t HTTPScheduleClient::submitScheduleFetch(int days, int8_t zoneId, uint32_t timeoutMs) {
+    if (days < 1 || days > 5 || !configManager || !scheduleManager) {
+        return 0;
+    }
+
+    // The worker fills a snapshot taken here; it never touches the live table
+    ScheduleManager* shadow = scheduleManager->createShadow(true);
+    if (!shadow) {
+        Serial.println("HTTP Client: Out of memory for schedule table");
+        return 0;
+    }
+
+    HttpJob job = {};
+    job.type = HTTP_JOB_FETCH_SCHEDULE;
+    job.shadow = shadow;
+    job.base = appliedRevision;     // What the snapshot holds, for a delta sync
+    job.clearGeneration = aiClearGeneration;
+    job.days = days;
+    job.zoneId = zoneId;
+
+    uint32_t id = submit(job, timeoutMs);
+    if (id == 0) {
+        delete shadow;
+    }
+    return id;
+}
+
+uint32_t HTTPScheduleClient::submitZoneDetailsFetch(uint32_t timeoutMs) {
+    if (!configManager) {
+        return 0;
+    }
+
+    HttpJob job = {};
+    job.type = HTTP_JOB_FETCH_ZONE_DETAILS;
+    return submit(job, timeoutMs);
+}
+
+uint32_t HTTPScheduleClient::submitCompletion(uint32_t scheduleId, uint8_t zoneId, float durationMin, float waterUsed,
+                                              const char* status, uint32_t timeoutMs) {
+    HttpJob job = {};
+    job.type = HTTP_JOB_REPORT_COMPLETION;
+    job.scheduleId = scheduleId;
+    job.zoneId = zoneId;
+    job.durationMin = durationMin;
+    job.waterUsed = waterUsed;
+    job.endTime = time(nullptr);
+    strncpy(job.status, status, sizeof(job.status) - 1);
+
+    uint32_t id = submit(job, timeoutMs);
+    if (id == 0) {
+        // Not lost: the next event sync sends it
+        savePendingEvent(buildCompletion(scheduleId, zoneId, durationMin, waterUsed, String(job.status), job.endTime));
+    }
+    return id;
+}
+
+uint32_t HTTPScheduleClient::submitConnectionTest(uint32_t timeoutMs) {
+    HttpJob job = {};
+    job.type = HTTP_JOB_TEST_CONNECTION;
+    return submit(job, timeoutMs);
+}
+
+bool HTTPScheduleClient::cancelRequest(uint32_t id) {
+    if (id == 0 || id >= nextJobId) {
         return false;
     }
+    for (uint8_t i = 0; i < recentCount; i++) {
+        if (recentResults[i].id == id) {
+            return false; // Already finished
+        }
+    }
 
-    bool success = respDoc["success"];
-    int synced = respDoc["synced"] | 0;
-    int skipped = respDoc["skipped"] | 0;
-    int errors = respDoc["errors"] | 0;
+    cancelledIds[nextCancelSlot] = id;
+    nextCancelSlot = (nextCancelSlot + 1) % CANCEL_SLOTS;
+    Serial.println("HTTP Client: Cancelling request " + String(id));
+    return true;
+}
 
-    if (success) {
-        Serial.println("HTTP Client: ✅ Event sync completed");
-        Serial.println("  Synced: " + String(synced) + ", Skipped: " + String(skipped) + ", Errors: " + String(errors));
-
-        // Delete successfully synced event files
-        File root2 = SPIFFS.open("/events");
-        File file2 = root2.openNextFile();
-        while (file2) {
-            String name = file2.name();
-            if (name.startsWith("/events/pending_")) {
-                file2.close();
-                SPIFFS.remove(name);
-                Serial.println("  Removed: " + name);
-                file2 = root2.openNextFile();
+bool HTTPScheduleClient::isCancelled(uint32_t id) const {
+    for (uint8_t i = 0; i < CANCEL_SLOTS; i++) {
+        if (cancelledIds[i] == id) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// True once the request the worker is running was cancelled or ran past its
+// deadline; checked before every attempt and between the days of a fetch
+bool HTTPScheduleClient::jobAborted() {
+    if (activeJobId == 0) {
+        return false;
+    }
+    if (isCancelled(activeJobId)) {
+        lastError = "Request cancelled";
+        return true;
+    }
+    if ((int32_t)(millis() - activeDeadline) >= 0) {
+        lastError = "Request deadline passed";
+        return true;
+    }
+    return false;
+}
+
+// Socket timeout for the next attempt, cut short by the request's deadline
+uint16_t HTTPScheduleClient::requestTimeout() {
+    if (activeJobId == 0) {
+        return HTTP_TIMEOUT;
+    }
+    int32_t remaining = (int32_t)(activeDeadline - millis());
+    if (remaining < 1000) {
+        return 1000;
+    }
+    return remaining < HTTP_TIMEOUT ? remaining : HTTP_TIMEOUT;
+}
+
+void HTTPScheduleClient::workerLoop(void* param) {
+    HTTPScheduleClient* client = static_cast<HTTPScheduleClient*>(param);
+    HttpJob job;
+    HttpJobResult result;
+
+    while (true) {
+        // Wake up when idle, to close the kept-alive connection in time
+        if (xQueueReceive(client->jobQueue, &job, pdMS_TO_TICKS(KEEP_ALIVE_IDLE_MS)) != pdTRUE) {
+            client->closeIdleConnection();
+            continue;
+        }
+
+        client->runJob(job, result);
+
+        // The loop drains results every pass; waiting here rather than
+        // dropping keeps a filled shadow table from leaking
+        xQueueSend(client->resultQueue, &result, portMAX_DELAY);
+    }
+}
+
+void HTTPScheduleClient::runJob(const HttpJob& job, HttpJobResult& result) {
+    result.id = job.id;
+    result.type = job.type;
+    result.status = HTTP_JOB_OK;
+    result.shadow = job.shadow;
+    result.daysLoaded = 0;
+    result.revision = ScheduleRevision();
+    result.clearGeneration = job.clearGeneration;
+    result.delta = false;
+    result.requests = 0;
+    result.notModified = 0;
+    result.zones = nullptr;
+    result.error[0] = '\0';
+
+    bool cancelled = isCancelled(job.id);
+    if (cancelled || (int32_t)(millis() - job.deadline) >= 0) {
+        result.status = cancelled ? HTTP_JOB_CANCELLED : HTTP_JOB_EXPIRED;
+        strncpy(result.error, cancelled ? "Request cancelled" : "Request deadline passed", sizeof(result.error) - 1);
+        result.error[sizeof(result.error) - 1] = '\0';
+
+        // A completion that was never sent is kept for the next event sync
+        if (job.type == HTTP_JOB_REPORT_COMPLETION) {
+            savePendingEvent(buildCompletion(job.scheduleId, job.zoneId, job.durationMin, job.waterUsed,
+                                             String(job.status), job.endTime));
+        }
+        result.elapsedMs = millis() - job.queuedAt;
+        return;
+    }
+
+    activeDeadline = job.deadline;
+    activeJobId = job.id;
+    lastError = "";
+
+    uint32_t notModifiedBefore = notModifiedCount;
+    bool ok = false;
+    switch (job.type) {
+        case HTTP_JOB_FETCH_SCHEDULE:
+            result.daysLoaded = loadSchedule(job.days, job.zoneId, job.shadow, job.base);
+            result.requests = lastFetchRequests;
+            result.revision = fetchedRevision;
+            result.delta = lastFetchDelta;
+            ok = result.daysLoaded > 0;
+            break;
+        case HTTP_JOB_FETCH_ZONE_DETAILS:
+            // A copy is only handed to the loop when the content changed
+            ok = requestZoneDetails(*zoneDetailsStaging);
+            if (ok && !lastNotModified) {
+                if (zoneDetailsStaging->hash != zoneDetailsHash) {
+                    result.zones = new ZoneDetailsTable(*zoneDetailsStaging);
+                } else {
+                    Serial.println("HTTP Client: Zone details unchanged");
+                }
+            }
+            break;
+        case HTTP_JOB_REPORT_COMPLETION:
+            // Saved for the next event sync when it can't be sent
+            ok = reportCompletion(job.scheduleId, job.zoneId, job.durationMin, job.waterUsed,
+                                  String(job.status), job.endTime);
+            break;
+        default:
+            ok = testConnection();
+            break;
+    }
+    result.notModified = notModifiedCount - notModifiedBefore;
+
+    // A cancelled fetch is discarded even if it got data; a sent completion stays sent
+    cancelled = isCancelled(job.id) && job.type != HTTP_JOB_REPORT_COMPLETION;
+    if (cancelled) {
+        result.status = HTTP_JOB_CANCELLED;
+    } else if (!ok) {
+        result.status = (int32_t)(millis() - job.deadline) >= 0 ? HTTP_JOB_EXPIRED : HTTP_JOB_FAILED;
+    }
+    activeJobId = 0;
+
+    strncpy(result.error, result.status == HTTP_JOB_OK ? "" : lastError.c_str(), sizeof(result.error) - 1);
+    result.error[sizeof(result.error) - 1] = '\0';
+    result.elapsedMs = millis() - job.queuedAt;
+}
+
+uint8_t HTTPScheduleClient::processResults() {
+    if (!resultQueue) {
+        return 0;
+    }
+
+    uint8_t handled = 0;
+    HttpJobResult result;
+    while (xQueueReceive(resultQueue, &result, 0) == pdTRUE) {
+        finishJob(result);
+        handled++;
+    }
+    return handled;
+}
+
+// Main loop side of a finished request: commit what it fetched, record it and
+// tell the result callback
+void HTTPScheduleClient::finishJob(HttpJobResult& result) {
+    if (pendingJobs[result.type] > 0) {
+        pendingJobs[result.type]--;
+    }
+
+    // Cancelled after the worker finished it, but before it was committed
+    if (result.status == HTTP_JOB_OK && result.type != HTTP_JOB_REPORT_COMPLETION && isCancelled(result.id)) {
+        result.status = HTTP_JOB_CANCELLED;
+        strncpy(result.error, "Request cancelled", sizeof(result.error) - 1);
+    }
+
+    // The AI schedules were cleared while this fetch was out; its shadow
+    // still holds the old ones
+    if (result.status == HTTP_JOB_OK && result.shadow && result.clearGeneration != aiClearGeneration) {
+        result.status = HTTP_JOB_CANCELLED;
+        strncpy(result.error, "AI schedules cleared during the fetch", sizeof(result.error) - 1);
+    }
+
+    if (result.shadow) {
+        if (result.status == HTTP_JOB_OK) {
+            // The shadow is a snapshot from when the request was queued: take
+            // the basic schedules as they are now and the fetched AI schedules
+            ScheduleManager* merged = scheduleManager->createShadow(false);
+            if (merged) {
+                merged->takeAISchedulesFrom(*result.shadow);
+                if (!commitShadow(merged, result.daysLoaded, &result.revision)) {
+                    result.status = HTTP_JOB_FAILED;
+                }
             } else {
-                file2.close();
-                file2 = root2.openNextFile();
+                result.status = HTTP_JOB_FAILED;
+                strncpy(result.error, "Out of memory for schedule table", sizeof(result.error) - 1);
             }
         }
+        delete result.shadow;
+        result.shadow = nullptr;
+    }
 
-        return true;
-    } else {
-        Serial.println("HTTP Client: ⚠️  Event sync partially failed");
-        return false;
+    if (result.zones) {
+        if (result.status == HTTP_JOB_OK) {
+            applyZoneDetails(result.zones);
+        } else {
+            delete result.zones;
+        }
+        result.zones = nullptr;
+    } else if (result.type == HTTP_JOB_FETCH_ZONE_DETAILS && result.status == HTTP_JOB_OK) {
+        // 304 or the same content: the current table was confirmed
+        lastZoneDetailsFetchTime = millis();
     }
+
+    strncpy(lastResultError, result.error, sizeof(lastResultError) - 1);
+    lastResultError[sizeof(lastResultError) - 1] = '\0';
+
+    Serial.printf("HTTP Client: Request %lu (%s) %s after %lu ms%s%s\n",
+                  (unsigned long)result.id, jobTypeName(result.type), jobStatusName(result.status),
+                  (unsigned long)result.elapsedMs, result.error[0] ? " - " : "", result.error);
+
+    // Newest first, for the status endpoint
+    for (uint8_t i = RECENT_RESULTS - 1; i > 0; i--) {
+        recentResults[i] = recentResults[i - 1];
+    }
+    recentResults[0] = result;
+    if (recentCount < RECENT_RESULTS) {
+        recentCount++;
+    }
+
+    if (resultCallback) {
+        resultCallback(result);
+    }
+}
+
+String HTTPScheduleClient::getWorkerStatusJSON() const {
+    JsonDocument doc;
+    doc["running"] = isWorkerRunning();
+    doc["queued"] = jobQueue ? uxQueueMessagesWaiting(jobQueue) : 0;
+    doc["active"] = activeJobId;
+
+    JsonObject conn = doc["connection"].to<JsonObject>();
+    conn["keep_alive_ms"] = KEEP_ALIVE_IDLE_MS;
+    conn["opened"] = connectionsOpened;
+    conn["reused"] = connectionsReused;
+    conn["dropped_by_server"] = connectionsDropped;
+    conn["not_modified"] = notModifiedCount;
+
+    JsonObject gzip = doc["compression"].to<JsonObject>();
+    gzip["responses"] = gzipResponses;
+    gzip["response_bytes"] = gzipResponseBytes;
+    gzip["inflated_bytes"] = gzipInflatedBytes;
+    gzip["uploads_enabled"] = gzipUploads;
+    gzip["uploads"] = gzipUploadCount;
+    gzip["upload_bytes"] = gzipUploadBytes;
+    gzip["upload_plain_bytes"] = gzipUploadPlainBytes;
+
+    JsonObject sync = doc["schedule_sync"].to<JsonObject>();
+    sync["revision"] = appliedRevision.revision;
+    sync["horizon_end"] = appliedRevision.horizonEnd;
+    sync["delta_syncs"] = deltaSyncs;
+    sync["full_resyncs"] = fullResyncs;
+
+    JsonArray recent = doc["recent"].to<JsonArray>();
+    for (uint8_t i = 0; i < recentCount; i++) {
+        const HttpJobResult& result = recentResults[i];
+        JsonObject entry = recent.add<JsonObject>();
+        entry["id"] = result.id;
+        entry["type"] = jobTypeName(result.type);
+        entry["status"] = jobStatusName(result.status);
+        entry["elapsed_ms"] = result.elapsedMs;
+        if (result.type == HTTP_JOB_FETCH_SCHEDULE) {
+            entry["days"] = result.daysLoaded;
+            entry["requests"] = result.requests;
+            if (result.revision.revision > 0) {
+                entry["revision"] = result.revision.revision;
+                entry["delta"] = result.delta;
+            }
+        }
+        if (result.notModified > 0) {
+            entry["not_modified"] = result.notModified;
+        }
+        if (result.error[0]) {
+            entry["error"] = result.error;
+        }
+    }
+
+    String json;
+    serializeJson(doc, json);
+    return json;
 }
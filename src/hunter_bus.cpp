@@ -0,0 +1,291 @@
+#include "hunter_bus.h"
+
+HunterBus::HunterBus(HunterRoam& roam, uint8_t busIndex) : encoder(roam) {
+    index = busIndex;
+    pin = -1;
+    channel = RMT_CHANNEL_0;
+    rmtReady = false;
+    queue = nullptr;
+    task = nullptr;
+    frame.count = 0;
+    sentCount = 0;
+    failedCount = 0;
+    droppedCount = 0;
+    supersededCount = 0;
+    maxWaitMillis = 0;
+}
+
+bool HunterBus::begin(int busPin, rmt_channel_t rmtChannel) {
+    if (queue) {
+        return true; // Already running
+    }
+
+    pin = busPin;
+    channel = rmtChannel;
+
+    QueueHandle_t newQueue = xQueueCreate(QUEUE_LENGTH, sizeof(HunterBusRequest));
+    if (!newQueue) {
+        Serial.println("HunterBus: Failed to create command queue");
+        return false;
+    }
+    queue = newQueue;
+
+    char taskName[16];
+    snprintf(taskName, sizeof(taskName), "hunterBus%d", index);
+    if (xTaskCreatePinnedToCore(taskLoop, taskName, TASK_STACK, this, TASK_PRIORITY, &task, 1) != pdPASS) {
+        Serial.println("HunterBus: Failed to start bus task");
+        vQueueDelete(queue);
+        queue = nullptr;
+        task = nullptr;
+        return false;
+    }
+
+    // Claim the pin for RMT only once the task is running, so a failed begin()
+    // leaves it to the blocking HunterRoam calls. 1 us ticks from the 80 MHz
+    // APB clock, bus idles low between frames.
+    rmt_config_t config = RMT_DEFAULT_CONFIG_TX((gpio_num_t)busPin, rmtChannel);
+    config.clk_div = 80;
+    config.tx_config.carrier_en = false;
+    config.tx_config.idle_level = RMT_IDLE_LEVEL_LOW;
+    config.tx_config.idle_output_en = true;
+    rmtReady = (rmt_config(&config) == ESP_OK && rmt_driver_install(channel, 0, 0) == ESP_OK);
+    if (!rmtReady) {
+        Serial.println("HunterBus: RMT unavailable, frames will be bit-banged");
+    }
+
+    Serial.printf("HunterBus: Bus %d started on GPIO%d (%s, queue of %d)\n", index, pin, rmtReady ? "RMT" : "bit-bang", QUEUE_LENGTH);
+    return true;
+}
+
+bool HunterBus::startZone(uint8_t zone, uint8_t minutes) {
+    if (zone < 1 || zone > HUNTER_ZONES_PER_BUS || minutes > 240) {
+        return false;
+    }
+    return submit(BUS_START_ZONE, zone, minutes);
+}
+
+bool HunterBus::stopZone(uint8_t zone) {
+    if (zone < 1 || zone > HUNTER_ZONES_PER_BUS) {
+        return false;
+    }
+    return submit(BUS_STOP_ZONE, zone, 0, STOP_QUEUE_WAIT_MS);
+}
+
+bool HunterBus::startProgram(uint8_t num) {
+    if (num < 1 || num > 4) {
+        return false;
+    }
+    return submit(BUS_RUN_PROGRAM, 0, num);
+}
+
+uint8_t HunterBus::getQueuedCount() const {
+    return queue ? uxQueueMessagesWaiting(queue) : 0;
+}
+
+String HunterBus::getStatsJSON() const {
+    const HunterJitterStats& jitter = encoder.getJitterStats();
+
+    String json = "{";
+    json += "\"bus\":" + String(index) + ",";
+    json += "\"pin\":" + String(pin) + ",";
+    json += "\"first_zone\":" + String(hunterGlobalZone(index, 1)) + ",";
+    json += "\"running\":" + String(isRunning() ? "true" : "false") + ",";
+    json += "\"transport\":\"" + String(rmtReady ? "rmt" : "bit-bang") + "\",";
+    json += "\"queued\":" + String(getQueuedCount()) + ",";
+    json += "\"sent\":" + String(sentCount) + ",";
+    json += "\"failed\":" + String(failedCount) + ",";
+    json += "\"dropped\":" + String(droppedCount) + ",";
+    json += "\"superseded\":" + String(supersededCount) + ",";
+    json += "\"max_wait_ms\":" + String(maxWaitMillis) + ",";
+    json += "\"jitter\":{";
+    json += "\"tolerance_percent\":" + String(HUNTER_JITTER_TOLERANCE) + ",";
+    json += "\"frames\":" + String(jitter.frames) + ",";
+    json += "\"retransmits\":" + String(jitter.retransmits) + ",";
+    json += "\"failures\":" + String(jitter.failures) + ",";
+    json += "\"last_deviation_percent\":" + String(jitter.lastDeviation) + ",";
+    json += "\"max_deviation_percent\":" + String(jitter.maxDeviation) + ",";
+    json += "\"max_stretch_us\":" + String(jitter.maxStretchMicros);
+    json += "}}";
+    return json;
+}
+
+void HunterBus::setCompletionCallback(void (*callback)(const HunterBusRequest& request, byte result)) {
+    completionCallback = callback;
+}
+
+bool HunterBus::submit(HunterBusCommand command, uint8_t zone, uint8_t value, uint32_t waitMillis) {
+    if (!queue) {
+        return false;
+    }
+
+    HunterBusRequest request;
+    request.command = command;
+    request.bus = index;
+    request.zone = zone;
+    request.value = value;
+    request.queuedAt = millis();
+
+    if (xQueueSend(queue, &request, pdMS_TO_TICKS(waitMillis)) != pdTRUE) {
+        droppedCount++;
+        Serial.printf("HunterBus: Queue full on bus %d, dropped command for zone %d\n", index, zone);
+        return false;
+    }
+    return true;
+}
+
+void HunterBus::taskLoop(void* param) {
+    HunterBus* bus = static_cast<HunterBus*>(param);
+    HunterBusRequest batch[BATCH_SIZE];
+    byte results[BATCH_SIZE];
+
+    while (true) {
+        if (xQueueReceive(bus->queue, &batch[0], portMAX_DELAY) != pdTRUE) {
+            continue;
+        }
+
+        // Take whatever queued up while the previous batch was on the wire,
+        // e.g. the starts of a run plan from the same loop pass
+        uint8_t count = 1;
+        while (count < BATCH_SIZE && xQueueReceive(bus->queue, &batch[count], 0) == pdTRUE) {
+            count++;
+        }
+
+        uint32_t now = millis();
+        for (uint8_t i = 0; i < count; i++) {
+            uint32_t waited = now - batch[i].queuedAt;
+            if (waited > bus->maxWaitMillis) {
+                bus->maxWaitMillis = waited;
+            }
+        }
+
+        bus->transmitBatch(batch, results, count);
+
+        for (uint8_t i = 0; i < count; i++) {
+            if (results[i] == 0) {
+                bus->sentCount++;
+            } else if (results[i] == RESULT_SUPERSEDED) {
+                bus->supersededCount++;
+            } else {
+                bus->failedCount++;
+            }
+
+            if (bus->completionCallback) {
+                bus->completionCallback(batch[i], results[i]);
+            }
+        }
+    }
+}
+
+void HunterBus::markSuperseded(const HunterBusRequest* batch, byte* results, uint8_t count) {
+    // A zone command is redundant if a later command in the batch sets the same
+    // zone again (stop then restart, repeated starts). Programs are kept and
+    // act as a barrier, since they may switch zones themselves.
+    for (uint8_t i = 0; i < count; i++) {
+        results[i] = 0;
+        if (batch[i].command == BUS_RUN_PROGRAM) continue;
+
+        for (uint8_t j = i + 1; j < count; j++) {
+            if (batch[j].command == BUS_RUN_PROGRAM) break;
+            if (batch[j].zone == batch[i].zone) {
+                results[i] = RESULT_SUPERSEDED;
+                break;
+            }
+        }
+    }
+}
+
+void HunterBus::transmitBatch(const HunterBusRequest* batch, byte* results, uint8_t count) {
+    markSuperseded(batch, results, count);
+
+    uint8_t sent = 0;
+    uint8_t buffer = 0;
+    for (uint8_t i = 0; i < count; i++) {
+        if (results[i] == RESULT_SUPERSEDED) continue;
+
+        results[i] = renderRequest(batch[i]);
+        if (results[i] != 0) continue;
+
+        if (!rmtReady) {
+            // Timed and repeated by HunterRoam when a pulse was stretched
+            results[i] = encoder.transmitFrame(frame);
+            if (results[i] == 0) {
+                sent++;
+            }
+            continue;
+        }
+
+        // Returns as soon as the frame is queued; it waits for the previous
+        // frame to finish first, so the buffer rendered next is already free
+        uint16_t itemCount = renderItems(items[buffer]);
+        if (itemCount == 0 || rmt_write_items(channel, items[buffer], itemCount, false) != ESP_OK) {
+            // Bit-bang this frame instead, once the channel has drained, and
+            // hand the pin back to RMT afterwards
+            Serial.println("HunterBus: RMT transmit failed, bit-banging the frame");
+            rmt_wait_tx_done(channel, portMAX_DELAY);
+            pinMode(pin, OUTPUT);
+            results[i] = encoder.transmitFrame(frame);
+            rmt_set_pin(channel, RMT_MODE_TX, (gpio_num_t)pin);
+            if (results[i] == 0) {
+                sent++;
+            }
+            continue;
+        }
+        buffer ^= 1;
+        sent++;
+    }
+
+    if (rmtReady && sent > 0) {
+        rmt_wait_tx_done(channel, portMAX_DELAY);
+    }
+    if (count > 1) {
+        Serial.printf("HunterBus: Sent %d of %d batched commands\n", sent, count);
+    }
+}
+
+byte HunterBus::renderRequest(const HunterBusRequest& request) {
+    switch (request.command) {
+        case BUS_START_ZONE:
+            return encoder.renderZone(request.zone, request.value, frame);
+        case BUS_STOP_ZONE:
+            return encoder.renderZone(request.zone, 0, frame);
+        default:
+            return encoder.renderProgram(request.value, frame);
+    }
+}
+
+uint16_t HunterBus::renderItems(rmt_item32_t* out) {
+    uint16_t count = 0;
+    bool secondHalf = false;
+
+    // Each RMT item holds two levels; pulses longer than 15 bits of ticks
+    // (the reset pulse) are split across several halves
+    for (uint16_t i = 0; i < frame.count; i++) {
+        uint32_t remaining = frame.pulses[i].micros;
+        while (remaining > 0) {
+            uint16_t ticks = remaining > MAX_ITEM_TICKS ? MAX_ITEM_TICKS : remaining;
+            remaining -= ticks;
+
+            if (!secondHalf) {
+                if (count >= MAX_ITEMS) {
+                    return 0;
+                }
+                out[count].val = 0;
+                out[count].level0 = frame.pulses[i].level;
+                out[count].duration0 = ticks;
+            } else {
+                out[count].level1 = frame.pulses[i].level;
+                out[count].duration1 = ticks;
+                count++;
+            }
+            secondHalf = !secondHalf;
+        }
+    }
+
+    // A zero-length half marks the end of the transmission
+    if (secondHalf) {
+        out[count].level1 = 0;
+        out[count].duration1 = 0;
+        count++;
+    }
+    return count;
+}
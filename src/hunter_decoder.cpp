@@ -0,0 +1,124 @@
+#include "hunter_decoder.h"
+
+const char* HunterDecoder::statusText(HunterDecodeStatus status) {
+    switch (status) {
+        case DECODE_OK: return "ok";
+        case DECODE_BAD_RESET: return "bad reset pulse";
+        case DECODE_BAD_START: return "bad start pulse";
+        case DECODE_BAD_PULSE: return "bad bit pulse";
+        case DECODE_BAD_LENGTH: return "bad frame length";
+        case DECODE_BAD_FRAME: return "frame does not re-encode";
+        default: return "unknown";
+    }
+}
+
+uint32_t HunterDecoder::deviation(const HunterPulse& pulse, uint32_t nominal) {
+    uint32_t actual = pulse.micros;
+    uint32_t diff = actual > nominal ? actual - nominal : nominal - actual;
+    return (uint32_t)((uint64_t)diff * 100 / nominal);
+}
+
+bool HunterDecoder::accept(const HunterPulse& pulse, uint32_t nominal, uint8_t tolerancePercent, HunterDecoded& result) {
+    uint32_t percent = deviation(pulse, nominal);
+    if (percent > tolerancePercent) {
+        return false;
+    }
+    if (percent > result.maxDeviation) {
+        result.maxDeviation = percent;
+    }
+    return true;
+}
+
+HunterDecoded HunterDecoder::decode(const HunterPulse* pulses, uint16_t count, uint8_t tolerancePercent) {
+    HunterDecoded result = {};
+    result.status = DECODE_OK;
+
+    for (uint16_t i = 0; i < count; i++) {
+        result.busMicros += pulses[i].micros;
+    }
+
+    // Reset pulse and gap, then the start pulse
+    const uint32_t header[4] = {RESET_PULSE_MS * 1000UL, RESET_GAP_MS * 1000UL, START_INTERVAL, SHORT_INTERVAL};
+    for (uint16_t i = 0; i < 4; i++) {
+        if (i >= count || pulses[i].level != (i % 2 == 0 ? 1 : 0) ||
+            !accept(pulses[i], header[i], tolerancePercent, result)) {
+            result.status = i < 2 ? DECODE_BAD_RESET : DECODE_BAD_START;
+            result.errorPulse = i;
+            return result;
+        }
+    }
+
+    // Each bit is a high/low pair: short high + long low is a 0, long high + short low a 1
+    uint8_t bytes[16] = {0};
+    uint16_t bits = 0;
+    uint8_t lastBit = 1;
+    uint16_t i = 4;
+    for (; i + 1 < count; i += 2) {
+        const HunterPulse& high = pulses[i];
+        const HunterPulse& low = pulses[i + 1];
+        uint8_t bit;
+
+        if (!high.level || low.level) {
+            bit = 2;
+        } else if (deviation(high, SHORT_INTERVAL) <= tolerancePercent && deviation(low, LONG_INTERVAL) <= tolerancePercent) {
+            bit = 0;
+            accept(high, SHORT_INTERVAL, tolerancePercent, result);
+            accept(low, LONG_INTERVAL, tolerancePercent, result);
+        } else if (deviation(high, LONG_INTERVAL) <= tolerancePercent && deviation(low, SHORT_INTERVAL) <= tolerancePercent) {
+            bit = 1;
+            accept(high, LONG_INTERVAL, tolerancePercent, result);
+            accept(low, SHORT_INTERVAL, tolerancePercent, result);
+        } else {
+            bit = 2;
+        }
+
+        if (bit > 1) {
+            result.status = DECODE_BAD_PULSE;
+            result.errorPulse = i;
+            return result;
+        }
+
+        if (bits < 128) {
+            bytes[bits / 8] |= bit << (7 - bits % 8);
+        }
+        bits++;
+        lastBit = bit;
+    }
+
+    // A dangling pulse or a missing stop bit (always a 0) means a cut-off frame
+    if (i < count || bits == 0 || lastBit != 0) {
+        result.status = DECODE_BAD_LENGTH;
+        result.errorPulse = i < count ? i : count;
+        return result;
+    }
+    result.bitCount = bits - 1;
+
+    if (result.bitCount == 121 && (bytes[15] & 0x80)) {
+        // Zone frame: 15 bytes and the extra 1 bit
+        HunterZoneBytes frame;
+        memcpy(frame.data(), bytes, frame.size());
+        result.zone = hunterReadField(frame, HUNTER_ZONE_FIELDS, FIELD_ZONE_17) - 0x17;
+        result.minutes = hunterReadField(frame, HUNTER_ZONE_FIELDS, FIELD_TIME_LOW) |
+                         (hunterReadField(frame, HUNTER_ZONE_FIELDS, FIELD_TIME_HIGH) << 4);
+
+        // Every redundant field has to agree, so compare the whole frame
+        if (result.zone < 1 || result.zone > 48 || result.minutes > 240 ||
+            !hunterBytesEqual(hunterEncodeZone(result.zone, result.minutes), frame)) {
+            result.status = DECODE_BAD_FRAME;
+        }
+    } else if (result.bitCount == 56) {
+        HunterProgramBytes frame;
+        memcpy(frame.data(), bytes, frame.size());
+        result.isProgram = true;
+        result.program = hunterReadField(frame, HUNTER_PROGRAM_FIELDS, FIELD_PROGRAM) + 1;
+
+        if (!hunterBytesEqual(hunterEncodeProgram(result.program), frame)) {
+            result.status = DECODE_BAD_FRAME;
+        }
+    } else {
+        result.status = DECODE_BAD_LENGTH;
+        result.errorPulse = count;
+    }
+
+    return result;
+}
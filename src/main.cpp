@@ -28,10 +28,12 @@
 #include <ArduinoOTA.h>
 // #include "hunter_esp32.h"
 #include "HunterRoam.h"
+#include "hunter_bus.h"
 #include "web_server.h"
 #include "rtc_module.h"
 #include "config_manager.h"
 #include "schedule_manager.h"
+#include "schedule_forecast.h"
 #include "mqtt_manager.h"
 #include "http_client.h"
 #include "event_logger.h"
@@ -55,9 +57,13 @@ HunterWebServer hunterServer(80);
 RTCModule rtcModule;
 ConfigManager configManager;
 ScheduleManager scheduleManager;
+ScheduleForecast scheduleForecast;
 MQTTManager mqttManager;
 HTTPScheduleClient httpClient;
-HunterRoam hunterController(HUNTER_PIN);
+// One Hunter bus per X-Core unit, created in setup()
+const int hunterBusPins[HUNTER_BUS_COUNT] = HUNTER_BUS_PINS;
+HunterRoam* hunterControllers[HUNTER_BUS_COUNT];
+HunterBus* hunterBuses[HUNTER_BUS_COUNT];
 EventLogger eventLogger;
 // Function to print device status details
 void printDeviceStatus() {
@@ -137,43 +143,168 @@ void printDeviceStatus() {
   Serial.println("");
 }
 
-// Zone control callback function for ScheduleManager
-void zoneControlCallback(uint8_t zoneNumber, bool enable, uint16_t duration, ScheduleType schedType, uint8_t schedId) {
+// Stops not yet confirmed by the bus, per zone. The bus task reports how a
+// queued stop went, the loop resends failed ones and releases the zone in
+// the schedule manager once its stop went out.
+enum HunterStopState : uint8_t {
+  STOP_NONE = 0,
+  STOP_QUEUED,      // Waiting for the bus task
+  STOP_FAILED,      // Not queued or not sent, resend
+  STOP_CONFIRMED    // Sent, release the zone
+};
+static volatile uint8_t hunterStopStates[HUNTER_MAX_ZONE + 1];
+static portMUX_TYPE hunterStopMux = portMUX_INITIALIZER_UNLOCKED;
+const unsigned long HUNTER_STOP_RETRY_MS = 1000;
+
+// Change a zone's stop state unless something else changed it first
+static bool changeHunterStopState(uint8_t zone, uint8_t from, uint8_t to) {
+  bool changed = false;
+  portENTER_CRITICAL(&hunterStopMux);
+  if (hunterStopStates[zone] == from) {
+    hunterStopStates[zone] = to;
+    changed = true;
+  }
+  portEXIT_CRITICAL(&hunterStopMux);
+  return changed;
+}
+
+static void setHunterStopState(uint8_t zone, uint8_t state) {
+  portENTER_CRITICAL(&hunterStopMux);
+  hunterStopStates[zone] = state;
+  portEXIT_CRITICAL(&hunterStopMux);
+}
+
+// Hunter bus completion callback, runs on the bus task after each command went out
+void hunterBusComplete(const HunterBusRequest& request, byte result) {
+  uint8_t zone = hunterGlobalZone(request.bus, request.zone);
+  if (result != 0 && result != HunterBus::RESULT_SUPERSEDED) {
+    Serial.println("Hunter bus: command for zone " + String(zone) + " failed: " + hunterControllers[request.bus]->errorHint(result));
+  }
+
+  // A superseded stop is settled by the later command for the same zone
+  if (request.command == BUS_STOP_ZONE && result != HunterBus::RESULT_SUPERSEDED) {
+    changeHunterStopState(zone, STOP_QUEUED, result == 0 ? STOP_CONFIRMED : STOP_FAILED);
+  }
+}
+
+// Send a stop to the bus that owns the zone and track it until it went out
+bool hunterStopCommand(uint8_t zoneNumber) {
+  uint8_t bus = hunterZoneBus(zoneNumber);
+  uint8_t localZone = hunterLocalZone(zoneNumber);
+  if (!hunterBuses[bus]->isRunning()) {
+    bool sent = hunterControllers[bus]->stopZone(localZone) == 0;
+    setHunterStopState(zoneNumber, sent ? STOP_CONFIRMED : STOP_FAILED);
+    return sent;
+  }
+
+  // Marked before queueing so the completion can't arrive first
+  setHunterStopState(zoneNumber, STOP_QUEUED);
+  if (!hunterBuses[bus]->stopZone(localZone)) {
+    changeHunterStopState(zoneNumber, STOP_QUEUED, STOP_FAILED);
+    return false;
+  }
+  return true;
+}
+
+// Send a start (minutes > 0) or stop to the bus that owns the zone; queued
+// when the bus task is running, otherwise sent blocking
+bool hunterZoneCommand(uint8_t zoneNumber, uint16_t minutes) {
+  if (zoneNumber < 1 || zoneNumber > HUNTER_MAX_ZONE) {
+    return false;
+  }
+  if (minutes == 0) {
+    return hunterStopCommand(zoneNumber);
+  }
+
+  // A start replaces any stop still outstanding for the zone
+  setHunterStopState(zoneNumber, STOP_NONE);
+
+  uint8_t bus = hunterZoneBus(zoneNumber);
+  uint8_t localZone = hunterLocalZone(zoneNumber);
+  if (!hunterBuses[bus]->isRunning()) {
+    return hunterControllers[bus]->startZone(localZone, minutes) == 0;
+  }
+  return hunterBuses[bus]->startZone(localZone, minutes);
+}
+
+// Resend stops that did not go out and release zones whose stop was confirmed
+void processHunterStops() {
+  static unsigned long lastRetry = 0;
+  bool retryDue = millis() - lastRetry >= HUNTER_STOP_RETRY_MS;
+
+  for (uint8_t zone = 1; zone <= HUNTER_MAX_ZONE; zone++) {
+    uint8_t state = hunterStopStates[zone];
+    if (state == STOP_CONFIRMED) {
+      if (changeHunterStopState(zone, STOP_CONFIRMED, STOP_NONE)) {
+        scheduleManager.setZoneStopPending(zone, false);
+      }
+    } else if (state == STOP_FAILED && retryDue) {
+      Serial.println("Hunter bus: resending stop for zone " + String(zone));
+      hunterStopCommand(zone);
+    }
+  }
+
+  if (retryDue) {
+    lastRetry = millis();
+  }
+}
+
+// Completion status reported to the server for the way a run ended
+const char* runEndStatus(RunEndReason reason) {
+  switch (reason) {
+    case RUN_STOPPED: return "stopped";
+    case RUN_PREEMPTED: return "preempted";
+    case RUN_RAIN_CANCELLED: return "rain_cancelled";
+    case RUN_PLAN_CANCELLED: return "cancelled";
+    default: return "completed";
+  }
+}
+
+// Zone control callback function for ScheduleManager; false if the bus could
+// not take the command
+bool zoneControlCallback(uint8_t zoneNumber, bool enable, uint16_t duration, ScheduleType schedType, uint32_t schedId, uint32_t serverId, RunEndReason reason) {
   Serial.println("Zone control callback: Zone " + String(zoneNumber) + " -> " + (enable ? "ON" : "OFF") + " for " + String(duration) + " minutes");
 
+  // Determine event type based on schedule ID and type
+  // schedId == 0 indicates manual start (via MQTT or REST API)
+  EventType eventType;
+  String mqttEventType;
+
+  if (schedId == 0) {
+    eventType = EventType::MANUAL;
+    mqttEventType = "manual";
+  } else if (schedType == AI) {
+    eventType = EventType::AI;
+    mqttEventType = "ai";
+  } else {
+    eventType = EventType::SCHEDULED;
+    mqttEventType = "scheduled";
+  }
+
   if (enable) {
-    // Determine event type based on schedule ID and type
-    // schedId == 0 indicates manual start (via MQTT or REST API)
-    EventType eventType;
-    String mqttEventType;
-
-    if (schedId == 0) {
-      // Manual start via MQTT or REST API
-      eventType = EventType::MANUAL;
-      mqttEventType = "manual";
-    } else if (schedType == AI) {
-      // AI-generated schedule
-      eventType = EventType::AI;
-      mqttEventType = "ai";
-    } else {
-      // Regular scheduled event
-      eventType = EventType::SCHEDULED;
-      mqttEventType = "scheduled";
+    // Queue the start on the zone's Hunter bus (zone, time in minutes); returns immediately
+    if (!hunterZoneCommand(zoneNumber, duration)) {
+      Serial.println("ERROR: Could not queue start of zone " + String(zoneNumber) + " on the Hunter bus");
+      return false;
     }
 
     // Log event start with correct type
-    uint32_t eventId = eventLogger.logEventStart(zoneNumber, duration, eventType, schedId);
+    uint32_t eventId = eventLogger.logEventStart(zoneNumber, duration, eventType, schedId, serverId);
 
-    // Publish MQTT START event before starting zone
-    mqttManager.publishZoneStatus(zoneNumber, "start", duration, schedId, mqttEventType);
+    // Publish MQTT START event
+    mqttManager.publishZoneStatus(zoneNumber, "start", duration, schedId, mqttEventType, serverId);
 
-    // Start the zone using Hunter protocol (zone, time in minutes)
-    hunterController.startZone(zoneNumber, duration);
     Serial.println("Zone " + String(zoneNumber) + " started (" + mqttEventType + ") for " + String(duration) + " minutes (Event ID: " + String(eventId) + ")");
+    return true;
   } else {
-    // Stop the zone
-    hunterController.stopZone(zoneNumber);
-    Serial.println("Zone " + String(zoneNumber) + " stopped");
+    // Queue the stop on the zone's Hunter bus; the zone stays marked as stopping
+    // and the stop is resent from the loop until the bus confirms it
+    bool stopQueued = hunterZoneCommand(zoneNumber, 0);
+    scheduleManager.setZoneStopPending(zoneNumber, true);
+    if (!stopQueued) {
+      Serial.println("ERROR: Could not queue stop of zone " + String(zoneNumber) + " on the Hunter bus, will retry");
+    }
+    Serial.println("Zone " + String(zoneNumber) + " stopped (" + runEndStatus(reason) + ")");
 
     // Update volatile last-watered timestamp (since boot)
     String localTime = configManager.getLocalTimeString();
@@ -181,21 +312,33 @@ void zoneControlCallback(uint8_t zoneNumber, bool enable, uint16_t duration, Sch
       hunterServer.setZoneLastWatered(zoneNumber, localTime);
     }
 
-    // Log event end (completed normally)
-    eventLogger.logEventEnd(0, true);
+    // Log event end, completed only if it ran its full duration; duration is
+    // the minutes actually run
+    eventLogger.logEventEnd(eventLogger.getActiveEventId(zoneNumber), reason == RUN_COMPLETED);
 
     // Publish MQTT STOP event
-    mqttManager.publishZoneStatus(zoneNumber, "stop", 0, 0, "manual");
+    mqttManager.publishZoneStatus(zoneNumber, "stop", duration, schedId, mqttEventType, serverId);
+
+    // Report server-originated runs back against their server event
+    if (serverId > 0) {
+      float waterUsed = scheduleManager.getZoneFlowRate(zoneNumber) * duration;
+      httpClient.submitCompletion(serverId, zoneNumber, duration, waterUsed, runEndStatus(reason));
+    }
+    return stopQueued;
   }
 }
 
+// Daily schedule fetch state, shared with the HTTP result handler
+static int dailyFetchRetryCount = 0;
+static unsigned long dailyFetchLastRetry = 0;
+static unsigned long dailyFetchRetryDelay = 0;   // Jittered, grows with each retry
+static uint32_t dailyFetchRequestId = 0;  // Fetch on the HTTP worker (0 = none)
+
 // Daily schedule fetch task - configurable time (default 6:00 AM)
 // This allows the ESP32 to fetch after Node-RED generates schedules
 void checkAndFetchDailySchedule() {
   static int lastFetchDay = -1;
   static bool fetchAttemptedToday = false;
-  static int retryCount = 0;
-  static unsigned long lastRetryTime = 0;
 
   if (!rtcModule.isInitialized() || !configManager.isServerEnabled()) {
     return;
@@ -214,7 +357,7 @@ void checkAndFetchDailySchedule() {
   // Reset fetch flag and retry count on new day
   if (currentDay != lastFetchDay) {
     fetchAttemptedToday = false;
-    retryCount = 0;
+    dailyFetchRetryCount = 0;
     lastFetchDay = currentDay;
   }
 
@@ -235,48 +378,35 @@ void checkAndFetchDailySchedule() {
     Serial.println("Server: " + configManager.getServerUrl());
     Serial.println("Fetching " + String(fetchDays) + "-day schedule...");
 
-    if (httpClient.fetchSchedule(fetchDays)) {
-      Serial.println("✅ " + String(fetchDays) + "-day schedule fetched successfully from server");
-      Serial.println("=======================================");
-      retryCount = 0; // Reset retry count on success
-    } else {
-      Serial.println("⚠️ Failed to fetch schedule: " + httpClient.getLastError());
-      Serial.println("   Will retry in " + String(configManager.getServerRetryInterval()/60) + " minutes");
-      Serial.println("=======================================");
-      lastRetryTime = millis();
+    // Runs on the HTTP worker; the outcome arrives in httpResultReceived()
+    dailyFetchLastRetry = millis();
+    dailyFetchRequestId = httpClient.submitScheduleFetch(fetchDays);
+    dailyFetchRetryDelay = configManager.getServerRetryInterval() * 1000UL;
+    if (dailyFetchRequestId == 0) {
+      Serial.println("⚠️ Could not queue schedule fetch, will retry in " + String(configManager.getServerRetryInterval()/60) + " minutes");
     }
   }
 
-  // Retry logic - attempt to fetch schedule every retry interval if initial fetch failed
-  if (fetchAttemptedToday && retryCount < configManager.getServerMaxRetries()) {
-    unsigned long retryInterval = configManager.getServerRetryInterval() * 1000UL;
-    if (millis() - lastRetryTime > retryInterval) {
-      retryCount++;
+  // Retry logic - retry a failed fetch after a growing, jittered delay
+  if (fetchAttemptedToday && dailyFetchRequestId == 0 && dailyFetchRetryCount < configManager.getServerMaxRetries()) {
+    // While the server's circuit is open the fetch would fail without trying;
+    // wait for it rather than spend a retry
+    if (httpClient.getRetryIn(HTTP_ENDPOINT_SCHEDULES) > 0) {
+      return;
+    }
+    if (millis() - dailyFetchLastRetry > dailyFetchRetryDelay) {
+      dailyFetchRetryCount++;
+      dailyFetchLastRetry = millis();
       Serial.println("");
-      Serial.println("=== SCHEDULE FETCH RETRY #" + String(retryCount) + " ===");
+      Serial.println("=== SCHEDULE FETCH RETRY #" + String(dailyFetchRetryCount) + " ===");
       Serial.println("Time: " + rtcModule.getDateTimeString());
 
       if (WiFi.status() != WL_CONNECTED) {
         Serial.println("⚠️ WiFi not connected, skipping retry");
-        lastRetryTime = millis();
         return;
       }
 
-      int fetchDays = configManager.getScheduleFetchDays();
-      if (httpClient.fetchSchedule(fetchDays)) {
-        Serial.println("✅ Schedule fetched successfully on retry #" + String(retryCount));
-        Serial.println("============================");
-        retryCount = configManager.getServerMaxRetries(); // Stop retrying
-      } else {
-        Serial.println("⚠️ Retry failed: " + httpClient.getLastError());
-        if (retryCount < configManager.getServerMaxRetries()) {
-          Serial.println("   Will retry again in " + String(configManager.getServerRetryInterval()/60) + " minutes");
-        } else {
-          Serial.println("   Max retries reached, will try again tomorrow");
-        }
-        Serial.println("============================");
-        lastRetryTime = millis();
-      }
+      dailyFetchRequestId = httpClient.submitScheduleFetch(configManager.getScheduleFetchDays());
     }
   }
 }
@@ -298,14 +428,49 @@ void checkAndFetchZoneDetails() {
     return;
   }
 
+  // Don't pile up requests behind a slow server
+  if (httpClient.isRequestPending(HTTP_JOB_FETCH_ZONE_DETAILS)) {
+    return;
+  }
+
   lastZoneFetchMs = millis();
 
-  // Best-effort: keep last good data on failure
-  if (!httpClient.fetchZoneDetails()) {
-    Serial.println("⚠️ Zone details fetch failed: " + httpClient.getLastError());
-  }
+  // Best-effort: keep last good data on failure (reported in httpResultReceived)
+  httpClient.submitZoneDetailsFetch();
 }
 
+// Results of background HTTP requests, called from httpClient.processResults() on the loop
+void httpResultReceived(const HttpJobResult& result) {
+  if (result.type == HTTP_JOB_FETCH_SCHEDULE && result.id == dailyFetchRequestId) {
+    dailyFetchRequestId = 0;
+    int maxRetries = configManager.getServerMaxRetries();
+
+    if (result.status == HTTP_JOB_OK) {
+      if (dailyFetchRetryCount > 0) {
+        Serial.println("✅ Schedule fetched successfully on retry #" + String(dailyFetchRetryCount));
+      } else {
+        Serial.println("✅ " + String(result.daysLoaded) + "-day schedule fetched successfully from server");
+      }
+      Serial.println("=======================================");
+      dailyFetchRetryCount = maxRetries; // Stop retrying
+    } else {
+      Serial.println("⚠️ Failed to fetch schedule: " + String(result.error));
+      if (dailyFetchRetryCount < maxRetries) {
+        // Half the configured interval plus full jitter that doubles per
+        // retry, so controllers that failed together don't retry together
+        unsigned long interval = configManager.getServerRetryInterval() * 1000UL;
+        dailyFetchRetryDelay = interval / 2 + HTTPScheduleClient::backoffDelay(dailyFetchRetryCount, interval / 2, interval * 4);
+        Serial.println("   Will retry in " + String(dailyFetchRetryDelay / 60000) + " minutes");
+      } else {
+        Serial.println("   Max retries reached, will try again tomorrow");
+      }
+      Serial.println("=======================================");
+      dailyFetchLastRetry = millis();
+    }
+  } else if (result.type == HTTP_JOB_FETCH_ZONE_DETAILS && result.status != HTTP_JOB_OK) {
+    Serial.println("⚠️ Zone details fetch failed: " + String(result.error));
+  }
+}
 
 void setup(void){
   // Serial port for debugging purposes
@@ -327,14 +492,25 @@ void setup(void){
 
   // Configure pins
   pinMode(PUMP_PIN, OUTPUT);
-  pinMode(HUNTER_PIN, OUTPUT);
 
   // Set PUMP_PIN to default value
   digitalWrite(PUMP_PIN, PUMP_PIN_DEFAULT ? HIGH : LOW);
-  digitalWrite(HUNTER_PIN, LOW);
-
   Serial.println("Pump pin: GPIO" + String(PUMP_PIN) + " set to " + (PUMP_PIN_DEFAULT ? "HIGH" : "LOW"));
-  Serial.println("Hunter pin: GPIO" + String(HUNTER_PIN) + " initialized");
+
+  // Zone commands go out through one task per bus so callers never wait for
+  // the frame, and units on different buses are driven in parallel
+  for (uint8_t i = 0; i < HUNTER_BUS_COUNT; i++) {
+    hunterControllers[i] = new HunterRoam(hunterBusPins[i]);
+    digitalWrite(hunterBusPins[i], LOW);
+    Serial.println("Hunter pin: GPIO" + String(hunterBusPins[i]) + " initialized (zones " +
+                   String(hunterGlobalZone(i, 1)) + "-" + String(hunterGlobalZone(i, HUNTER_ZONES_PER_BUS)) + ")");
+
+    hunterBuses[i] = new HunterBus(*hunterControllers[i], i);
+    hunterBuses[i]->setCompletionCallback(hunterBusComplete);
+    if (!hunterBuses[i]->begin(hunterBusPins[i], (rmt_channel_t)(RMT_CHANNEL_0 + i))) {
+      Serial.println("WARNING: Hunter bus " + String(i) + " task failed to start, its zone commands will block the loop");
+    }
+  }
 
   // Initialize RTC module
   Serial.println("");
@@ -374,6 +550,8 @@ void setup(void){
     // Set the zone control callback
     scheduleManager.setZoneControlCallback(zoneControlCallback);
     Serial.println("Zone control callback configured");
+
+    scheduleForecast.begin(&configManager, &scheduleManager);
   } else {
     Serial.println("WARNING: Schedule Manager failed to initialize");
   }
@@ -461,7 +639,9 @@ void setup(void){
     Serial.println("⚠️  Stopping all zones during firmware update...");
 
     // Stop any running zones during OTA (stop zone 0 stops all)
-    hunterController.stopZone(0);
+    for (uint8_t i = 0; i < HUNTER_BUS_COUNT; i++) {
+      hunterControllers[i]->stopZone(0);
+    }
   });
 
   ArduinoOTA.onEnd([]() {
@@ -496,6 +676,8 @@ void setup(void){
   hunterServer.setScheduleManager(&scheduleManager);
   hunterServer.setEventLogger(&eventLogger);
   hunterServer.setHTTPClient(&httpClient);
+  hunterServer.setScheduleForecast(&scheduleForecast);
+  hunterServer.setHunterBuses(hunterBuses, HUNTER_BUS_COUNT);
   hunterServer.begin();
 
   // Initialize MQTT Manager
@@ -550,6 +732,12 @@ void setup(void){
     } else if (!configManager.isServerEnabled()) {
       Serial.println("ℹ️ Server communication disabled in configuration");
     }
+
+    // From here on requests run on the worker task and never block the loop
+    httpClient.setResultCallback(httpResultReceived);
+    if (!httpClient.startWorker()) {
+      Serial.println("WARNING: HTTP worker failed to start, server requests will block the loop");
+    }
   } else {
     Serial.println("WARNING: HTTP Schedule Client failed to initialize");
   }
@@ -675,6 +863,9 @@ void loop(void)
   // Process MQTT communication
   mqttManager.loop();
 
+  // Commit schedules and zone details fetched by the HTTP worker
+  httpClient.processResults();
+
   // Check for daily schedule fetch (runs at 5:15 PM with retry logic)
   checkAndFetchDailySchedule();
 
@@ -687,6 +878,9 @@ void loop(void)
   // Process active zones (handle zone timeouts and cleanup)
   scheduleManager.processActiveZones();
 
+  // Resend failed Hunter stops and release zones whose stop went out
+  processHunterStops();
+
   // Feed the watchdog and yield to other tasks
   yield();
 
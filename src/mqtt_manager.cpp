@@ -467,7 +467,7 @@ void MQTTManager::setDeviceId(const String& id) {
     deviceId = id;
 }
 
-void MQTTManager::publishZoneStatus(uint8_t zone, const String& status, uint32_t duration, uint8_t scheduleId, const String& eventType) {
+void MQTTManager::publishZoneStatus(uint8_t zone, const String& status, uint32_t duration, uint32_t scheduleId, const String& eventType, uint32_t serverId) {
     if (!isConnected) return;
 
     JsonDocument doc;
@@ -490,6 +490,10 @@ void MQTTManager::publishZoneStatus(uint8_t zone, const String& status, uint32_t
         }
     } else if (status == "stop") {
         doc["completed"] = true; // Assume normal completion
+        doc["duration_actual_min"] = duration;
+    }
+    if (serverId > 0) {
+        doc["server_id"] = serverId;
     }
 
     String json;
@@ -0,0 +1,301 @@
+#include "schedule_forecast.h"
+#include "config_manager.h"
+#include <ArduinoJson.h>
+
+ScheduleForecast* ScheduleForecast::instance = nullptr;
+
+ScheduleForecast::ScheduleForecast() {
+    configManager = nullptr;
+    sourceManager = nullptr;
+    entryCount = 0;
+    truncated = false;
+    valid = false;
+    lastRefreshHit = false;
+    computedAt = 0;
+    horizonEnd = 0;
+    cachedRevision = 0;
+    cachedConfigKey = 0;
+    computeMillis = 0;
+    computeCount = 0;
+    hitCount = 0;
+    replayStart = 0;
+    virtualUnixNow = 0;
+    baseMillis = 0;
+    replay = nullptr;
+    occurrences = nullptr;
+    occurrenceCount = 0;
+}
+
+bool ScheduleForecast::begin(ConfigManager* config, ScheduleManager* source) {
+    configManager = config;
+    sourceManager = source;
+    valid = false;
+    return (configManager != nullptr && sourceManager != nullptr);
+}
+
+uint32_t ScheduleForecast::getConfigKey() {
+    // Settings that change the plan without touching the schedule revision
+    uint32_t key = (uint32_t)(configManager->getSupplyCapacityLpm() * 10.0f);
+    key = key * 131 + (uint32_t)(configManager->getTimezoneOffset() + 64);
+    key = key * 2 + (configManager->isDaylightSaving() ? 1 : 0);
+    return key;
+}
+
+bool ScheduleForecast::refresh(uint32_t nowUtc, uint16_t hours) {
+    if (!configManager || !sourceManager || nowUtc == 0 || hours < 1 || hours > MAX_HOURS) {
+        return false;
+    }
+
+    uint32_t toUtc = nowUtc + (uint32_t)hours * 3600UL;
+    if (valid && cachedRevision == sourceManager->getRevision() && cachedConfigKey == getConfigKey() &&
+        nowUtc >= computedAt && nowUtc - computedAt < MAX_CACHE_AGE && toUtc <= horizonEnd) {
+        hitCount++;
+        lastRefreshHit = true;
+        return true;
+    }
+
+    lastRefreshHit = false;
+    return compute(nowUtc, toUtc + HORIZON_SLACK);
+}
+
+bool ScheduleForecast::compute(uint32_t nowUtc, uint32_t toUtc) {
+    if (instance != nullptr) {
+        return false;
+    }
+
+    uint32_t wallStart = millis();
+    valid = false;
+    entryCount = 0;
+    truncated = false;
+
+    ScheduleOccurrence* occ = new ScheduleOccurrence[MAX_OCCURRENCES];
+    replay = new ScheduleManager();
+    if (!occ || !replay) {
+        delete[] occ;
+        delete replay;
+        replay = nullptr;
+        Serial.println("ScheduleForecast: Out of memory");
+        return false;
+    }
+
+    bool occTruncated = false;
+    occurrenceCount = sourceManager->expandOccurrences(nowUtc, toUtc, occ, MAX_OCCURRENCES, &occTruncated);
+    occurrences = occ;
+    truncated = occTruncated;
+
+    // Replay from the live state so running and queued zones are accounted for
+    baseMillis = millis();
+    replayStart = nowUtc;
+    virtualUnixNow = nowUtc;
+    replay->begin(configManager, nullptr);
+    replay->copyStateFrom(*sourceManager);
+    replay->setClockSource(virtualMillis, virtualUnixTime);
+    replay->setZoneControlCallback(recordActuation);
+    instance = this;
+
+    for (uint8_t i = 0; i < ScheduleManager::getMaxActiveZones(); i++) {
+        const ActiveZone* active = sourceManager->getActiveZoneAt(i);
+        if (!active) continue;
+
+        ForecastEntry* e = addEntry();
+        if (!e) break;
+        e->start = nowUtc - (baseMillis - active->startTime) / 1000;
+        e->nominal = e->start;
+        e->scheduleId = active->scheduleId;
+        e->serverId = active->serverId;
+        e->zone = active->zone;
+        e->type = active->type;
+        e->running = true;
+    }
+
+    // Jump from event to event: the next cycle start or the next zone stop
+    uint16_t next = 0;
+    uint32_t t = nowUtc;
+    uint32_t steps = 0;
+    replay->processActiveZones();
+
+    while (true) {
+        uint32_t nextTime = 0;
+        if (next < occurrenceCount) {
+            nextTime = occurrences[next].time;
+        }
+        uint32_t untilStop = replay->getMillisUntilNextStop();
+        if (untilStop != UINT32_MAX) {
+            uint32_t stopTime = t + (untilStop + 999) / 1000;
+            if (stopTime <= t) stopTime = t + 1;
+            if (nextTime == 0 || stopTime < nextTime) {
+                nextTime = stopTime;
+            }
+        }
+        if (nextTime == 0 || nextTime > toUtc) break;
+
+        t = nextTime;
+        virtualUnixNow = t;
+
+        if (next < occurrenceCount && occurrences[next].time <= t) {
+            while (next < occurrenceCount && occurrences[next].time <= t) {
+                next++;
+            }
+            replay->checkAndExecuteSchedules();
+        }
+        replay->processActiveZones();
+
+        if ((++steps % 200) == 0) {
+            yield();
+        }
+    }
+
+    instance = nullptr;
+    delete replay;
+    replay = nullptr;
+    delete[] occ;
+    occurrences = nullptr;
+
+    computedAt = nowUtc;
+    horizonEnd = toUtc;
+    cachedRevision = sourceManager->getRevision();
+    cachedConfigKey = getConfigKey();
+    computeMillis = millis() - wallStart;
+    computeCount++;
+    valid = true;
+
+    Serial.printf("ScheduleForecast: %d runs from %d occurrences in %lu ms (revision %lu)\n",
+                  entryCount, occurrenceCount, (unsigned long)computeMillis, (unsigned long)cachedRevision);
+    return true;
+}
+
+ForecastEntry* ScheduleForecast::addEntry() {
+    if (entryCount >= MAX_ENTRIES) {
+        truncated = true;
+        return nullptr;
+    }
+
+    ForecastEntry* e = &entries[entryCount++];
+    e->start = 0;
+    e->end = 0;
+    e->nominal = 0;
+    e->scheduleId = 0;
+    e->serverId = 0;
+    e->zone = 0;
+    e->cycle = 0;
+    e->type = BASIC;
+    e->running = false;
+    return e;
+}
+
+void ScheduleForecast::findNominal(uint32_t scheduleId, uint32_t t, uint32_t& nominal, uint8_t& cycle) {
+    nominal = t;
+    cycle = 0;
+
+    // Latest cycle of this schedule at or before t (later if the run was queued)
+    for (int16_t i = occurrenceCount - 1; i >= 0; i--) {
+        if (occurrences[i].time > t) continue;
+        const ScheduleEntry* schedule = sourceManager->getScheduleAt(occurrences[i].slot);
+        if (schedule && schedule->id == scheduleId) {
+            nominal = occurrences[i].time;
+            cycle = occurrences[i].cycle;
+            return;
+        }
+    }
+}
+
+uint32_t ScheduleForecast::virtualMillis() {
+    if (!instance) return millis();
+    return instance->baseMillis + (instance->virtualUnixNow - instance->replayStart) * 1000UL;
+}
+
+uint32_t ScheduleForecast::virtualUnixTime() {
+    return instance ? instance->virtualUnixNow : 0;
+}
+
+// The replayed bus takes every command, so a full entry table never changes the run
+bool ScheduleForecast::recordActuation(uint8_t zone, bool state, uint16_t duration, ScheduleType schedType, uint32_t schedId, uint32_t serverId, RunEndReason reason) {
+    if (!instance) return true;
+
+    if (state) {
+        ForecastEntry* e = instance->addEntry();
+        if (!e) return true;
+        e->start = instance->virtualUnixNow;
+        e->scheduleId = schedId;
+        e->serverId = serverId;
+        e->zone = zone;
+        e->type = schedType;
+        instance->findNominal(schedId, e->start, e->nominal, e->cycle);
+        return true;
+    }
+
+    // Close the open run for this zone
+    for (int16_t i = instance->entryCount - 1; i >= 0; i--) {
+        ForecastEntry& e = instance->entries[i];
+        if (e.zone == zone && e.end == 0) {
+            e.end = instance->virtualUnixNow;
+            return true;
+        }
+    }
+    return true;
+}
+
+String ScheduleForecast::getForecastJSON(uint32_t nowUtc, uint16_t hours) {
+    JsonDocument doc;
+
+    int offsetSeconds = configManager->getTimezoneOffset() * 1800; // Convert half-hours to seconds
+    if (configManager->isDaylightSaving()) {
+        offsetSeconds += 3600; // Add 1 hour for DST
+    }
+
+    uint32_t toUtc = nowUtc + (uint32_t)hours * 3600UL;
+    doc["generated"] = nowUtc;
+    doc["hours"] = hours;
+    doc["revision"] = cachedRevision;
+    doc["cached"] = lastRefreshHit;
+    doc["computed_at"] = computedAt;
+    doc["compute_ms"] = computeMillis;
+    doc["truncated"] = truncated;
+
+    char timeBuffer[20];
+    uint16_t count = 0;
+    JsonArray runs = doc["runs"].to<JsonArray>();
+    for (uint8_t i = 0; valid && i < entryCount; i++) {
+        const ForecastEntry& e = entries[i];
+        if (e.start >= toUtc || (e.end > 0 && e.end <= nowUtc)) continue;
+
+        JsonObject run = runs.add<JsonObject>();
+        run["zone"] = e.zone;
+
+        DateTime startLocal(e.start + offsetSeconds);
+        sprintf(timeBuffer, "%04d-%02d-%02d %02d:%02d", startLocal.year(), startLocal.month(), startLocal.day(),
+                startLocal.hour(), startLocal.minute());
+        run["start"] = timeBuffer;
+        run["start_utc"] = e.start;
+
+        if (e.end > 0) {
+            DateTime endLocal(e.end + offsetSeconds);
+            sprintf(timeBuffer, "%04d-%02d-%02d %02d:%02d", endLocal.year(), endLocal.month(), endLocal.day(),
+                    endLocal.hour(), endLocal.minute());
+            run["end"] = timeBuffer;
+            run["end_utc"] = e.end;
+            run["duration_min"] = (e.end - e.start + 30) / 60;
+        }
+
+        run["type"] = e.scheduleId == 0 ? "manual" : (e.type == AI ? "ai" : "basic");
+        run["schedule_id"] = e.scheduleId;
+        if (e.serverId > 0) {
+            run["server_id"] = e.serverId;
+        }
+        if (e.scheduleId > 0) {
+            run["cycle"] = e.cycle + 1;
+        }
+        if (e.start > e.nominal) {
+            run["delay_min"] = (e.start - e.nominal + 30) / 60;
+        }
+        if (e.running) {
+            run["running"] = true;
+        }
+        count++;
+    }
+    doc["count"] = count;
+
+    String result;
+    serializeJson(doc, result);
+    return result;
+}
@@ -3,9 +3,21 @@
 #include "rtc_module.h"
 #include <ArduinoJson.h>
 
+// Slack for float rounding when comparing flow sums against capacity
+static const float FLOW_EPSILON = 0.01f;
+
 ScheduleManager::ScheduleManager() {
-    scheduleCount = 0;
-    nextScheduleId = 1;
+    table = new ScheduleTable();
+    table->scheduleCount = 0;
+    table->nextScheduleId = 1;
+    revision = 0;
+    lastEvaluatedMinute = 0;
+    lateStartCount = 0;
+    missedFireCount = 0;
+    clockBehind = false;
+    maxLateSeconds = 0;
+    table->runWindowCount = 0;
+    table->runWindowsFull = false;
     configManager = nullptr;
     rtcModule = nullptr;
 
@@ -14,10 +26,24 @@ ScheduleManager::ScheduleManager() {
     rainDelayEndTime = 0;
     scheduleEnabled = true;
 
+    // No run plan loaded
+    runPlanStepCount = 0;
+    runPlanCurrent = 0;
+    runPlanState = PLAN_IDLE;
+    runPlanId = 0;
+    runPlanPhaseStart = 0;
+    runPlanStartMillis = 0;
+
     // Clear all schedules
     for (int i = 0; i < MAX_SCHEDULES; i++) {
-        schedules[i].id = 0;
-        schedules[i].enabled = false;
+        table->schedules[i].id = 0;
+        table->schedules[i].serverId = 0;
+        table->schedules[i].repeatCount = 1;
+        table->schedules[i].restMinutes = 0;
+        table->schedules[i].enabled = false;
+    }
+    for (int i = 0; i < SERVER_INDEX_SIZE; i++) {
+        table->serverIndex[i] = -1;
     }
 
     // Clear active zones
@@ -28,8 +54,22 @@ ScheduleManager::ScheduleManager() {
         activeZones[i].duration = 0;
         activeZones[i].isScheduled = false;
         activeZones[i].scheduleId = 0;
+        activeZones[i].serverId = 0;
         activeZones[i].timeRemaining = 0;
+        activeZones[i].type = BASIC;
+        activeZones[i].flowLpm = 0;
     }
+
+    // Clear pending runs, flow rates and unconfirmed stops
+    pendingRunCount = 0;
+    for (int i = 0; i <= MAX_ZONE_ID; i++) {
+        zoneFlowLpm[i] = 0;
+        zoneStopPending[i] = false;
+    }
+}
+
+ScheduleManager::~ScheduleManager() {
+    delete table;
 }
 
 bool ScheduleManager::begin(ConfigManager* config, RTCModule* rtc) {
@@ -39,7 +79,8 @@ bool ScheduleManager::begin(ConfigManager* config, RTCModule* rtc) {
     return true;
 }
 
-uint8_t ScheduleManager::addBasicSchedule(uint8_t zone, uint8_t dayMask, uint8_t hour, uint8_t minute, uint16_t duration) {
+uint32_t ScheduleManager::addBasicSchedule(uint8_t zone, uint8_t dayMask, uint8_t hour, uint8_t minute, uint16_t duration,
+                                           uint8_t repeatCount, uint16_t restMinutes, ScheduleConflict* conflictOut) {
     if (!configManager || !configManager->isZoneEnabled(zone)) {
         Serial.printf("ScheduleManager: Zone %d not enabled\n", zone);
         return 0;
@@ -51,120 +92,301 @@ uint8_t ScheduleManager::addBasicSchedule(uint8_t zone, uint8_t dayMask, uint8_t
         return 0;
     }
 
-    schedules[slot].id = nextScheduleId++;
-    schedules[slot].zone = zone;
-    schedules[slot].dayMask = dayMask;
-    schedules[slot].startHour = hour;
-    schedules[slot].startMinute = minute;
-    schedules[slot].duration = duration;
-    schedules[slot].enabled = true;
-    schedules[slot].type = BASIC;
-    schedules[slot].createdTime = getCurrentUnixTime();
-    schedules[slot].expiryTime = 0; // Never expires
+    table->schedules[slot].serverId = 0;
+    table->schedules[slot].zone = zone;
+    table->schedules[slot].dayMask = dayMask;
+    table->schedules[slot].startHour = hour;
+    table->schedules[slot].startMinute = minute;
+    table->schedules[slot].duration = duration;
+    table->schedules[slot].enabled = true;
+    table->schedules[slot].type = BASIC;
+    table->schedules[slot].createdTime = getCurrentUnixTime();
+    table->schedules[slot].expiryTime = 0; // Never expires
+    setCycles(table->schedules[slot], repeatCount, restMinutes);
+
+    // Basic schedules must not overlap: reject instead of finding out at run time
+    ScheduleConflict conflict;
+    if (scheduleConflicts(table->schedules[slot], slot, &conflict)) {
+        unindexRunWindows(slot);
+        table->schedules[slot].enabled = false;
+        Serial.println("ScheduleManager: Rejected basic schedule: " + describeConflict(conflict));
+        if (conflictOut) {
+            *conflictOut = conflict;
+        }
+        return 0;
+    }
 
-    scheduleCount++;
-    Serial.printf("ScheduleManager: Added basic schedule ID %d for zone %d\n", schedules[slot].id, zone);
-    return schedules[slot].id;
+    table->schedules[slot].id = table->nextScheduleId++;
+    if (table->nextScheduleId == 0) table->nextScheduleId = 1; // 0 is reserved for manual starts
+    table->scheduleCount++;
+    revision++;
+    Serial.printf("ScheduleManager: Added basic schedule ID %lu for zone %d\n", (unsigned long)table->schedules[slot].id, zone);
+    return table->schedules[slot].id;
 }
 
-uint8_t ScheduleManager::addAISchedule(uint8_t zone, uint8_t dayMask, uint8_t hour, uint8_t minute, uint16_t duration, uint32_t expiryTime) {
+uint32_t ScheduleManager::addAISchedule(uint8_t zone, uint8_t dayMask, uint8_t hour, uint8_t minute, uint16_t duration, uint32_t expiryTime,
+                                        uint32_t serverId, uint8_t repeatCount, uint16_t restMinutes) {
     if (!configManager || !configManager->isZoneEnabled(zone)) {
         Serial.printf("ScheduleManager: Zone %d not enabled\n", zone);
         return 0;
     }
 
-    uint8_t slot = findFreeScheduleSlot();
-    if (slot >= MAX_SCHEDULES) {
-        Serial.println("ScheduleManager: No free schedule slots");
-        return 0;
+    // A server event already loaded is updated in place and keeps its local ID
+    uint8_t slot = MAX_SCHEDULES;
+    bool existing = false;
+    if (serverId > 0) {
+        uint8_t pos = findServerIndexPos(serverId);
+        if (pos < SERVER_INDEX_SIZE) {
+            slot = table->serverIndex[pos];
+            existing = true;
+        }
     }
 
-    schedules[slot].id = nextScheduleId++;
-    schedules[slot].zone = zone;
-    schedules[slot].dayMask = dayMask;
-    schedules[slot].startHour = hour;
-    schedules[slot].startMinute = minute;
-    schedules[slot].duration = duration;
-    schedules[slot].enabled = true;
-    schedules[slot].type = AI;
-    schedules[slot].createdTime = getCurrentUnixTime();
-    schedules[slot].expiryTime = expiryTime;
+    if (!existing) {
+        slot = findFreeScheduleSlot();
+        if (slot >= MAX_SCHEDULES) {
+            Serial.println("ScheduleManager: No free schedule slots");
+            return 0;
+        }
 
-    scheduleCount++;
-    Serial.printf("ScheduleManager: Added AI schedule ID %d for zone %d (expires in %d hours)\n",
-                  schedules[slot].id, zone, (expiryTime - getCurrentUnixTime()) / 3600);
-    return schedules[slot].id;
+        table->schedules[slot].id = table->nextScheduleId++;
+        if (table->nextScheduleId == 0) table->nextScheduleId = 1; // 0 is reserved for manual starts
+        table->schedules[slot].serverId = serverId;
+        table->scheduleCount++;
+        if (serverId > 0) {
+            indexServerId(slot);
+        }
+    } else {
+        unindexRunWindows(slot);
+    }
+
+    table->schedules[slot].zone = zone;
+    table->schedules[slot].dayMask = dayMask;
+    table->schedules[slot].startHour = hour;
+    table->schedules[slot].startMinute = minute;
+    table->schedules[slot].duration = duration;
+    table->schedules[slot].enabled = true;
+    table->schedules[slot].type = AI;
+    table->schedules[slot].createdTime = getCurrentUnixTime();
+    table->schedules[slot].expiryTime = expiryTime;
+    setCycles(table->schedules[slot], repeatCount, restMinutes);
+    revision++;
+
+    // Server schedules are kept as sent, overlaps are flagged and listed by getConflictsJSON()
+    ScheduleConflict conflict;
+    if (scheduleConflicts(table->schedules[slot], slot, &conflict)) {
+        Serial.println("ScheduleManager: WARNING AI schedule overlap: " + describeConflict(conflict));
+    }
+
+    Serial.printf("ScheduleManager: %s AI schedule ID %lu (server %lu) for zone %d\n",
+                  existing ? "Updated" : "Added", (unsigned long)table->schedules[slot].id,
+                  (unsigned long)serverId, zone);
+    return table->schedules[slot].id;
 }
 
-bool ScheduleManager::removeSchedule(uint8_t id) {
+bool ScheduleManager::removeSchedule(uint32_t id) {
+    if (id == 0) return false;
+
     uint8_t slot = findScheduleById(id);
     if (slot >= MAX_SCHEDULES) {
         return false;
     }
 
-    schedules[slot].id = 0;
-    schedules[slot].enabled = false;
-    scheduleCount--;
-
-    Serial.printf("ScheduleManager: Removed schedule ID %d\n", id);
+    if (table->schedules[slot].serverId > 0) {
+        unindexServerId(table->schedules[slot].serverId);
+    }
+    unindexRunWindows(slot);
+    table->schedules[slot].id = 0;
+    table->schedules[slot].serverId = 0;
+    table->schedules[slot].enabled = false;
+    table->scheduleCount--;
+    revision++;
+    purgePendingRuns();
+
+    Serial.printf("ScheduleManager: Removed schedule ID %lu\n", (unsigned long)id);
     return true;
 }
 
 void ScheduleManager::checkAndExecuteSchedules() {
     if (!configManager) return;
 
-    // Clean up expired AI schedules first
+    // Clean up expired AI schedules first, and queued runs whose window ended
     cleanupExpiredAISchedules();
+    purgePendingRuns();
 
-    // Get current time
-    String timeStr = configManager->getLocalTimeString();
-    if (timeStr.indexOf("RTC not available") != -1) {
+    // Get current time (in UTC)
+    uint32_t nowUTC = getCurrentUnixTime();
+    if (nowUTC == 0) {
         return; // RTC not available
     }
 
-    // Get current time from RTC (in UTC)
-    DateTime nowUTC = rtcModule->getCurrentTime();
-    if (!nowUTC.isValid()) {
+    // Each minute is evaluated once; a stalled loop leaves a gap to catch up
+    uint32_t nowMinute = nowUTC / 60;
+    if (lastEvaluatedMinute == 0) {
+        lastEvaluatedMinute = nowMinute - 1;
+    } else if (nowMinute < lastEvaluatedMinute) {
+        // Minutes already evaluated are not evaluated again, so a small
+        // correction can't fire a schedule twice; a step back of more than a
+        // day is a clock being set, and evaluation resumes from there
+        uint32_t backMinutes = lastEvaluatedMinute - nowMinute;
+        if (backMinutes > 1440) {
+            Serial.printf("ScheduleManager: Clock moved back %lu min, resuming at current minute\n",
+                          (unsigned long)backMinutes);
+            lastEvaluatedMinute = nowMinute;
+        } else if (!clockBehind) {
+            Serial.printf("ScheduleManager: Clock moved back %lu min, waiting for it to catch up\n",
+                          (unsigned long)backMinutes);
+        }
+        clockBehind = (nowMinute < lastEvaluatedMinute);
+    } else {
+        clockBehind = false;
+    }
+    if (nowMinute <= lastEvaluatedMinute) {
         return;
     }
 
-    // Convert UTC to local time for schedule comparison
-    // timezoneOffset is in half-hours (e.g., 19 = UTC+9:30, 21 = UTC+10:30)
-    int offsetSeconds = configManager->getTimezoneOffset() * 1800; // Convert half-hours to seconds
-    if (configManager->isDaylightSaving()) {
-        offsetSeconds += 3600; // Add 1 hour for DST
+    // Fire times older than the grace window are skipped and reported
+    uint32_t graceMinutes = configManager->getMissedFireGraceMinutes();
+    uint32_t firstMinute = lastEvaluatedMinute + 1;
+    if (nowMinute - firstMinute > graceMinutes) {
+        reportMissedFires(firstMinute * 60, (nowMinute - graceMinutes) * 60, nowUTC, graceMinutes);
+        firstMinute = nowMinute - graceMinutes;
     }
-    DateTime now = DateTime(nowUTC.unixtime() + offsetSeconds);
 
-    // Check each schedule
-    for (int i = 0; i < MAX_SCHEDULES; i++) {
-        if (!schedules[i].enabled || schedules[i].id == 0) continue;
+    int offsetSeconds = getLocalOffsetSeconds();
+    for (uint32_t minute = firstMinute; minute <= nowMinute; minute++) {
+        // Convert UTC to local time for schedule comparison
+        DateTime now = DateTime(minute * 60 + offsetSeconds);
+        uint32_t lateSeconds = nowUTC - minute * 60;
+
+        // Check each schedule
+        for (int i = 0; i < MAX_SCHEDULES; i++) {
+            if (!table->schedules[i].enabled || table->schedules[i].id == 0) continue;
+
+            // Check if it's time to execute this schedule
+            if (isTimeMatch(table->schedules[i], now)) {
+                if (minute < nowMinute) {
+                    lateStartCount++;
+                    if (lateSeconds > maxLateSeconds) {
+                        maxLateSeconds = lateSeconds;
+                    }
+                    Serial.printf("ScheduleManager: Late start of schedule ID %lu for zone %d (%lu s late)\n",
+                                 (unsigned long)table->schedules[i].id, table->schedules[i].zone,
+                                 (unsigned long)lateSeconds);
+                } else {
+                    Serial.printf("ScheduleManager: Executing schedule ID %lu for zone %d\n",
+                                 (unsigned long)table->schedules[i].id, table->schedules[i].zone);
+                }
 
-        // Check if it's time to execute this schedule
-        if (isTimeMatch(schedules[i], now)) {
-            Serial.printf("ScheduleManager: Executing schedule ID %d for zone %d\n",
-                         schedules[i].id, schedules[i].zone);
+                // Start now if it fits the supply budget, otherwise wait for capacity
+                startScheduledRun(table->schedules[i].zone, table->schedules[i].duration, table->schedules[i].type,
+                                  table->schedules[i].id, table->schedules[i].serverId);
+            }
+        }
+    }
 
-            // Start the zone (this will handle conflicts automatically)
-            ConflictResult result = startZoneManual(schedules[i].zone, schedules[i].duration);
+    lastEvaluatedMinute = nowMinute;
+}
 
-            if (result.hasConflict) {
-                Serial.printf("ScheduleManager: Schedule conflict resolved - %s\n", result.message.c_str());
+void ScheduleManager::reportMissedFires(uint32_t fromUtc, uint32_t toUtc, uint32_t nowUtc, uint32_t graceMinutes) {
+    // A jump of more than a week is a clock being set, not a stall
+    if (toUtc - fromUtc > 7 * 86400UL) {
+        Serial.printf("ScheduleManager: Clock jumped %lu min, not replaying missed fires\n",
+                      (unsigned long)((toUtc - fromUtc) / 60));
+        return;
+    }
+
+    for (int i = 0; i < MAX_SCHEDULES; i++) {
+        const ScheduleEntry& schedule = table->schedules[i];
+        uint16_t missed = 0;
+        uint32_t oldest = 0;
+        uint32_t t = nextOccurrence(schedule, fromUtc);
+        while (t != 0 && t < toUtc) {
+            if (missed == 0) {
+                oldest = t;
             }
+            missed++;
+            t = nextOccurrence(schedule, t + 60);
+        }
+        if (missed == 0) continue;
 
-            // Find the active zone and mark it as scheduled
-            int8_t activeSlot = findActiveZone(schedules[i].zone);
-            if (activeSlot >= 0) {
-                activeZones[activeSlot].isScheduled = true;
-                activeZones[activeSlot].scheduleId = schedules[i].id;
+        missedFireCount += missed;
+        Serial.printf("ScheduleManager: Skipped %d fire(s) of schedule ID %lu for zone %d (oldest %lu min late, grace %lu min)\n",
+                      missed, (unsigned long)schedule.id, schedule.zone,
+                      (unsigned long)((nowUtc - oldest) / 60), (unsigned long)graceMinutes);
+    }
+}
 
-                // Call zone control callback with schedule type info
-                if (zoneControlCallback) {
-                    zoneControlCallback(schedules[i].zone, true, schedules[i].duration, schedules[i].type, schedules[i].id);
-                }
-            }
+void ScheduleManager::startScheduledRun(uint8_t zone, uint16_t duration, ScheduleType type, uint32_t scheduleId, uint32_t serverId) {
+    int8_t existingSlot = findActiveZone(zone);
+    if (existingSlot >= 0) {
+        if (activeZones[existingSlot].isScheduled && activeZones[existingSlot].scheduleId == scheduleId) {
+            return; // Already running for this schedule
+        }
+
+        // Zone already running from another source, take it over with the scheduled duration
+        activeZones[existingSlot].startTime = nowMillis();
+        activeZones[existingSlot].duration = duration * 60000UL;
+        activeZones[existingSlot].isScheduled = true;
+        activeZones[existingSlot].scheduleId = scheduleId;
+        activeZones[existingSlot].serverId = serverId;
+        activeZones[existingSlot].type = type;
+        if (zoneControlCallback) {
+            zoneControlCallback(zone, true, duration, type, scheduleId, serverId, RUN_COMPLETED);
+        }
+        return;
+    }
+
+    for (uint8_t i = 0; i < pendingRunCount; i++) {
+        if (pendingRuns[i].scheduleId == scheduleId && pendingRuns[i].zone == zone) {
+            return; // Already waiting for capacity
         }
     }
+
+    // Runs already waiting have an earlier deadline, so only start directly when nothing is queued
+    if (pendingRunCount == 0 && fitsFlowBudget(zone)) {
+        activateZone(zone, duration, true, type, scheduleId, serverId);
+        return;
+    }
+
+    if (queuePendingRun(zone, duration, type, scheduleId, serverId)) {
+        Serial.printf("ScheduleManager: Zone %d queued (%.1f L/min committed, %d waiting)\n",
+                      zone, getCommittedFlowLpm(), pendingRunCount);
+    }
+}
+
+bool ScheduleManager::activateZone(uint8_t zone, uint16_t duration, bool isScheduled, ScheduleType type, uint32_t scheduleId, uint32_t serverId) {
+    int8_t freeSlot = findFreeActiveSlot();
+    if (freeSlot < 0) {
+        return false;
+    }
+
+    activeZones[freeSlot].zone = zone;
+    activeZones[freeSlot].state = RUNNING;
+    activeZones[freeSlot].startTime = nowMillis();
+    activeZones[freeSlot].duration = duration * 60000UL; // Convert to milliseconds
+    activeZones[freeSlot].isScheduled = isScheduled;
+    activeZones[freeSlot].scheduleId = scheduleId;     // 0 indicates manual start
+    activeZones[freeSlot].serverId = serverId;
+    activeZones[freeSlot].timeRemaining = duration * 60; // Duration in seconds
+    activeZones[freeSlot].type = type;
+    activeZones[freeSlot].flowLpm = getZoneFlowDemand(zone);
+    zoneStopPending[zone] = false;
+
+    if (zoneControlCallback && !zoneControlCallback(zone, true, duration, type, scheduleId, serverId, RUN_COMPLETED)) {
+        // The bus refused the start, so the zone is not running
+        activeZones[freeSlot].zone = 0;
+        activeZones[freeSlot].state = IDLE;
+        activeZones[freeSlot].duration = 0;
+        activeZones[freeSlot].timeRemaining = 0;
+        activeZones[freeSlot].flowLpm = 0;
+        Serial.printf("ScheduleManager: Could not start zone %d\n", zone);
+        return false;
+    }
+
+    Serial.printf("ScheduleManager: Started zone %d for %d minutes (%s, %.1f L/min)\n",
+                  zone, duration, isScheduled ? "scheduled" : "manual", activeZones[freeSlot].flowLpm);
+    return true;
 }
 
 ConflictResult ScheduleManager::startZoneManual(uint8_t zone, uint16_t duration) {
@@ -181,37 +403,31 @@ ConflictResult ScheduleManager::startZoneManual(uint8_t zone, uint16_t duration)
     if (existingSlot >= 0) {
         // Zone already running, update duration
         activeZones[existingSlot].duration = duration * 60000; // Convert to milliseconds
-        activeZones[existingSlot].startTime = millis();
+        activeZones[existingSlot].startTime = nowMillis();
+        revision++;
         result.message = "Zone " + String(zone) + " duration updated";
         return result;
     }
 
-    // Check for conflicts and resolve if necessary
-    if (getActiveZoneCount() >= MAX_ACTIVE_ZONES) {
-        result = resolveZoneConflict(zone, true);
-        if (result.hasConflict && result.stoppedZone == 0) {
+    // Manual starts take priority: stop running zones until the new one fits the budget
+    while (!fitsFlowBudget(zone) && getActiveZoneCount() > 0) {
+        ConflictResult step = resolveZoneConflict(zone, true);
+        if (step.stoppedZone == 0) {
             // Could not resolve conflict
-            return result;
+            return step;
         }
+        result.hasConflict = true;
+        result.stoppedZone = step.stoppedZone;
+        result.message += (result.message.length() > 0 ? "; " : "") + step.message;
     }
 
-    // Find free slot and start zone
-    int8_t freeSlot = findFreeActiveSlot();
-    if (freeSlot >= 0) {
-        activeZones[freeSlot].zone = zone;
-        activeZones[freeSlot].state = RUNNING;
-        activeZones[freeSlot].startTime = millis();
-        activeZones[freeSlot].duration = duration * 60000; // Convert to milliseconds
-        activeZones[freeSlot].isScheduled = false; // Manual start, not scheduled
-        activeZones[freeSlot].scheduleId = 0;      // 0 indicates manual start
-        activeZones[freeSlot].timeRemaining = duration * 60; // Duration in seconds
-
-        // Call zone control callback (manual start, use BASIC type with scheduleId=0 to indicate manual)
-        if (zoneControlCallback) {
-            zoneControlCallback(zone, true, duration, BASIC, 0);
-        }
-
-        Serial.printf("ScheduleManager: Started zone %d for %d minutes (manual)\n", zone, duration);
+    // Manual start uses BASIC type with scheduleId=0 to indicate manual
+    bool started = activateZone(zone, duration, false, BASIC, 0, 0);
+    revision++;
+    if (!started) {
+        result.hasConflict = true;
+        result.stoppedZone = 0;
+        result.message = "Zone " + String(zone) + " could not be started";
     }
 
     return result;
@@ -220,12 +436,40 @@ ConflictResult ScheduleManager::startZoneManual(uint8_t zone, uint16_t duration)
 bool ScheduleManager::stopZone(uint8_t zone) {
     int8_t slot = findActiveZone(zone);
     if (slot < 0) {
-        return false;
+        // Not running, drop any queued runs for this zone instead
+        bool removed = false;
+        for (uint8_t i = 0; i < pendingRunCount; ) {
+            if (pendingRuns[i].zone == zone) {
+                removePendingRunAt(i);
+                removed = true;
+            } else {
+                i++;
+            }
+        }
+        if (removed) {
+            revision++;
+            Serial.printf("ScheduleManager: Removed queued runs for zone %d\n", zone);
+        }
+        return removed;
     }
 
-    // Call zone control callback (stop)
+    revision++;
+    return stopZoneSlot(slot, RUN_STOPPED);
+}
+
+bool ScheduleManager::stopZoneSlot(uint8_t slot, RunEndReason reason) {
+    if (slot >= MAX_ACTIVE_ZONES || activeZones[slot].zone == 0) return false;
+    uint8_t zone = activeZones[slot].zone;
+
+    // Call zone control callback (stop) with the minutes actually run; a stop
+    // that could not be sent yet is retried by the callback's owner, which
+    // marks the zone with setZoneStopPending() until it goes out
     if (zoneControlCallback) {
-        zoneControlCallback(zone, false, 0, BASIC, 0);
+        uint16_t ranMinutes = (nowMillis() - activeZones[slot].startTime + 30000UL) / 60000UL;
+        if (!zoneControlCallback(zone, false, ranMinutes, activeZones[slot].type,
+                                 activeZones[slot].scheduleId, activeZones[slot].serverId, reason)) {
+            Serial.printf("ScheduleManager: Stop of zone %d not sent yet\n", zone);
+        }
     }
 
     // Clear the active zone slot
@@ -235,14 +479,17 @@ bool ScheduleManager::stopZone(uint8_t zone) {
     activeZones[slot].duration = 0;
     activeZones[slot].isScheduled = false;
     activeZones[slot].scheduleId = 0;
+    activeZones[slot].serverId = 0;
     activeZones[slot].timeRemaining = 0;
+    activeZones[slot].type = BASIC;
+    activeZones[slot].flowLpm = 0;
 
     Serial.printf("ScheduleManager: Stopped zone %d\n", zone);
     return true;
 }
 
 void ScheduleManager::processActiveZones() {
-    uint32_t currentTime = millis();
+    uint32_t currentTime = nowMillis();
 
     for (int i = 0; i < MAX_ACTIVE_ZONES; i++) {
         if (activeZones[i].zone == 0) continue;
@@ -250,20 +497,387 @@ void ScheduleManager::processActiveZones() {
         // Check if zone duration has expired
         if (currentTime - activeZones[i].startTime >= activeZones[i].duration) {
             uint8_t zone = activeZones[i].zone;
-            stopZone(zone);
+            stopZoneSlot(i, RUN_COMPLETED);
             Serial.printf("ScheduleManager: Zone %d completed its scheduled duration\n", zone);
         }
     }
+
+    // Start queued runs into any capacity that was released
+    dispatchPendingRuns();
+
+    // Move a run plan on to its next step
+    advanceRunPlan();
+}
+
+uint32_t ScheduleManager::startRunPlan(const RunPlanStep* steps, uint8_t count) {
+    if (isRunPlanActive()) {
+        Serial.printf("ScheduleManager: Run plan %lu still active\n", (unsigned long)runPlanId);
+        return 0;
+    }
+    if (!configManager || !steps || count == 0 || count > MAX_RUN_PLAN_STEPS) {
+        return 0;
+    }
+    for (uint8_t i = 0; i < count; i++) {
+        if (!configManager->isZoneEnabled(steps[i].zone) || steps[i].minutes == 0) {
+            return 0;
+        }
+    }
+
+    for (uint8_t i = 0; i < count; i++) {
+        runPlanSteps[i] = steps[i];
+        runPlanSkipped[i] = false;
+    }
+    runPlanStepCount = count;
+    runPlanCurrent = 0;
+    runPlanId++;
+    runPlanStartMillis = nowMillis();
+
+    Serial.printf("ScheduleManager: Run plan %lu started with %d steps\n", (unsigned long)runPlanId, count);
+    startRunPlanStep();
+    return runPlanId;
+}
+
+void ScheduleManager::startRunPlanStep() {
+    // Steps that cannot start are skipped without waiting for their gap
+    while (runPlanCurrent < runPlanStepCount) {
+        const RunPlanStep& step = runPlanSteps[runPlanCurrent];
+        ConflictResult result = startZoneManual(step.zone, step.minutes);
+        if (!result.hasConflict || result.stoppedZone > 0) {
+            runPlanState = PLAN_RUNNING;
+            runPlanPhaseStart = nowMillis();
+            Serial.printf("ScheduleManager: Run plan %lu step %d/%d, zone %d for %d minutes\n",
+                          (unsigned long)runPlanId, runPlanCurrent + 1, runPlanStepCount, step.zone, step.minutes);
+            return;
+        }
+
+        Serial.printf("ScheduleManager: Run plan %lu step %d skipped: %s\n",
+                      (unsigned long)runPlanId, runPlanCurrent + 1, result.message.c_str());
+        runPlanSkipped[runPlanCurrent] = true;
+        runPlanCurrent++;
+    }
+
+    runPlanState = PLAN_COMPLETED;
+    Serial.printf("ScheduleManager: Run plan %lu completed in %lu s\n",
+                  (unsigned long)runPlanId, (unsigned long)((nowMillis() - runPlanStartMillis) / 1000));
+}
+
+void ScheduleManager::advanceRunPlan() {
+    if (runPlanState == PLAN_RUNNING) {
+        // The step ends when its zone stops, whether it ran out or was stopped
+        if (findActiveZone(runPlanSteps[runPlanCurrent].zone) >= 0) return;
+
+        runPlanCurrent++;
+        if (runPlanCurrent >= runPlanStepCount) {
+            startRunPlanStep();
+            return;
+        }
+        runPlanState = PLAN_GAP;
+        runPlanPhaseStart = nowMillis();
+    }
+
+    if (runPlanState == PLAN_GAP) {
+        uint32_t gapMillis = runPlanSteps[runPlanCurrent - 1].gapSeconds * 1000UL;
+        if (nowMillis() - runPlanPhaseStart < gapMillis) return;
+        startRunPlanStep();
+    }
+}
+
+bool ScheduleManager::cancelRunPlan() {
+    if (!isRunPlanActive()) {
+        return false;
+    }
+
+    if (runPlanState == PLAN_RUNNING) {
+        // Stop the step's zone unless a schedule has taken it over
+        int8_t slot = findActiveZone(runPlanSteps[runPlanCurrent].zone);
+        if (slot >= 0 && !activeZones[slot].isScheduled) {
+            revision++;
+            stopZoneSlot(slot, RUN_PLAN_CANCELLED);
+        }
+    }
+    runPlanState = PLAN_CANCELLED;
+
+    Serial.printf("ScheduleManager: Run plan %lu cancelled at step %d/%d\n",
+                  (unsigned long)runPlanId, runPlanCurrent + 1, runPlanStepCount);
+    return true;
+}
+
+String ScheduleManager::getRunPlanJSON() {
+    JsonDocument doc;
+
+    const char* stateStr = "idle";
+    switch (runPlanState) {
+        case PLAN_RUNNING: stateStr = "running"; break;
+        case PLAN_GAP: stateStr = "gap"; break;
+        case PLAN_COMPLETED: stateStr = "completed"; break;
+        case PLAN_CANCELLED: stateStr = "cancelled"; break;
+        default: stateStr = "idle"; break;
+    }
+    doc["id"] = runPlanId;
+    doc["state"] = stateStr;
+    if (runPlanState == PLAN_IDLE) {
+        String result;
+        serializeJson(doc, result);
+        return result;
+    }
+
+    doc["step"] = runPlanCurrent < runPlanStepCount ? runPlanCurrent + 1 : runPlanStepCount;
+    doc["step_count"] = runPlanStepCount;
+
+    uint32_t now = nowMillis();
+    if (runPlanState == PLAN_RUNNING) {
+        int8_t slot = findActiveZone(runPlanSteps[runPlanCurrent].zone);
+        doc["zone"] = runPlanSteps[runPlanCurrent].zone;
+        doc["remaining_seconds"] = slot >= 0 ? getRemainingTime(slot) / 1000 : 0;
+    } else if (runPlanState == PLAN_GAP) {
+        uint32_t gapMillis = runPlanSteps[runPlanCurrent - 1].gapSeconds * 1000UL;
+        uint32_t waited = now - runPlanPhaseStart;
+        doc["remaining_seconds"] = waited < gapMillis ? (gapMillis - waited) / 1000 : 0;
+    }
+    if (isRunPlanActive()) {
+        doc["elapsed_seconds"] = (now - runPlanStartMillis) / 1000;
+    }
+
+    uint32_t totalMinutes = 0;
+    JsonArray steps = doc["steps"].to<JsonArray>();
+    for (uint8_t i = 0; i < runPlanStepCount; i++) {
+        const char* status = "pending";
+        if (runPlanSkipped[i]) {
+            status = "skipped";
+        } else if (i < runPlanCurrent) {
+            status = "done";
+        } else if (i == runPlanCurrent && runPlanState == PLAN_RUNNING) {
+            status = "running";
+        } else if (runPlanState == PLAN_CANCELLED) {
+            status = "cancelled";
+        }
+
+        JsonObject step = steps.add<JsonObject>();
+        step["zone"] = runPlanSteps[i].zone;
+        step["minutes"] = runPlanSteps[i].minutes;
+        step["gap_seconds"] = runPlanSteps[i].gapSeconds;
+        step["status"] = status;
+        totalMinutes += runPlanSteps[i].minutes;
+    }
+    doc["total_minutes"] = totalMinutes;
+
+    String result;
+    serializeJson(doc, result);
+    return result;
+}
+
+void ScheduleManager::setZoneFlowRate(uint8_t zone, float lpm) {
+    if (zone < 1 || zone > MAX_ZONE_ID) return;
+    float rate = (lpm > 0) ? lpm : 0;
+    if (zoneFlowLpm[zone] != rate) {
+        zoneFlowLpm[zone] = rate;
+        revision++;
+    }
+}
+
+float ScheduleManager::getZoneFlowRate(uint8_t zone) const {
+    if (zone < 1 || zone > MAX_ZONE_ID) return 0;
+    return zoneFlowLpm[zone];
+}
+
+float ScheduleManager::getCommittedFlowLpm() {
+    float committed = 0;
+    for (int i = 0; i < MAX_ACTIVE_ZONES; i++) {
+        if (activeZones[i].zone != 0) {
+            committed += activeZones[i].flowLpm;
+        }
+    }
+    return committed;
+}
+
+float ScheduleManager::getZoneFlowDemand(uint8_t zone) {
+    float rate = getZoneFlowRate(zone);
+    if (rate > 0) {
+        return rate;
+    }
+
+    // Unknown rate: assume the zone needs an equal share of the legacy zone limit
+    float capacity = configManager ? configManager->getSupplyCapacityLpm() : 0;
+    return capacity / DEFAULT_MAX_CONCURRENT_ZONES;
+}
+
+bool ScheduleManager::budgetAllows(float committed, uint8_t count, uint8_t busCount, float demand) {
+    if (count >= MAX_ACTIVE_ZONES) {
+        return false;
+    }
+
+    // Without a supply capacity each X-Core unit runs the legacy number of
+    // zones; busCount is the zones already running on the new zone's bus
+    float capacity = configManager ? configManager->getSupplyCapacityLpm() : 0;
+    if (capacity <= 0) {
+        return busCount < DEFAULT_MAX_CONCURRENT_ZONES;
+    }
+
+    // A zone that exceeds the supply on its own still runs alone
+    if (count == 0) {
+        return true;
+    }
+    return committed + demand <= capacity + FLOW_EPSILON;
+}
+
+bool ScheduleManager::fitsFlowBudget(uint8_t zone) {
+    return budgetAllows(getCommittedFlowLpm(), getActiveZoneCount(), getActiveZoneCountOnBus(hunterZoneBus(zone)),
+                        getZoneFlowDemand(zone));
+}
+
+uint32_t ScheduleManager::estimateStartDelay(uint8_t zone) {
+    // Release running zones in finishing order until the zone fits
+    uint32_t remaining[MAX_ACTIVE_ZONES];
+    float flow[MAX_ACTIVE_ZONES];
+    bool sameBus[MAX_ACTIVE_ZONES];
+    uint8_t count = 0;
+    uint8_t busCount = 0;
+    float committed = 0;
+    uint8_t bus = hunterZoneBus(zone);
+
+    for (int i = 0; i < MAX_ACTIVE_ZONES; i++) {
+        if (activeZones[i].zone == 0) continue;
+
+        // Insertion sort by remaining time (at most MAX_ACTIVE_ZONES entries)
+        uint32_t r = getRemainingTime(i);
+        uint8_t j = count;
+        while (j > 0 && remaining[j - 1] > r) {
+            remaining[j] = remaining[j - 1];
+            flow[j] = flow[j - 1];
+            sameBus[j] = sameBus[j - 1];
+            j--;
+        }
+        remaining[j] = r;
+        flow[j] = activeZones[i].flowLpm;
+        sameBus[j] = hunterZoneBus(activeZones[i].zone) == bus;
+        committed += activeZones[i].flowLpm;
+        busCount += sameBus[j] ? 1 : 0;
+        count++;
+    }
+
+    float demand = getZoneFlowDemand(zone);
+    for (uint8_t i = 0; i < count; i++) {
+        committed -= flow[i];
+        busCount -= sameBus[i] ? 1 : 0;
+        if (budgetAllows(committed, count - i - 1, busCount, demand)) {
+            return remaining[i];
+        }
+    }
+    return 0;
+}
+
+bool ScheduleManager::queuePendingRun(uint8_t zone, uint16_t duration, ScheduleType type, uint32_t scheduleId, uint32_t serverId) {
+    if (pendingRunCount >= MAX_PENDING_RUNS) {
+        Serial.printf("ScheduleManager: Pending queue full, skipping zone %d (schedule %lu)\n", zone, (unsigned long)scheduleId);
+        return false;
+    }
+
+    PendingRun& run = pendingRuns[pendingRunCount++];
+    run.zone = zone;
+    run.duration = duration;
+    run.type = type;
+    run.scheduleId = scheduleId;
+    run.serverId = serverId;
+    run.queuedAt = nowMillis();
+    return true;
+}
+
+void ScheduleManager::removePendingRunAt(uint8_t index) {
+    if (index >= pendingRunCount) return;
+
+    for (uint8_t i = index; i + 1 < pendingRunCount; i++) {
+        pendingRuns[i] = pendingRuns[i + 1];
+    }
+    pendingRunCount--;
+}
+
+// Drop queued runs that must not start any more: their schedule was removed,
+// replaced or disabled, scheduling is off or rain-delayed, or the schedule is
+// due again, which ends the window of the queued fire and counts it as missed
+void ScheduleManager::purgePendingRuns() {
+    uint32_t nowUtc = getCurrentUnixTime();
+
+    for (uint8_t i = 0; i < pendingRunCount; ) {
+        const PendingRun& run = pendingRuns[i];
+        uint8_t slot = findScheduleById(run.scheduleId);
+        uint32_t waited = nowMillis() - run.queuedAt;
+
+        const char* reason = nullptr;
+        if (slot >= MAX_SCHEDULES || !table->schedules[slot].enabled) {
+            reason = "schedule removed";
+        } else if (!scheduleEnabled) {
+            reason = "scheduling disabled";
+        } else if (rainDelayActive) {
+            reason = "rain delay";
+        } else if (nowUtc > 0) {
+            uint32_t next = nextOccurrence(table->schedules[slot], nowUtc - waited / 1000 + 60);
+            if (next != 0 && next <= nowUtc) {
+                missedFireCount++;
+                reason = "schedule due again";
+            }
+        }
+
+        if (!reason) {
+            i++;
+            continue;
+        }
+        Serial.printf("ScheduleManager: Dropped queued run of zone %d (schedule %lu, %s, waited %lu s)\n",
+                      run.zone, (unsigned long)run.scheduleId, reason, (unsigned long)(waited / 1000));
+        removePendingRunAt(i);
+        revision++;
+    }
+}
+
+void ScheduleManager::dispatchPendingRuns() {
+    purgePendingRuns();
+
+    // Queue is in due order, so the head has the earliest deadline. Later runs may
+    // backfill around a blocked head only if they finish before the head could start,
+    // which keeps a large zone from being starved by a stream of small ones.
+    uint32_t headDelay = 0;
+    bool headBlocked = false;
+
+    for (uint8_t i = 0; i < pendingRunCount; ) {
+        PendingRun run = pendingRuns[i];
+
+        if (findActiveZone(run.zone) >= 0) {
+            // Zone became active in the meantime (e.g. manual start), hand it to the schedule
+            removePendingRunAt(i);
+            startScheduledRun(run.zone, run.duration, run.type, run.scheduleId, run.serverId);
+            continue;
+        }
+
+        bool canStart = fitsFlowBudget(run.zone) &&
+                        (!headBlocked || run.duration * 60000UL <= headDelay);
+        if (canStart) {
+            removePendingRunAt(i);
+            Serial.printf("ScheduleManager: Starting queued zone %d after %lu s\n",
+                          run.zone, (unsigned long)((nowMillis() - run.queuedAt) / 1000));
+            activateZone(run.zone, run.duration, true, run.type, run.scheduleId, run.serverId);
+            continue;
+        }
+
+        if (!headBlocked) {
+            headBlocked = true;
+            headDelay = estimateStartDelay(run.zone);
+        }
+        i++;
+    }
 }
 
 ConflictResult ScheduleManager::resolveZoneConflict(uint8_t newZone, bool isManual) {
     ConflictResult result = {true, "", 0};
 
-    if (getActiveZoneCount() < MAX_ACTIVE_ZONES) {
+    if (fitsFlowBudget(newZone)) {
         result.hasConflict = false;
         return result;
     }
 
+    // Without a supply capacity the zone limit is per bus, so only a zone
+    // on the same bus makes room
+    float capacity = configManager ? configManager->getSupplyCapacityLpm() : 0;
+    bool sameBusOnly = capacity <= 0 && getActiveZoneCount() < MAX_ACTIVE_ZONES;
+
     // Find zone with least remaining time
     uint8_t zoneToStop = 0;
     uint32_t minRemainingTime = UINT32_MAX;
@@ -271,6 +885,7 @@ ConflictResult ScheduleManager::resolveZoneConflict(uint8_t newZone, bool isManu
 
     for (int i = 0; i < MAX_ACTIVE_ZONES; i++) {
         if (activeZones[i].zone == 0) continue;
+        if (sameBusOnly && hunterZoneBus(activeZones[i].zone) != hunterZoneBus(newZone)) continue;
 
         uint32_t remainingTime = getRemainingTime(i);
 
@@ -286,7 +901,8 @@ ConflictResult ScheduleManager::resolveZoneConflict(uint8_t newZone, bool isManu
     }
 
     if (zoneToStop > 0) {
-        stopZone(zoneToStop);
+        revision++;
+        stopZoneSlot(slotToStop, RUN_PREEMPTED);
         result.stoppedZone = zoneToStop;
         result.message = "Stopped zone " + String(zoneToStop) + " (least remaining time) to start zone " + String(newZone);
         Serial.printf("ScheduleManager: Conflict resolved - %s\n", result.message.c_str());
@@ -297,15 +913,33 @@ ConflictResult ScheduleManager::resolveZoneConflict(uint8_t newZone, bool isManu
     return result;
 }
 
+void ScheduleManager::setCycles(ScheduleEntry& schedule, uint8_t repeatCount, uint16_t restMinutes) {
+#if !SCHEDULE_CYCLE_SOAK
+    repeatCount = 1;
+    restMinutes = 0;
+#endif
+    if (repeatCount < 1) repeatCount = 1;
+
+    // Back-to-back cycles without a soak are the same as one longer run
+    if (restMinutes == 0 && repeatCount > 1) {
+        uint32_t total = (uint32_t)schedule.duration * repeatCount;
+        schedule.duration = total > 1440 ? 1440 : total;
+        repeatCount = 1;
+    }
+
+    schedule.repeatCount = repeatCount;
+    schedule.restMinutes = repeatCount > 1 ? restMinutes : 0;
+}
+
 void ScheduleManager::cleanupExpiredAISchedules() {
     uint32_t currentTime = getCurrentUnixTime();
 
     for (int i = 0; i < MAX_SCHEDULES; i++) {
-        if (schedules[i].id == 0 || schedules[i].type != AI) continue;
+        if (table->schedules[i].id == 0 || table->schedules[i].type != AI) continue;
 
-        if (schedules[i].expiryTime > 0 && currentTime > schedules[i].expiryTime) {
-            Serial.printf("ScheduleManager: Removing expired AI schedule ID %d\n", schedules[i].id);
-            removeSchedule(schedules[i].id);
+        if (table->schedules[i].expiryTime > 0 && currentTime > table->schedules[i].expiryTime) {
+            Serial.printf("ScheduleManager: Removing expired AI schedule ID %lu\n", (unsigned long)table->schedules[i].id);
+            removeSchedule(table->schedules[i].id);
         }
     }
 }
@@ -315,26 +949,29 @@ String ScheduleManager::getSchedulesJSON() {
     bool first = true;
 
     for (int i = 0; i < MAX_SCHEDULES; i++) {
-        if (schedules[i].id == 0) continue;
+        if (table->schedules[i].id == 0) continue;
 
         if (!first) json += ",";
         first = false;
 
         json += "{";
-        json += "\"id\":" + String(schedules[i].id) + ",";
-        json += "\"zone\":" + String(schedules[i].zone) + ",";
-        json += "\"days\":" + String(schedules[i].dayMask) + ",";
-        json += "\"start_hour\":" + String(schedules[i].startHour) + ",";
-        json += "\"start_minute\":" + String(schedules[i].startMinute) + ",";
-        json += "\"duration\":" + String(schedules[i].duration) + ",";
-        json += "\"enabled\":" + String(schedules[i].enabled ? "true" : "false") + ",";
-        json += "\"type\":\"" + String(schedules[i].type == BASIC ? "basic" : "ai") + "\",";
-        json += "\"created\":" + String(schedules[i].createdTime) + ",";
-        json += "\"expires\":" + String(schedules[i].expiryTime);
+        json += "\"id\":" + String(table->schedules[i].id) + ",";
+        json += "\"server_id\":" + String(table->schedules[i].serverId) + ",";
+        json += "\"zone\":" + String(table->schedules[i].zone) + ",";
+        json += "\"days\":" + String(table->schedules[i].dayMask) + ",";
+        json += "\"start_hour\":" + String(table->schedules[i].startHour) + ",";
+        json += "\"start_minute\":" + String(table->schedules[i].startMinute) + ",";
+        json += "\"duration\":" + String(table->schedules[i].duration) + ",";
+        json += "\"repeat_count\":" + String(table->schedules[i].repeatCount) + ",";
+        json += "\"rest_minutes\":" + String(table->schedules[i].restMinutes) + ",";
+        json += "\"enabled\":" + String(table->schedules[i].enabled ? "true" : "false") + ",";
+        json += "\"type\":\"" + String(table->schedules[i].type == BASIC ? "basic" : "ai") + "\",";
+        json += "\"created\":" + String(table->schedules[i].createdTime) + ",";
+        json += "\"expires\":" + String(table->schedules[i].expiryTime);
         json += "}";
     }
 
-    json += "],\"count\":" + String(scheduleCount) + "}";
+    json += "],\"count\":" + String(table->scheduleCount) + "}";
     return json;
 }
 
@@ -352,33 +989,376 @@ String ScheduleManager::getActiveZonesJSON() {
 
         json += "{";
         json += "\"zone\":" + String(activeZones[i].zone) + ",";
+        json += "\"bus\":" + String(hunterZoneBus(activeZones[i].zone)) + ",";
         json += "\"remaining_seconds\":" + String(remainingTime / 1000) + ",";
         json += "\"is_scheduled\":" + String(activeZones[i].isScheduled ? "true" : "false") + ",";
-        json += "\"schedule_id\":" + String(activeZones[i].scheduleId);
+        json += "\"schedule_id\":" + String(activeZones[i].scheduleId) + ",";
+        json += "\"server_id\":" + String(activeZones[i].serverId) + ",";
+        json += "\"flow_lpm\":" + String(activeZones[i].flowLpm, 1);
         json += "}";
     }
 
-    json += "]}";
+    json += "],\"queued_zones\":[";
+    for (uint8_t i = 0; i < pendingRunCount; i++) {
+        if (i > 0) json += ",";
+        json += "{";
+        json += "\"zone\":" + String(pendingRuns[i].zone) + ",";
+        json += "\"duration\":" + String(pendingRuns[i].duration) + ",";
+        json += "\"schedule_id\":" + String(pendingRuns[i].scheduleId) + ",";
+        json += "\"waiting_seconds\":" + String((nowMillis() - pendingRuns[i].queuedAt) / 1000);
+        json += "}";
+    }
+
+    json += "],\"stopping_zones\":[";
+    bool firstStopping = true;
+    for (int zone = 1; zone <= MAX_ZONE_ID; zone++) {
+        if (!zoneStopPending[zone]) continue;
+        if (!firstStopping) json += ",";
+        firstStopping = false;
+        json += String(zone);
+    }
+
+    float capacity = configManager ? configManager->getSupplyCapacityLpm() : 0;
+    json += "],\"flow_committed_lpm\":" + String(getCommittedFlowLpm(), 1);
+    json += ",\"flow_capacity_lpm\":" + String(capacity, 1) + "}";
     return json;
 }
 
 // Helper methods
 bool ScheduleManager::isScheduleSlotFree(uint8_t index) {
-    return (index < MAX_SCHEDULES && schedules[index].id == 0);
+    return (index < MAX_SCHEDULES && table->schedules[index].id == 0);
 }
 
-uint8_t ScheduleManager::findScheduleById(uint8_t id) {
+uint8_t ScheduleManager::findScheduleById(uint32_t id) {
     for (int i = 0; i < MAX_SCHEDULES; i++) {
-        if (schedules[i].id == id) {
+        if (table->schedules[i].id == id) {
             return i;
         }
     }
     return MAX_SCHEDULES; // Not found
 }
 
+const ScheduleEntry* ScheduleManager::findByServerId(uint32_t serverId) const {
+    uint8_t pos = findServerIndexPos(serverId);
+    return (pos < SERVER_INDEX_SIZE) ? &table->schedules[table->serverIndex[pos]] : nullptr;
+}
+
+// Server ID index: linear probing over SERVER_INDEX_SIZE buckets. The table is
+// larger than MAX_SCHEDULES, so there is always an empty bucket to end a probe.
+static inline uint8_t serverIdHash(uint32_t serverId, uint8_t size) {
+    return (uint8_t)((uint32_t)(serverId * 2654435761UL) >> 24) & (size - 1);  // Knuth multiplicative hash
+}
+
+uint8_t ScheduleManager::findServerIndexPos(uint32_t serverId) const {
+    if (serverId == 0) return SERVER_INDEX_SIZE;
+
+    uint8_t pos = serverIdHash(serverId, SERVER_INDEX_SIZE);
+    for (uint8_t probes = 0; probes < SERVER_INDEX_SIZE; probes++) {
+        int8_t slot = table->serverIndex[pos];
+        if (slot < 0) {
+            return SERVER_INDEX_SIZE; // Empty bucket ends the probe
+        }
+        if (table->schedules[slot].serverId == serverId) {
+            return pos;
+        }
+        pos = (pos + 1) & (SERVER_INDEX_SIZE - 1);
+    }
+    return SERVER_INDEX_SIZE;
+}
+
+void ScheduleManager::indexServerId(uint8_t slot) {
+    uint8_t pos = serverIdHash(table->schedules[slot].serverId, SERVER_INDEX_SIZE);
+    while (table->serverIndex[pos] >= 0) {
+        pos = (pos + 1) & (SERVER_INDEX_SIZE - 1);
+    }
+    table->serverIndex[pos] = slot;
+}
+
+void ScheduleManager::unindexServerId(uint32_t serverId) {
+    uint8_t pos = findServerIndexPos(serverId);
+    if (pos >= SERVER_INDEX_SIZE) return;
+
+    // Backward-shift deletion keeps probe chains intact without tombstones
+    table->serverIndex[pos] = -1;
+    uint8_t next = (pos + 1) & (SERVER_INDEX_SIZE - 1);
+    while (table->serverIndex[next] >= 0) {
+        uint8_t home = serverIdHash(table->schedules[table->serverIndex[next]].serverId, SERVER_INDEX_SIZE);
+        // Move the entry back unless its home bucket lies in (pos, next]
+        bool movable = (pos <= next) ? (home <= pos || home > next) : (home <= pos && home > next);
+        if (movable) {
+            table->serverIndex[pos] = table->serverIndex[next];
+            table->serverIndex[next] = -1;
+            pos = next;
+        }
+        next = (next + 1) & (SERVER_INDEX_SIZE - 1);
+    }
+}
+
+void ScheduleManager::rebuildServerIndex() {
+    for (int i = 0; i < SERVER_INDEX_SIZE; i++) {
+        table->serverIndex[i] = -1;
+    }
+    for (int i = 0; i < MAX_SCHEDULES; i++) {
+        if (table->schedules[i].id != 0 && table->schedules[i].serverId > 0) {
+            indexServerId(i);
+        }
+    }
+}
+
+// Returns the number of windows the schedule needs; only the first maxCount are written
+uint16_t ScheduleManager::buildRunWindows(const ScheduleEntry& schedule, uint8_t slot, RunWindow* out, uint16_t maxCount) {
+    uint16_t count = 0;
+    uint32_t cycleLength = (uint32_t)schedule.duration + schedule.restMinutes;
+
+    for (uint8_t day = 0; day < 7; day++) {
+        if (!(schedule.dayMask & (1 << day))) continue;
+
+        uint32_t cycleStart = day * 1440UL + schedule.startHour * 60 + schedule.startMinute;
+        for (uint8_t c = 0; c < schedule.repeatCount; c++, cycleStart += cycleLength) {
+            uint16_t start = cycleStart % MINUTES_PER_WEEK;
+            uint32_t end = (uint32_t)start + schedule.duration;
+
+            // Split runs crossing Saturday midnight into two windows
+            if (count < maxCount) {
+                out[count].start = start;
+                out[count].end = end > MINUTES_PER_WEEK ? MINUTES_PER_WEEK : end;
+                out[count].slot = slot;
+                out[count].cycle = c;
+            }
+            count++;
+
+            if (end > MINUTES_PER_WEEK) {
+                if (count < maxCount) {
+                    out[count].start = 0;
+                    out[count].end = end - MINUTES_PER_WEEK;
+                    out[count].slot = slot;
+                    out[count].cycle = c;
+                }
+                count++;
+            }
+        }
+    }
+    return count;
+}
+
+void ScheduleManager::indexRunWindows(uint8_t slot) {
+    if (!table->schedules[slot].enabled || table->schedules[slot].duration == 0) return;
+
+    // Build the windows in the unused tail of the index, then move each one
+    // from the front of the tail to its sorted position
+    uint16_t freeCount = MAX_RUN_WINDOWS - table->runWindowCount;
+    uint16_t count = buildRunWindows(table->schedules[slot], slot, &table->runWindows[table->runWindowCount], freeCount);
+    if (count > freeCount) {
+        table->runWindowsFull = true;
+        count = freeCount;
+    }
+
+    for (uint16_t i = 0; i < count; i++) {
+        RunWindow window = table->runWindows[table->runWindowCount];
+
+        // Binary search for the insert position, ordered by (start, slot)
+        uint16_t lo = 0, hi = table->runWindowCount;
+        while (lo < hi) {
+            uint16_t mid = (lo + hi) / 2;
+            if (table->runWindows[mid].start < window.start ||
+                (table->runWindows[mid].start == window.start && table->runWindows[mid].slot <= slot)) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        memmove(&table->runWindows[lo + 1], &table->runWindows[lo], (table->runWindowCount - lo) * sizeof(RunWindow));
+        table->runWindows[lo] = window;
+        table->runWindowCount++;
+    }
+}
+
+void ScheduleManager::unindexRunWindows(uint8_t slot) {
+    uint16_t kept = 0;
+    for (uint16_t i = 0; i < table->runWindowCount; i++) {
+        if (table->runWindows[i].slot != slot) {
+            table->runWindows[kept++] = table->runWindows[i];
+        }
+    }
+    table->runWindowCount = kept;
+}
+
+void ScheduleManager::rebuildRunWindows() {
+    table->runWindowCount = 0;
+    table->runWindowsFull = false;
+    for (uint8_t i = 0; i < MAX_SCHEDULES; i++) {
+        if (table->schedules[i].id != 0) {
+            indexRunWindows(i);
+        }
+    }
+}
+
+// Dated server schedules run once, on the day before their expiry (plus the
+// cycles spilling past midnight). Two of them that land on the same weekly
+// minute but in different weeks never meet.
+static bool inDifferentWeeks(const ScheduleEntry& a, const ScheduleEntry& b) {
+    if (a.type != AI || b.type != AI || a.expiryTime == 0 || b.expiryTime == 0) return false;
+
+    uint32_t dayEndA = a.expiryTime - (uint32_t)(a.repeatCount - 1) * (a.duration + a.restMinutes) * 60UL;
+    uint32_t dayEndB = b.expiryTime - (uint32_t)(b.repeatCount - 1) * (b.duration + b.restMinutes) * 60UL;
+    uint32_t apart = dayEndA > dayEndB ? dayEndA - dayEndB : dayEndB - dayEndA;
+    return apart >= 7 * 86400UL / 2;
+}
+
+bool ScheduleManager::windowConflicts(const RunWindow& window, uint8_t zone, uint8_t involveSlot, ScheduleConflict* conflict) {
+    // Windows already running when this cycle starts; at the same minute,
+    // lower slots fire first (same order as checkAndExecuteSchedules)
+    float committed = 0;
+    uint8_t count = 0;
+    uint8_t busCount = 0;
+    uint32_t sameZoneId = 0;
+    bool sameZone = false;
+    bool involved = (involveSlot >= MAX_SCHEDULES || window.slot == involveSlot);
+
+    for (uint16_t i = 0; i < table->runWindowCount; i++) {
+        const RunWindow& other = table->runWindows[i];
+        if (other.start > window.start) break;
+        if (other.slot == window.slot || other.end <= window.start) continue;
+        if (other.start == window.start && other.slot > window.slot) continue;
+        if (inDifferentWeeks(table->schedules[other.slot], table->schedules[window.slot])) continue;
+
+        uint8_t otherZone = table->schedules[other.slot].zone;
+        if (otherZone == zone && !sameZone) {
+            sameZone = true;
+            sameZoneId = table->schedules[other.slot].id;
+        }
+        if (other.slot == involveSlot) {
+            involved = true;
+        }
+        committed += getZoneFlowDemand(otherZone);
+        count++;
+        if (hunterZoneBus(otherZone) == hunterZoneBus(zone)) {
+            busCount++;
+        }
+    }
+
+    if (!involved) return false;
+    if (!sameZone && budgetAllows(committed, count, busCount, getZoneFlowDemand(zone))) return false;
+
+    if (conflict) {
+        conflict->weekMinute = window.start;
+        conflict->zone = zone;
+        conflict->scheduleId = table->schedules[window.slot].id;
+        conflict->otherId = sameZoneId;
+        conflict->runningCount = count;
+        conflict->sameZone = sameZone;
+    }
+    return true;
+}
+
+bool ScheduleManager::scheduleConflicts(const ScheduleEntry& schedule, uint8_t slot, ScheduleConflict* conflict) {
+    // Index the schedule, then check its own cycle starts and every cycle
+    // that starts while one of its runs is going
+    indexRunWindows(slot);
+
+    for (uint16_t i = 0; i < table->runWindowCount; i++) {
+        const RunWindow& window = table->runWindows[i];
+        bool check = (window.slot == slot);
+        for (uint16_t j = 0; !check && j < table->runWindowCount; j++) {
+            const RunWindow& own = table->runWindows[j];
+            if (own.slot != slot) continue;
+            check = (own.start < window.start && window.start < own.end) ||
+                    (own.start == window.start && slot < window.slot);
+        }
+        if (check && windowConflicts(window, table->schedules[window.slot].zone, slot, conflict)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ScheduleManager::checkScheduleConflict(uint8_t zone, uint8_t dayMask, uint8_t hour, uint8_t minute, uint16_t duration,
+                                            uint8_t repeatCount, uint16_t restMinutes, ScheduleConflict* conflict) {
+    uint8_t slot = findFreeScheduleSlot();
+    if (slot >= MAX_SCHEDULES) return false;
+
+    // Borrow the free slot (id stays 0, so nothing else treats it as a schedule)
+    ScheduleEntry& candidate = table->schedules[slot];
+    candidate.zone = zone;
+    candidate.dayMask = dayMask;
+    candidate.startHour = hour;
+    candidate.startMinute = minute;
+    candidate.duration = duration;
+    candidate.enabled = true;
+    candidate.type = BASIC;
+    candidate.expiryTime = 0;
+    setCycles(candidate, repeatCount, restMinutes);
+
+    bool found = scheduleConflicts(candidate, slot, conflict);
+
+    unindexRunWindows(slot);
+    candidate.enabled = false;
+    return found;
+}
+
+uint16_t ScheduleManager::findConflicts(ScheduleConflict* out, uint16_t maxCount) {
+    uint16_t total = 0;
+    for (uint16_t i = 0; i < table->runWindowCount; i++) {
+        ScheduleConflict conflict;
+        if (!windowConflicts(table->runWindows[i], table->schedules[table->runWindows[i].slot].zone, MAX_SCHEDULES, &conflict)) continue;
+
+        if (out && total < maxCount) {
+            out[total] = conflict;
+        }
+        total++;
+    }
+    return total;
+}
+
+String ScheduleManager::describeConflict(const ScheduleConflict& conflict) {
+    static const char* dayNames[] = {"Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat"};
+    char timeStr[16];
+    uint16_t minuteOfDay = conflict.weekMinute % 1440;
+    sprintf(timeStr, "%s %02d:%02d", dayNames[conflict.weekMinute / 1440], minuteOfDay / 60, minuteOfDay % 60);
+
+    if (conflict.sameZone) {
+        return "zone " + String(conflict.zone) + " already run by schedule " + String(conflict.otherId) + " at " + timeStr;
+    }
+    return "zone " + String(conflict.zone) + " exceeds the concurrent zone/flow limit at " + timeStr +
+           " (" + String(conflict.runningCount) + " zones running)";
+}
+
+String ScheduleManager::getConflictsJSON() {
+    static const uint8_t MAX_REPORTED = 32;
+    static const char* dayNames[] = {"Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat"};
+
+    ScheduleConflict* conflicts = new ScheduleConflict[MAX_REPORTED];
+    uint16_t total = findConflicts(conflicts, MAX_REPORTED);
+
+    String json = "{\"conflicts\":[";
+    for (uint16_t i = 0; conflicts && i < total && i < MAX_REPORTED; i++) {
+        const ScheduleConflict& c = conflicts[i];
+        uint16_t minuteOfDay = c.weekMinute % 1440;
+        char timeStr[8];
+        sprintf(timeStr, "%02d:%02d", minuteOfDay / 60, minuteOfDay % 60);
+
+        if (i > 0) json += ",";
+        json += "{";
+        json += "\"day\":\"" + String(dayNames[c.weekMinute / 1440]) + "\",";
+        json += "\"time\":\"" + String(timeStr) + "\",";
+        json += "\"zone\":" + String(c.zone) + ",";
+        json += "\"schedule_id\":" + String(c.scheduleId) + ",";
+        json += "\"kind\":\"" + String(c.sameZone ? "same_zone" : "over_capacity") + "\",";
+        json += "\"other_schedule_id\":" + String(c.otherId) + ",";
+        json += "\"running_zones\":" + String(c.runningCount);
+        json += "}";
+    }
+    delete[] conflicts;
+
+    json += "],\"count\":" + String(total);
+    json += ",\"windows\":" + String(table->runWindowCount);
+    json += ",\"index_full\":" + String(table->runWindowsFull ? "true" : "false") + "}";
+    return json;
+}
+
 uint8_t ScheduleManager::findFreeScheduleSlot() {
     for (int i = 0; i < MAX_SCHEDULES; i++) {
-        if (schedules[i].id == 0) {
+        if (table->schedules[i].id == 0) {
             return i;
         }
     }
@@ -413,12 +1393,22 @@ uint8_t ScheduleManager::getActiveZoneCount() {
     return count;
 }
 
+uint8_t ScheduleManager::getActiveZoneCountOnBus(uint8_t bus) {
+    uint8_t count = 0;
+    for (int i = 0; i < MAX_ACTIVE_ZONES; i++) {
+        if (activeZones[i].zone != 0 && hunterZoneBus(activeZones[i].zone) == bus) {
+            count++;
+        }
+    }
+    return count;
+}
+
 uint32_t ScheduleManager::getRemainingTime(uint8_t activeIndex) {
     if (activeIndex >= MAX_ACTIVE_ZONES || activeZones[activeIndex].zone == 0) {
         return 0;
     }
 
-    uint32_t elapsed = millis() - activeZones[activeIndex].startTime;
+    uint32_t elapsed = nowMillis() - activeZones[activeIndex].startTime;
     if (elapsed >= activeZones[activeIndex].duration) {
         return 0;
     }
@@ -427,25 +1417,280 @@ uint32_t ScheduleManager::getRemainingTime(uint8_t activeIndex) {
 }
 
 bool ScheduleManager::isTimeMatch(const ScheduleEntry& schedule, const DateTime& now) {
-    // Check day of week (0=Sunday, 6=Saturday)
-    uint8_t dayBit = 1 << now.dayOfTheWeek();
-    if (!(schedule.dayMask & dayBit)) {
-        return false;
+    uint16_t nowMinute = now.hour() * 60 + now.minute();
+    uint32_t cycleStart = schedule.startHour * 60 + schedule.startMinute;
+    uint32_t cycleLength = (uint32_t)schedule.duration + schedule.restMinutes;
+
+    // Each cycle may land on a later day than the first one, so check the
+    // day mask against the day the schedule started (0=Sunday, 6=Saturday)
+    for (uint8_t cycle = 0; cycle < schedule.repeatCount; cycle++) {
+        if (cycleStart % 1440 == nowMinute) {
+            uint8_t startDay = (now.dayOfTheWeek() + 7 - (cycleStart / 1440) % 7) % 7;
+            if (schedule.dayMask & (1 << startDay)) {
+                return true;
+            }
+        }
+        cycleStart += cycleLength;
+    }
+    return false;
+}
+
+uint32_t ScheduleManager::nextOccurrence(const ScheduleEntry& schedule, uint32_t fromUtc, uint8_t* cycle) {
+    if (schedule.id == 0 || !schedule.enabled || schedule.dayMask == 0) return 0;
+
+    int offsetSeconds = getLocalOffsetSeconds();
+    uint32_t localDay = (fromUtc + offsetSeconds) / 86400UL;
+    uint32_t cycleLength = ((uint32_t)schedule.duration + schedule.restMinutes) * 60UL;
+    uint32_t span = (schedule.repeatCount - 1) * cycleLength;
+    uint32_t lookback = span / 86400UL + 1;
+
+    // Cycles from a start a few days back can still be ahead of fromUtc
+    for (uint32_t day = localDay - lookback; day <= localDay + 7; day++) {
+        uint8_t weekday = (day + 4) % 7; // 1970-01-01 was a Thursday
+        if (!(schedule.dayMask & (1 << weekday))) continue;
+
+        uint32_t first = day * 86400UL + schedule.startHour * 3600UL + schedule.startMinute * 60UL - offsetSeconds;
+        for (uint8_t c = 0; c < schedule.repeatCount; c++) {
+            uint32_t t = first + c * cycleLength;
+            if (t < fromUtc) continue;
+            if (schedule.expiryTime > 0 && t > schedule.expiryTime) return 0;
+            if (cycle) *cycle = c;
+            return t;
+        }
+    }
+    return 0;
+}
+
+uint16_t ScheduleManager::expandOccurrences(uint32_t fromUtc, uint32_t toUtc, ScheduleOccurrence* out, uint16_t maxCount, bool* truncated) {
+    uint16_t count = 0;
+    if (truncated) *truncated = false;
+    if (!out || toUtc <= fromUtc) return 0;
+
+    int offsetSeconds = getLocalOffsetSeconds();
+    uint32_t firstDay = (fromUtc + offsetSeconds) / 86400UL;
+    uint32_t lastDay = (toUtc + offsetSeconds) / 86400UL;
+
+    for (uint8_t i = 0; i < MAX_SCHEDULES; i++) {
+        const ScheduleEntry& schedule = table->schedules[i];
+        if (schedule.id == 0 || !schedule.enabled || schedule.dayMask == 0) continue;
+
+        uint32_t cycleLength = ((uint32_t)schedule.duration + schedule.restMinutes) * 60UL;
+        uint32_t lookback = ((schedule.repeatCount - 1) * cycleLength) / 86400UL + 1;
+
+        for (uint32_t day = firstDay - lookback; day <= lastDay; day++) {
+            uint8_t weekday = (day + 4) % 7; // 1970-01-01 was a Thursday
+            if (!(schedule.dayMask & (1 << weekday))) continue;
+
+            uint32_t first = day * 86400UL + schedule.startHour * 3600UL + schedule.startMinute * 60UL - offsetSeconds;
+            for (uint8_t c = 0; c < schedule.repeatCount; c++) {
+                uint32_t t = first + c * cycleLength;
+                if (t < fromUtc || t >= toUtc) continue;
+                if (schedule.expiryTime > 0 && t > schedule.expiryTime) continue;
+
+                if (count >= maxCount) {
+                    if (truncated) *truncated = true;
+                    continue;
+                }
+                out[count].time = t;
+                out[count].slot = i;
+                out[count].cycle = c;
+                count++;
+            }
+        }
     }
 
-    // Check hour and minute
-    return (schedule.startHour == now.hour() && schedule.startMinute == now.minute());
+    // Insertion sort by time; equal times stay in slot order like checkAndExecuteSchedules
+    for (uint16_t i = 1; i < count; i++) {
+        ScheduleOccurrence item = out[i];
+        int16_t j = i - 1;
+        while (j >= 0 && (out[j].time > item.time || (out[j].time == item.time && out[j].slot > item.slot))) {
+            out[j + 1] = out[j];
+            j--;
+        }
+        out[j + 1] = item;
+    }
+    return count;
+}
+
+const ScheduleEntry* ScheduleManager::getScheduleAt(uint8_t slot) const {
+    if (slot >= MAX_SCHEDULES || table->schedules[slot].id == 0) return nullptr;
+    return &table->schedules[slot];
+}
+
+uint32_t ScheduleManager::getMillisUntilNextStop() {
+    uint32_t next = UINT32_MAX;
+    for (uint8_t i = 0; i < MAX_ACTIVE_ZONES; i++) {
+        if (activeZones[i].zone == 0) continue;
+        uint32_t remaining = getRemainingTime(i);
+        if (remaining < next) {
+            next = remaining;
+        }
+    }
+    return next;
 }
 
 uint32_t ScheduleManager::getCurrentUnixTime() {
+    if (unixTimeSource) {
+        return unixTimeSource();
+    }
+
+    if (!rtcModule || !rtcModule->isRunning()) {
+        return 0;
+    }
+
+    DateTime nowUTC = rtcModule->getCurrentTime();
+    return nowUTC.isValid() ? nowUTC.unixtime() : 0;
+}
+
+uint32_t ScheduleManager::nowMillis() {
+    return millisSource ? millisSource() : millis();
+}
+
+int ScheduleManager::getLocalOffsetSeconds() {
     if (!configManager) return 0;
 
-    // This would need to be implemented based on your RTC setup
-    // For now, return a placeholder
-    return millis() / 1000; // Simplified - should use actual RTC time
+    // timezoneOffset is in half-hours (e.g., 19 = UTC+9:30, 21 = UTC+10:30)
+    int offsetSeconds = configManager->getTimezoneOffset() * 1800; // Convert half-hours to seconds
+    if (configManager->isDaylightSaving()) {
+        offsetSeconds += 3600; // Add 1 hour for DST
+    }
+    return offsetSeconds;
+}
+
+void ScheduleManager::setClockSource(uint32_t (*millisFn)(), uint32_t (*unixTimeFn)()) {
+    millisSource = millisFn;
+    unixTimeSource = unixTimeFn;
+}
+
+void ScheduleManager::copySchedulesFrom(const ScheduleManager& other) {
+    // The table carries its server ID and run window indexes along
+    *table = *other.table;
+
+    for (int i = 0; i <= MAX_ZONE_ID; i++) {
+        zoneFlowLpm[i] = other.zoneFlowLpm[i];
+    }
+    revision++;
+}
+
+ScheduleManager* ScheduleManager::createShadow(bool keepAISchedules) {
+    ScheduleManager* shadow = new ScheduleManager();
+    if (!shadow || !shadow->table) {
+        delete shadow;
+        return nullptr;
+    }
+
+    // Same config and clock, no callback: a shadow never drives zones
+    shadow->configManager = configManager;
+    shadow->rtcModule = rtcModule;
+    shadow->millisSource = millisSource;
+    shadow->unixTimeSource = unixTimeSource;
+    shadow->copySchedulesFrom(*this);
+
+    if (!keepAISchedules) {
+        for (uint8_t i = 0; i < MAX_SCHEDULES; i++) {
+            if (shadow->table->schedules[i].id != 0 && shadow->table->schedules[i].type == AI) {
+                shadow->removeSchedule(shadow->table->schedules[i].id);
+            }
+        }
+    }
+    return shadow;
+}
+
+void ScheduleManager::swapScheduleTable(ScheduleManager& shadow) {
+    // One pointer store: the executor sees either the old or the new table, never a mix
+    ScheduleTable* previous = table;
+    table = shadow.table;
+    shadow.table = previous;
+    revision++;
+    purgePendingRuns();
+
+    Serial.printf("ScheduleManager: Schedule table swapped (%d schedules)\n", table->scheduleCount);
+}
+
+void ScheduleManager::takeAISchedulesFrom(const ScheduleManager& other) {
+    for (uint8_t i = 0; i < MAX_SCHEDULES; i++) {
+        if (table->schedules[i].id != 0 && table->schedules[i].type == AI) {
+            table->schedules[i].id = 0;
+            table->schedules[i].serverId = 0;
+            table->schedules[i].enabled = false;
+            table->scheduleCount--;
+        }
+    }
+
+    if (other.table->nextScheduleId > table->nextScheduleId) {
+        table->nextScheduleId = other.table->nextScheduleId;
+    }
+
+    for (uint8_t i = 0; i < MAX_SCHEDULES; i++) {
+        const ScheduleEntry& entry = other.table->schedules[i];
+        if (entry.id == 0 || entry.type != AI) continue;
+
+        uint8_t slot = findFreeScheduleSlot();
+        if (slot >= MAX_SCHEDULES) {
+            Serial.println("ScheduleManager: No free schedule slots");
+            break;
+        }
+
+        // A basic schedule added meanwhile may have been given the same ID
+        bool clash = findScheduleById(entry.id) < MAX_SCHEDULES;
+        table->schedules[slot] = entry;
+        if (clash) {
+            table->schedules[slot].id = table->nextScheduleId++;
+            if (table->nextScheduleId == 0) table->nextScheduleId = 1;
+        }
+        table->scheduleCount++;
+    }
+
+    // Slots moved, so both indexes are rebuilt from scratch
+    rebuildServerIndex();
+    rebuildRunWindows();
+    revision++;
+}
+
+uint8_t ScheduleManager::removeAISchedulesExpiring(uint32_t expiryFrom, uint32_t expiryTo, bool outsideRange) {
+    uint8_t removed = 0;
+    for (uint8_t i = 0; i < MAX_SCHEDULES; i++) {
+        const ScheduleEntry& schedule = table->schedules[i];
+        if (schedule.id == 0 || schedule.type != AI) continue;
+
+        bool inRange = schedule.expiryTime >= expiryFrom && schedule.expiryTime < expiryTo;
+        if (inRange != outsideRange) {
+            removeSchedule(schedule.id);
+            removed++;
+        }
+    }
+    return removed;
+}
+
+uint8_t ScheduleManager::countAISchedulesExpiring(uint32_t expiryFrom, uint32_t expiryTo) const {
+    uint8_t count = 0;
+    for (uint8_t i = 0; i < MAX_SCHEDULES; i++) {
+        const ScheduleEntry& schedule = table->schedules[i];
+        if (schedule.id != 0 && schedule.type == AI &&
+            schedule.expiryTime >= expiryFrom && schedule.expiryTime < expiryTo) {
+            count++;
+        }
+    }
+    return count;
+}
+
+void ScheduleManager::copyStateFrom(const ScheduleManager& other) {
+    copySchedulesFrom(other);
+
+    for (int i = 0; i < MAX_ACTIVE_ZONES; i++) {
+        activeZones[i] = other.activeZones[i];
+    }
+    for (int i = 0; i < other.pendingRunCount; i++) {
+        pendingRuns[i] = other.pendingRuns[i];
+    }
+    pendingRunCount = other.pendingRunCount;
+    lastEvaluatedMinute = other.lastEvaluatedMinute;
+    rainDelayActive = other.rainDelayActive;
+    rainDelayEndTime = other.rainDelayEndTime;
+    scheduleEnabled = other.scheduleEnabled;
 }
 
-void ScheduleManager::setZoneControlCallback(void (*callback)(uint8_t zone, bool state, uint16_t duration, ScheduleType schedType, uint8_t schedId)) {
+void ScheduleManager::setZoneControlCallback(bool (*callback)(uint8_t zone, bool state, uint16_t duration, ScheduleType schedType, uint32_t schedId, uint32_t serverId, RunEndReason reason)) {
     zoneControlCallback = callback;
 }
 
@@ -462,15 +1707,28 @@ bool ScheduleManager::setAIScheduleBatch(const String& jsonSchedules) {
 
 void ScheduleManager::clearAISchedules() {
     for (int i = 0; i < MAX_SCHEDULES; i++) {
-        if (schedules[i].id != 0 && schedules[i].type == AI) {
-            removeSchedule(schedules[i].id);
+        if (table->schedules[i].id != 0 && table->schedules[i].type == AI) {
+            removeSchedule(table->schedules[i].id);
         }
     }
     Serial.println("ScheduleManager: Cleared all AI schedules");
 }
 
 bool ScheduleManager::hasActiveZones() {
-    return getActiveZoneCount() > 0;
+    if (getActiveZoneCount() > 0) return true;
+    for (int zone = 1; zone <= MAX_ZONE_ID; zone++) {
+        if (zoneStopPending[zone]) return true;
+    }
+    return false;
+}
+
+void ScheduleManager::setZoneStopPending(uint8_t zone, bool pending) {
+    if (zone < 1 || zone > MAX_ZONE_ID) return;
+    zoneStopPending[zone] = pending;
+}
+
+bool ScheduleManager::isZoneStopPending(uint8_t zone) const {
+    return zone >= 1 && zone <= MAX_ZONE_ID && zoneStopPending[zone];
 }
 
 // Rain control methods
@@ -482,12 +1740,20 @@ void ScheduleManager::setRainDelay(uint32_t delayMinutes) {
 }
 
 void ScheduleManager::cancelZoneForRain(uint8_t zone) {
+    for (uint8_t i = 0; i < pendingRunCount; ) {
+        if (pendingRuns[i].zone == zone) {
+            removePendingRunAt(i);
+            revision++;
+            Serial.println("ScheduleManager: Queued run of zone " + String(zone) + " cancelled due to rain");
+        } else {
+            i++;
+        }
+    }
+
     int8_t activeIndex = findActiveZone(zone);
     if (activeIndex >= 0) {
-        activeZones[activeIndex].state = RAINCANCELLED;
-        if (zoneControlCallback) {
-            zoneControlCallback(zone, false, 0, BASIC, 0);
-        }
+        revision++;
+        stopZoneSlot(activeIndex, RUN_RAIN_CANCELLED);
         Serial.println("ScheduleManager: Zone " + String(zone) + " cancelled due to rain");
     }
 }
@@ -545,7 +1811,7 @@ String ScheduleManager::getDeviceStatusJSON() {
             zone["status"] = stateStr;
 
             if (activeZones[i].state == RUNNING) {
-                uint32_t elapsed = millis() - activeZones[i].startTime;
+                uint32_t elapsed = nowMillis() - activeZones[i].startTime;
                 uint32_t remaining = (activeZones[i].duration > elapsed) ?
                                    (activeZones[i].duration - elapsed) / 1000 : 0;
                 zone["timeRemaining"] = remaining;
@@ -553,6 +1819,19 @@ String ScheduleManager::getDeviceStatusJSON() {
         }
     }
 
+    // Runs waiting for supply capacity
+    for (uint8_t i = 0; i < pendingRunCount; i++) {
+        JsonObject zone = zones.add<JsonObject>();
+        zone["id"] = pendingRuns[i].zone;
+        zone["status"] = "scheduled";
+    }
+    doc["flowCommittedLpm"] = getCommittedFlowLpm();
+
+    // Fires caught up or lost after loop stalls
+    doc["lateStarts"] = lateStartCount;
+    doc["missedFires"] = missedFireCount;
+    doc["maxLateSeconds"] = maxLateSeconds;
+
     String result;
     serializeJson(doc, result);
     return result;
@@ -561,40 +1840,44 @@ String ScheduleManager::getDeviceStatusJSON() {
 String ScheduleManager::getNextEventJSON() {
     JsonDocument doc;
 
-    // Find next scheduled event
-    // Get current time with timezone
-    DateTime utcTime = rtcModule->getCurrentTime();
-    int offsetSeconds = configManager->getTimezoneOffset() * 1800; // Convert half-hours to seconds
-    if (configManager->isDaylightSaving()) {
-        offsetSeconds += 3600; // Add 1 hour for DST
+    uint32_t nowUTC = getCurrentUnixTime();
+    if (nowUTC == 0) {
+        String result;
+        serializeJson(doc, result);
+        return result;
     }
-    DateTime localTime = DateTime(utcTime.unixtime() + offsetSeconds);
 
-    uint8_t nextZone = 0;
+    uint8_t nextSlot = MAX_SCHEDULES;
+    uint8_t nextCycle = 0;
     uint32_t nextTime = 0;
 
-    // Look through all enabled schedules to find the next one
-    for (int i = 0; i < MAX_SCHEDULES; i++) {
-        if (schedules[i].enabled && schedules[i].id != 0) {
-            // Calculate next occurrence for this schedule
-            // This is simplified - full implementation would check day masks
-            uint32_t scheduleTime = schedules[i].startHour * 3600 + schedules[i].startMinute * 60;
-            uint32_t currentTime = localTime.hour() * 3600 + localTime.minute() * 60;
-
-            if (scheduleTime > currentTime) {
-                if (nextTime == 0 || scheduleTime < nextTime) {
-                    nextTime = scheduleTime;
-                    nextZone = schedules[i].zone;
-                }
-            }
+    // Earliest upcoming cycle across all enabled schedules (day mask and expiry applied)
+    for (uint8_t i = 0; i < MAX_SCHEDULES; i++) {
+        uint8_t cycle = 0;
+        uint32_t t = nextOccurrence(table->schedules[i], nowUTC + 1, &cycle);
+        if (t > 0 && (nextTime == 0 || t < nextTime)) {
+            nextTime = t;
+            nextSlot = i;
+            nextCycle = cycle;
         }
     }
 
-    if (nextZone > 0) {
-        doc["zone"] = nextZone;
+    if (nextSlot < MAX_SCHEDULES) {
+        DateTime local(nextTime + getLocalOffsetSeconds());
         char timeStr[16];
-        sprintf(timeStr, "%02d:%02d", nextTime / 3600, (nextTime % 3600) / 60);
+        char dateStr[16];
+        sprintf(timeStr, "%02d:%02d", local.hour(), local.minute());
+        sprintf(dateStr, "%04d-%02d-%02d", local.year(), local.month(), local.day());
+
+        doc["zone"] = table->schedules[nextSlot].zone;
         doc["time"] = timeStr;
+        doc["date"] = dateStr;
+        doc["duration"] = table->schedules[nextSlot].duration;
+        doc["schedule_id"] = table->schedules[nextSlot].id;
+        if (table->schedules[nextSlot].repeatCount > 1) {
+            doc["cycle"] = nextCycle + 1;
+            doc["cycles"] = table->schedules[nextSlot].repeatCount;
+        }
     }
 
     String result;
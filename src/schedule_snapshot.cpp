@@ -0,0 +1,173 @@
+#include "schedule_snapshot.h"
+#include "schedule_manager.h"
+#include <SPIFFS.h>
+#include <esp32/rom/crc.h>
+#include <stddef.h>
+
+ScheduleSnapshot::ScheduleSnapshot(const char* snapshotPath, const char* tempFile) {
+    path = snapshotPath;
+    tempPath = tempFile;
+    savedCrc = 0;
+    savedCount = 0;
+    savedAt = 0;
+    savedRevision = 0;
+    savedHorizonEnd[0] = '\0';
+    restoreFailures = 0;
+}
+
+bool ScheduleSnapshot::save(const ScheduleManager& manager, uint32_t nowUtc, uint32_t revision, const char* horizonEnd) {
+    Record records[MAX_RECORDS];
+    uint16_t count = 0;
+    for (uint8_t slot = 0; slot < ScheduleManager::getMaxSchedules(); slot++) {
+        const ScheduleEntry* entry = manager.getScheduleAt(slot);
+        if (!entry || entry->type != AI) continue;
+        if (count >= MAX_RECORDS) break;
+
+        Record& record = records[count++];
+        memset(&record, 0, sizeof(record));
+        record.serverId = entry->serverId;
+        record.expiryTime = entry->expiryTime;
+        record.duration = entry->duration;
+        record.restMinutes = entry->restMinutes;
+        record.zone = entry->zone;
+        record.dayMask = entry->dayMask;
+        record.startHour = entry->startHour;
+        record.startMinute = entry->startMinute;
+        record.repeatCount = entry->repeatCount;
+    }
+
+    if (!horizonEnd) {
+        horizonEnd = "";
+    }
+
+    // Same schedules and revision as on flash: nothing to write
+    uint32_t recordsCrc = crc32_le(0, (const uint8_t*)records, count * sizeof(Record));
+    if (savedCrc != 0 && recordsCrc == savedCrc && count == savedCount &&
+        revision == savedRevision && strcmp(horizonEnd, savedHorizonEnd) == 0) {
+        return true;
+    }
+
+    Header header;
+    memset(&header, 0, sizeof(header));
+    header.magic = MAGIC;
+    header.version = VERSION;
+    header.recordSize = sizeof(Record);
+    header.count = count;
+    header.savedAt = nowUtc;
+    header.revision = revision;
+    strncpy(header.horizonEnd, horizonEnd, DATE_SIZE - 1);
+    header.crc = checksum(header, records);
+
+    File file = SPIFFS.open(tempPath, "w");
+    if (!file) {
+        Serial.println("ScheduleSnapshot: Failed to create " + String(tempPath));
+        return false;
+    }
+    size_t written = file.write((const uint8_t*)&header, sizeof(header));
+    written += file.write((const uint8_t*)records, count * sizeof(Record));
+    file.close();
+
+    if (written != sizeof(header) + count * sizeof(Record)) {
+        Serial.println("ScheduleSnapshot: Failed to write snapshot");
+        SPIFFS.remove(tempPath);
+        return false;
+    }
+
+    SPIFFS.remove(path);
+    if (!SPIFFS.rename(tempPath, path)) {
+        Serial.println("ScheduleSnapshot: Failed to replace snapshot");
+        savedCrc = 0;
+        return false;
+    }
+
+    savedCrc = recordsCrc;
+    savedCount = count;
+    savedAt = nowUtc;
+    savedRevision = revision;
+    strncpy(savedHorizonEnd, header.horizonEnd, DATE_SIZE);
+    Serial.printf("ScheduleSnapshot: Saved %u AI schedule(s) at revision %lu, %u bytes\n", count,
+                  (unsigned long)revision, (unsigned)written);
+    return true;
+}
+
+int ScheduleSnapshot::restore(ScheduleManager& target, uint32_t nowUtc) {
+    Header header;
+    Record records[MAX_RECORDS];
+    restoreFailures = 0;
+    if (!load(header, records)) {
+        return -1;
+    }
+
+    int added = 0;
+    uint16_t expired = 0;
+    for (uint16_t i = 0; i < header.count; i++) {
+        const Record& record = records[i];
+        if (nowUtc > 0 && record.expiryTime > 0 && record.expiryTime <= nowUtc) {
+            expired++;
+            continue;
+        }
+        if (target.addAISchedule(record.zone, record.dayMask, record.startHour, record.startMinute,
+                                 record.duration, record.expiryTime, record.serverId,
+                                 record.repeatCount, record.restMinutes) > 0) {
+            added++;
+        } else {
+            restoreFailures++;
+            Serial.printf("ScheduleSnapshot: Could not restore schedule %lu for zone %d\n",
+                          (unsigned long)record.serverId, record.zone);
+        }
+    }
+
+    Serial.printf("ScheduleSnapshot: Restored %d of %u AI schedule(s) (%u expired, %u failed)\n",
+                  added, header.count, expired, restoreFailures);
+    return added;
+}
+
+void ScheduleSnapshot::remove() {
+    SPIFFS.remove(path);
+    SPIFFS.remove(tempPath);
+    savedCrc = 0;
+    savedCount = 0;
+    savedAt = 0;
+    savedRevision = 0;
+    savedHorizonEnd[0] = '\0';
+}
+
+// Read and check the snapshot; records gets header.count entries
+bool ScheduleSnapshot::load(Header& header, Record* records) {
+    File file = SPIFFS.open(path, "r");
+    if (!file) {
+        return false;
+    }
+
+    bool ok = file.read((uint8_t*)&header, sizeof(header)) == sizeof(header);
+    if (ok && (header.magic != MAGIC || header.version != VERSION || header.recordSize != sizeof(Record) ||
+               header.count > MAX_RECORDS)) {
+        // Written by another firmware version: the next fetch replaces it
+        Serial.println("ScheduleSnapshot: Snapshot format not supported, ignoring it");
+        ok = false;
+    }
+    size_t length = ok ? header.count * sizeof(Record) : 0;
+    ok = ok && file.read((uint8_t*)records, length) == length && file.available() == 0;
+    file.close();
+
+    if (ok && checksum(header, records) != header.crc) {
+        Serial.println("ScheduleSnapshot: Snapshot checksum mismatch, ignoring it");
+        ok = false;
+    }
+    if (!ok) {
+        return false;
+    }
+
+    savedCrc = crc32_le(0, (const uint8_t*)records, length);
+    savedCount = header.count;
+    savedAt = header.savedAt;
+    savedRevision = header.revision;
+    strncpy(savedHorizonEnd, header.horizonEnd, DATE_SIZE);
+    savedHorizonEnd[DATE_SIZE - 1] = '\0';
+    return true;
+}
+
+uint32_t ScheduleSnapshot::checksum(const Header& header, const Record* records) {
+    uint32_t crc = crc32_le(0, (const uint8_t*)&header, offsetof(Header, crc));
+    return crc32_le(crc, (const uint8_t*)records, header.count * sizeof(Record));
+}
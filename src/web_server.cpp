@@ -3,7 +3,9 @@
 #include "rtc_module.h"
 #include "config_manager.h"
 #include "schedule_manager.h"
+#include "schedule_forecast.h"
 #include "event_logger.h"
+#include "hunter_bus.h"
 #include "http_client.h"
 #include "mqtt_manager.h"
 #include "build_number.h"
@@ -158,9 +160,15 @@ const char* getMainHTML() {
            "function fetchSchedules(){"
            "document.getElementById('status').textContent='Fetching 5-day schedule...';"
            "fetch('/api/schedules/fetch?days=5',{method:'POST'}).then(response=>response.json()).then(data=>{"
-           "if(data.status=='success'){document.getElementById('status').textContent='Schedule fetched successfully ('+data.days+' days)';updateScheduleInfo();}else{"
+           "if(data.status=='queued'){waitForFetch(data.request_id,0);}else{"
            "document.getElementById('status').textContent='Fetch failed: '+data.message;}}).catch(err=>{"
            "document.getElementById('status').textContent='Fetch error: '+err.message;console.error('Error:',err);});}"
+           "function waitForFetch(id,tries){"
+           "fetch('/api/http/jobs').then(response=>response.json()).then(data=>{"
+           "let job=(data.recent||[]).find(j=>j.id==id);"
+           "if(!job){if(tries<180){setTimeout(()=>waitForFetch(id,tries+1),1000);}return;}"
+           "if(job.status=='ok'){document.getElementById('status').textContent='Schedule fetched successfully ('+job.days+' days)';updateScheduleInfo();}else{"
+           "document.getElementById('status').textContent='Fetch failed: '+(job.error||job.status);}}).catch(err=>console.error('Error:',err));}"
            "function updateScheduleInfo(){"
            "fetch('/api/schedules').then(response=>response.json()).then(data=>{"
            "if(!data.schedules||data.schedules.length==0){document.getElementById('scheduleInfo').innerHTML='<div style=\"padding:10px;text-align:center;color:#999;\">No schedules found</div>';return;}"
@@ -199,11 +207,14 @@ ScheduleManager* HunterWebServer::scheduleManager = nullptr;
 EventLogger* HunterWebServer::eventLogger = nullptr;
 HTTPScheduleClient* HunterWebServer::httpClient = nullptr;
 MQTTManager* HunterWebServer::mqttManager = nullptr;
+ScheduleForecast* HunterWebServer::scheduleForecast = nullptr;
+HunterBus** HunterWebServer::hunterBuses = nullptr;
+uint8_t HunterWebServer::hunterBusCount = 0;
 ZoneSchedule HunterWebServer::schedules[16] = {}; // Initialize all to default values
 int HunterWebServer::activeZones[16] = {}; // All zones start inactive
 unsigned long HunterWebServer::zoneStartTimes[16] = {}; // All start times zero
 int HunterWebServer::zoneDurations[16] = {}; // All durations zero
-char HunterWebServer::zoneLastWatered[49][48] = {};
+char HunterWebServer::zoneLastWatered[HUNTER_MAX_ZONE + 1][48] = {};
 bool HunterWebServer::zoneLastWateredInitialized = false;
 static HunterWebServer* serverInstance = nullptr;
 
@@ -211,7 +222,7 @@ HunterWebServer::HunterWebServer(int port) : server(port) {
     serverInstance = this;
 
     if (!zoneLastWateredInitialized) {
-        for (int i = 0; i < 49; i++) {
+        for (int i = 0; i <= HUNTER_MAX_ZONE; i++) {
             strncpy(zoneLastWatered[i], "Unknown", sizeof(zoneLastWatered[i]) - 1);
             zoneLastWatered[i][sizeof(zoneLastWatered[i]) - 1] = '\0';
         }
@@ -220,7 +231,7 @@ HunterWebServer::HunterWebServer(int port) : server(port) {
 }
 
 void HunterWebServer::setZoneLastWatered(uint8_t zone, const String& timestamp) {
-    if (zone < 1 || zone > 48) return;
+    if (zone < 1 || zone > HUNTER_MAX_ZONE) return;
     strncpy(zoneLastWatered[zone], timestamp.c_str(), sizeof(zoneLastWatered[zone]) - 1);
     zoneLastWatered[zone][sizeof(zoneLastWatered[zone]) - 1] = '\0';
 }
@@ -233,6 +244,9 @@ void HunterWebServer::begin() {
     server.on("/api/start-zone", HTTP_GET, handleStartZone);
     server.on("/api/stop-zone", HTTP_GET, handleStopZone);
     server.on("/api/run-program", HTTP_GET, handleRunProgram);
+    server.on("/api/runplan", HTTP_POST, handleStartRunPlan);
+    server.on("/api/runplan", HTTP_GET, handleGetRunPlan);
+    server.on("/api/runplan", HTTP_DELETE, handleCancelRunPlan);
     server.on("/api/time", HTTP_GET, handleGetTime);
     server.on("/api/status", HTTP_GET, handleGetStatus);
     server.on("/api/set-time", HTTP_POST, handleSetTime);
@@ -247,10 +261,15 @@ void HunterWebServer::begin() {
     server.on("/api/schedules/ai", HTTP_POST, handleSetAISchedules);
     server.on("/api/schedules/ai", HTTP_DELETE, handleClearAISchedules);
     server.on("/api/schedules/fetch", HTTP_POST, handleFetchSchedules);
+    server.on("/api/schedules/conflicts", HTTP_GET, handleGetScheduleConflicts);
 
     // Device status and control endpoints for Node-RED
     server.on("/api/device/status", HTTP_GET, handleGetDeviceStatus);
     server.on("/api/device/next", HTTP_GET, handleGetNextEvent);
+    server.on("/api/bus/stats", HTTP_GET, handleGetBusStats);
+    server.on("/api/http/jobs", HTTP_GET, handleGetHttpJobs);
+    server.on("/api/http/jobs", HTTP_DELETE, handleCancelHttpJob);
+    server.on("/api/device/forecast", HTTP_GET, handleGetForecast);
     server.on("/api/device/command", HTTP_POST, handleDeviceCommand);
 
     // MQTT configuration endpoints
@@ -302,6 +321,9 @@ void HunterWebServer::begin() {
     Serial.println("  GET  /api/start-zone      - Start zone (params: zone, time)");
     Serial.println("  GET  /api/stop-zone       - Stop zone (params: zone)");
     Serial.println("  GET  /api/run-program     - Run program (params: program)");
+    Serial.println("  POST /api/runplan         - Run zones one after another (JSON steps: zone, minutes, gap_seconds)");
+    Serial.println("  GET  /api/runplan         - Get run plan progress");
+    Serial.println("  DELETE /api/runplan       - Cancel the run plan");
     Serial.println("  GET  /api/time            - Get current time");
     Serial.println("  GET  /api/status          - Get system status");
     Serial.println("  GET  /api/sync-ntp        - Sync RTC with NTP time");
@@ -313,7 +335,12 @@ void HunterWebServer::begin() {
     Serial.println("  GET  /api/schedules/active - Get active zones status");
     Serial.println("  POST /api/schedules/ai    - Set AI schedules from Node-RED");
     Serial.println("  DELETE /api/schedules/ai  - Clear AI schedules");
-    Serial.println("  POST /api/schedules/fetch - Fetch schedules from server");
+    Serial.println("  POST /api/schedules/fetch - Queue a schedule fetch from the server");
+    Serial.println("  GET  /api/schedules/conflicts - List planned schedule overlaps");
+    Serial.println("  GET  /api/device/forecast - Planned zone runs for the next hours (params: hours)");
+    Serial.println("  GET  /api/bus/stats       - Bus queue counters and pulse timing jitter");
+    Serial.println("  GET  /api/http/jobs       - Background server requests and their recent results");
+    Serial.println("  DELETE /api/http/jobs     - Cancel a background server request (params: id)");
     Serial.println("  GET  /api/events          - Get watering event logs");
     Serial.println("  DELETE /api/events        - Clear event logs");
     Serial.println("  GET  /api/events/stats    - Get event statistics");
@@ -382,8 +409,8 @@ void HunterWebServer::processCommands() {
     int zoneNum = zone.toInt();
     int timeMin = time.toInt();
 
-    if (zoneNum < 1 || zoneNum > 48) {
-        String jsonError = "{\"status\":\"error\",\"message\":\"Zone must be 1-48\"}";
+    if (zoneNum < 1 || zoneNum > HUNTER_MAX_ZONE) {
+        String jsonError = "{\"status\":\"error\",\"message\":\"Zone must be 1-" + String(HUNTER_MAX_ZONE) + "\"}";
         serverInstance->server.send(400, "application/json", jsonError);
         return;
     }
@@ -472,8 +499,8 @@ void HunterWebServer::handleStopZone() {
 
     int zoneNum = zone.toInt();
 
-    if (zoneNum < 1 || zoneNum > 48) {
-        String jsonError = "{\"status\":\"error\",\"message\":\"Zone must be 1-48\"}";
+    if (zoneNum < 1 || zoneNum > HUNTER_MAX_ZONE) {
+        String jsonError = "{\"status\":\"error\",\"message\":\"Zone must be 1-" + String(HUNTER_MAX_ZONE) + "\"}";
         serverInstance->server.send(400, "application/json", jsonError);
         return;
     }
@@ -487,14 +514,10 @@ void HunterWebServer::handleStopZone() {
 
     // Use ScheduleManager if available, otherwise fallback to old method
     if (scheduleManager) {
+        // The zone control callback ends the zone's event as interrupted
         bool success = scheduleManager->stopZone(zoneNum);
 
         if (success) {
-            // Log event completion (interrupted since stopped manually)
-            if (eventLogger) {
-                eventLogger->logEventEnd(0, false); // false = interrupted
-            }
-
             String jsonResponse = "{\"status\":\"success\",\"message\":\"Zone " + String(zoneNum) + " stopped\",\"zone\":" + String(zoneNum) + "}";
             serverInstance->server.send(200, "application/json", jsonResponse);
             Serial.println("API: Zone " + String(zoneNum) + " stopped");
@@ -534,6 +557,109 @@ void HunterWebServer::handleStopZone() {
     Serial.println("API: Zone " + String(zoneNum) + " stopped");
 }
 
+void HunterWebServer::handleStartRunPlan() {
+    if (!serverInstance) return;
+
+    if (!scheduleManager || !configManager) {
+        String jsonError = "{\"status\":\"error\",\"message\":\"Schedule manager not available\"}";
+        serverInstance->server.send(500, "application/json", jsonError);
+        return;
+    }
+
+    String body = serverInstance->server.arg("plain");
+    JsonDocument doc;
+    DeserializationError error = deserializeJson(doc, body);
+    if (error) {
+        String jsonError = "{\"status\":\"error\",\"message\":\"Invalid JSON: " + String(error.c_str()) + "\"}";
+        serverInstance->server.send(400, "application/json", jsonError);
+        return;
+    }
+
+    JsonArray stepList = doc["steps"].as<JsonArray>();
+    if (stepList.isNull() || stepList.size() == 0 || stepList.size() > ScheduleManager::MAX_RUN_PLAN_STEPS) {
+        String jsonError = "{\"status\":\"error\",\"message\":\"steps must list 1-" + String(ScheduleManager::MAX_RUN_PLAN_STEPS) + " runs\"}";
+        serverInstance->server.send(400, "application/json", jsonError);
+        return;
+    }
+
+    // Gap between runs applies to steps that don't set their own
+    int defaultGap = doc["gap_seconds"] | 0;
+
+    RunPlanStep steps[ScheduleManager::MAX_RUN_PLAN_STEPS];
+    uint8_t count = 0;
+    for (JsonObject item : stepList) {
+        int zoneNum = item["zone"] | 0;
+        int minutes = item["minutes"] | 0;
+        int gap = item["gap_seconds"] | defaultGap;
+
+        if (zoneNum < 1 || zoneNum > HUNTER_MAX_ZONE || minutes < 1 || minutes > 240 || gap < 0 || gap > 3600) {
+            String jsonError = "{\"status\":\"error\",\"message\":\"Step " + String(count + 1) + ": zone 1-" + String(HUNTER_MAX_ZONE) + ", minutes 1-240, gap_seconds 0-3600\"}";
+            serverInstance->server.send(400, "application/json", jsonError);
+            return;
+        }
+        if (!configManager->isZoneEnabled(zoneNum)) {
+            String jsonError = "{\"status\":\"error\",\"message\":\"Zone " + String(zoneNum) + " is not enabled. Maximum enabled zones: " + String(configManager->getMaxEnabledZones()) + "\"}";
+            serverInstance->server.send(403, "application/json", jsonError);
+            return;
+        }
+
+        steps[count].zone = zoneNum;
+        steps[count].minutes = minutes;
+        steps[count].gapSeconds = gap;
+        count++;
+    }
+
+    if (scheduleManager->isRunPlanActive()) {
+        String jsonError = "{\"status\":\"error\",\"message\":\"A run plan is already active, cancel it first\",\"plan\":" + scheduleManager->getRunPlanJSON() + "}";
+        serverInstance->server.send(409, "application/json", jsonError);
+        return;
+    }
+
+    uint32_t planId = scheduleManager->startRunPlan(steps, count);
+    if (planId == 0) {
+        String jsonError = "{\"status\":\"error\",\"message\":\"Run plan rejected\"}";
+        serverInstance->server.send(400, "application/json", jsonError);
+        return;
+    }
+
+    String jsonResponse = "{\"status\":\"success\",\"plan_id\":" + String(planId) + ",\"plan\":" + scheduleManager->getRunPlanJSON() + "}";
+    serverInstance->server.send(200, "application/json", jsonResponse);
+    Serial.println("API: Run plan " + String(planId) + " started with " + String(count) + " steps");
+}
+
+void HunterWebServer::handleGetRunPlan() {
+    if (!serverInstance) return;
+
+    if (!scheduleManager) {
+        String jsonError = "{\"status\":\"error\",\"message\":\"Schedule manager not available\"}";
+        serverInstance->server.send(500, "application/json", jsonError);
+        return;
+    }
+
+    String jsonResponse = "{\"status\":\"success\",\"plan\":" + scheduleManager->getRunPlanJSON() + "}";
+    serverInstance->server.send(200, "application/json", jsonResponse);
+}
+
+void HunterWebServer::handleCancelRunPlan() {
+    if (!serverInstance) return;
+
+    if (!scheduleManager) {
+        String jsonError = "{\"status\":\"error\",\"message\":\"Schedule manager not available\"}";
+        serverInstance->server.send(500, "application/json", jsonError);
+        return;
+    }
+
+    if (!scheduleManager->cancelRunPlan()) {
+        String jsonError = "{\"status\":\"error\",\"message\":\"No run plan is active\"}";
+        serverInstance->server.send(404, "application/json", jsonError);
+        return;
+    }
+
+    String jsonResponse = "{\"status\":\"success\",\"message\":\"Run plan cancelled\",\"plan\":" + scheduleManager->getRunPlanJSON() + "}";
+    serverInstance->server.send(200, "application/json", jsonResponse);
+    Serial.println("API: Run plan cancelled");
+}
+
 void HunterWebServer::handleRunProgram() {
     if (!serverInstance) return;
 
@@ -643,6 +769,7 @@ void HunterWebServer::handleGetStatus() {
     // Zone details (from server /api/zonedetails), if available
     if (httpClient) {
         jsonResponse += ",\"zonedetails\":" + httpClient->getZoneDetailsJSON();
+        jsonResponse += ",\"server_circuits\":" + httpClient->getBreakerJSON();
     }
 
     // Volatile last-watered per zone (since boot)
@@ -783,6 +910,8 @@ void HunterWebServer::handleSetConfig() {
                 return doc[key].as<bool>() ? "true" : "false";
             } else if (doc[key].is<int>()) {
                 return String(doc[key].as<int>());
+            } else if (doc[key].is<float>()) {
+                return String(doc[key].as<float>(), 2);
             }
             return "";
         } else {
@@ -1017,6 +1146,26 @@ void HunterWebServer::handleSetConfig() {
         configChanged = true;
     }
 
+    String supplyCapacityStr = getParam("supply_capacity_lpm");
+    if (supplyCapacityStr.length() > 0) {
+        float capacity = supplyCapacityStr.toFloat();
+        if (capacity >= 0 && capacity <= 2000) {
+            configManager->setSupplyCapacityLpm(capacity);
+            response += "- Supply Capacity: " + String(capacity, 1) + " L/min\n";
+            configChanged = true;
+        }
+    }
+
+    String graceStr = getParam("missed_fire_grace_min");
+    if (graceStr.length() > 0) {
+        int grace = graceStr.toInt();
+        if (grace >= 0 && grace <= 240) {
+            configManager->setMissedFireGraceMinutes(grace);
+            response += "- Missed Fire Grace: " + String(grace) + " minutes\n";
+            configChanged = true;
+        }
+    }
+
     if (configChanged) {
         if (configManager->saveConfig()) {
             String jsonResponse = "{\"status\":\"success\",\"message\":\"Configuration updated successfully\",\"config\":" + configManager->getConfigJSON() + "}";
@@ -1195,16 +1344,26 @@ void HunterWebServer::handleCreateSchedule() {
     uint8_t minute = serverInstance->server.arg("minute").toInt();
     uint16_t duration = serverInstance->server.arg("duration").toInt();
     uint8_t dayMask = serverInstance->server.hasArg("days") ? serverInstance->server.arg("days").toInt() : 0b1111111; // Default: every day
+    int repeat = serverInstance->server.hasArg("repeat") ? serverInstance->server.arg("repeat").toInt() : 1;  // Cycle/soak cycles
+    int rest = serverInstance->server.hasArg("rest") ? serverInstance->server.arg("rest").toInt() : 0;        // Soak minutes between cycles
 
-    if (zone < 1 || zone > 16 || hour > 23 || minute > 59 || duration < 1 || duration > 1440) {
+    if (zone < 1 || zone > 16 || hour > 23 || minute > 59 || duration < 1 || duration > 1440 ||
+        repeat < 1 || repeat > 10 || rest < 0 || rest > 1440) {
         String jsonError = "{\"status\":\"error\",\"message\":\"Invalid parameter values\"}";
         serverInstance->server.send(400, "application/json", jsonError);
         return;
     }
 
-    uint8_t scheduleId = scheduleManager->addBasicSchedule(zone, dayMask, hour, minute, duration);
+    // Overlapping basic schedules are refused by the add itself (zone stays 0 otherwise)
+    ScheduleConflict conflict;
+    conflict.zone = 0;
+    uint32_t scheduleId = scheduleManager->addBasicSchedule(zone, dayMask, hour, minute, duration, repeat, rest, &conflict);
 
-    if (scheduleId > 0) {
+    if (scheduleId == 0 && conflict.zone != 0) {
+        String jsonError = "{\"status\":\"error\",\"message\":\"Schedule overlaps: " +
+                           ScheduleManager::describeConflict(conflict) + "\"}";
+        serverInstance->server.send(409, "application/json", jsonError);
+    } else if (scheduleId > 0) {
         String jsonResponse = "{\"status\":\"success\",\"message\":\"Schedule created\",\"schedule_id\":" + String(scheduleId) + "}";
         serverInstance->server.send(201, "application/json", jsonResponse);
     } else {
@@ -1213,6 +1372,19 @@ void HunterWebServer::handleCreateSchedule() {
     }
 }
 
+void HunterWebServer::handleGetScheduleConflicts() {
+    if (!serverInstance) return;
+
+    if (!scheduleManager) {
+        String jsonError = "{\"status\":\"error\",\"message\":\"Schedule manager not available\"}";
+        serverInstance->server.send(500, "application/json", jsonError);
+        return;
+    }
+
+    String jsonResponse = scheduleManager->getConflictsJSON();
+    serverInstance->server.send(200, "application/json", jsonResponse);
+}
+
 void HunterWebServer::handleGetActiveZones() {
     if (!serverInstance) return;
 
@@ -1267,6 +1439,9 @@ void HunterWebServer::handleClearAISchedules() {
     }
 
     scheduleManager->clearAISchedules();
+    if (httpClient) {
+        httpClient->clearScheduleSnapshot();    // So they don't come back after a reset
+    }
     String jsonResponse = "{\"status\":\"success\",\"message\":\"AI schedules cleared\"}";
     serverInstance->server.send(200, "application/json", jsonResponse);
     Serial.println("API: AI schedules cleared");
@@ -1313,6 +1488,55 @@ void HunterWebServer::handleGetNextEvent() {
     Serial.println("API: Next event requested");
 }
 
+void HunterWebServer::handleGetBusStats() {
+    if (!serverInstance) return;
+
+    if (!hunterBuses || hunterBusCount == 0) {
+        String jsonError = "{\"status\":\"error\",\"message\":\"Hunter bus not available\"}";
+        serverInstance->server.send(500, "application/json", jsonError);
+        return;
+    }
+
+    String jsonResponse = "{\"buses\":[";
+    for (uint8_t i = 0; i < hunterBusCount; i++) {
+        if (i > 0) jsonResponse += ",";
+        jsonResponse += hunterBuses[i]->getStatsJSON();
+    }
+    jsonResponse += "]}";
+    serverInstance->server.send(200, "application/json", jsonResponse);
+}
+
+void HunterWebServer::handleGetForecast() {
+    if (!serverInstance) return;
+
+    if (!scheduleForecast || !rtcModule || !rtcModule->isRunning()) {
+        String jsonError = "{\"status\":\"error\",\"message\":\"Forecast not available\"}";
+        serverInstance->server.send(500, "application/json", jsonError);
+        return;
+    }
+
+    int hours = 24;
+    if (serverInstance->server.hasArg("hours")) {
+        hours = serverInstance->server.arg("hours").toInt();
+    }
+    if (hours < 1 || hours > ScheduleForecast::MAX_HOURS) {
+        String jsonError = "{\"status\":\"error\",\"message\":\"Invalid hours (1-" + String(ScheduleForecast::MAX_HOURS) + ")\"}";
+        serverInstance->server.send(400, "application/json", jsonError);
+        return;
+    }
+
+    uint32_t now = rtcModule->getCurrentTime().unixtime();
+    if (!scheduleForecast->refresh(now, hours)) {
+        String jsonError = "{\"status\":\"error\",\"message\":\"Forecast failed\"}";
+        serverInstance->server.send(500, "application/json", jsonError);
+        return;
+    }
+
+    String forecast = scheduleForecast->getForecastJSON(now, hours);
+    serverInstance->server.send(200, "application/json", forecast);
+    Serial.println("API: Forecast requested (" + String(hours) + " h)");
+}
+
 void HunterWebServer::handleDeviceCommand() {
     if (!serverInstance) return;
 
@@ -1378,19 +1602,64 @@ void HunterWebServer::handleFetchSchedules() {
 
     Serial.println("API: Manual schedule fetch triggered (" + String(days) + " days)");
 
-    // Trigger the fetch in the background
-    bool success = httpClient->fetchSchedule(days);
+    // Runs on the HTTP worker; the result shows up in /api/http/jobs
+    uint32_t requestId = httpClient->submitScheduleFetch(days);
+    if (requestId == 0) {
+        String jsonError = "{\"status\":\"error\",\"message\":\"Request queue full, try again later\"}";
+        serverInstance->server.send(503, "application/json", jsonError);
+        Serial.println("API: Schedule fetch not queued");
+        return;
+    }
 
-    if (success) {
-        String jsonResponse = "{\"status\":\"success\",\"message\":\"Schedules fetched successfully\",\"days\":" + String(days) + "}";
-        serverInstance->server.send(200, "application/json", jsonResponse);
-        Serial.println("API: Schedule fetch completed successfully");
-    } else {
-        String error = httpClient->getLastError();
-        String jsonError = "{\"status\":\"error\",\"message\":\"Schedule fetch failed\",\"error\":\"" + error + "\"}";
+    String jsonResponse = "{\"status\":\"queued\",\"request_id\":" + String(requestId) +
+                          ",\"days\":" + String(days) +
+                          ",\"last_requests\":" + String(httpClient->getLastFetchRequestCount()) +
+                          ",\"last_fetch_ms\":" + String(httpClient->getLastFetchDuration()) +
+                          ",\"range_supported\":" + String(httpClient->isRangeFetchSupported() ? "true" : "false") +
+                          ",\"revision\":" + String(httpClient->getScheduleRevision()) + "}";
+    serverInstance->server.send(202, "application/json", jsonResponse);
+}
+
+void HunterWebServer::handleGetHttpJobs() {
+    if (!serverInstance) return;
+
+    serverInstance->server.sendHeader("Access-Control-Allow-Origin", "*");
+
+    if (!httpClient) {
+        String jsonError = "{\"status\":\"error\",\"message\":\"HTTP client not available\"}";
         serverInstance->server.send(500, "application/json", jsonError);
-        Serial.println("API: Schedule fetch failed - " + error);
+        return;
     }
+
+    serverInstance->server.send(200, "application/json", httpClient->getWorkerStatusJSON());
+}
+
+void HunterWebServer::handleCancelHttpJob() {
+    if (!serverInstance) return;
+
+    serverInstance->server.sendHeader("Access-Control-Allow-Origin", "*");
+
+    if (!httpClient) {
+        String jsonError = "{\"status\":\"error\",\"message\":\"HTTP client not available\"}";
+        serverInstance->server.send(500, "application/json", jsonError);
+        return;
+    }
+
+    uint32_t requestId = serverInstance->server.hasArg("id") ? serverInstance->server.arg("id").toInt() : 0;
+    if (requestId == 0) {
+        String jsonError = "{\"status\":\"error\",\"message\":\"Missing request id\"}";
+        serverInstance->server.send(400, "application/json", jsonError);
+        return;
+    }
+
+    if (!httpClient->cancelRequest(requestId)) {
+        String jsonError = "{\"status\":\"error\",\"message\":\"Request not found or already finished\"}";
+        serverInstance->server.send(404, "application/json", jsonError);
+        return;
+    }
+
+    String jsonResponse = "{\"status\":\"success\",\"message\":\"Request cancelled\",\"request_id\":" + String(requestId) + "}";
+    serverInstance->server.send(200, "application/json", jsonResponse);
 }
 
 // MQTT configuration handlers
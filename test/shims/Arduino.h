@@ -0,0 +1,282 @@
+#ifndef ARDUINO_SHIM_H
+#define ARDUINO_SHIM_H
+
+// Just enough of the Arduino ESP32 core to build the hardware-independent
+// sources on the host for `pio test -e native`. Time is virtual: it only
+// moves through delay(), delayMicroseconds() and reads of the cycle counter,
+// and every digitalWrite() is recorded with its timestamp so a test can
+// rebuild the waveform that would have gone out on a pin.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <math.h>
+#include <time.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH 0x1
+#define LOW 0x0
+#define INPUT 0x01
+#define OUTPUT 0x03
+
+#define DEC 10
+#define HEX 16
+
+#define F(string_literal) (string_literal)
+#define PROGMEM
+#define IRAM_ATTR
+
+using std::max;
+using std::min;
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+class String {
+public:
+    String(const char* cstr = "") : buffer(cstr ? cstr : "") {}
+    String(const std::string& str) : buffer(str) {}
+    explicit String(char c) : buffer(1, c) {}
+    explicit String(unsigned char value, unsigned char base = 10) : String((unsigned long)value, base) {}
+    explicit String(int value, unsigned char base = 10) : String((long)value, base) {}
+    explicit String(unsigned int value, unsigned char base = 10) : String((unsigned long)value, base) {}
+    explicit String(long value, unsigned char base = 10) {
+        char text[34];
+        snprintf(text, sizeof(text), base == 16 ? "%lx" : "%ld", value);
+        buffer = text;
+    }
+    explicit String(unsigned long value, unsigned char base = 10) {
+        char text[34];
+        snprintf(text, sizeof(text), base == 16 ? "%lx" : "%lu", value);
+        buffer = text;
+    }
+    explicit String(long long value) : buffer(std::to_string(value)) {}
+    explicit String(unsigned long long value) : buffer(std::to_string(value)) {}
+    explicit String(float value, unsigned char decimals = 2) : String((double)value, decimals) {}
+    explicit String(double value, unsigned char decimals = 2) {
+        char text[64];
+        snprintf(text, sizeof(text), "%.*f", decimals, value);
+        buffer = text;
+    }
+
+    const char* c_str() const { return buffer.c_str(); }
+    unsigned int length() const { return buffer.size(); }
+    bool isEmpty() const { return buffer.empty(); }
+    bool reserve(unsigned int size) { buffer.reserve(size); return true; }
+    explicit operator bool() const { return true; }
+
+    bool concat(const String& str) { buffer += str.buffer; return true; }
+    bool concat(const char* cstr) { if (cstr) buffer += cstr; return cstr != nullptr; }
+    bool concat(const char* cstr, unsigned int length) { if (cstr) buffer.append(cstr, length); return cstr != nullptr; }
+    bool concat(char c) { buffer += c; return true; }
+    String& operator+=(const String& rhs) { concat(rhs); return *this; }
+    String& operator+=(const char* cstr) { concat(cstr); return *this; }
+    String& operator+=(char c) { concat(c); return *this; }
+
+    bool equals(const String& str) const { return buffer == str.buffer; }
+    bool equalsIgnoreCase(const String& str) const { return strcasecmp(c_str(), str.c_str()) == 0; }
+    bool operator==(const String& rhs) const { return buffer == rhs.buffer; }
+    bool operator==(const char* cstr) const { return buffer == (cstr ? cstr : ""); }
+    bool operator!=(const String& rhs) const { return !(*this == rhs); }
+    bool operator!=(const char* cstr) const { return !(*this == cstr); }
+    bool operator<(const String& rhs) const { return buffer < rhs.buffer; }
+    bool startsWith(const String& prefix) const { return buffer.compare(0, prefix.buffer.size(), prefix.buffer) == 0; }
+    bool endsWith(const String& suffix) const {
+        return buffer.size() >= suffix.buffer.size() &&
+               buffer.compare(buffer.size() - suffix.buffer.size(), suffix.buffer.size(), suffix.buffer) == 0;
+    }
+
+    char charAt(unsigned int index) const { return index < buffer.size() ? buffer[index] : 0; }
+    char operator[](unsigned int index) const { return charAt(index); }
+    int indexOf(char c, unsigned int from = 0) const { return position(buffer.find(c, from)); }
+    int indexOf(const String& str, unsigned int from = 0) const { return position(buffer.find(str.buffer, from)); }
+    int lastIndexOf(char c) const { return position(buffer.rfind(c)); }
+    String substring(unsigned int from) const { return from < buffer.size() ? String(buffer.substr(from)) : String(); }
+    String substring(unsigned int from, unsigned int to) const {
+        if (from > to) std::swap(from, to);
+        return from < buffer.size() ? String(buffer.substr(from, to - from)) : String();
+    }
+
+    void replace(const String& find, const String& replacement) {
+        if (find.buffer.empty()) return;
+        for (size_t at = buffer.find(find.buffer); at != std::string::npos;
+             at = buffer.find(find.buffer, at + replacement.buffer.size())) {
+            buffer.replace(at, find.buffer.size(), replacement.buffer);
+        }
+    }
+    void remove(unsigned int index) { if (index < buffer.size()) buffer.erase(index); }
+    void remove(unsigned int index, unsigned int count) { if (index < buffer.size()) buffer.erase(index, count); }
+    void toLowerCase() { for (char& c : buffer) c = tolower(c); }
+    void toUpperCase() { for (char& c : buffer) c = toupper(c); }
+    void trim() {
+        size_t first = buffer.find_first_not_of(" \t\r\n");
+        buffer = first == std::string::npos ? std::string() : buffer.substr(first, buffer.find_last_not_of(" \t\r\n") - first + 1);
+    }
+    long toInt() const { return atol(c_str()); }
+    float toFloat() const { return atof(c_str()); }
+
+private:
+    std::string buffer;
+
+    static int position(size_t at) { return at == std::string::npos ? -1 : (int)at; }
+};
+
+// ArduinoJson looks for this type next to String
+class StringSumHelper : public String {
+public:
+    using String::String;
+};
+
+inline String operator+(const String& lhs, const String& rhs) { String result(lhs); result += rhs; return result; }
+inline String operator+(const String& lhs, const char* rhs) { String result(lhs); result += rhs; return result; }
+inline String operator+(const char* lhs, const String& rhs) { String result(lhs); result += rhs; return result; }
+inline String operator+(const String& lhs, char rhs) { String result(lhs); result += rhs; return result; }
+
+class Print {
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t* data, size_t size) {
+        for (size_t i = 0; i < size; i++) write(data[i]);
+        return size;
+    }
+
+    size_t print(const String& str) { return write((const uint8_t*)str.c_str(), str.length()); }
+    size_t print(const char* cstr) { return write((const uint8_t*)cstr, strlen(cstr)); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(int value, int base = DEC) { return print(String(value, (unsigned char)base)); }
+    size_t print(unsigned int value, int base = DEC) { return print(String(value, (unsigned char)base)); }
+    size_t print(long value, int base = DEC) { return print(String(value, (unsigned char)base)); }
+    size_t print(unsigned long value, int base = DEC) { return print(String(value, (unsigned char)base)); }
+    size_t print(unsigned char value, int base = DEC) { return print(String(value, (unsigned char)base)); }
+    size_t print(double value, int decimals = 2) { return print(String(value, (unsigned char)decimals)); }
+
+    size_t println() { return print("\n"); }
+    template <typename T>
+    size_t println(const T& value) { return print(value) + println(); }
+    template <typename T>
+    size_t println(const T& value, int format) { return print(value, format) + println(); }
+
+    size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3))) {
+        char text[512];
+        va_list args;
+        va_start(args, format);
+        int length = vsnprintf(text, sizeof(text), format, args);
+        va_end(args);
+        print(text);
+        return length;
+    }
+};
+
+class Stream : public Print {
+public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+    void setTimeout(unsigned long) {}
+
+    // No timeout to wait out: stops at the first byte that isn't there
+    size_t readBytes(char* buffer, size_t length) {
+        size_t count = 0;
+        while (count < length) {
+            int c = read();
+            if (c < 0) break;
+            buffer[count++] = (char)c;
+        }
+        return count;
+    }
+    size_t readBytes(uint8_t* buffer, size_t length) { return readBytes((char*)buffer, length); }
+};
+
+// Serial output goes to stdout unless a test silences it
+class HardwareSerial : public Stream {
+public:
+    bool muted = false;
+
+    void begin(unsigned long) {}
+    size_t write(uint8_t c) override { if (!muted) putchar(c); return 1; }
+    using Print::write;
+    int available() override { return 0; }
+    int read() override { return -1; }
+    int peek() override { return -1; }
+};
+
+inline HardwareSerial Serial;
+
+// Virtual clock and pin recorder
+namespace ArduinoShim {
+
+struct PinWrite {
+    uint8_t pin;
+    uint8_t level;
+    uint64_t atMicros;
+};
+
+inline uint64_t clockMicros = 0;
+inline std::vector<PinWrite> pinWrites;
+inline uint8_t pinLevels[64] = {};
+
+// Start a test from time zero with no recorded writes
+inline void reset() {
+    clockMicros = 0;
+    pinWrites.clear();
+    memset(pinLevels, 0, sizeof(pinLevels));
+}
+
+inline void advanceMicros(uint64_t micros) { clockMicros += micros; }
+
+} // namespace ArduinoShim
+
+inline unsigned long millis() { return (unsigned long)(ArduinoShim::clockMicros / 1000); }
+inline unsigned long micros() { return (unsigned long)ArduinoShim::clockMicros; }
+inline void delay(unsigned long ms) { ArduinoShim::advanceMicros((uint64_t)ms * 1000); }
+inline void delayMicroseconds(unsigned int us) { ArduinoShim::advanceMicros(us); }
+inline void yield() {}
+
+inline void pinMode(uint8_t, uint8_t) {}
+inline void digitalWrite(uint8_t pin, uint8_t level) {
+    level = level ? HIGH : LOW;
+    ArduinoShim::pinLevels[pin & 63] = level;
+    ArduinoShim::pinWrites.push_back({pin, level, ArduinoShim::clockMicros});
+}
+inline int digitalRead(uint8_t pin) { return ArduinoShim::pinLevels[pin & 63]; }
+
+inline long random(long howBig) { return howBig > 0 ? rand() % howBig : 0; }
+inline long random(long howSmall, long howBig) { return howSmall >= howBig ? howSmall : howSmall + random(howBig - howSmall); }
+inline void randomSeed(unsigned long seed) { srand(seed); }
+inline uint32_t esp_random() { return (uint32_t)rand(); }
+
+// Critical sections have nothing to guard on the host
+typedef int portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED 0
+#define portENTER_CRITICAL(mux) ((void)(mux))
+#define portEXIT_CRITICAL(mux) ((void)(mux))
+
+class EspClass {
+public:
+    static const uint32_t CPU_MHZ = 240;
+
+    uint32_t getCpuFreqMHz() { return CPU_MHZ; }
+    // Each read moves the virtual clock one microsecond, so loops that spin
+    // on the cycle counter finish and measure the width they waited for
+    uint32_t getCycleCount() {
+        ArduinoShim::advanceMicros(1);
+        return (uint32_t)(ArduinoShim::clockMicros * CPU_MHZ);
+    }
+    uint32_t getFreeHeap() { return 200000; }
+    uint32_t getMaxAllocHeap() { return 110000; }
+    void restart() {}
+};
+
+inline EspClass ESP;
+
+// SNTP is never reached on the host; the local clock stays unset
+inline void configTime(long, int, const char*, const char* = nullptr, const char* = nullptr) {}
+inline bool getLocalTime(struct tm*, uint32_t = 5000) { return false; }
+
+#endif // ARDUINO_SHIM_H
@@ -0,0 +1,27 @@
+#ifndef FS_SHIM_H
+#define FS_SHIM_H
+
+// A file that keeps what is written to it in memory
+#include <Arduino.h>
+
+namespace fs {
+class File : public Stream {
+public:
+    std::string contents;
+
+    size_t write(uint8_t c) override { contents += (char)c; return 1; }
+    size_t write(const uint8_t* data, size_t size) override {
+        contents.append((const char*)data, size);
+        return size;
+    }
+    int available() override { return 0; }
+    int read() override { return -1; }
+    int peek() override { return -1; }
+    void close() {}
+    operator bool() const { return true; }
+};
+} // namespace fs
+
+using fs::File;
+
+#endif // FS_SHIM_H
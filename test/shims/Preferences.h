@@ -0,0 +1,63 @@
+#ifndef PREFERENCES_SHIM_H
+#define PREFERENCES_SHIM_H
+
+// In-memory NVS for the native tests: keys live as long as the process
+#include <Arduino.h>
+#include <map>
+
+class Preferences {
+public:
+    bool begin(const char* name, bool readOnly = false) {
+        (void)readOnly;
+        space = &store()[name];
+        return true;
+    }
+    void end() { space = nullptr; }
+    bool clear() { if (space) space->clear(); return space != nullptr; }
+    bool remove(const char* key) { return space && space->erase(key) > 0; }
+    bool isKey(const char* key) { return space && space->count(key) > 0; }
+
+    size_t putBytes(const char* key, const void* value, size_t length) {
+        if (!space) return 0;
+        (*space)[key].assign((const uint8_t*)value, (const uint8_t*)value + length);
+        return length;
+    }
+    size_t getBytesLength(const char* key) {
+        return isKey(key) ? (*space)[key].size() : 0;
+    }
+    size_t getBytes(const char* key, void* buffer, size_t maxLength) {
+        size_t length = getBytesLength(key);
+        if (length == 0 || length > maxLength) return 0;
+        memcpy(buffer, (*space)[key].data(), length);
+        return length;
+    }
+
+    size_t putUInt(const char* key, uint32_t value) { return putBytes(key, &value, sizeof(value)); }
+    uint32_t getUInt(const char* key, uint32_t defaultValue = 0) { return get(key, defaultValue); }
+    size_t putInt(const char* key, int32_t value) { return putBytes(key, &value, sizeof(value)); }
+    int32_t getInt(const char* key, int32_t defaultValue = 0) { return get(key, defaultValue); }
+    size_t putFloat(const char* key, float value) { return putBytes(key, &value, sizeof(value)); }
+    float getFloat(const char* key, float defaultValue = NAN) { return get(key, defaultValue); }
+    size_t putUChar(const char* key, uint8_t value) { return putBytes(key, &value, sizeof(value)); }
+    uint8_t getUChar(const char* key, uint8_t defaultValue = 0) { return get(key, defaultValue); }
+    size_t putBool(const char* key, bool value) { return putUChar(key, value ? 1 : 0); }
+    bool getBool(const char* key, bool defaultValue = false) { return getUChar(key, defaultValue ? 1 : 0) != 0; }
+
+private:
+    typedef std::map<std::string, std::vector<uint8_t>> Namespace;
+
+    Namespace* space = nullptr;
+
+    static std::map<std::string, Namespace>& store() {
+        static std::map<std::string, Namespace> namespaces;
+        return namespaces;
+    }
+
+    template <typename T>
+    T get(const char* key, T defaultValue) {
+        T value;
+        return getBytes(key, &value, sizeof(value)) == sizeof(value) ? value : defaultValue;
+    }
+};
+
+#endif // PREFERENCES_SHIM_H
@@ -0,0 +1,74 @@
+#ifndef RTCLIB_SHIM_H
+#define RTCLIB_SHIM_H
+
+// DateTime as RTClib defines it (UTC arithmetic, no time zone), and a DS3231
+// that is never found on the bus
+#include <Arduino.h>
+#include <Wire.h>
+
+#define SECONDS_FROM_1970_TO_2000 946684800
+
+class TimeSpan {
+public:
+    TimeSpan(int32_t seconds = 0) : total(seconds) {}
+    TimeSpan(int16_t days, int8_t hours, int8_t minutes, int8_t seconds)
+        : total((int32_t)days * 86400L + (int32_t)hours * 3600 + (int32_t)minutes * 60 + seconds) {}
+    int32_t totalseconds() const { return total; }
+
+private:
+    int32_t total;
+};
+
+class DateTime {
+public:
+    DateTime(uint32_t t = SECONDS_FROM_1970_TO_2000) : seconds(t) {}
+    DateTime(uint16_t year, uint8_t month, uint8_t day, uint8_t hour = 0, uint8_t min = 0, uint8_t sec = 0) {
+        struct tm parts = {};
+        parts.tm_year = year - 1900;
+        parts.tm_mon = month - 1;
+        parts.tm_mday = day;
+        parts.tm_hour = hour;
+        parts.tm_min = min;
+        parts.tm_sec = sec;
+        seconds = (uint32_t)timegm(&parts);
+    }
+    // Build time of the firmware; fixed on the host
+    DateTime(const char* date, const char* time) : DateTime(2024, 1, 1) { (void)date; (void)time; }
+
+    bool isValid() const { return seconds >= SECONDS_FROM_1970_TO_2000; }
+    uint32_t unixtime() const { return seconds; }
+    uint16_t year() const { return parts().tm_year + 1900; }
+    uint8_t month() const { return parts().tm_mon + 1; }
+    uint8_t day() const { return parts().tm_mday; }
+    uint8_t hour() const { return parts().tm_hour; }
+    uint8_t minute() const { return parts().tm_min; }
+    uint8_t second() const { return parts().tm_sec; }
+    uint8_t dayOfTheWeek() const { return parts().tm_wday; }
+
+    DateTime operator+(const TimeSpan& span) const { return DateTime(seconds + span.totalseconds()); }
+    DateTime operator-(const TimeSpan& span) const { return DateTime(seconds - span.totalseconds()); }
+    TimeSpan operator-(const DateTime& right) const { return TimeSpan((int32_t)(seconds - right.seconds)); }
+
+private:
+    uint32_t seconds;
+
+    struct tm parts() const {
+        time_t t = seconds;
+        struct tm result;
+        gmtime_r(&t, &result);
+        return result;
+    }
+};
+
+class RTC_DS3231 {
+public:
+    bool begin(TwoWire* wire = &Wire) { (void)wire; return false; }
+    bool lostPower() { return true; }
+    void adjust(const DateTime& dt) { now_ = dt; }
+    DateTime now() { return now_; }
+
+private:
+    DateTime now_;
+};
+
+#endif // RTCLIB_SHIM_H
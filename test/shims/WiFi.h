@@ -0,0 +1,17 @@
+#ifndef WIFI_SHIM_H
+#define WIFI_SHIM_H
+
+// Station that never connects
+#include <Arduino.h>
+
+#define WL_CONNECTED 3
+#define WL_DISCONNECTED 6
+
+class WiFiClass {
+public:
+    int status() { return WL_DISCONNECTED; }
+};
+
+inline WiFiClass WiFi;
+
+#endif // WIFI_SHIM_H
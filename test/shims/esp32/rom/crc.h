@@ -0,0 +1,12 @@
+#ifndef CRC_SHIM_H
+#define CRC_SHIM_H
+
+// ROM CRC-32 (the zlib one: reflected, inverted in and out)
+#include <stdint.h>
+#include <zlib.h>
+
+inline uint32_t crc32_le(uint32_t crc, const uint8_t* buf, uint32_t len) {
+    return (uint32_t)crc32(crc, buf, len);
+}
+
+#endif // CRC_SHIM_H
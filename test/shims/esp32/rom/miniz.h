@@ -0,0 +1,96 @@
+#ifndef MINIZ_SHIM_H
+#define MINIZ_SHIM_H
+
+// The inflate entry point of the ESP32 ROM (miniz 1.15 tinfl), done with the
+// host zlib. The ROM decoder refills its 32-bit bit buffer two bytes at a
+// time while decoding codes and counts those bytes as used, so when the
+// stream ends it can have read past it: the bytes that follow (the gzip
+// trailer) are left in m_bit_buf. That read-ahead is reproduced here, since
+// zlib on its own stops at the exact end of the stream.
+#include <stdint.h>
+#include <stddef.h>
+#include <zlib.h>
+
+#define TINFL_LZ_DICT_SIZE 32768
+
+enum {
+    TINFL_FLAG_PARSE_ZLIB_HEADER = 1,
+    TINFL_FLAG_HAS_MORE_INPUT = 2,
+    TINFL_FLAG_USING_NON_WRAPPING_OUTPUT_BUF = 4,
+    TINFL_FLAG_COMPUTE_ADLER32 = 8
+};
+
+typedef enum {
+    TINFL_STATUS_BAD_PARAM = -3,
+    TINFL_STATUS_ADLER32_MISMATCH = -2,
+    TINFL_STATUS_FAILED = -1,
+    TINFL_STATUS_DONE = 0,
+    TINFL_STATUS_NEEDS_MORE_INPUT = 1,
+    TINFL_STATUS_HAS_MORE_OUTPUT = 2
+} tinfl_status;
+
+typedef uint8_t mz_uint8;
+typedef uint32_t mz_uint32;
+typedef mz_uint32 tinfl_bit_buf_t;
+
+struct tinfl_decompressor {
+    mz_uint32 m_state;
+    mz_uint32 m_num_bits;
+    tinfl_bit_buf_t m_bit_buf;
+    z_stream m_zlib;
+};
+
+#define tinfl_init(r) do { (r)->m_state = 0; } while (0)
+
+inline tinfl_status tinfl_decompress(tinfl_decompressor* r, const mz_uint8* pIn_buf_next, size_t* pIn_buf_size,
+                                     mz_uint8* pOut_buf_start, mz_uint8* pOut_buf_next, size_t* pOut_buf_size,
+                                     const mz_uint32 decomp_flags) {
+    (void)pOut_buf_start;
+    (void)decomp_flags;
+    if (r->m_state == 0) {
+        r->m_zlib = z_stream();
+        if (inflateInit2(&r->m_zlib, -15) != Z_OK) {
+            return TINFL_STATUS_FAILED;
+        }
+        r->m_num_bits = 0;
+        r->m_bit_buf = 0;
+        r->m_state = 1;
+    }
+    if (r->m_state == 2) {
+        *pIn_buf_size = 0;
+        *pOut_buf_size = 0;
+        return TINFL_STATUS_DONE;
+    }
+
+    r->m_zlib.next_in = (Bytef*)pIn_buf_next;
+    r->m_zlib.avail_in = *pIn_buf_size;
+    r->m_zlib.next_out = pOut_buf_next;
+    r->m_zlib.avail_out = *pOut_buf_size;
+    int rc = inflate(&r->m_zlib, Z_NO_FLUSH);
+
+    size_t used = *pIn_buf_size - r->m_zlib.avail_in;
+    bool full = r->m_zlib.avail_out == 0;
+    *pOut_buf_size -= r->m_zlib.avail_out;
+
+    if (rc == Z_STREAM_END) {
+        // Read-ahead: up to two more bytes go into the bit buffer
+        size_t ahead = *pIn_buf_size - used < 2 ? *pIn_buf_size - used : 2;
+        for (size_t i = 0; i < ahead; i++) {
+            r->m_bit_buf |= (tinfl_bit_buf_t)pIn_buf_next[used++] << r->m_num_bits;
+            r->m_num_bits += 8;
+        }
+        *pIn_buf_size = used;
+        inflateEnd(&r->m_zlib);
+        r->m_state = 2;
+        return TINFL_STATUS_DONE;
+    }
+    *pIn_buf_size = used;
+    if (rc != Z_OK && rc != Z_BUF_ERROR) {
+        inflateEnd(&r->m_zlib);
+        r->m_state = 2;
+        return TINFL_STATUS_FAILED;
+    }
+    return full ? TINFL_STATUS_HAS_MORE_OUTPUT : TINFL_STATUS_NEEDS_MORE_INPUT;
+}
+
+#endif // MINIZ_SHIM_H
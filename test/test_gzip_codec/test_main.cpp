@@ -0,0 +1,297 @@
+#include <unity.h>
+#include <zlib.h>
+#include "gzip_codec.h"
+#include "http_body_reader.h"
+
+// gzip as it comes off the wire: real zlib output fed through HttpBodyReader
+// a few bytes at a time, so the end of the deflate stream lands at every
+// position in a read (the ROM inflater can read into the trailer, see the
+// miniz shim). And the request-side compressor checked against zlib.
+
+// A response body that reports at most `piece` bytes available at a time
+class PieceStream : public Stream {
+public:
+    PieceStream(const std::string& bytes, size_t pieceSize) : data(bytes), pos(0), piece(pieceSize) {}
+
+    int available() override {
+        size_t left = data.size() - pos;
+        return (int)(left < piece ? left : piece);
+    }
+    int read() override { return pos < data.size() ? (uint8_t)data[pos++] : -1; }
+    int peek() override { return pos < data.size() ? (uint8_t)data[pos] : -1; }
+    size_t write(uint8_t) override { return 0; }
+
+private:
+    std::string data;
+    size_t pos;
+    size_t piece;
+};
+
+// Deterministic payloads: noise, text-like runs, or one repeated byte
+static std::string payload(size_t length, uint32_t seed) {
+    std::string out(length, '\0');
+    uint32_t x = seed * 2654435761u + 1;
+    uint8_t kind = seed % 3;
+    for (size_t i = 0; i < length; i++) {
+        x = x * 1103515245u + 12345;
+        if (kind == 0) {
+            out[i] = (char)(x >> 24);
+        } else if (kind == 1) {
+            out[i] = "{\"zone\": 12, \"minutes\": 30}, "[(x >> 16) % 30];
+            if ((x >> 8) % 7 == 0 && i >= 40) {
+                out[i] = out[i - 40];
+            }
+        } else {
+            out[i] = 'a';
+        }
+    }
+    return out;
+}
+
+static std::string zlibDeflate(const std::string& in, int windowBits) {
+    z_stream z = z_stream();
+    TEST_ASSERT_EQUAL(Z_OK, deflateInit2(&z, 9, Z_DEFLATED, windowBits, 8, Z_DEFAULT_STRATEGY));
+    std::string out(deflateBound(&z, in.size()) + 32, '\0');
+    z.next_in = (Bytef*)in.data();
+    z.avail_in = in.size();
+    z.next_out = (Bytef*)&out[0];
+    z.avail_out = out.size();
+    TEST_ASSERT_EQUAL(Z_STREAM_END, deflate(&z, Z_FINISH));
+    out.resize(z.total_out);
+    deflateEnd(&z);
+    return out;
+}
+
+static std::string zlibGunzip(const uint8_t* in, size_t length, size_t expected) {
+    z_stream z = z_stream();
+    TEST_ASSERT_EQUAL(Z_OK, inflateInit2(&z, 31));
+    std::string out(expected + 1, '\0');
+    z.next_in = (Bytef*)in;
+    z.avail_in = length;
+    z.next_out = (Bytef*)&out[0];
+    z.avail_out = out.size();
+    TEST_ASSERT_EQUAL(Z_STREAM_END, inflate(&z, Z_FINISH));
+    TEST_ASSERT_EQUAL(0, z.avail_in);
+    out.resize(z.total_out);
+    inflateEnd(&z);
+    return out;
+}
+
+static void appendLE32(std::string& out, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        out += (char)(value >> (8 * i));
+    }
+}
+
+static std::string chunked(const std::string& body, size_t chunkSize) {
+    std::string out;
+    for (size_t i = 0; i < body.size(); i += chunkSize) {
+        std::string part = body.substr(i, chunkSize);
+        char line[16];
+        snprintf(line, sizeof(line), "%zx\r\n", part.size());
+        out += line + part + "\r\n";
+    }
+    return out + "0\r\n\r\n";
+}
+
+struct Received {
+    std::string body;
+    bool complete;
+    bool decodeFailed;
+};
+
+static Received receive(HttpBodyReader& reader) {
+    Received result;
+    char buffer[37];
+    size_t n;
+    while ((n = reader.readBytes(buffer, sizeof(buffer))) > 0) {
+        result.body.append(buffer, n);
+    }
+    result.complete = reader.skipRest();
+    result.decodeFailed = reader.decodeFailed();
+    return result;
+}
+
+// Feed a gzip member straight to the inflater, `step` bytes per call
+static Received inflateAll(const std::string& gz, size_t step) {
+    Received result = {"", false, false};
+    GzipInflater inflater;
+    TEST_ASSERT_TRUE(inflater.begin());
+    size_t pos = 0;
+    while (!inflater.isDone()) {
+        size_t length = gz.size() - pos < step ? gz.size() - pos : step;
+        if (length == 0 && !inflater.hasMoreOutput()) {
+            break;
+        }
+        const uint8_t* out;
+        size_t outLength;
+        if (!inflater.inflate((const uint8_t*)gz.data() + pos, length, out, outLength)) {
+            result.decodeFailed = true;
+            break;
+        }
+        pos += length;
+        result.body.append((const char*)out, outLength);
+    }
+    result.complete = inflater.isDone() && pos == gz.size();
+    return result;
+}
+
+void setUp() {
+    Serial.muted = true;
+}
+
+void tearDown() {}
+
+void test_gzip_reads_in_small_chunks() {
+    static const size_t SIZES[] = {0, 1, 7, 100, 4000, 33000, 70000};
+    for (size_t s = 0; s < sizeof(SIZES) / sizeof(SIZES[0]); s++) {
+        for (uint32_t seed = 0; seed < 3; seed++) {
+            std::string plain = payload(SIZES[s], seed);
+            std::string gz = zlibDeflate(plain, 31);
+
+            for (size_t chunk = 1; chunk <= 12; chunk++) {
+                PieceStream wire(chunked(gz, chunk), 64);
+                HttpBodyReader reader(wire, -1, true, nullptr, true);
+                Received got = receive(reader);
+                TEST_ASSERT_FALSE(got.decodeFailed);
+                TEST_ASSERT_TRUE(got.complete);
+                TEST_ASSERT_TRUE(got.body == plain);
+            }
+            for (size_t piece = 1; piece <= 12; piece++) {
+                PieceStream wire(gz, piece);
+                HttpBodyReader reader(wire, -1, false, nullptr, true);
+                Received got = receive(reader);
+                TEST_ASSERT_FALSE(got.decodeFailed);
+                TEST_ASSERT_TRUE(got.body == plain);
+                TEST_ASSERT_EQUAL(plain.size(), reader.getDecodedBytes());
+            }
+        }
+    }
+}
+
+void test_gzip_body_is_copied_decoded() {
+    std::string plain = payload(5000, 1);
+    std::string gz = zlibDeflate(plain, 31);
+    PieceStream wire(gz, 5);
+    File copy;
+    HttpBodyReader reader(wire, gz.size(), false, &copy, true);
+    Received got = receive(reader);
+    TEST_ASSERT_TRUE(got.complete);
+    TEST_ASSERT_FALSE(reader.copyFailed());
+    TEST_ASSERT_TRUE(copy.contents == plain);
+    TEST_ASSERT_EQUAL(gz.size(), reader.getBytesRead());
+}
+
+void test_optional_header_fields_are_skipped() {
+    std::string plain = payload(3000, 1);
+    std::string deflated = zlibDeflate(plain, -15);
+    static const uint8_t FLAGS[] = {0x04, 0x08, 0x10, 0x02, 0x1E};
+
+    for (size_t f = 0; f < sizeof(FLAGS); f++) {
+        uint8_t flags = FLAGS[f];
+        std::string gz("\x1F\x8B\x08", 3);
+        gz += (char)flags;
+        gz += std::string("\0\0\0\0\0\xFF", 6);
+        if (flags & 0x04) {
+            gz += std::string("\x05\0extra", 7);
+        }
+        if (flags & 0x08) {
+            gz += std::string("schedule.json\0", 14);
+        }
+        if (flags & 0x10) {
+            gz += std::string("a comment\0", 10);
+        }
+        if (flags & 0x02) {
+            uint32_t headerCrc = crc32(0, (const Bytef*)gz.data(), gz.size());
+            gz += (char)(headerCrc & 0xFF);
+            gz += (char)((headerCrc >> 8) & 0xFF);
+        }
+        gz += deflated;
+        appendLE32(gz, crc32(0, (const Bytef*)plain.data(), plain.size()));
+        appendLE32(gz, plain.size());
+
+        for (size_t step = 1; step <= 5; step++) {
+            Received got = inflateAll(gz, step);
+            TEST_ASSERT_FALSE(got.decodeFailed);
+            TEST_ASSERT_TRUE(got.complete);
+            TEST_ASSERT_TRUE(got.body == plain);
+        }
+    }
+}
+
+void test_wrong_crc_is_an_error() {
+    std::string plain = payload(2000, 1);
+    std::string gz = zlibDeflate(plain, 31);
+    gz[gz.size() - 8] ^= 0x01;
+
+    for (size_t step = 1; step <= 9; step++) {
+        Received got = inflateAll(gz, step);
+        TEST_ASSERT_TRUE(got.decodeFailed);
+        TEST_ASSERT_FALSE(got.complete);
+    }
+
+    PieceStream wire(chunked(gz, 3), 64);
+    HttpBodyReader reader(wire, -1, true, nullptr, true);
+    Received got = receive(reader);
+    TEST_ASSERT_TRUE(got.decodeFailed);
+    TEST_ASSERT_FALSE(got.complete);
+}
+
+void test_truncated_trailer_is_not_done() {
+    std::string plain = payload(2000, 1);
+    std::string gz = zlibDeflate(plain, 31);
+
+    for (size_t cut = 1; cut <= 8; cut++) {
+        std::string shortened = gz.substr(0, gz.size() - cut);
+        for (size_t step = 1; step <= 9; step++) {
+            Received got = inflateAll(shortened, step);
+            TEST_ASSERT_FALSE(got.decodeFailed);
+            TEST_ASSERT_FALSE(got.complete);
+            TEST_ASSERT_TRUE(got.body == plain);
+        }
+
+        PieceStream wire(shortened, 2);
+        HttpBodyReader reader(wire, shortened.size(), false, nullptr, true);
+        Received got = receive(reader);
+        TEST_ASSERT_FALSE(got.complete);
+    }
+}
+
+void test_compress_round_trips_through_zlib() {
+    std::string out(70000, '\0');
+    for (uint32_t seed = 0; seed < 2000; seed++) {
+        size_t length = seed < 64 ? seed : (seed * 7919u) % 60000;
+        std::string plain = payload(length, seed);
+
+        size_t size = gzipCompress((const uint8_t*)plain.data(), plain.size(), (uint8_t*)&out[0], out.size());
+        TEST_ASSERT_NOT_EQUAL(0, size);
+        TEST_ASSERT_TRUE(zlibGunzip((const uint8_t*)out.data(), size, plain.size()) == plain);
+        if (seed % 50 == 0) {
+            Received got = inflateAll(out.substr(0, size), 3);
+            TEST_ASSERT_TRUE(got.complete);
+            TEST_ASSERT_TRUE(got.body == plain);
+        }
+    }
+}
+
+void test_compress_reports_what_does_not_fit() {
+    std::string plain = payload(1000, 0);
+    std::string out(100, '\0');
+    TEST_ASSERT_EQUAL(0, gzipCompress((const uint8_t*)plain.data(), plain.size(), (uint8_t*)&out[0], out.size()));
+
+    std::string big(65535, 'a');
+    out.resize(70000);
+    TEST_ASSERT_EQUAL(0, gzipCompress((const uint8_t*)big.data(), big.size(), (uint8_t*)&out[0], out.size()));
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_gzip_reads_in_small_chunks);
+    RUN_TEST(test_gzip_body_is_copied_decoded);
+    RUN_TEST(test_optional_header_fields_are_skipped);
+    RUN_TEST(test_wrong_crc_is_an_error);
+    RUN_TEST(test_truncated_trailer_is_not_done);
+    RUN_TEST(test_compress_round_trips_through_zlib);
+    RUN_TEST(test_compress_reports_what_does_not_fit);
+    return UNITY_END();
+}
@@ -0,0 +1,145 @@
+#include <unity.h>
+#include "HunterRoam.h"
+#include "hunter_decoder.h"
+
+// Bus commands are played out of the pin shim, which stamps every
+// digitalWrite() with the virtual clock; the waveform rebuilt from those
+// writes has to decode back to the command that was sent.
+
+static HunterRoam* bus;
+static HunterFrame* wave;
+
+// Turn the recorded writes on HUNTER_PIN into levels and their durations.
+// The last write ends the final pulse.
+static void captureWave() {
+    wave->count = 0;
+    const std::vector<ArduinoShim::PinWrite>& writes = ArduinoShim::pinWrites;
+    for (size_t i = 0; i + 1 < writes.size(); i++) {
+        uint32_t width = (uint32_t)(writes[i + 1].atMicros - writes[i].atMicros);
+        if (wave->count > 0 && wave->pulses[wave->count - 1].level == writes[i].level) {
+            wave->pulses[wave->count - 1].micros += width;
+        } else if (wave->count < HUNTER_MAX_PULSES) {
+            wave->pulses[wave->count].level = writes[i].level;
+            wave->pulses[wave->count].micros = width;
+            wave->count++;
+        }
+    }
+}
+
+void setUp() {
+    Serial.muted = true;
+    ArduinoShim::reset();
+    bus = new HunterRoam(HUNTER_PIN);
+    wave = new HunterFrame();
+}
+
+void tearDown() {
+    delete bus;
+    delete wave;
+}
+
+void test_zone_commands_decode_from_the_pin() {
+    for (uint8_t zone = 1; zone <= 48; zone++) {
+        for (uint16_t minutes = 0; minutes <= 240; minutes += 15) {
+            ArduinoShim::reset();
+            TEST_ASSERT_EQUAL_UINT8(0, bus->startZone(zone, minutes));
+            captureWave();
+
+            HunterDecoded decoded = HunterDecoder::decode(*wave);
+            TEST_ASSERT_EQUAL_MESSAGE(DECODE_OK, decoded.status, HunterDecoder::statusText(decoded.status));
+            TEST_ASSERT_FALSE(decoded.isProgram);
+            TEST_ASSERT_EQUAL_UINT8(zone, decoded.zone);
+            TEST_ASSERT_EQUAL_UINT8(minutes, decoded.minutes);
+            TEST_ASSERT_EQUAL_UINT16(121, decoded.bitCount);
+        }
+    }
+}
+
+void test_program_commands_decode_from_the_pin() {
+    for (uint8_t program = 1; program <= 4; program++) {
+        ArduinoShim::reset();
+        TEST_ASSERT_EQUAL_UINT8(0, bus->startProgram(program));
+        captureWave();
+
+        HunterDecoded decoded = HunterDecoder::decode(*wave);
+        TEST_ASSERT_EQUAL(DECODE_OK, decoded.status);
+        TEST_ASSERT_TRUE(decoded.isProgram);
+        TEST_ASSERT_EQUAL_UINT8(program, decoded.program);
+    }
+}
+
+void test_every_rendered_zone_frame_round_trips() {
+    HunterFrame* frame = new HunterFrame();
+    for (uint8_t zone = 1; zone <= 48; zone++) {
+        for (uint16_t minutes = 0; minutes <= 240; minutes++) {
+            TEST_ASSERT_EQUAL_UINT8(0, bus->renderZone(zone, minutes, *frame));
+            HunterDecoded decoded = HunterDecoder::decode(*frame, 0);
+            TEST_ASSERT_EQUAL(DECODE_OK, decoded.status);
+            TEST_ASSERT_EQUAL_UINT8(zone, decoded.zone);
+            TEST_ASSERT_EQUAL_UINT8(minutes, decoded.minutes);
+            TEST_ASSERT_EQUAL_UINT8(0, decoded.maxDeviation);
+        }
+    }
+    delete frame;
+}
+
+void test_recorder_matches_the_pin_waveform() {
+    HunterFrame* recorded = new HunterFrame();
+    recorded->count = 0;
+    HunterRoam recorder(-1);
+    recorder.setRecorder(recorded);
+    TEST_ASSERT_EQUAL_UINT8(0, recorder.startZone(7, 42));
+    TEST_ASSERT_TRUE(ArduinoShim::pinWrites.empty());
+
+    TEST_ASSERT_EQUAL_UINT8(0, bus->startZone(7, 42));
+    captureWave();
+
+    TEST_ASSERT_EQUAL_UINT16(recorded->count, wave->count);
+    for (uint16_t i = 0; i < wave->count; i++) {
+        TEST_ASSERT_EQUAL_UINT8(recorded->pulses[i].level, wave->pulses[i].level);
+        // The cycle counter spin overshoots each pulse by a few microseconds
+        TEST_ASSERT_LESS_OR_EQUAL_UINT32(3, wave->pulses[i].micros - recorded->pulses[i].micros);
+    }
+    delete recorded;
+}
+
+void test_out_of_tolerance_pulse_is_reported() {
+    TEST_ASSERT_EQUAL_UINT8(0, bus->renderZone(3, 10, *wave));
+    wave->pulses[20].micros = wave->pulses[20].micros * 13 / 10;
+
+    HunterDecoded decoded = HunterDecoder::decode(*wave);
+    TEST_ASSERT_EQUAL(DECODE_BAD_PULSE, decoded.status);
+    TEST_ASSERT_EQUAL_UINT16(20, decoded.errorPulse);
+}
+
+void test_cut_off_frame_is_reported() {
+    TEST_ASSERT_EQUAL_UINT8(0, bus->renderZone(3, 10, *wave));
+    wave->count -= 4;
+    TEST_ASSERT_EQUAL(DECODE_BAD_LENGTH, HunterDecoder::decode(*wave).status);
+
+    TEST_ASSERT_EQUAL_UINT8(0, bus->renderZone(3, 10, *wave));
+    wave->pulses[0].micros = 100000;
+    TEST_ASSERT_EQUAL(DECODE_BAD_RESET, HunterDecoder::decode(*wave).status);
+}
+
+void test_transmit_checks_the_measured_timing() {
+    TEST_ASSERT_EQUAL_UINT8(0, bus->startZone(12, 5));
+
+    const HunterJitterStats& jitter = bus->getJitterStats();
+    TEST_ASSERT_EQUAL_UINT32(1, jitter.frames);
+    TEST_ASSERT_EQUAL_UINT32(0, jitter.retransmits);
+    TEST_ASSERT_EQUAL_UINT32(0, jitter.failures);
+    TEST_ASSERT_LESS_OR_EQUAL_UINT8(HUNTER_JITTER_TOLERANCE, jitter.maxDeviation);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_zone_commands_decode_from_the_pin);
+    RUN_TEST(test_program_commands_decode_from_the_pin);
+    RUN_TEST(test_every_rendered_zone_frame_round_trips);
+    RUN_TEST(test_recorder_matches_the_pin_waveform);
+    RUN_TEST(test_out_of_tolerance_pulse_is_reported);
+    RUN_TEST(test_cut_off_frame_is_reported);
+    RUN_TEST(test_transmit_checks_the_measured_timing);
+    return UNITY_END();
+}
@@ -0,0 +1,103 @@
+#ifndef LEGACY_ENCODER_H
+#define LEGACY_ENCODER_H
+
+// Reference copy of the Hunter frame encoder and bus writer as they were
+// before the constexpr field tables, kept only to check the new encoder
+// against. Not built into the firmware.
+
+#include <Arduino.h>
+#include <vector>
+#include "HunterRoam.h"
+
+namespace Legacy {
+
+inline void hunterBitfield(std::vector<byte> &bits, byte pos, byte val, byte len) {
+	while (len > 0) {
+		if (val & 0x1) {
+			bits[pos / 8] = bits[pos / 8] | 0x80 >> (pos % 8);
+		} else {
+			bits[pos / 8] = bits[pos / 8] & ~(0x80 >> (pos % 8));
+		}
+		len--;
+		val = val >> 1;
+		pos++;
+	}
+}
+
+inline std::vector<byte> zoneFrame(byte zone, byte time) {
+	std::vector<byte> buffer = {0xff,0x00,0x00,0x00,0x10,0x00,0x00,0x04,0x00,0x00,0x01,0x00,0x01,0xb8,0x3f};
+
+	if (zone > 12) {
+		hunterBitfield(buffer, 9, 0x1, 2);
+	} else {
+		hunterBitfield(buffer, 9, 0x2, 2);
+	}
+
+	hunterBitfield(buffer, 23, zone + 0x17, 7);
+	hunterBitfield(buffer, 36, zone + 0x17, 7);
+	hunterBitfield(buffer, 49, zone + 0x23, 7);
+	hunterBitfield(buffer, 62, zone + 0x23, 7);
+	hunterBitfield(buffer, 75, zone + 0x2f, 7);
+	hunterBitfield(buffer, 88, zone + 0x2f, 7);
+
+	hunterBitfield(buffer, 31, time, 4);
+	hunterBitfield(buffer, 44, time >> 4, 4);
+	hunterBitfield(buffer, 57, time, 4);
+	hunterBitfield(buffer, 70, time >> 4, 4);
+	hunterBitfield(buffer, 83, time, 4);
+	hunterBitfield(buffer, 96, time >> 4, 4);
+
+	hunterBitfield(buffer, 109, zone - 1, 4);
+	return buffer;
+}
+
+inline std::vector<byte> programFrame(byte num) {
+	std::vector<byte> buffer = {0xff, 0x40, 0x03, 0x96, 0x09 ,0xbd ,0x7f};
+	hunterBitfield(buffer, 31, num - 1, 2);
+	return buffer;
+}
+
+inline void sendLow(int pin) {
+	digitalWrite(pin, HIGH);
+	delayMicroseconds(SHORT_INTERVAL);
+	digitalWrite(pin, LOW);
+	delayMicroseconds(LONG_INTERVAL);
+}
+
+inline void sendHigh(int pin) {
+	digitalWrite(pin, HIGH);
+	delayMicroseconds(LONG_INTERVAL);
+	digitalWrite(pin, LOW);
+	delayMicroseconds(SHORT_INTERVAL);
+}
+
+// The old writer, delays and all; on the pin shim it leaves an exact waveform
+inline void writeBus(int pin, std::vector<byte> buffer, bool extrabit) {
+	digitalWrite(pin, HIGH);
+	delay(325);
+	digitalWrite(pin, LOW);
+	delay(65);
+
+	digitalWrite(pin, HIGH);
+	delayMicroseconds(START_INTERVAL);
+	digitalWrite(pin, LOW);
+	delayMicroseconds(SHORT_INTERVAL);
+
+	for (auto &sendByte : buffer) {
+		for (byte inner = 0; inner < 8; inner++) {
+			(sendByte & 0x80) ? sendHigh(pin) : sendLow(pin);
+			sendByte <<= 1;
+		}
+	}
+
+	if (extrabit) {
+		sendHigh(pin);
+	}
+	sendLow(pin);
+	// Marks the end of the stop pulse for the waveform capture
+	digitalWrite(pin, LOW);
+}
+
+} // namespace Legacy
+
+#endif // LEGACY_ENCODER_H
@@ -0,0 +1,114 @@
+#include <unity.h>
+#include "HunterRoam.h"
+#include "hunter_encoder.h"
+#include "legacy_encoder.h"
+
+// The constexpr encoder and the pulse renderer must reproduce the old
+// hunterBitfield() encoder and delay-based bus writer exactly, for every
+// zone at every run time and for every program.
+
+static HunterRoam* renderer;
+static HunterFrame* frame;
+static HunterFrame* legacyWave;
+
+// Levels and durations of the writes on HUNTER_PIN; the last write ends the final pulse
+static void captureWave(HunterFrame& wave) {
+    wave.count = 0;
+    const std::vector<ArduinoShim::PinWrite>& writes = ArduinoShim::pinWrites;
+    for (size_t i = 0; i + 1 < writes.size(); i++) {
+        uint32_t width = (uint32_t)(writes[i + 1].atMicros - writes[i].atMicros);
+        if (wave.count > 0 && wave.pulses[wave.count - 1].level == writes[i].level) {
+            wave.pulses[wave.count - 1].micros += width;
+        } else if (wave.count < HUNTER_MAX_PULSES) {
+            wave.pulses[wave.count].level = writes[i].level;
+            wave.pulses[wave.count].micros = width;
+            wave.count++;
+        }
+    }
+}
+
+static void assertSameWave(const HunterFrame& expected, const HunterFrame& actual) {
+    TEST_ASSERT_EQUAL_UINT16(expected.count, actual.count);
+    for (uint16_t i = 0; i < expected.count; i++) {
+        TEST_ASSERT_EQUAL_UINT8(expected.pulses[i].level, actual.pulses[i].level);
+        TEST_ASSERT_EQUAL_UINT32(expected.pulses[i].micros, actual.pulses[i].micros);
+    }
+}
+
+void setUp() {
+    Serial.muted = true;
+    ArduinoShim::reset();
+    renderer = new HunterRoam(-1);
+    frame = new HunterFrame();
+    legacyWave = new HunterFrame();
+}
+
+void tearDown() {
+    delete renderer;
+    delete frame;
+    delete legacyWave;
+}
+
+void test_zone_bytes_match_legacy_encoder() {
+    for (uint8_t zone = 1; zone <= 48; zone++) {
+        for (uint16_t minutes = 0; minutes <= 240; minutes++) {
+            std::vector<byte> expected = Legacy::zoneFrame(zone, minutes);
+            HunterZoneBytes actual = hunterEncodeZone(zone, minutes);
+            TEST_ASSERT_EQUAL_UINT16(expected.size(), actual.size());
+            TEST_ASSERT_EQUAL_HEX8_ARRAY(expected.data(), actual.data(), expected.size());
+        }
+        std::vector<byte> stop = Legacy::zoneFrame(zone, 0);
+        TEST_ASSERT_EQUAL_HEX8_ARRAY(stop.data(), HUNTER_STOP_FRAMES[zone - 1].data(), stop.size());
+    }
+}
+
+void test_program_bytes_match_legacy_encoder() {
+    for (uint8_t program = 1; program <= 4; program++) {
+        std::vector<byte> expected = Legacy::programFrame(program);
+        TEST_ASSERT_EQUAL_UINT16(expected.size(), HunterProgramBytes().size());
+        TEST_ASSERT_EQUAL_HEX8_ARRAY(expected.data(), hunterEncodeProgram(program).data(), expected.size());
+        TEST_ASSERT_EQUAL_HEX8_ARRAY(expected.data(), HUNTER_PROGRAM_FRAMES[program - 1].data(), expected.size());
+    }
+}
+
+void test_zone_timing_matches_legacy_writer() {
+    for (uint8_t zone = 1; zone <= 48; zone++) {
+        for (uint16_t minutes = 0; minutes <= 240; minutes++) {
+            ArduinoShim::reset();
+            Legacy::writeBus(HUNTER_PIN, Legacy::zoneFrame(zone, minutes), true);
+            captureWave(*legacyWave);
+
+            TEST_ASSERT_EQUAL_UINT8(0, renderer->renderZone(zone, minutes, *frame));
+            assertSameWave(*legacyWave, *frame);
+        }
+    }
+}
+
+void test_program_timing_matches_legacy_writer() {
+    for (uint8_t program = 1; program <= 4; program++) {
+        ArduinoShim::reset();
+        Legacy::writeBus(HUNTER_PIN, Legacy::programFrame(program), false);
+        captureWave(*legacyWave);
+
+        TEST_ASSERT_EQUAL_UINT8(0, renderer->renderProgram(program, *frame));
+        assertSameWave(*legacyWave, *frame);
+    }
+}
+
+void test_out_of_range_commands_are_refused() {
+    TEST_ASSERT_EQUAL_UINT8(1, renderer->renderZone(0, 10, *frame));
+    TEST_ASSERT_EQUAL_UINT8(1, renderer->renderZone(49, 10, *frame));
+    TEST_ASSERT_EQUAL_UINT8(2, renderer->renderZone(1, 241, *frame));
+    TEST_ASSERT_EQUAL_UINT8(3, renderer->renderProgram(0, *frame));
+    TEST_ASSERT_EQUAL_UINT8(3, renderer->renderProgram(5, *frame));
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_zone_bytes_match_legacy_encoder);
+    RUN_TEST(test_program_bytes_match_legacy_encoder);
+    RUN_TEST(test_zone_timing_matches_legacy_writer);
+    RUN_TEST(test_program_timing_matches_legacy_writer);
+    RUN_TEST(test_out_of_range_commands_are_refused);
+    return UNITY_END();
+}
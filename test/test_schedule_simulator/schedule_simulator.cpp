@@ -0,0 +1,187 @@
+#include "schedule_simulator.h"
+#include "config_manager.h"
+
+ScheduleSimulator* ScheduleSimulator::instance = nullptr;
+
+ScheduleSimulator::ScheduleSimulator() {
+    configManager = nullptr;
+    sourceManager = nullptr;
+    commandCount = 0;
+    virtualMillisNow = 0;
+    clockOffset = 0;
+    resetResults();
+}
+
+bool ScheduleSimulator::begin(ConfigManager* config, ScheduleManager* source) {
+    configManager = config;
+    sourceManager = source;
+    return (configManager != nullptr && sourceManager != nullptr);
+}
+
+bool ScheduleSimulator::addCommand(uint32_t atMinute, uint8_t zone, uint16_t duration) {
+    if (commandCount >= MAX_COMMANDS) {
+        return false;
+    }
+
+    commands[commandCount].atMinute = atMinute;
+    commands[commandCount].type = SIM_ZONE;
+    commands[commandCount].zone = zone;
+    commands[commandCount].duration = duration;
+    commands[commandCount].scheduleId = 0;
+    commands[commandCount].seconds = 0;
+    commandCount++;
+    return true;
+}
+
+bool ScheduleSimulator::addScheduleRemoval(uint32_t atMinute, uint32_t scheduleId) {
+    if (scheduleId == 0 || !addCommand(atMinute, 0, 0)) {
+        return false;
+    }
+    commands[commandCount - 1].type = SIM_REMOVE_SCHEDULE;
+    commands[commandCount - 1].scheduleId = scheduleId;
+    return true;
+}
+
+bool ScheduleSimulator::addStall(uint32_t atMinute, uint16_t minutes) {
+    if (minutes == 0 || !addCommand(atMinute, 0, 0)) {
+        return false;
+    }
+    commands[commandCount - 1].type = SIM_STALL;
+    commands[commandCount - 1].seconds = minutes * 60;
+    return true;
+}
+
+bool ScheduleSimulator::addClockStep(uint32_t atMinute, int32_t seconds) {
+    if (seconds == 0 || !addCommand(atMinute, 0, 0)) {
+        return false;
+    }
+    commands[commandCount - 1].type = SIM_CLOCK_STEP;
+    commands[commandCount - 1].seconds = seconds;
+    return true;
+}
+
+void ScheduleSimulator::resetResults() {
+    actuationCount = 0;
+    actuationTotal = 0;
+    conflictCount = 0;
+    conflictTotal = 0;
+    startUnix = 0;
+    simulatedDays = 0;
+    stepSeconds = 0;
+    iterations = 0;
+    lateStarts = 0;
+    missedFires = 0;
+}
+
+bool ScheduleSimulator::run(uint32_t startTime, uint16_t days, uint16_t step) {
+    if (!configManager || !sourceManager || instance != nullptr) {
+        return false;
+    }
+    if (days < 1 || days > 31 || step < 1 || step > 3600) {
+        return false;
+    }
+
+    resetResults();
+    startUnix = startTime;
+    simulatedDays = days;
+    stepSeconds = step;
+    virtualMillisNow = 0;
+    clockOffset = 0;
+
+    // Private copy so the live scheduler and the bus are never touched
+    ScheduleManager* sim = new ScheduleManager();
+    if (!sim) {
+        return false;
+    }
+    sim->begin(configManager, nullptr);
+    sim->copySchedulesFrom(*sourceManager);
+    sim->setClockSource(virtualMillis, virtualUnixTime);
+    sim->setZoneControlCallback(recordActuation);
+    instance = this;
+
+    uint32_t totalSeconds = (uint32_t)days * 86400UL;
+    uint32_t commandsDone = 0; // Bit per command
+    uint32_t stallEnd = 0;     // No passes before this many seconds
+
+    for (uint32_t elapsed = 0; elapsed <= totalSeconds; elapsed += step) {
+        virtualMillisNow = elapsed * 1000UL;
+        if (elapsed < stallEnd) continue;
+
+        // Manual commands due at this point
+        for (uint8_t c = 0; c < commandCount; c++) {
+            if ((commandsDone & (1UL << c)) || commands[c].atMinute * 60UL > elapsed) continue;
+            commandsDone |= (1UL << c);
+
+            if (commands[c].type == SIM_REMOVE_SCHEDULE) {
+                sim->removeSchedule(commands[c].scheduleId);
+            } else if (commands[c].type == SIM_STALL) {
+                stallEnd = elapsed + commands[c].seconds;
+            } else if (commands[c].type == SIM_CLOCK_STEP) {
+                clockOffset += commands[c].seconds;
+            } else if (commands[c].duration == 0) {
+                sim->stopZone(commands[c].zone);
+            } else {
+                ConflictResult result = sim->startZoneManual(commands[c].zone, commands[c].duration);
+                if (result.stoppedZone > 0) {
+                    addConflict(commands[c].zone, result.stoppedZone, true);
+                }
+            }
+        }
+
+        if (elapsed < stallEnd) continue;
+
+        uint8_t pendingBefore = sim->getPendingRunCount();
+        sim->checkAndExecuteSchedules();
+        iterations++;
+
+        // Scheduled runs that had to wait for capacity
+        for (uint8_t i = pendingBefore; i < sim->getPendingRunCount(); i++) {
+            addConflict(sim->getPendingRun(i)->zone, 0, false);
+        }
+
+        sim->processActiveZones();
+    }
+
+    lateStarts = sim->getLateStartCount();
+    missedFires = sim->getMissedFireCount();
+    instance = nullptr;
+    delete sim;
+    return true;
+}
+
+uint32_t ScheduleSimulator::virtualMillis() {
+    return instance ? instance->virtualMillisNow : 0;
+}
+
+uint32_t ScheduleSimulator::virtualUnixTime() {
+    return instance ? instance->startUnix + instance->virtualMillisNow / 1000 + instance->clockOffset : 0;
+}
+
+bool ScheduleSimulator::recordActuation(uint8_t zone, bool state, uint16_t duration, ScheduleType schedType, uint32_t schedId, uint32_t serverId, RunEndReason reason) {
+    if (!instance) return true;
+
+    instance->actuationTotal++;
+    if (instance->actuationCount >= MAX_ACTUATIONS) return true;
+
+    SimActuation& a = instance->actuations[instance->actuationCount++];
+    a.time = virtualUnixTime();
+    a.zone = zone;
+    a.state = state;
+    a.duration = duration;
+    a.type = schedType;
+    a.scheduleId = schedId;
+    a.serverId = serverId;
+    a.reason = reason;
+    return true;
+}
+
+void ScheduleSimulator::addConflict(uint8_t zone, uint8_t otherZone, bool preempted) {
+    conflictTotal++;
+    if (conflictCount >= MAX_CONFLICTS) return;
+
+    SimConflict& c = conflicts[conflictCount++];
+    c.time = virtualUnixTime();
+    c.zone = zone;
+    c.otherZone = otherZone;
+    c.preempted = preempted;
+}
@@ -0,0 +1,118 @@
+#ifndef SCHEDULE_SIMULATOR_H
+#define SCHEDULE_SIMULATOR_H
+
+#include <Arduino.h>
+#include "schedule_manager.h"
+
+// Forward declarations
+class ConfigManager;
+
+// Recorded zone actuation
+struct SimActuation {
+    uint32_t time;          // Simulated unix timestamp (UTC)
+    uint8_t zone;           // Zone number
+    bool state;             // true = start, false = stop
+    uint16_t duration;      // Requested duration in minutes (starts only)
+    ScheduleType type;      // Schedule type passed to the callback
+    uint32_t scheduleId;    // Schedule ID (0 = manual)
+    uint32_t serverId;      // Server-side schedule ID (0 = local)
+    RunEndReason reason;    // Why the run ended (stops only)
+};
+
+// Conflict seen during the replay
+struct SimConflict {
+    uint32_t time;          // Simulated unix timestamp (UTC)
+    uint8_t zone;           // Zone that was affected
+    uint8_t otherZone;      // Zone stopped to make room (preempted only)
+    bool preempted;         // true = manual start stopped a zone, false = scheduled run queued
+};
+
+// Kinds of commands injected into the replay
+enum SimCommandType {
+    SIM_ZONE = 0,           // Start (duration > 0) or stop a zone
+    SIM_REMOVE_SCHEDULE,    // Remove a schedule
+    SIM_STALL,              // Run no scheduler passes for a while
+    SIM_CLOCK_STEP          // Move the wall clock (not millis) by some seconds
+};
+
+// Command injected into the replay
+struct SimCommand {
+    uint32_t atMinute;      // Minutes after simulation start
+    SimCommandType type;
+    uint8_t zone;           // Zone number
+    uint16_t duration;      // Duration in minutes (0 = stop zone)
+    uint32_t scheduleId;    // Schedule to remove
+    int32_t seconds;        // Stall length or clock step
+};
+
+// Replays a schedule set against a virtual clock using a private
+// ScheduleManager copy and records what the zone callback would have done.
+// Host-only: built by the native test environment, never by the firmware.
+class ScheduleSimulator {
+private:
+    static const uint16_t MAX_ACTUATIONS = 200;
+    static const uint8_t MAX_CONFLICTS = 32;
+    static const uint8_t MAX_COMMANDS = 16;
+
+    ConfigManager* configManager;
+    ScheduleManager* sourceManager;
+
+    SimCommand commands[MAX_COMMANDS];
+    uint8_t commandCount;
+
+    // Results
+    SimActuation actuations[MAX_ACTUATIONS];
+    uint16_t actuationCount;
+    uint32_t actuationTotal;        // Including entries that did not fit
+    SimConflict conflicts[MAX_CONFLICTS];
+    uint8_t conflictCount;
+    uint32_t conflictTotal;
+    uint32_t startUnix;
+    uint16_t simulatedDays;
+    uint16_t stepSeconds;
+    uint32_t iterations;            // Scheduler passes run
+
+    uint32_t lateStarts;            // Scheduler counters at the end of the replay
+    uint32_t missedFires;
+
+    // Virtual clock
+    uint32_t virtualMillisNow;
+    int32_t clockOffset;            // Sum of the clock steps so far
+
+    static ScheduleSimulator* instance;
+    static uint32_t virtualMillis();
+    static uint32_t virtualUnixTime();
+    static bool recordActuation(uint8_t zone, bool state, uint16_t duration, ScheduleType schedType, uint32_t schedId, uint32_t serverId, RunEndReason reason);
+
+    void addConflict(uint8_t zone, uint8_t otherZone, bool preempted);
+    void resetResults();
+
+public:
+    ScheduleSimulator();
+
+    // Initialization
+    bool begin(ConfigManager* config, ScheduleManager* source);
+
+    // Manual commands replayed alongside the schedules
+    bool addCommand(uint32_t atMinute, uint8_t zone, uint16_t duration);
+    bool addScheduleRemoval(uint32_t atMinute, uint32_t scheduleId);
+    bool addStall(uint32_t atMinute, uint16_t minutes);
+    bool addClockStep(uint32_t atMinute, int32_t seconds);
+    void clearCommands() { commandCount = 0; }
+
+    // Run the replay (1-31 days, step 1-3600 seconds)
+    bool run(uint32_t startTime, uint16_t days, uint16_t step = 60);
+
+    // Results; only the first MAX_ACTUATIONS and MAX_CONFLICTS are kept
+    uint16_t getActuationCount() const { return actuationCount; }
+    const SimActuation& getActuation(uint16_t index) const { return actuations[index]; }
+    uint32_t getActuationTotal() const { return actuationTotal; }
+    uint8_t getConflictCount() const { return conflictCount; }
+    const SimConflict& getConflict(uint8_t index) const { return conflicts[index]; }
+    uint32_t getConflictTotal() const { return conflictTotal; }
+    uint32_t getIterations() const { return iterations; }
+    uint32_t getLateStarts() const { return lateStarts; }
+    uint32_t getMissedFires() const { return missedFires; }
+};
+
+#endif // SCHEDULE_SIMULATOR_H
@@ -0,0 +1,228 @@
+#include <unity.h>
+#include "config_manager.h"
+#include "schedule_manager.h"
+#include "schedule_simulator.h"
+
+// Replays of small schedule sets on a virtual clock. Times in the checks are
+// local minutes after the replay start, which is local midnight of a Monday.
+
+static ConfigManager* config;
+static ScheduleManager* schedules;
+static ScheduleSimulator* simulator;
+static uint32_t startUtc;
+
+static uint32_t localMinute(uint32_t utc) {
+    return (utc - startUtc) / 60;
+}
+
+void setUp() {
+    Serial.muted = true;
+    config = new ConfigManager();
+    config->begin(nullptr);
+    schedules = new ScheduleManager();
+    schedules->begin(config, nullptr);
+    simulator = new ScheduleSimulator();
+    simulator->begin(config, schedules);
+
+    int offsetSeconds = config->getTimezoneOffset() * 1800 + (config->isDaylightSaving() ? 3600 : 0);
+    startUtc = DateTime(2026, 1, 5).unixtime() - offsetSeconds;
+}
+
+void tearDown() {
+    delete simulator;
+    delete schedules;
+    delete config;
+}
+
+void test_weekly_schedule_fires_every_selected_day() {
+    // Monday and Wednesday at 06:00 for 20 minutes
+    TEST_ASSERT_NOT_EQUAL(0, schedules->addBasicSchedule(1, 0x0A, 6, 0, 20));
+    TEST_ASSERT_TRUE(simulator->run(startUtc, 7));
+
+    TEST_ASSERT_EQUAL_UINT16(4, simulator->getActuationCount());
+    const uint32_t expected[] = {6 * 60, 6 * 60 + 20, 2 * 1440 + 6 * 60, 2 * 1440 + 6 * 60 + 20};
+    for (uint16_t i = 0; i < 4; i++) {
+        const SimActuation& a = simulator->getActuation(i);
+        TEST_ASSERT_EQUAL_UINT8(1, a.zone);
+        TEST_ASSERT_EQUAL(i % 2 == 0, a.state);
+        TEST_ASSERT_EQUAL_UINT32(expected[i], localMinute(a.time));
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, simulator->getConflictTotal());
+}
+
+void test_run_over_capacity_waits_for_a_free_zone() {
+    // Server schedules are taken as sent, so a third zone at 06:00 is accepted
+    // and has to wait for one of the first two (2 zones without a supply capacity)
+    TEST_ASSERT_NOT_EQUAL(0, schedules->addAISchedule(1, 0x02, 6, 0, 30, 0, 101));
+    TEST_ASSERT_NOT_EQUAL(0, schedules->addAISchedule(2, 0x02, 6, 0, 30, 0, 102));
+    TEST_ASSERT_NOT_EQUAL(0, schedules->addAISchedule(3, 0x02, 6, 0, 10, 0, 103));
+    TEST_ASSERT_TRUE(simulator->run(startUtc, 1));
+
+    TEST_ASSERT_EQUAL_UINT32(1, simulator->getConflictTotal());
+    TEST_ASSERT_FALSE(simulator->getConflict(0).preempted);
+    TEST_ASSERT_EQUAL_UINT8(3, simulator->getConflict(0).zone);
+
+    bool zone3Started = false;
+    for (uint16_t i = 0; i < simulator->getActuationCount(); i++) {
+        const SimActuation& a = simulator->getActuation(i);
+        if (a.zone == 3 && a.state) {
+            zone3Started = true;
+            TEST_ASSERT_EQUAL_UINT32(6 * 60 + 30, localMinute(a.time));
+            TEST_ASSERT_EQUAL_UINT32(103, a.serverId);
+        }
+    }
+    TEST_ASSERT_TRUE(zone3Started);
+}
+
+void test_removed_schedule_drops_its_queued_run() {
+    TEST_ASSERT_NOT_EQUAL(0, schedules->addAISchedule(1, 0x02, 6, 0, 30, 0, 101));
+    TEST_ASSERT_NOT_EQUAL(0, schedules->addAISchedule(2, 0x02, 6, 0, 30, 0, 102));
+    uint32_t queuedId = schedules->addAISchedule(3, 0x02, 6, 0, 10, 0, 103);
+    TEST_ASSERT_NOT_EQUAL(0, queuedId);
+    TEST_ASSERT_TRUE(simulator->addScheduleRemoval(6 * 60 + 10, queuedId));
+    TEST_ASSERT_TRUE(simulator->run(startUtc, 1));
+
+    TEST_ASSERT_EQUAL_UINT32(1, simulator->getConflictTotal());
+    for (uint16_t i = 0; i < simulator->getActuationCount(); i++) {
+        TEST_ASSERT_NOT_EQUAL(3, simulator->getActuation(i).zone);
+    }
+}
+
+void test_manual_start_preempts_a_scheduled_zone() {
+    TEST_ASSERT_NOT_EQUAL(0, schedules->addBasicSchedule(1, 0x02, 6, 0, 60));
+    TEST_ASSERT_NOT_EQUAL(0, schedules->addBasicSchedule(2, 0x02, 6, 0, 60));
+    TEST_ASSERT_TRUE(simulator->addCommand(6 * 60 + 10, 3, 15));
+    TEST_ASSERT_TRUE(simulator->run(startUtc, 1));
+
+    TEST_ASSERT_EQUAL_UINT32(1, simulator->getConflictTotal());
+    const SimConflict& conflict = simulator->getConflict(0);
+    TEST_ASSERT_TRUE(conflict.preempted);
+    TEST_ASSERT_EQUAL_UINT8(3, conflict.zone);
+    TEST_ASSERT_TRUE(conflict.otherZone == 1 || conflict.otherZone == 2);
+    TEST_ASSERT_EQUAL_UINT32(6 * 60 + 10, localMinute(conflict.time));
+
+    // The preempted run ends with its own reason, the others run out
+    for (uint16_t i = 0; i < simulator->getActuationCount(); i++) {
+        const SimActuation& a = simulator->getActuation(i);
+        if (a.state) continue;
+        TEST_ASSERT_EQUAL(a.zone == conflict.otherZone ? RUN_PREEMPTED : RUN_COMPLETED, a.reason);
+    }
+}
+
+void test_expired_server_schedule_never_fires() {
+    TEST_ASSERT_NOT_EQUAL(0, schedules->addAISchedule(1, 0x7F, 6, 0, 20, startUtc + 3600, 201));
+    TEST_ASSERT_TRUE(simulator->run(startUtc, 3));
+
+    TEST_ASSERT_EQUAL_UINT32(0, simulator->getActuationTotal());
+}
+
+void test_replay_leaves_the_source_schedules_alone() {
+    TEST_ASSERT_NOT_EQUAL(0, schedules->addBasicSchedule(1, 0x7F, 6, 0, 20));
+    uint32_t revision = schedules->getRevision();
+    TEST_ASSERT_TRUE(simulator->run(startUtc, 2));
+
+    TEST_ASSERT_EQUAL_UINT32(revision, schedules->getRevision());
+    TEST_ASSERT_FALSE(schedules->hasActiveZones());
+}
+
+void test_dated_schedules_a_week_apart_do_not_overlap() {
+    // Same zone, Monday 06:00, on two consecutive Mondays
+    uint32_t firstDayEnd = startUtc + 2 * 86400;
+    TEST_ASSERT_NOT_EQUAL(0, schedules->addAISchedule(1, 0x02, 6, 0, 30, firstDayEnd, 301));
+    TEST_ASSERT_NOT_EQUAL(0, schedules->addAISchedule(1, 0x02, 6, 0, 30, firstDayEnd + 7 * 86400, 302));
+    TEST_ASSERT_EQUAL_UINT16(0, schedules->findConflicts(nullptr, 0));
+
+    // The same day twice still is one
+    TEST_ASSERT_NOT_EQUAL(0, schedules->addAISchedule(1, 0x02, 6, 15, 30, firstDayEnd, 303));
+    TEST_ASSERT_NOT_EQUAL(0, schedules->findConflicts(nullptr, 0));
+}
+
+// Starts of a zone and the minute of the first one (UINT32_MAX if none)
+static uint16_t countStarts(uint8_t zone, uint32_t* firstMinute) {
+    uint16_t starts = 0;
+    *firstMinute = UINT32_MAX;
+    for (uint16_t i = 0; i < simulator->getActuationCount(); i++) {
+        const SimActuation& a = simulator->getActuation(i);
+        if (a.zone != zone || !a.state) continue;
+        if (starts++ == 0) *firstMinute = localMinute(a.time);
+    }
+    return starts;
+}
+
+void test_stall_within_grace_fires_late_once() {
+    // Loop blocked from 05:55 to 06:15: 15 minutes late is still within the grace window
+    TEST_ASSERT_EQUAL(15, config->getMissedFireGraceMinutes());
+    TEST_ASSERT_NOT_EQUAL(0, schedules->addBasicSchedule(1, 0x02, 6, 0, 20));
+    TEST_ASSERT_TRUE(simulator->addStall(5 * 60 + 55, 20));
+    TEST_ASSERT_TRUE(simulator->run(startUtc, 1));
+
+    uint32_t firstMinute;
+    TEST_ASSERT_EQUAL_UINT16(1, countStarts(1, &firstMinute));
+    TEST_ASSERT_EQUAL_UINT32(6 * 60 + 15, firstMinute);
+    TEST_ASSERT_EQUAL_UINT32(1, simulator->getLateStarts());
+    TEST_ASSERT_EQUAL_UINT32(0, simulator->getMissedFires());
+}
+
+void test_stall_past_grace_skips_the_fire() {
+    // One minute more and the 06:00 fire is skipped and counted instead
+    TEST_ASSERT_NOT_EQUAL(0, schedules->addBasicSchedule(1, 0x02, 6, 0, 20));
+    TEST_ASSERT_TRUE(simulator->addStall(5 * 60 + 55, 21));
+    TEST_ASSERT_TRUE(simulator->run(startUtc, 1));
+
+    uint32_t firstMinute;
+    TEST_ASSERT_EQUAL_UINT16(0, countStarts(1, &firstMinute));
+    TEST_ASSERT_EQUAL_UINT32(0, simulator->getLateStarts());
+    TEST_ASSERT_EQUAL_UINT32(1, simulator->getMissedFires());
+}
+
+void test_clock_stepping_back_does_not_fire_twice() {
+    // At 06:10 the clock is set back half an hour, so 06:00 comes round again
+    TEST_ASSERT_NOT_EQUAL(0, schedules->addBasicSchedule(1, 0x02, 6, 0, 20));
+    TEST_ASSERT_TRUE(simulator->addClockStep(6 * 60 + 10, -30 * 60));
+    TEST_ASSERT_TRUE(simulator->run(startUtc, 1));
+
+    uint32_t firstMinute;
+    TEST_ASSERT_EQUAL_UINT16(1, countStarts(1, &firstMinute));
+    TEST_ASSERT_EQUAL_UINT32(6 * 60, firstMinute);
+    TEST_ASSERT_EQUAL_UINT32(0, simulator->getLateStarts());
+    TEST_ASSERT_EQUAL_UINT32(0, simulator->getMissedFires());
+}
+
+static bool refuseCommand(uint8_t, bool, uint16_t, ScheduleType, uint32_t, uint32_t, RunEndReason) {
+    return false;
+}
+
+void test_refused_start_leaves_the_zone_idle() {
+    schedules->setZoneControlCallback(refuseCommand);
+
+    ConflictResult result = schedules->startZoneManual(4, 10);
+    TEST_ASSERT_TRUE(result.hasConflict);
+    TEST_ASSERT_EQUAL_UINT8(0, result.stoppedZone);
+    TEST_ASSERT_FALSE(schedules->hasActiveZones());
+}
+
+void test_unconfirmed_stop_keeps_the_zone_active() {
+    schedules->setZoneStopPending(5, true);
+    TEST_ASSERT_TRUE(schedules->isZoneStopPending(5));
+    TEST_ASSERT_TRUE(schedules->hasActiveZones());
+
+    schedules->setZoneStopPending(5, false);
+    TEST_ASSERT_FALSE(schedules->hasActiveZones());
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_weekly_schedule_fires_every_selected_day);
+    RUN_TEST(test_run_over_capacity_waits_for_a_free_zone);
+    RUN_TEST(test_removed_schedule_drops_its_queued_run);
+    RUN_TEST(test_manual_start_preempts_a_scheduled_zone);
+    RUN_TEST(test_expired_server_schedule_never_fires);
+    RUN_TEST(test_replay_leaves_the_source_schedules_alone);
+    RUN_TEST(test_dated_schedules_a_week_apart_do_not_overlap);
+    RUN_TEST(test_stall_within_grace_fires_late_once);
+    RUN_TEST(test_stall_past_grace_skips_the_fire);
+    RUN_TEST(test_clock_stepping_back_does_not_fire_twice);
+    RUN_TEST(test_refused_start_leaves_the_zone_idle);
+    RUN_TEST(test_unconfirmed_stop_keeps_the_zone_active);
+    return UNITY_END();
+}